@@ -0,0 +1,536 @@
+// Micro-benchmarks for the plasma_physics.c kernels
+//
+// Reports ns/call and calls/s for each model function, for a full
+// advance_plasma_state() step over batches of shots (and the
+// advance_plasma_batch() equivalent), and a per-call latency distribution
+// of the control-cycle step against the real-time budget. --json writes
+// the same results in a machine-readable form for regression tracking.
+//
+// Before timing, both confinement_scaling.h modes are checked against the
+// double-precision law at known worst-case points and over a seeded sweep
+// of the documented input range; a bound beyond TAU_E_*_MAX_ULP exits 2.
+//
+// Build with the flags the batch stepper expects (see plasma_batch.h):
+//        gcc -O3 -fno-math-errno -fno-trapping-math -I.. plasma_physics_bench.c
+//            ../plasma_physics.c ../plasma_rng.c ../plasma_batch.c
+//            ../confinement_scaling.c -lm -lpthread -o plasma_physics_bench
+// Run:   ./plasma_physics_bench --min-time 0.5 --cpu 3 --json bench.json
+
+#define _GNU_SOURCE
+#include "confinement_scaling.h"
+#include "plasma_batch.h"
+#include "plasma_physics.h"
+#include "plasma_rng.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// ================= BENCHMARK PARAMETERS =================
+#define BENCH_INPUT_POOL 1024             // power of two
+#define BENCH_MAX_RESULTS 32
+#define BENCH_MIN_TIME_DEFAULT 0.2        // s per benchmark
+#define BENCH_LATENCY_SAMPLES 200000
+#define BENCH_LATENCY_WARMUP 10000
+#define BENCH_STEP_DT 1e-3f
+#define BENCH_CYCLE_BUDGET_NS 1000000.0   // 1 kHz control loop
+#define BENCH_TAU_E_SAMPLES 1000000
+
+static const uint32_t batch_sizes[] = { 1, 16, 256, 4096 };
+#define BENCH_NUM_BATCH_SIZES (sizeof(batch_sizes) / sizeof(batch_sizes[0]))
+
+typedef struct {
+    // Scalar kernel inputs, drawn once so no call sees constant arguments
+    float R[BENCH_INPUT_POOL];
+    float Z[BENCH_INPUT_POOL];
+    float r[BENCH_INPUT_POOL];
+    float w[BENCH_INPUT_POOL];
+    float power[BENCH_INPUT_POOL];
+    float frequency[BENCH_INPUT_POOL];
+    PlasmaState states[BENCH_INPUT_POOL];
+    float coil_currents[NUM_PF_COILS];
+    float gs_params[4];
+    float deposition[10];
+
+    // Stepping benchmarks
+    uint32_t shots;
+    PlasmaState *step_states;
+    PlasmaControlSystem *step_controls;
+    PlasmaBatch batch;
+
+    volatile float sink;
+} BenchContext;
+
+typedef void (*BenchFn)(BenchContext *ctx, uint64_t iterations);
+
+typedef struct {
+    char name[64];
+    uint32_t batch;                 // calls per iteration
+    uint64_t iterations;
+    double seconds;
+    double ns_per_call;
+    double calls_per_second;
+} BenchResult;
+
+typedef struct {
+    uint32_t samples;
+    double timer_overhead_ns;
+    double p50_ns;
+    double p99_ns;
+    double p999_ns;
+    double max_ns;
+    double mean_ns;
+    uint32_t over_budget;
+} LatencyResult;
+
+static inline double now_seconds(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + 1e-9 * (double)t.tv_nsec;
+}
+
+static inline int64_t now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// ================= INPUTS =================
+
+static void init_shot(PlasmaState *s, PlasmaControlSystem *c, PlasmaRng *rng,
+                      uint64_t shot) {
+    memset(s, 0, sizeof(*s));
+    memset(c, 0, sizeof(*c));
+    plasma_rng_seed(&c->rng, 1, shot);
+    s->plasma_current = 1.0f + 14.0f * plasma_rng_uniform(rng);
+    s->elongation = 1.5f + 0.4f * plasma_rng_uniform(rng);
+    s->triangularity = 0.33f;
+    s->density_core = 5.0f + 5.0f * plasma_rng_uniform(rng);
+    s->temperature_core = 5.0f + 10.0f * plasma_rng_uniform(rng);
+    s->vertical_position = 0.0f;
+    c->pf_coil_currents[0] = 10.0f * s->plasma_current;
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        c->heating_systems[h].power = 0.4f;
+        c->heating_systems[h].frequency = 170.0e9f;
+        c->heating_systems[h].enabled = true;
+    }
+    c->fuel_injection_rate = 1e21f;
+    c->energy_confinement_time = ENERGY_CONFINEMENT_TIME;
+    c->stored_energy = 1.0f;
+}
+
+static int init_context(BenchContext *ctx, uint32_t max_shots) {
+    PlasmaRng rng;
+    plasma_rng_seed(&rng, 12345, 0);
+    const MachineGeometry *m = &machine_default;
+    for (int i = 0; i < BENCH_INPUT_POOL; i++) {
+        float u = plasma_rng_uniform(&rng), v = plasma_rng_uniform(&rng);
+        ctx->R[i] = m->major_radius + m->minor_radius * (2.0f * u - 1.0f);
+        ctx->Z[i] = m->minor_radius * (2.0f * v - 1.0f);
+        ctx->r[i] = plasma_rng_uniform(&rng);
+        ctx->w[i] = 0.01f + 0.1f * plasma_rng_uniform(&rng);
+        ctx->power[i] = 0.1f + 20.0f * plasma_rng_uniform(&rng);
+        ctx->frequency[i] = 140.0e9f + 60.0e9f * plasma_rng_uniform(&rng);
+        PlasmaControlSystem unused;
+        init_shot(&ctx->states[i], &unused, &rng, (uint64_t)i);
+    }
+    for (int c = 0; c < NUM_PF_COILS; c++) ctx->coil_currents[c] = 1e4f * (c + 1);
+    ctx->gs_params[0] = 1.0f;
+
+    ctx->shots = max_shots;
+    ctx->step_states = calloc(max_shots, sizeof(PlasmaState));
+    ctx->step_controls = calloc(max_shots, sizeof(PlasmaControlSystem));
+    if (!ctx->step_states || !ctx->step_controls ||
+        plasma_batch_init(&ctx->batch, max_shots) != 0) {
+        return -1;
+    }
+    for (uint32_t k = 0; k < max_shots; k++) {
+        init_shot(&ctx->step_states[k], &ctx->step_controls[k], &rng, k);
+        plasma_batch_load(&ctx->batch, k, &ctx->step_states[k],
+                          &ctx->step_controls[k]);
+    }
+    return 0;
+}
+
+// ================= KERNELS =================
+
+#define POOL(i) ((uint32_t)(i) & (BENCH_INPUT_POOL - 1))
+
+static void bench_grad_shafranov(BenchContext *ctx, uint64_t iterations) {
+    float acc = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        acc += grad_shafranov_solution(ctx->R[POOL(i)], ctx->Z[POOL(i)],
+                                       ctx->gs_params);
+    }
+    ctx->sink = acc;
+}
+
+static void bench_safety_factor(BenchContext *ctx, uint64_t iterations) {
+    float acc = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        acc += safety_factor_profile(ctx->r[POOL(i)], &ctx->states[POOL(i)]);
+    }
+    ctx->sink = acc;
+}
+
+static void bench_beta_normalized(BenchContext *ctx, uint64_t iterations) {
+    float acc = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        acc += calculate_beta_normalized(&ctx->states[POOL(i)]);
+    }
+    ctx->sink = acc;
+}
+
+static void bench_ntm_island(BenchContext *ctx, uint64_t iterations) {
+    float acc = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        acc += ntm_island_growth(ctx->w[POOL(i)], 0.1f, -0.5f, 0.2f, 0.1f,
+                                 BENCH_STEP_DT);
+    }
+    ctx->sink = acc;
+}
+
+static void bench_ecrh_heating(BenchContext *ctx, uint64_t iterations) {
+    float acc = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        acc += ecrh_heating_model(ctx->power[POOL(i)], ctx->frequency[POOL(i)],
+                                  &ctx->states[POOL(i)], ctx->deposition);
+    }
+    ctx->sink = acc + ctx->deposition[5];
+}
+
+static void bench_confinement_time(BenchContext *ctx, uint64_t iterations) {
+    float acc = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        acc += energy_confinement_time(&ctx->states[POOL(i)], ctx->power[POOL(i)]);
+    }
+    ctx->sink = acc;
+}
+
+static void bench_disruption_forces(BenchContext *ctx, uint64_t iterations) {
+    float acc = 0.0f;
+    for (uint64_t i = 0; i < iterations; i++) {
+        acc += calculate_disruption_forces(&ctx->states[POOL(i)],
+                                           ctx->coil_currents);
+    }
+    ctx->sink = acc;
+}
+
+// One iteration steps ctx->shots shots, so calls = iterations * shots
+static void bench_advance_state(BenchContext *ctx, uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (uint32_t k = 0; k < ctx->shots; k++) {
+            advance_plasma_state(&ctx->step_states[k], &ctx->step_controls[k],
+                                 BENCH_STEP_DT);
+        }
+    }
+    ctx->sink = ctx->step_states[0].temperature_core;
+}
+
+static void bench_advance_batch(BenchContext *ctx, uint64_t iterations) {
+    ctx->batch.count = ctx->shots;
+    for (uint64_t i = 0; i < iterations; i++) {
+        advance_plasma_batch(&ctx->batch, BENCH_STEP_DT);
+    }
+    ctx->sink = ctx->batch.temperature_core[0];
+}
+
+// ================= ACCURACY =================
+
+// Inputs (Ip, density_core, kappa, P) where a kernel once exceeded its bound
+static const float tau_e_regressions[][4] = {
+    // 17 ULP in TAU_E_FAST without FMA when the log terms were summed in float
+    { 0.266219944f, 0.258272976f, 1.95000243f, 199.477692f },
+};
+
+// Distance in representable floats
+static uint32_t ulp_distance(float a, float b) {
+    int32_t ia, ib;
+    memcpy(&ia, &a, sizeof(ia));
+    memcpy(&ib, &b, sizeof(ib));
+    int64_t oa = ia < 0 ? (int64_t)INT32_MIN - ia : ia;
+    int64_t ob = ib < 0 ? (int64_t)INT32_MIN - ib : ib;
+    return (uint32_t)(oa > ob ? oa - ob : ob - oa);
+}
+
+static float tau_e_reference(const TauEScaling *law, const float *x) {
+    return (float)exp2(law->log2_coefficient +
+                       (double)law->exponent_current * log2(x[0]) +
+                       (double)law->exponent_density * log2(x[1]) +
+                       (double)law->exponent_elongation * log2(x[2]) +
+                       (double)law->exponent_power * log2(x[3]));
+}
+
+// Log-uniform in [lo, hi]
+static float draw_log(PlasmaRng *rng, float lo, float hi) {
+    return lo * powf(hi / lo, plasma_rng_uniform(rng));
+}
+
+// Worst error of each mode over the regression points and the sweep;
+// returns -1 if either is beyond its documented bound
+static int check_tau_e_accuracy(void) {
+    TauEScaling law;
+    tau_e_scaling_init(&law, &machine_default);
+    static const TauEMode modes[] = { TAU_E_ACCURATE, TAU_E_FAST };
+    static const uint32_t bounds[] = { TAU_E_ACCURATE_MAX_ULP, TAU_E_FAST_MAX_ULP };
+    static const char *const names[] = { "accurate", "fast" };
+    uint32_t worst[2] = { 0, 0 };
+    uint32_t num_points = sizeof(tau_e_regressions) / sizeof(tau_e_regressions[0]);
+    PlasmaRng rng;
+    plasma_rng_seed(&rng, 12345, 1);
+    for (uint32_t i = 0; i < num_points + BENCH_TAU_E_SAMPLES; i++) {
+        float drawn[4];
+        const float *x = drawn;
+        if (i < num_points) {
+            x = tau_e_regressions[i];
+        } else {
+            drawn[0] = draw_log(&rng, 0.1f, 30.0f);
+            drawn[1] = draw_log(&rng, 0.1f, 30.0f);
+            drawn[2] = 1.0f + 1.5f * plasma_rng_uniform(&rng);
+            drawn[3] = draw_log(&rng, 0.1f, 200.0f);
+        }
+        float reference = tau_e_reference(&law, x);
+        for (int m = 0; m < 2; m++) {
+            float tau = tau_e_evaluate(&law, modes[m], x[0], x[1], x[2], x[3]);
+            uint32_t ulp = ulp_distance(tau, reference);
+            if (ulp > worst[m]) worst[m] = ulp;
+            if (i < num_points && ulp > bounds[m]) {
+                fprintf(stderr, "tau_e %s: %u ULP at regression point %u\n",
+                        names[m], ulp, i);
+            }
+        }
+    }
+    int status = 0;
+    for (int m = 0; m < 2; m++) {
+        printf("tau_e_evaluate %-8s worst %u ULP (bound %u)\n", names[m],
+               worst[m], bounds[m]);
+        if (worst[m] > bounds[m]) status = -1;
+    }
+    return status;
+}
+
+// ================= HARNESS =================
+
+// Doubles the iteration count (or jumps by the measured rate) until one
+// timed run lasts at least min_time
+static void run_bench(BenchContext *ctx, const char *name, BenchFn fn,
+                      uint32_t batch, double min_time, BenchResult *result) {
+    fn(ctx, 1);
+    uint64_t iterations = 1;
+    double elapsed = 0.0;
+    for (;;) {
+        double t0 = now_seconds();
+        fn(ctx, iterations);
+        elapsed = now_seconds() - t0;
+        if (elapsed >= min_time) break;
+        double scale = elapsed > 0.0 ? 1.4 * min_time / elapsed : 10.0;
+        if (scale < 2.0) scale = 2.0;
+        if (scale > 100.0) scale = 100.0;
+        iterations = (uint64_t)((double)iterations * scale);
+    }
+    snprintf(result->name, sizeof(result->name), "%s", name);
+    result->batch = batch;
+    result->iterations = iterations;
+    result->seconds = elapsed;
+    double calls = (double)iterations * batch;
+    result->ns_per_call = elapsed * 1e9 / calls;
+    result->calls_per_second = calls / elapsed;
+    printf("%-32s %6u %12llu %10.2f %14.4g\n", result->name, batch,
+           (unsigned long long)iterations, result->ns_per_call,
+           result->calls_per_second);
+}
+
+static int compare_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of sorted samples
+static double percentile(const int64_t *sorted, uint32_t n, double p) {
+    uint32_t rank = (uint32_t)(p / 100.0 * n + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > n) rank = n;
+    return (double)sorted[rank - 1];
+}
+
+// Per-call latency of the single-shot control-cycle step. The back-to-back
+// clock_gettime() cost is measured the same way and subtracted.
+static int measure_latency(BenchContext *ctx, LatencyResult *result) {
+    int64_t *samples = malloc(BENCH_LATENCY_SAMPLES * sizeof(int64_t));
+    if (!samples) return -1;
+    PlasmaState *s = &ctx->step_states[0];
+    PlasmaControlSystem *c = &ctx->step_controls[0];
+
+    for (uint32_t i = 0; i < BENCH_LATENCY_SAMPLES; i++) {
+        int64_t t0 = now_ns();
+        samples[i] = now_ns() - t0;
+    }
+    qsort(samples, BENCH_LATENCY_SAMPLES, sizeof(int64_t), compare_i64);
+    double overhead = percentile(samples, BENCH_LATENCY_SAMPLES, 50.0);
+
+    for (uint32_t i = 0; i < BENCH_LATENCY_WARMUP; i++) {
+        advance_plasma_state(s, c, BENCH_STEP_DT);
+    }
+    double sum = 0.0;
+    result->over_budget = 0;
+    for (uint32_t i = 0; i < BENCH_LATENCY_SAMPLES; i++) {
+        int64_t t0 = now_ns();
+        advance_plasma_state(s, c, BENCH_STEP_DT);
+        int64_t dt_ns = now_ns() - t0 - (int64_t)overhead;
+        samples[i] = dt_ns > 0 ? dt_ns : 0;
+        sum += (double)samples[i];
+        if (samples[i] > BENCH_CYCLE_BUDGET_NS) result->over_budget++;
+    }
+    qsort(samples, BENCH_LATENCY_SAMPLES, sizeof(int64_t), compare_i64);
+    result->samples = BENCH_LATENCY_SAMPLES;
+    result->timer_overhead_ns = overhead;
+    result->p50_ns = percentile(samples, BENCH_LATENCY_SAMPLES, 50.0);
+    result->p99_ns = percentile(samples, BENCH_LATENCY_SAMPLES, 99.0);
+    result->p999_ns = percentile(samples, BENCH_LATENCY_SAMPLES, 99.9);
+    result->max_ns = (double)samples[BENCH_LATENCY_SAMPLES - 1];
+    result->mean_ns = sum / BENCH_LATENCY_SAMPLES;
+    free(samples);
+    return 0;
+}
+
+static int write_json(const char *path, double min_time,
+                      const BenchResult *results, int count,
+                      const LatencyResult *latency) {
+    FILE *out = fopen(path, "w");
+    if (!out) return -1;
+    time_t now = time(NULL);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%s\",\n", date);
+    fprintf(out, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "    \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(out, "    \"min_time_s\": %g,\n", min_time);
+    fprintf(out, "    \"step_dt_s\": %g\n  },\n", (double)BENCH_STEP_DT);
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (int i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"batch\": %u, \"iterations\": %llu, "
+                     "\"ns_per_call\": %.4f, \"calls_per_second\": %.6g}%s\n",
+                r->name, r->batch, (unsigned long long)r->iterations,
+                r->ns_per_call, r->calls_per_second, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"latency\": {\n");
+    fprintf(out, "    \"name\": \"advance_plasma_state\",\n");
+    fprintf(out, "    \"samples\": %u,\n", latency->samples);
+    fprintf(out, "    \"timer_overhead_ns\": %.1f,\n", latency->timer_overhead_ns);
+    fprintf(out, "    \"mean_ns\": %.1f,\n", latency->mean_ns);
+    fprintf(out, "    \"p50_ns\": %.1f,\n", latency->p50_ns);
+    fprintf(out, "    \"p99_ns\": %.1f,\n", latency->p99_ns);
+    fprintf(out, "    \"p999_ns\": %.1f,\n", latency->p999_ns);
+    fprintf(out, "    \"max_ns\": %.1f,\n", latency->max_ns);
+    fprintf(out, "    \"budget_ns\": %.1f,\n", BENCH_CYCLE_BUDGET_NS);
+    fprintf(out, "    \"over_budget\": %u\n  }\n}\n", latency->over_budget);
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--min-time S] [--cpu N] [--json FILE]\n"
+            "  --min-time  minimum timed run per benchmark (default %g s)\n"
+            "  --cpu       pin to this CPU (default: no pinning)\n"
+            "  --json      also write the results as JSON\n",
+            prog, BENCH_MIN_TIME_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+    double min_time = BENCH_MIN_TIME_DEFAULT;
+    int cpu = -1;
+    const char *json_path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--min-time") == 0) {
+            min_time = strtod(argv[++i], NULL);
+        } else if (i + 1 < argc && strcmp(argv[i], "--cpu") == 0) {
+            cpu = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--json") == 0) {
+            json_path = argv[++i];
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (min_time <= 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) fprintf(stderr, "warning: cannot pin to CPU %d\n", cpu);
+    }
+
+    if (check_tau_e_accuracy() != 0) {
+        fprintf(stderr, "tau_e_evaluate exceeds its documented error bound\n");
+        return 2;
+    }
+    printf("\n");
+
+    static BenchContext ctx;
+    uint32_t max_shots = batch_sizes[BENCH_NUM_BATCH_SIZES - 1];
+    if (init_context(&ctx, max_shots) != 0) {
+        fprintf(stderr, "cannot allocate %u shots\n", max_shots);
+        return 1;
+    }
+
+    static const struct {
+        const char *name;
+        BenchFn fn;
+    } kernels[] = {
+        { "grad_shafranov_solution", bench_grad_shafranov },
+        { "safety_factor_profile", bench_safety_factor },
+        { "calculate_beta_normalized", bench_beta_normalized },
+        { "ntm_island_growth", bench_ntm_island },
+        { "ecrh_heating_model", bench_ecrh_heating },
+        { "energy_confinement_time", bench_confinement_time },
+        { "calculate_disruption_forces", bench_disruption_forces },
+    };
+
+    BenchResult results[BENCH_MAX_RESULTS];
+    int count = 0;
+    printf("%-32s %6s %12s %10s %14s\n", "benchmark", "batch", "iterations",
+           "ns/call", "calls/s");
+    for (size_t k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++) {
+        run_bench(&ctx, kernels[k].name, kernels[k].fn, 1, min_time,
+                  &results[count++]);
+    }
+    for (size_t b = 0; b < BENCH_NUM_BATCH_SIZES; b++) {
+        char name[64];
+        ctx.shots = batch_sizes[b];
+        snprintf(name, sizeof(name), "advance_plasma_state/%u", ctx.shots);
+        run_bench(&ctx, name, bench_advance_state, ctx.shots, min_time,
+                  &results[count++]);
+        snprintf(name, sizeof(name), "advance_plasma_batch/%u", ctx.shots);
+        run_bench(&ctx, name, bench_advance_batch, ctx.shots, min_time,
+                  &results[count++]);
+    }
+
+    LatencyResult latency;
+    if (measure_latency(&ctx, &latency) != 0) return 1;
+    printf("\nadvance_plasma_state latency, %u samples (timer overhead %.0f ns "
+           "subtracted):\n", latency.samples, latency.timer_overhead_ns);
+    printf("  mean %.0f ns  p50 %.0f ns  p99 %.0f ns  p99.9 %.0f ns  max %.0f ns\n",
+           latency.mean_ns, latency.p50_ns, latency.p99_ns, latency.p999_ns,
+           latency.max_ns);
+    printf("  over the %.0f us budget: %u\n", BENCH_CYCLE_BUDGET_NS / 1e3,
+           latency.over_budget);
+
+    if (json_path && write_json(json_path, min_time, results, count, &latency) != 0) {
+        fprintf(stderr, "cannot write %s\n", json_path);
+        return 1;
+    }
+    plasma_batch_free(&ctx.batch);
+    free(ctx.step_states);
+    free(ctx.step_controls);
+    return 0;
+}
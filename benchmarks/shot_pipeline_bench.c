@@ -0,0 +1,746 @@
+// Macro-benchmark of the full shot pipeline
+//
+// Runs canonical scenarios end to end through the control cycle that
+// npe_psq_core_sim.c runs, from control_cycle.h (actuator laws,
+// advance_plasma_state(), the MHD warning, predictor, mitigation selection
+// and actuators, the controller state machine and the analytic TQ/CQ of
+// disruption_quench.h), back to back with no real-time pacing:
+//
+//   ramp_up     INIT to flat-top entry
+//   flat_top    the whole shot: ramp-up, SCENARIO_FLAT_TOP_TIME of
+//               flat-top, ramp-down to SAFE_SHUTDOWN
+//   ntm         a seed island grown by ntm_island_growth() in flat-top,
+//               until the predictor sees the mode lock and fires
+//   vde         a kick in flat-top with the vertical feedback polarity
+//               reversed, until the displacement limit
+//   disruption  a disruption forced in flat-top, through the TQ/CQ
+//
+// Each scenario runs the same --shots at every thread configuration (1,
+// half and all online CPUs by default); workers claim shots from a shared
+// counter, and the best of --repeats runs is kept. Reported per scenario
+// and configuration: shots/s, simulated seconds per wall second, the
+// process peak RSS so far and the per-cycle latency distribution (timer
+// overhead subtracted). Every shot is seeded from (--seed, scenario,
+// shot), so the final states are reproducible: their checksum must agree
+// across repeats and thread counts, or the run fails.
+//
+// --json records the results; --baseline compares against a recorded
+// file (keep one per host and build, e.g. baselines/<host>.json) and
+// fails on a throughput drop beyond --tolerance, a p99 rise beyond
+// --latency-tolerance or, when seed, shots and compiler match, a checksum
+// change. Exit status 2 on any failure.
+//
+// Build with the flags of plasma_physics_bench.c:
+//        gcc -O3 -fno-math-errno -fno-trapping-math -I.. shot_pipeline_bench.c
+//            ../control_cycle.c ../plasma_physics.c ../plasma_rng.c
+//            ../plasma_safety.c ../disruption_quench.c ../mhd_spectrum.c
+//            -lm -lpthread -o shot_pipeline_bench
+// Run:   ./shot_pipeline_bench --json baselines/$(hostname).json
+//        ./shot_pipeline_bench --baseline baselines/$(hostname).json
+
+#define _GNU_SOURCE
+#include "control_cycle.h"
+#include "disruption_quench.h"
+#include "plasma_physics.h"
+#include "plasma_rng.h"
+#include "plasma_safety.h"
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <time.h>
+#include <unistd.h>
+
+// ================= BENCHMARK PARAMETERS =================
+#define BENCH_STEP_DT 1e-3f               // 1 kHz control loop
+#define BENCH_SHOTS_DEFAULT 64            // per scenario and configuration
+#define BENCH_REPEATS_DEFAULT 3
+#define BENCH_SEED_DEFAULT 12345
+#define BENCH_MAX_THREADS 256
+#define BENCH_MAX_CONFIGS 8
+#define BENCH_MAX_RESULTS 64
+#define BENCH_TIMER_SAMPLES 100000
+#define BENCH_LATENCY_BIN_NS 10
+#define BENCH_LATENCY_BINS 4096           // last bin collects the overflow
+#define BENCH_TOLERANCE_DEFAULT 0.15      // fractional shots/s drop
+#define BENCH_LATENCY_TOLERANCE_DEFAULT 0.50   // fractional p99 rise
+#define BENCH_LINE_MAX 1024
+#define BENCH_NOISE_SEED_SALT 0x6e6f697365ULL  // "noise"
+
+// ================= SCENARIO PARAMETERS =================
+// Flat-top events: EVENT_DELAY into flat-top plus up to EVENT_JITTER
+#define EVENT_DELAY 0.5f                  // s
+#define EVENT_JITTER 0.5f                 // s
+#define NTM_SEED_WIDTH 0.005f             // m
+#define NTM_SATURATED_WIDTH 0.3f          // m
+#define NTM_DELTA_PRIME 2.0f
+#define NTM_BOOTSTRAP 0.5f
+#define NTM_DAMPING 0.2f
+#define NTM_DETECT_WIDTH 0.02f            // m, seen rotating by the magnetics
+#define VDE_KICK 0.03f                    // m
+
+typedef enum {
+    SCENARIO_RAMP_UP,
+    SCENARIO_FLAT_TOP,
+    SCENARIO_NTM,
+    SCENARIO_VDE,
+    SCENARIO_DISRUPTION,
+    SCENARIO_COUNT
+} ScenarioId;
+
+static const struct {
+    const char *name;
+    float max_time;                 // s, a shot stops here if not done
+} scenarios[SCENARIO_COUNT] = {
+    [SCENARIO_RAMP_UP] = { "ramp_up", 10.0f },
+    [SCENARIO_FLAT_TOP] = { "flat_top", 20.0f },
+    [SCENARIO_NTM] = { "ntm", 15.0f },
+    [SCENARIO_VDE] = { "vde", 15.0f },
+    [SCENARIO_DISRUPTION] = { "disruption", 15.0f },
+};
+
+typedef struct {
+    PlasmaControlSystem control;
+    ScenarioState cycle;
+    CycleSafety safety;
+    ScenarioId scenario;
+    float event_time;               // s into flat-top
+    float ntm_width;                // m
+    bool event_fired;
+} Shot;
+
+typedef struct {
+    ScenarioId scenario;
+    uint32_t shots;
+    uint64_t seed;
+    int64_t timer_overhead_ns;
+    atomic_uint next_shot;
+} BenchRun;
+
+typedef struct {
+    BenchRun *run;
+    int cpu;                        // -1: not pinned
+    uint64_t shots;
+    uint64_t cycles;
+    uint64_t mitigated;
+    double simulated_s;
+    uint64_t checksum;
+    int64_t max_ns;
+    uint64_t hist[BENCH_LATENCY_BINS];
+} Worker;
+
+typedef struct {
+    ScenarioId scenario;
+    char config[16];
+    uint32_t threads;
+    uint32_t shots;
+    uint64_t cycles;
+    uint64_t mitigated;
+    double wall_s;
+    double shots_per_second;
+    double sim_per_wall;
+    double p50_ns;
+    double p99_ns;
+    double p999_ns;
+    double max_ns;
+    long peak_rss_kb;
+    uint64_t checksum;
+} BenchResult;
+
+typedef struct {
+    char label[16];
+    uint32_t threads;
+} ThreadConfig;
+
+static inline int64_t now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// ================= SHOT =================
+static void init_shot(Shot *shot, ScenarioId scenario, uint64_t seed,
+                      uint32_t index) {
+    memset(shot, 0, sizeof(*shot));
+    uint64_t stream = (uint64_t)scenario << 32 | index;
+    PlasmaRng rng;
+    plasma_rng_seed(&rng, seed, stream);
+
+    PlasmaControlSystem *control = &shot->control;
+    plasma_rng_seed(&control->rng, seed ^ BENCH_NOISE_SEED_SALT, stream);
+    PlasmaState *s = &control->current_state;
+    s->plasma_current = 0.1f;
+    s->elongation = 1.7f;
+    s->triangularity = 0.33f;
+    s->li_inductance = PLASMA_LI_TARGET;
+    s->density_core = 9.5f + plasma_rng_uniform(&rng);
+    s->density_edge = 3.0f;
+    s->temperature_core = 1.0f;
+    s->temperature_edge = 0.1f;
+    s->vertical_position = 0.005f + 0.01f * plasma_rng_uniform(&rng);
+
+    control->target_state = *s;
+    control->target_state.plasma_current = SCENARIO_PLASMA_CURRENT;
+    control->target_state.density_core = 10.0f;
+    control->target_state.vertical_position = 0.0f;
+    for (int i = 0; i < NUM_HEATING_SYSTEMS; i++) {
+        control->heating_systems[i].power = 0.4f;       // MW
+        control->heating_systems[i].frequency = 170.0e9f;
+        control->heating_systems[i].enabled = false;
+    }
+    control->energy_confinement_time = ENERGY_CONFINEMENT_TIME;
+    control->stored_energy = 1.0f;
+    control->controller_state = PSQ_STATE_INIT;
+
+    control_cycle_scenario_init(&shot->cycle, control);
+    control_cycle_safety_init(&shot->safety);
+    shot->scenario = scenario;
+    shot->event_time = EVENT_DELAY + EVENT_JITTER * plasma_rng_uniform(&rng);
+    shot->ntm_width = NTM_SEED_WIDTH;
+}
+
+// Fires the scenario's flat-top event and evolves the island once seeded.
+// A fired VDE reverses the vertical feedback polarity.
+static void scenario_event(Shot *shot, float dt) {
+    PlasmaControlSystem *control = &shot->control;
+    PlasmaState *s = &control->current_state;
+    if (!shot->event_fired && control->controller_state == PSQ_STATE_FLAT_TOP &&
+        shot->cycle.state_timer >= shot->event_time) {
+        shot->event_fired = true;
+        if (shot->scenario == SCENARIO_VDE) {
+            s->vertical_position += VDE_KICK;
+            shot->cycle.vertical_reversed = true;
+        }
+        if (shot->scenario == SCENARIO_DISRUPTION) control->disruption_detected = true;
+    }
+    if (shot->scenario == SCENARIO_NTM && shot->event_fired &&
+        control->controller_state == PSQ_STATE_FLAT_TOP) {
+        shot->ntm_width = ntm_island_growth(shot->ntm_width, NTM_SATURATED_WIDTH,
+                                            NTM_DELTA_PRIME, NTM_BOOTSTRAP,
+                                            NTM_DAMPING, dt);
+        s->ntm_amplitude = shot->ntm_width;
+        shot->safety.system.disruption_flags.ntm_detected = shot->ntm_width > NTM_DETECT_WIDTH;
+    }
+}
+
+// The stepper, or the closed-form quench from the disruption onset until
+// the current quench ends
+static void advance_plasma(Shot *shot, float dt) {
+    PlasmaControlSystem *control = &shot->control;
+    int state = control->controller_state;
+    bool quench_phase = state == PSQ_STATE_DISRUPTION || state == PSQ_STATE_MITIGATION ||
+                        (state == PSQ_STATE_SAFE_SHUTDOWN && shot->safety.quench.active);
+    if (!quench_phase) {
+        advance_plasma_state(&control->current_state, control, dt);
+        return;
+    }
+    control_cycle_quench(control, &shot->safety, dt);
+}
+
+static bool shot_done(const Shot *shot) {
+    const PlasmaControlSystem *control = &shot->control;
+    if (control->simulation_time >= scenarios[shot->scenario].max_time) return true;
+    if (shot->scenario == SCENARIO_RAMP_UP) {
+        return control->controller_state == PSQ_STATE_FLAT_TOP;
+    }
+    if (control->controller_state != PSQ_STATE_SAFE_SHUTDOWN) return false;
+    const DisruptionQuench *quench = &shot->safety.quench;
+    return !quench->active ||
+           control->simulation_time >= quench->onset_time + quench->current_quench_end;
+}
+
+// One control cycle, in the order of npe_psq_core_sim.c's run_loop()
+static void shot_cycle(Shot *shot, float dt) {
+    scenario_event(shot, dt);
+    control_cycle_actuators(&shot->control, &shot->cycle, dt);
+    advance_plasma(shot, dt);
+    control_cycle_warnings(&shot->control, dt);
+    control_cycle_safety(&shot->control, &shot->safety, dt);
+    control_cycle_controller(&shot->control, &shot->cycle, dt);
+    shot->control.simulation_time += dt;
+    shot->control.iteration_count++;
+}
+
+// FNV-1a over the shot's identity and outcome
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t n) {
+    const unsigned char *p = data;
+    for (size_t i = 0; i < n; i++) {
+        h ^= p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static uint64_t shot_checksum(const Shot *shot, uint32_t index) {
+    const PlasmaControlSystem *control = &shot->control;
+    uint64_t h = 0xcbf29ce484222325ULL;
+    uint32_t words[4] = {
+        index, (uint32_t)shot->scenario, (uint32_t)control->controller_state,
+        control->iteration_count,
+    };
+    h = hash_bytes(h, words, sizeof(words));
+    h = hash_bytes(h, &control->current_state, sizeof(PlasmaState));
+    h = hash_bytes(h, &control->stored_energy, sizeof(float));
+    uint8_t flags = (uint8_t)(control->disruption_detected | control->mitigation_activated << 1);
+    return hash_bytes(h, &flags, 1);
+}
+
+// ================= WORKERS =================
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    BenchRun *run = w->run;
+    if (w->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+    Shot shot;
+    for (;;) {
+        uint32_t index = atomic_fetch_add_explicit(&run->next_shot, 1,
+                                                   memory_order_relaxed);
+        if (index >= run->shots) break;
+        init_shot(&shot, run->scenario, run->seed, index);
+        while (!shot_done(&shot)) {
+            int64_t t0 = now_ns();
+            shot_cycle(&shot, BENCH_STEP_DT);
+            int64_t ns = now_ns() - t0 - run->timer_overhead_ns;
+            if (ns < 0) ns = 0;
+            int64_t bin = ns / BENCH_LATENCY_BIN_NS;
+            w->hist[bin < BENCH_LATENCY_BINS ? bin : BENCH_LATENCY_BINS - 1]++;
+            if (ns > w->max_ns) w->max_ns = ns;
+        }
+        w->shots++;
+        w->cycles += shot.control.iteration_count;
+        w->mitigated += shot.control.mitigation_activated;
+        w->simulated_s += shot.control.simulation_time;
+        w->checksum += shot_checksum(&shot, index);
+    }
+    return NULL;
+}
+
+// Upper edge of the bin holding the nearest-rank percentile; the overflow
+// bin reports the maximum
+static double hist_percentile(const uint64_t *hist, uint64_t n, int64_t max_ns,
+                              double p) {
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)n + 0.5);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < BENCH_LATENCY_BINS - 1; b++) {
+        seen += hist[b];
+        if (seen >= rank) {
+            double edge = (double)(b + 1) * BENCH_LATENCY_BIN_NS;
+            return edge < (double)max_ns ? edge : (double)max_ns;
+        }
+    }
+    return (double)max_ns;
+}
+
+static int run_config(BenchRun *run, uint32_t threads, bool pin, long num_cpus,
+                      BenchResult *result) {
+    Worker *workers = calloc(threads, sizeof(Worker));
+    pthread_t *tids = calloc(threads, sizeof(pthread_t));
+    if (!workers || !tids) {
+        free(workers);
+        free(tids);
+        return -1;
+    }
+    atomic_store(&run->next_shot, 0);
+    int64_t start = now_ns();
+    uint32_t started = 0;
+    for (; started < threads; started++) {
+        workers[started].run = run;
+        workers[started].cpu = pin ? (int)(started % (uint32_t)num_cpus) : -1;
+        if (pthread_create(&tids[started], NULL, worker_main, &workers[started]) != 0) break;
+    }
+    for (uint32_t t = 0; t < started; t++) pthread_join(tids[t], NULL);
+    double wall = (double)(now_ns() - start) * 1e-9;
+
+    static uint64_t hist[BENCH_LATENCY_BINS];
+    memset(hist, 0, sizeof(hist));
+    memset(result, 0, sizeof(*result));
+    double simulated = 0.0;
+    int64_t max_ns = 0;
+    for (uint32_t t = 0; t < started; t++) {
+        const Worker *w = &workers[t];
+        for (int b = 0; b < BENCH_LATENCY_BINS; b++) hist[b] += w->hist[b];
+        if (w->max_ns > max_ns) max_ns = w->max_ns;
+        result->shots += (uint32_t)w->shots;
+        result->cycles += w->cycles;
+        result->mitigated += w->mitigated;
+        result->checksum += w->checksum;
+        simulated += w->simulated_s;
+    }
+    free(workers);
+    free(tids);
+    if (started != threads || result->shots != run->shots) return -1;
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    result->scenario = run->scenario;
+    result->threads = threads;
+    result->wall_s = wall;
+    result->shots_per_second = result->shots / wall;
+    result->sim_per_wall = simulated / wall;
+    result->p50_ns = hist_percentile(hist, result->cycles, max_ns, 50.0);
+    result->p99_ns = hist_percentile(hist, result->cycles, max_ns, 99.0);
+    result->p999_ns = hist_percentile(hist, result->cycles, max_ns, 99.9);
+    result->max_ns = (double)max_ns;
+    result->peak_rss_kb = usage.ru_maxrss;
+    return 0;
+}
+
+static int compare_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Median back-to-back clock_gettime() cost
+static int64_t measure_timer_overhead(void) {
+    int64_t *samples = malloc(BENCH_TIMER_SAMPLES * sizeof(int64_t));
+    if (!samples) return 0;
+    for (uint32_t i = 0; i < BENCH_TIMER_SAMPLES; i++) {
+        int64_t t0 = now_ns();
+        samples[i] = now_ns() - t0;
+    }
+    qsort(samples, BENCH_TIMER_SAMPLES, sizeof(int64_t), compare_i64);
+    int64_t median = samples[BENCH_TIMER_SAMPLES / 2];
+    free(samples);
+    return median;
+}
+
+// ================= RESULTS =================
+static void print_row(const BenchResult *r) {
+    printf("%-11s %-6s %4u %6u %10.1f %10.1f %8.0f %8.0f %8.0f %9.0f %8ld %3llu  %016llx\n",
+           scenarios[r->scenario].name, r->config, r->threads, r->shots,
+           r->shots_per_second, r->sim_per_wall, r->p50_ns, r->p99_ns, r->p999_ns,
+           r->max_ns, r->peak_rss_kb / 1024, (unsigned long long)r->mitigated,
+           (unsigned long long)r->checksum);
+}
+
+static int write_json(const char *path, uint64_t seed, uint32_t shots,
+                      uint32_t repeats, int64_t timer_overhead_ns,
+                      const BenchResult *results, int count) {
+    FILE *out = fopen(path, "w");
+    if (!out) return -1;
+    time_t now = time(NULL);
+    char date[32];
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+    fprintf(out, "{\n  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%s\",\n", date);
+    fprintf(out, "    \"num_cpus\": %ld,\n", sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "    \"compiler\": \"%s\",\n", __VERSION__);
+    fprintf(out, "    \"seed\": %llu,\n", (unsigned long long)seed);
+    fprintf(out, "    \"shots\": %u,\n", shots);
+    fprintf(out, "    \"repeats\": %u,\n", repeats);
+    fprintf(out, "    \"timer_overhead_ns\": %lld,\n", (long long)timer_overhead_ns);
+    fprintf(out, "    \"step_dt_s\": %g\n  },\n", (double)BENCH_STEP_DT);
+    fprintf(out, "  \"results\": [\n");
+    for (int i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(out, "    {\"scenario\": \"%s\", \"config\": \"%s\", \"threads\": %u, "
+                     "\"shots\": %u, \"cycles\": %llu, \"mitigated\": %llu, "
+                     "\"wall_s\": %.6f, \"shots_per_second\": %.6g, "
+                     "\"sim_seconds_per_second\": %.6g, \"p50_ns\": %.1f, "
+                     "\"p99_ns\": %.1f, \"p999_ns\": %.1f, \"max_ns\": %.1f, "
+                     "\"peak_rss_kb\": %ld, \"checksum\": \"%016llx\"}%s\n",
+                scenarios[r->scenario].name, r->config, r->threads, r->shots,
+                (unsigned long long)r->cycles, (unsigned long long)r->mitigated,
+                r->wall_s, r->shots_per_second, r->sim_per_wall, r->p50_ns,
+                r->p99_ns, r->p999_ns, r->max_ns, r->peak_rss_kb,
+                (unsigned long long)r->checksum, i + 1 < count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+    return fclose(out) == 0 ? 0 : -1;
+}
+
+// ================= BASELINE =================
+// Reads back what write_json() writes, one result per line
+typedef struct {
+    char scenario[32];
+    char config[16];
+    uint32_t shots;
+    double shots_per_second;
+    double p99_ns;
+    uint64_t checksum;
+} BaselineEntry;
+
+typedef struct {
+    char compiler[256];
+    uint64_t seed;
+    uint32_t shots;
+    int count;
+    BaselineEntry entries[BENCH_MAX_RESULTS];
+} Baseline;
+
+static const char *json_field(const char *line, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *p = strstr(line, pattern);
+    return p ? p + strlen(pattern) : NULL;
+}
+
+static bool json_string(const char *line, const char *key, char *out, size_t size) {
+    const char *p = json_field(line, key);
+    if (!p || *p != '"') return false;
+    const char *end = strchr(++p, '"');
+    if (!end || (size_t)(end - p) >= size) return false;
+    memcpy(out, p, (size_t)(end - p));
+    out[end - p] = '\0';
+    return true;
+}
+
+static bool json_number(const char *line, const char *key, double *out) {
+    const char *p = json_field(line, key);
+    char *end;
+    if (!p) return false;
+    *out = strtod(p, &end);
+    return end != p;
+}
+
+static int load_baseline(const char *path, Baseline *baseline) {
+    FILE *in = fopen(path, "r");
+    if (!in) return -1;
+    memset(baseline, 0, sizeof(*baseline));
+    char line[BENCH_LINE_MAX], checksum[32];
+    double value;
+    while (fgets(line, sizeof(line), in)) {
+        if (!json_field(line, "scenario")) {
+            json_string(line, "compiler", baseline->compiler, sizeof(baseline->compiler));
+            if (json_number(line, "seed", &value)) baseline->seed = (uint64_t)value;
+            if (json_number(line, "shots", &value)) baseline->shots = (uint32_t)value;
+            continue;
+        }
+        if (baseline->count == BENCH_MAX_RESULTS) break;
+        BaselineEntry *e = &baseline->entries[baseline->count];
+        if (!json_string(line, "scenario", e->scenario, sizeof(e->scenario)) ||
+            !json_string(line, "config", e->config, sizeof(e->config)) ||
+            !json_number(line, "shots_per_second", &e->shots_per_second) ||
+            !json_number(line, "p99_ns", &e->p99_ns) ||
+            !json_string(line, "checksum", checksum, sizeof(checksum))) {
+            continue;
+        }
+        e->shots = json_number(line, "shots", &value) ? (uint32_t)value : 0;
+        e->checksum = strtoull(checksum, NULL, 16);
+        baseline->count++;
+    }
+    fclose(in);
+    return baseline->count > 0 ? 0 : -1;
+}
+
+// Returns the number of regressions
+static int compare_baseline(const Baseline *baseline, const BenchResult *results,
+                            int count, uint64_t seed, double tolerance,
+                            double latency_tolerance) {
+    bool comparable = baseline->seed == seed &&
+                      strcmp(baseline->compiler, __VERSION__) == 0;
+    if (!comparable) {
+        printf("baseline seed or compiler differs: checksums not compared\n");
+    }
+    printf("\n%-11s %-6s %10s %10s %7s %8s %8s %7s  %s\n", "scenario", "config",
+           "shots/s", "baseline", "change", "p99 ns", "baseline", "change", "status");
+    int regressions = 0;
+    for (int i = 0; i < count; i++) {
+        const BenchResult *r = &results[i];
+        const BaselineEntry *e = NULL;
+        for (int j = 0; j < baseline->count && !e; j++) {
+            if (strcmp(baseline->entries[j].scenario, scenarios[r->scenario].name) == 0 &&
+                strcmp(baseline->entries[j].config, r->config) == 0) {
+                e = &baseline->entries[j];
+            }
+        }
+        if (!e) {
+            printf("%-11s %-6s %10.1f %10s\n", scenarios[r->scenario].name, r->config,
+                   r->shots_per_second, "-");
+            continue;
+        }
+        double throughput = r->shots_per_second / e->shots_per_second - 1.0;
+        double latency = e->p99_ns > 0.0 ? r->p99_ns / e->p99_ns - 1.0 : 0.0;
+        const char *status = "ok";
+        if (comparable && e->shots == r->shots && e->checksum != r->checksum) {
+            status = "RESULTS CHANGED";
+        } else if (throughput < -tolerance) {
+            status = "SLOWER";
+        } else if (latency > latency_tolerance) {
+            status = "P99 HIGHER";
+        }
+        regressions += strcmp(status, "ok") != 0;
+        printf("%-11s %-6s %10.1f %10.1f %+6.1f%% %8.0f %8.0f %+6.1f%%  %s\n",
+               scenarios[r->scenario].name, r->config, r->shots_per_second,
+               e->shots_per_second, 100.0 * throughput, r->p99_ns, e->p99_ns,
+               100.0 * latency, status);
+    }
+    return regressions;
+}
+
+// ================= MAIN =================
+// "1,half,all" or explicit counts; duplicates after resolution are dropped
+static int parse_threads(const char *list, long num_cpus, ThreadConfig *configs) {
+    char buffer[128];
+    snprintf(buffer, sizeof(buffer), "%s", list);
+    int count = 0;
+    for (char *save, *item = strtok_r(buffer, ",", &save); item;
+         item = strtok_r(NULL, ",", &save)) {
+        long threads;
+        if (strcmp(item, "all") == 0) {
+            threads = num_cpus;
+        } else if (strcmp(item, "half") == 0) {
+            threads = num_cpus / 2 > 0 ? num_cpus / 2 : 1;
+        } else {
+            threads = strtol(item, NULL, 10);
+        }
+        if (threads < 1 || threads > BENCH_MAX_THREADS || count == BENCH_MAX_CONFIGS) {
+            return -1;
+        }
+        bool duplicate = false;
+        for (int c = 0; c < count; c++) duplicate |= configs[c].threads == (uint32_t)threads;
+        if (duplicate) continue;
+        snprintf(configs[count].label, sizeof(configs[count].label), "%s", item);
+        configs[count].threads = (uint32_t)threads;
+        count++;
+    }
+    return count;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--shots N] [--repeats N] [--threads LIST] [--seed N]\n"
+            "          [--scenario NAME] [--pin] [--json FILE] [--baseline FILE]\n"
+            "          [--tolerance F] [--latency-tolerance F]\n"
+            "  --shots      shots per scenario and configuration (default %d)\n"
+            "  --repeats    runs per configuration, best kept (default %d)\n"
+            "  --threads    worker counts, numbers or half/all (default 1,half,all)\n"
+            "  --seed       base seed of every shot (default %d)\n"
+            "  --scenario   run only this one: ramp_up, flat_top, ntm, vde, disruption\n"
+            "  --pin        pin worker i to CPU i modulo the online CPUs\n"
+            "  --json       also write the results as JSON\n"
+            "  --baseline   compare against a file written by --json, exit 2 on regression\n"
+            "  --tolerance  allowed shots/s drop (default %g)\n"
+            "  --latency-tolerance  allowed p99 rise (default %g)\n",
+            prog, BENCH_SHOTS_DEFAULT, BENCH_REPEATS_DEFAULT, BENCH_SEED_DEFAULT,
+            BENCH_TOLERANCE_DEFAULT, BENCH_LATENCY_TOLERANCE_DEFAULT);
+}
+
+int main(int argc, char **argv) {
+    long shots = BENCH_SHOTS_DEFAULT;
+    long repeats = BENCH_REPEATS_DEFAULT;
+    const char *thread_list = "1,half,all";
+    uint64_t seed = BENCH_SEED_DEFAULT;
+    int only = -1;
+    bool pin = false;
+    const char *json_path = NULL;
+    const char *baseline_path = NULL;
+    double tolerance = BENCH_TOLERANCE_DEFAULT;
+    double latency_tolerance = BENCH_LATENCY_TOLERANCE_DEFAULT;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--shots") == 0) {
+            shots = strtol(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--repeats") == 0) {
+            repeats = strtol(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            thread_list = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            seed = strtoull(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--scenario") == 0) {
+            const char *name = argv[++i];
+            for (int s = 0; s < SCENARIO_COUNT; s++) {
+                if (strcmp(name, scenarios[s].name) == 0) only = s;
+            }
+            if (only < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--pin") == 0) {
+            pin = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "--json") == 0) {
+            json_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--baseline") == 0) {
+            baseline_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--tolerance") == 0) {
+            tolerance = strtod(argv[++i], NULL);
+        } else if (i + 1 < argc && strcmp(argv[i], "--latency-tolerance") == 0) {
+            latency_tolerance = strtod(argv[++i], NULL);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus < 1) num_cpus = 1;
+    ThreadConfig configs[BENCH_MAX_CONFIGS];
+    int num_configs = parse_threads(thread_list, num_cpus, configs);
+    if (shots < 1 || shots > UINT32_MAX || repeats < 1 || num_configs < 1 ||
+        tolerance < 0.0 || latency_tolerance < 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Read the baseline first so a bad path fails before the runs
+    static Baseline baseline;
+    if (baseline_path && load_baseline(baseline_path, &baseline) != 0) {
+        fprintf(stderr, "cannot read baseline %s\n", baseline_path);
+        return 1;
+    }
+
+    static BenchRun run;
+    run.shots = (uint32_t)shots;
+    run.seed = seed;
+    run.timer_overhead_ns = measure_timer_overhead();
+    printf("%u shots per run, best of %ld, dt %g s, seed %llu, "
+           "timer overhead %lld ns subtracted\n\n", run.shots, repeats,
+           (double)BENCH_STEP_DT, (unsigned long long)seed,
+           (long long)run.timer_overhead_ns);
+    printf("%-11s %-6s %4s %6s %10s %10s %8s %8s %8s %9s %8s %3s  %s\n",
+           "scenario", "config", "thr", "shots", "shots/s", "sim s/s", "p50 ns",
+           "p99 ns", "p99.9 ns", "max ns", "rss MiB", "mit", "checksum");
+
+    // Configurations outermost, so the peak RSS grows with the thread count
+    BenchResult results[BENCH_MAX_RESULTS];
+    uint64_t reference[SCENARIO_COUNT];
+    bool have_reference[SCENARIO_COUNT] = { false };
+    int count = 0;
+    bool deterministic = true;
+    for (int c = 0; c < num_configs; c++) {
+        for (int s = 0; s < SCENARIO_COUNT; s++) {
+            if ((only >= 0 && s != only) || count == BENCH_MAX_RESULTS) continue;
+            run.scenario = (ScenarioId)s;
+            BenchResult best, trial;
+            for (long r = 0; r < repeats; r++) {
+                if (run_config(&run, configs[c].threads, pin, num_cpus, &trial) != 0) {
+                    fprintf(stderr, "cannot run %u workers\n", configs[c].threads);
+                    return 1;
+                }
+                if (!have_reference[s]) {
+                    reference[s] = trial.checksum;
+                    have_reference[s] = true;
+                }
+                if (trial.checksum != reference[s]) deterministic = false;
+                if (r == 0 || trial.shots_per_second > best.shots_per_second) best = trial;
+            }
+            memcpy(best.config, configs[c].label, sizeof(best.config));
+            print_row(&best);
+            results[count++] = best;
+        }
+    }
+    if (!deterministic) {
+        fprintf(stderr, "checksums differ between runs: the pipeline is not reproducible\n");
+    }
+
+    if (json_path && write_json(json_path, seed, run.shots, (uint32_t)repeats,
+                                run.timer_overhead_ns, results, count) != 0) {
+        fprintf(stderr, "cannot write %s\n", json_path);
+        return 1;
+    }
+    int regressions = 0;
+    if (baseline_path) {
+        regressions = compare_baseline(&baseline, results, count, seed,
+                                       tolerance, latency_tolerance);
+        printf("%d regression%s against %s\n", regressions,
+               regressions == 1 ? "" : "s", baseline_path);
+    }
+    return deterministic && regressions == 0 ? 0 : 2;
+}
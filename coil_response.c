@@ -0,0 +1,282 @@
+#include "coil_response.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROWS COIL_RESPONSE_ROWS
+
+#define COIL_FIELD_STEP 1e-3            // m, central difference for dB_R/dz
+#define COIL_LINE_MAX 256
+
+// ================= LOOP GREEN'S FUNCTIONS =================
+// Complete elliptic integrals K(m), E(m) of parameter m = k^2 by the
+// arithmetic-geometric mean
+static void elliptic_ke(double m, double *K, double *E) {
+    double a = 1.0, b = sqrt(1.0 - m), sum = 0.5 * m, weight = 0.5;
+    for (int it = 0; it < 32 && fabs(a - b) > 1e-15 * a; it++) {
+        double c = 0.5 * (a - b);
+        double next = 0.5 * (a + b);
+        b = sqrt(a * b);
+        a = next;
+        weight *= 2.0;
+        sum += weight * c * c;
+    }
+    *K = M_PI / (2.0 * a);
+    *E = *K * (1.0 - sum);
+}
+
+// Flux through, and field at, (r, z) of a unit-current loop of radius a at
+// height zc
+static double loop_flux(double a, double zc, double r, double z) {
+    double dz = z - zc;
+    double m = 4.0 * a * r / ((a + r) * (a + r) + dz * dz);
+    double K, E, k = sqrt(m);
+    elliptic_ke(m, &K, &E);
+    return MU0 * sqrt(a * r) * ((2.0 / k - k) * K - 2.0 / k * E);
+}
+
+static void loop_field(double a, double zc, double r, double z,
+                       double *B_r, double *B_z) {
+    double dz = z - zc;
+    double plus = (a + r) * (a + r) + dz * dz;
+    double minus = (a - r) * (a - r) + dz * dz;
+    double K, E;
+    elliptic_ke(4.0 * a * r / plus, &K, &E);
+    double c = MU0 / (2.0 * M_PI * sqrt(plus));
+    *B_r = c * dz / r * (-K + (a * a + r * r + dz * dz) / minus * E);
+    *B_z = c * (K + (a * a - r * r - dz * dz) / minus * E);
+}
+
+// ================= BUILD =================
+int coil_response_build(CoilResponse *cache, const CoilSpec *coils,
+                        uint32_t num_pf, uint32_t num_vertical,
+                        float plasma_R, float plasma_Z) {
+    memset(cache, 0, sizeof(*cache));
+    uint32_t n = num_pf + num_vertical;
+    if (n == 0 || n > COIL_RESPONSE_MAX_COILS || !(plasma_R > 0.0f)) return -1;
+    for (uint32_t i = 0; i < n; i++) {
+        if (!(coils[i].R > 0.0f) || !(coils[i].wire_radius > 0.0f)) return -1;
+        double dR = coils[i].R - plasma_R, dZ = coils[i].Z - plasma_Z;
+        if (dR * dR + dZ * dZ < COIL_FIELD_STEP * COIL_FIELD_STEP) return -1;
+        for (uint32_t j = 0; j < i; j++) {
+            if (coils[i].R == coils[j].R && coils[i].Z == coils[j].Z) return -1;
+        }
+    }
+
+    uint32_t per_line = COIL_RESPONSE_ALIGN / sizeof(float);
+    uint32_t stride = (n + per_line - 1) / per_line * per_line;
+    size_t bytes = (size_t)(ROWS + n) * stride * sizeof(float);
+    float *block = aligned_alloc(COIL_RESPONSE_ALIGN, bytes);
+    if (!block) return -1;
+    memset(block, 0, bytes);
+    cache->num_pf = num_pf;
+    cache->num_vertical = num_vertical;
+    cache->num_coils = n;
+    cache->stride = stride;
+    cache->plasma_R = plasma_R;
+    cache->plasma_Z = plasma_Z;
+    cache->response = block;
+    cache->mutual = block + (size_t)ROWS * stride;
+    cache->block = block;
+
+    const double r = plasma_R, z = plasma_Z, h = COIL_FIELD_STEP;
+    for (uint32_t c = 0; c < n; c++) {
+        double a = coils[c].R, zc = coils[c].Z, turns = coils[c].turns;
+        double B_r, B_z, B_r_up, B_r_down, unused;
+        loop_field(a, zc, r, z, &B_r, &B_z);
+        loop_field(a, zc, r, z + h, &B_r_up, &unused);
+        loop_field(a, zc, r, z - h, &B_r_down, &unused);
+        cache->response[COIL_ROW_FLUX * stride + c] = (float)(turns * loop_flux(a, zc, r, z));
+        cache->response[COIL_ROW_BR * stride + c] = (float)(turns * B_r);
+        cache->response[COIL_ROW_BZ * stride + c] = (float)(turns * B_z);
+        cache->response[COIL_ROW_DBR_DZ * stride + c] =
+            (float)(turns * (B_r_up - B_r_down) / (2.0 * h));
+
+        for (uint32_t i = 0; i < n; i++) {
+            double M;
+            if (i == c) {
+                double w = coils[c].wire_radius;
+                M = MU0 * a * (log(8.0 * a / w) - 1.75);
+            } else {
+                M = loop_flux(a, zc, coils[i].R, coils[i].Z);
+            }
+            cache->mutual[(size_t)i * stride + c] = (float)(coils[i].turns * turns * M);
+        }
+    }
+    return 0;
+}
+
+int coil_response_default(CoilResponse *cache, const MachineGeometry *machine) {
+    CoilSpec coils[NUM_PF_COILS + NUM_VERTICAL_COILS];
+    const float R0 = machine->major_radius, a = machine->minor_radius;
+    const uint32_t n_pf = machine->num_pf_coils, n_vertical = machine->num_vertical_coils;
+    for (uint32_t i = 0; i < n_pf; i++) {
+        float theta = (float)(2.0 * M_PI) * ((float)i + 0.5f) / (float)n_pf;
+        coils[i] = (CoilSpec){ R0 + 2.0f * a * cosf(theta), 2.0f * a * sinf(theta),
+                               100.0f, COIL_WIRE_RADIUS_DEFAULT };
+    }
+    uint32_t pairs = (n_vertical + 1) / 2;
+    for (uint32_t i = 0; i < n_vertical; i++) {
+        uint32_t pair = i / 2;
+        float upper = i % 2 ? -1.0f : 1.0f;
+        float R_coil = R0 + a * (((float)pair + 0.5f) / (float)pairs - 0.5f);
+        coils[n_pf + i] = (CoilSpec){ R_coil, upper * 1.5f * a, upper * 10.0f,
+                                      0.5f * COIL_WIRE_RADIUS_DEFAULT };
+    }
+    return coil_response_build(cache, coils, n_pf, n_vertical, R0, 0.0f);
+}
+
+int coil_response_load(CoilResponse *cache, const char *path) {
+    memset(cache, 0, sizeof(*cache));
+    FILE *f = fopen(path, "r");
+    if (!f) return -1;
+    CoilSpec *coils = malloc(2 * COIL_RESPONSE_MAX_COILS * sizeof(CoilSpec));
+    if (!coils) {
+        fclose(f);
+        return -1;
+    }
+    // PF coils fill from the front, vertical coils from the back half
+    CoilSpec *vertical = coils + COIL_RESPONSE_MAX_COILS;
+    uint32_t num_pf = 0, num_vertical = 0;
+    float plasma_R = TOKAMAK_MAJOR_RADIUS, plasma_Z = 0.0f;
+    char line[COIL_LINE_MAX];
+    bool ok = true;
+    while (ok && fgets(line, sizeof(line), f)) {
+        char *comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+        char kind[16];
+        CoilSpec spec = { .wire_radius = COIL_WIRE_RADIUS_DEFAULT };
+        int fields = sscanf(line, "%15s %f %f %f %f", kind, &spec.R, &spec.Z,
+                            &spec.turns, &spec.wire_radius);
+        if (fields <= 0) continue;
+        if (strcmp(kind, "plasma") == 0 && fields == 3) {
+            plasma_R = spec.R;
+            plasma_Z = spec.Z;
+        } else if (strcmp(kind, "pf") == 0 && fields >= 4 &&
+                   num_pf < COIL_RESPONSE_MAX_COILS) {
+            coils[num_pf++] = spec;
+        } else if (strcmp(kind, "vertical") == 0 && fields >= 4 &&
+                   num_vertical < COIL_RESPONSE_MAX_COILS) {
+            vertical[num_vertical++] = spec;
+        } else {
+            ok = false;
+        }
+    }
+    ok = ok && !ferror(f);
+    fclose(f);
+    if (ok && num_pf + num_vertical <= COIL_RESPONSE_MAX_COILS) {
+        memmove(coils + num_pf, vertical, num_vertical * sizeof(CoilSpec));
+        ok = coil_response_build(cache, coils, num_pf, num_vertical,
+                                 plasma_R, plasma_Z) == 0;
+    } else {
+        ok = false;
+    }
+    free(coils);
+    return ok ? 0 : -1;
+}
+
+void coil_response_free(CoilResponse *cache) {
+    free(cache->block);
+    memset(cache, 0, sizeof(*cache));
+}
+
+// ================= EVALUATION =================
+void coil_response_gather(const CoilResponse *cache,
+                          const PlasmaControlSystem *control, float *currents) {
+    for (uint32_t c = 0; c < cache->num_pf; c++) {
+        currents[c] = c < NUM_PF_COILS ? control->pf_coil_currents[c] : 0.0f;
+    }
+    for (uint32_t c = 0; c < cache->num_vertical; c++) {
+        currents[cache->num_pf + c] =
+            c < NUM_VERTICAL_COILS ? control->vertical_coil_currents[c] : 0.0f;
+    }
+}
+
+void coil_response_evaluate(const CoilResponse *cache, const float *currents,
+                            float *out) {
+    const uint32_t n = cache->num_coils, stride = cache->stride;
+    for (int row = 0; row < ROWS; row++) {
+        const float *restrict g = cache->response + (size_t)row * stride;
+        float acc = 0.0f;
+        for (uint32_t c = 0; c < n; c++) acc += g[c] * currents[c];
+        out[row] = acc;
+    }
+}
+
+void coil_response_coil_flux(const CoilResponse *cache, const float *currents,
+                             float plasma_current, float *flux) {
+    const uint32_t n = cache->num_coils, stride = cache->stride;
+    const float *restrict M_cp = cache->response + (size_t)COIL_ROW_FLUX * stride;
+    const float Ip = plasma_current * 1e6f;
+    for (uint32_t i = 0; i < n; i++) {
+        const float *restrict M = cache->mutual + (size_t)i * stride;
+        float acc = 0.0f;
+        for (uint32_t c = 0; c < n; c++) acc += M[c] * currents[c];
+        flux[i] = acc + M_cp[i] * Ip;
+    }
+}
+
+float coil_response_vertical_force_per_ma(const CoilResponse *cache,
+                                          const float *out,
+                                          float vertical_position) {
+    float B_r = out[COIL_ROW_BR] + vertical_position * out[COIL_ROW_DBR_DZ];
+    return -(float)(2.0 * M_PI) * cache->plasma_R * 1e6f * B_r;
+}
+
+float coil_response_disruption_forces(const CoilResponse *cache,
+                                      const MachineGeometry *machine,
+                                      const PlasmaState *state,
+                                      const float *currents) {
+    float out[ROWS];
+    coil_response_evaluate(cache, currents, out);
+    float dIp_dt = -state->plasma_current / 0.01f;
+    float B_coil = hypotf(out[COIL_ROW_BR], out[COIL_ROW_BZ]);
+    float lorentz_force = dIp_dt * B_coil * machine->minor_radius;
+    // B_pol enters unsquared, as in calculate_disruption_forces()
+    float B_total = sqrtf(machine->toroidal_field * machine->toroidal_field +
+                          machine->b_pol_per_ma * state->plasma_current);
+    float magnetic_pressure = B_total * B_total / (2.0f * MU0);
+    return lorentz_force + magnetic_pressure * machine->minor_radius;
+}
+
+// ================= BATCHED =================
+void coil_response_evaluate_batch(const CoilResponse *cache,
+                                  const float *const *currents, uint32_t count,
+                                  float *const *out) {
+    const uint32_t n = cache->num_coils, stride = cache->stride;
+    for (int row = 0; row < ROWS; row++) {
+        float *restrict y = out[row];
+        for (uint32_t l = 0; l < count; l++) y[l] = 0.0f;
+    }
+    // Coil-outer so each current array streams once per row block
+    for (uint32_t c = 0; c < n; c++) {
+        const float *restrict I = currents[c];
+        for (int row = 0; row < ROWS; row++) {
+            const float g = cache->response[(size_t)row * stride + c];
+            float *restrict y = out[row];
+            for (uint32_t l = 0; l < count; l++) y[l] += g * I[l];
+        }
+    }
+}
+
+int coil_response_batch_forces(const CoilResponse *cache, const PlasmaBatch *batch,
+                               float *const *out, float *force_per_ma) {
+    if (cache->num_pf > NUM_PF_COILS || cache->num_vertical > NUM_VERTICAL_COILS) {
+        return -1;
+    }
+    const float *currents[NUM_PF_COILS + NUM_VERTICAL_COILS];
+    for (uint32_t c = 0; c < cache->num_pf; c++) currents[c] = batch->pf_coil_currents[c];
+    for (uint32_t c = 0; c < cache->num_vertical; c++) {
+        currents[cache->num_pf + c] = batch->vertical_coil_currents[c];
+    }
+    coil_response_evaluate_batch(cache, currents, batch->count, out);
+
+    const float scale = -(float)(2.0 * M_PI) * cache->plasma_R * 1e6f;
+    const float *restrict B_r = out[COIL_ROW_BR];
+    const float *restrict dB_r = out[COIL_ROW_DBR_DZ];
+    const float *restrict z = batch->vertical_position;
+    for (uint32_t l = 0; l < batch->count; l++) {
+        force_per_ma[l] = scale * (B_r[l] + z[l] * dB_r[l]);
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+#ifndef COIL_RESPONSE_H
+#define COIL_RESPONSE_H
+
+#include "npe_config.h"
+#include "machine_geometry.h"
+#include "plasma_batch.h"
+
+// ================= COIL GREEN'S-FUNCTION CACHE =================
+// Axisymmetric coil set, each coil a circular filament at (R, Z) with a
+// number of turns, and the plasma a filament at its current centroid
+// (R_p, Z_p). Everything that depends on geometry alone is computed once,
+// in double, from the elliptic-integral Green's functions of a loop:
+//
+//   response[row][c]   plasma-side response per ampere in coil c:
+//     COIL_ROW_FLUX      poloidal flux at the centroid, Wb       (M_cp)
+//     COIL_ROW_BR        radial field, T
+//     COIL_ROW_BZ        vertical field, T
+//     COIL_ROW_DBR_DZ    d B_R / dz, T/m, for displaced plasmas
+//   mutual[i][c]       coil-to-coil mutual inductances, H (self on the
+//                      diagonal, from each coil's wire radius)
+//
+// Per step every plasma quantity is then one dense GEMV of the
+// COIL_RESPONSE_ROWS x num_coils response with the current vector, and
+// the coil flux linkages one num_coils-square GEMV, so the cost is set by
+// the coil count alone and the arrays are not bounded by NUM_PF_COILS.
+// coil_response_evaluate_batch() does the same over PlasmaBatch-style
+// lane arrays, one row-by-lanes pass per coil.
+//
+// Coil currents are in amperes per turn, coils ordered PF then vertical.
+// Turns carry the connection polarity: the default vertical coils are
+// up-down pairs in antiseries (turns of opposite sign), so the equal
+// currents the controller writes to every vertical coil give a radial
+// field at the midplane.
+//
+// Machine file: one coil per line, '#' starts a comment,
+//   pf        R Z turns [wire_radius]
+//   vertical  R Z turns [wire_radius]
+//   plasma    R Z                      (centroid; default R0, 0)
+// with lengths in m. Lines may come in any order; the coils keep file
+// order within each kind.
+
+#define COIL_RESPONSE_ROWS 4
+#define COIL_RESPONSE_ALIGN 64
+#define COIL_RESPONSE_MAX_COILS 1024
+#define COIL_WIRE_RADIUS_DEFAULT 0.1f   // m, when the file gives none
+
+enum { COIL_ROW_FLUX, COIL_ROW_BR, COIL_ROW_BZ, COIL_ROW_DBR_DZ };
+
+typedef struct {
+    float R;                        // m
+    float Z;                        // m
+    float turns;                    // signed
+    float wire_radius;              // m, for the self-inductance
+} CoilSpec;
+
+typedef struct {
+    uint32_t num_pf;
+    uint32_t num_vertical;
+    uint32_t num_coils;
+    uint32_t stride;                // row stride of both matrices, floats
+    float plasma_R;                 // m
+    float plasma_Z;                 // m
+    float *response;                // COIL_RESPONSE_ROWS x stride
+    float *mutual;                  // num_coils x stride
+    void *block;
+} CoilResponse;
+
+// Builds the cache for num_pf PF coils followed by num_vertical vertical
+// coils. Returns -1 for no coils, more than COIL_RESPONSE_MAX_COILS, a
+// coil or centroid off R > 0, coincident filaments, or a failed
+// allocation.
+int coil_response_build(CoilResponse *cache, const CoilSpec *coils,
+                        uint32_t num_pf, uint32_t num_vertical,
+                        float plasma_R, float plasma_Z);
+
+// The machine's coil counts on a generic layout: PF coils evenly around
+// the plasma at 2a from the magnetic axis, vertical coils as antiseries
+// pairs above and below it at z = +-1.5a, spread evenly over R0 +- a/2.
+// machines/npe_psq_default.coils is this layout for machine_default.
+int coil_response_default(CoilResponse *cache, const MachineGeometry *machine);
+
+// Returns -1 if the file cannot be read, a line does not parse, or
+// coil_response_build() fails.
+int coil_response_load(CoilResponse *cache, const char *path);
+
+void coil_response_free(CoilResponse *cache);
+
+// Current vector of a shot: pf_coil_currents then vertical_coil_currents,
+// coils beyond the NUM_* capacities at zero
+void coil_response_gather(const CoilResponse *cache,
+                          const PlasmaControlSystem *control, float *currents);
+
+// out[COIL_RESPONSE_ROWS] = response * currents
+void coil_response_evaluate(const CoilResponse *cache, const float *currents,
+                            float *out);
+
+// flux[num_coils] = mutual * currents + M_cp * Ip, Wb (Ip in MA)
+void coil_response_coil_flux(const CoilResponse *cache, const float *currents,
+                             float plasma_current, float *flux);
+
+// Vertical force per MA of plasma current on a ring displaced by z from
+// the centroid, F_z = -2 pi R_p Ip B_R(z), N/MA
+float coil_response_vertical_force_per_ma(const CoilResponse *cache,
+                                          const float *out,
+                                          float vertical_position);
+
+// calculate_disruption_forces() with the coil field at the plasma taken
+// from the cache, |B_pol coils| = |(B_R, B_Z)|, instead of the per-coil
+// I / (2 pi R0) sum over the PF coils
+float coil_response_disruption_forces(const CoilResponse *cache,
+                                      const MachineGeometry *machine,
+                                      const PlasmaState *state,
+                                      const float *currents);
+
+// Batched: currents[c] and out[row] are lane arrays of count entries.
+void coil_response_evaluate_batch(const CoilResponse *cache,
+                                  const float *const *currents, uint32_t count,
+                                  float *const *out);
+
+// Vertical force per MA for every shot in a PlasmaBatch on machine_default
+// sized coil arrays; out[row] are caller lane arrays of batch->capacity,
+// force_per_ma[batch->count]. Returns -1 if the cache has more PF or
+// vertical coils than the batch carries.
+int coil_response_batch_forces(const CoilResponse *cache, const PlasmaBatch *batch,
+                               float *const *out, float *force_per_ma);
+
+#endif // COIL_RESPONSE_H
@@ -0,0 +1,240 @@
+#include "confinement_scaling.h"
+#include <string.h>
+
+// Kernels use bit manipulation and selects only: no branches, no libm, no
+// 64-bit arithmetic shifts and no float->int conversions. That lets GCC
+// vectorize them on SSE2 and AVX2 as well as AVX-512. They rely on IEEE
+// evaluation order.
+
+// ================= SINGLE-PRECISION KERNELS =================
+
+// log2(m) = 2/ln2 * atanh(t), t = (m - 1) / (m + 1), |t| <= 0.1716
+#define LOG2F_C1 (float)(2.0 / M_LN2)
+#define LOG2F_C3 (float)(2.0 / M_LN2 / 3.0)
+#define LOG2F_C5 (float)(2.0 / M_LN2 / 5.0)
+#define LOG2F_C7 (float)(2.0 / M_LN2 / 7.0)
+#define LOG2F_C9 (float)(2.0 / M_LN2 / 9.0)
+
+static inline float fast_log2f(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    float e = (float)(int32_t)(bits >> 23) - 127.0f;
+    uint32_t mantissa = (bits & 0x007fffffu) | 0x3f800000u;
+    float m;
+    memcpy(&m, &mantissa, sizeof(m));
+    // Centre the mantissa on 1: [sqrt(1/2), sqrt(2))
+    bool high = m > (float)M_SQRT2;
+    m *= high ? 0.5f : 1.0f;
+    e += high ? 1.0f : 0.0f;
+
+    float t = (m - 1.0f) / (m + 1.0f);
+    float t2 = t * t;
+    float p = LOG2F_C9;
+    p = p * t2 + LOG2F_C7;
+    p = p * t2 + LOG2F_C5;
+    p = p * t2 + LOG2F_C3;
+    p = p * t2 + LOG2F_C1;
+    return e + t * p;
+}
+
+// 2^f = exp(f ln2), Taylor to degree 7 on |f| <= 0.5
+#define EXP2F_C1 (float)(M_LN2)
+#define EXP2F_C2 (float)(M_LN2 * M_LN2 / 2.0)
+#define EXP2F_C3 (float)(M_LN2 * M_LN2 * M_LN2 / 6.0)
+#define EXP2F_C4 (float)(M_LN2 * M_LN2 * M_LN2 * M_LN2 / 24.0)
+#define EXP2F_C5 (float)(M_LN2 * M_LN2 * M_LN2 * M_LN2 * M_LN2 / 120.0)
+#define EXP2F_C6 (float)(M_LN2 * M_LN2 * M_LN2 * M_LN2 * M_LN2 * M_LN2 / 720.0)
+#define EXP2F_C7 (float)(M_LN2 * M_LN2 * M_LN2 * M_LN2 * M_LN2 * M_LN2 * M_LN2 / 5040.0)
+#define ROUND_MAGIC_F 0x1.8p23f
+#define ROUND_MAGIC 0x1.8p52
+
+// 2^k * 2^f for an integer-valued k in [-126, 127] and |f| <= 0.5. The
+// caller splits the exponent, so the fraction keeps its own precision.
+static inline float fast_exp2f(float k, float f) {
+    // Adding 1.5 * 2^23 holds the integer k in the low mantissa bits
+    float shifted = k + ROUND_MAGIC_F;
+    uint32_t k_bits;
+    memcpy(&k_bits, &shifted, sizeof(k_bits));
+
+    float p = EXP2F_C7;
+    p = p * f + EXP2F_C6;
+    p = p * f + EXP2F_C5;
+    p = p * f + EXP2F_C4;
+    p = p * f + EXP2F_C3;
+    p = p * f + EXP2F_C2;
+    p = p * f + EXP2F_C1;
+    p = p * f + 1.0f;
+
+    uint32_t bits;
+    memcpy(&bits, &p, sizeof(bits));
+    bits += k_bits << 23;
+    memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+// ================= DOUBLE-PRECISION KERNELS =================
+
+#define LOG2_C1 (2.0 / M_LN2)
+#define LOG2_C3 (2.0 / M_LN2 / 3.0)
+#define LOG2_C5 (2.0 / M_LN2 / 5.0)
+#define LOG2_C7 (2.0 / M_LN2 / 7.0)
+#define LOG2_C9 (2.0 / M_LN2 / 9.0)
+#define LOG2_C11 (2.0 / M_LN2 / 11.0)
+#define LOG2_C13 (2.0 / M_LN2 / 13.0)
+
+static inline double accurate_log2(double x) {
+    uint64_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    // The biased exponent fits in 32 bits, so convert through int32_t
+    double e = (double)(int32_t)(uint32_t)(bits >> 52) - 1023.0;
+    uint64_t mantissa = (bits & 0x000fffffffffffffull) | 0x3ff0000000000000ull;
+    double m;
+    memcpy(&m, &mantissa, sizeof(m));
+    bool high = m > M_SQRT2;
+    m *= high ? 0.5 : 1.0;
+    e += high ? 1.0 : 0.0;
+
+    double t = (m - 1.0) / (m + 1.0);
+    double t2 = t * t;
+    double p = LOG2_C13;
+    p = p * t2 + LOG2_C11;
+    p = p * t2 + LOG2_C9;
+    p = p * t2 + LOG2_C7;
+    p = p * t2 + LOG2_C5;
+    p = p * t2 + LOG2_C3;
+    p = p * t2 + LOG2_C1;
+    return e + t * p;
+}
+
+#define EXP2_C1 M_LN2
+#define EXP2_C2 (EXP2_C1 * M_LN2 / 2.0)
+#define EXP2_C3 (EXP2_C2 * M_LN2 / 3.0)
+#define EXP2_C4 (EXP2_C3 * M_LN2 / 4.0)
+#define EXP2_C5 (EXP2_C4 * M_LN2 / 5.0)
+#define EXP2_C6 (EXP2_C5 * M_LN2 / 6.0)
+#define EXP2_C7 (EXP2_C6 * M_LN2 / 7.0)
+#define EXP2_C8 (EXP2_C7 * M_LN2 / 8.0)
+#define EXP2_C9 (EXP2_C8 * M_LN2 / 9.0)
+#define EXP2_C10 (EXP2_C9 * M_LN2 / 10.0)
+#define EXP2_C11 (EXP2_C10 * M_LN2 / 11.0)
+
+// Taylor to degree 11 on |f| <= 0.5, truncation below 1e-14
+static inline double accurate_exp2(double y) {
+    y = y < -1022.0 ? -1022.0 : y;
+    y = y > 1023.0 ? 1023.0 : y;
+    double shifted = y + ROUND_MAGIC;
+    double k = shifted - ROUND_MAGIC;
+    uint64_t k_bits;
+    memcpy(&k_bits, &shifted, sizeof(k_bits));
+    double f = y - k;
+
+    double p = EXP2_C11;
+    p = p * f + EXP2_C10;
+    p = p * f + EXP2_C9;
+    p = p * f + EXP2_C8;
+    p = p * f + EXP2_C7;
+    p = p * f + EXP2_C6;
+    p = p * f + EXP2_C5;
+    p = p * f + EXP2_C4;
+    p = p * f + EXP2_C3;
+    p = p * f + EXP2_C2;
+    p = p * f + EXP2_C1;
+    p = p * f + 1.0;
+
+    uint64_t bits;
+    memcpy(&bits, &p, sizeof(bits));
+    bits += k_bits << 52;
+    memcpy(&p, &bits, sizeof(p));
+    return p;
+}
+
+// ================= SCALING LAW =================
+
+// Exponents of energy_confinement_time()
+#define TAU_E_EXPONENT_CURRENT 0.93f
+#define TAU_E_EXPONENT_DENSITY 0.41f
+#define TAU_E_EXPONENT_ELONGATION 0.78f
+#define TAU_E_EXPONENT_POWER -0.69f
+
+void tau_e_scaling_init(TauEScaling *law, const MachineGeometry *machine) {
+    law->exponent_current = TAU_E_EXPONENT_CURRENT;
+    law->exponent_density = TAU_E_EXPONENT_DENSITY;
+    law->exponent_elongation = TAU_E_EXPONENT_ELONGATION;
+    law->exponent_power = TAU_E_EXPONENT_POWER;
+    // n = 0.1 * density_core is folded into the constant
+    law->log2_coefficient = log2((double)machine->tau_geometry) +
+                            (double)TAU_E_EXPONENT_DENSITY * log2(0.1);
+}
+
+// Coefficients passed by value so the batch loops see invariant scalars.
+// The fast law keeps them in double for the sum of the log terms.
+typedef struct {
+    double c0, a_ip, a_n, a_kappa, a_p;
+} FastLaw;
+
+typedef struct {
+    double c0, a_ip, a_n, a_kappa, a_p;
+} AccurateLaw;
+
+static inline FastLaw fast_law(const TauEScaling *law) {
+    return (FastLaw){ law->log2_coefficient, law->exponent_current,
+                      law->exponent_density, law->exponent_elongation,
+                      law->exponent_power };
+}
+
+static inline AccurateLaw accurate_law(const TauEScaling *law) {
+    return (AccurateLaw){ law->log2_coefficient, law->exponent_current,
+                          law->exponent_density, law->exponent_elongation,
+                          law->exponent_power };
+}
+
+// Float log2s, summed in double: a float sum of terms up to ~8 costs up
+// to 18 ULP of tau_E, more than the kernels themselves
+static inline float tau_e_fast(FastLaw c, float Ip, float n, float kappa, float P) {
+    double y = c.c0 + c.a_ip * fast_log2f(Ip) + c.a_n * fast_log2f(n) +
+               c.a_kappa * fast_log2f(kappa) + c.a_p * fast_log2f(P);
+    // Selects rather than fmin/fmax, which do not vectorize without -ffast-math
+    y = y < -126.0 ? -126.0 : y;
+    y = y > 127.0 ? 127.0 : y;
+    double k = (y + ROUND_MAGIC) - ROUND_MAGIC;
+    return fast_exp2f((float)k, (float)(y - k));
+}
+
+static inline float tau_e_accurate(AccurateLaw c, float Ip, float n,
+                                   float kappa, float P) {
+    double y = c.c0 + c.a_ip * accurate_log2(Ip) + c.a_n * accurate_log2(n) +
+               c.a_kappa * accurate_log2(kappa) + c.a_p * accurate_log2(P);
+    return (float)accurate_exp2(y);
+}
+
+float tau_e_evaluate(const TauEScaling *law, TauEMode mode,
+                     float plasma_current, float density_core,
+                     float elongation, float heating_power) {
+    if (mode == TAU_E_FAST) {
+        return tau_e_fast(fast_law(law), plasma_current, density_core,
+                          elongation, heating_power);
+    }
+    return tau_e_accurate(accurate_law(law), plasma_current, density_core,
+                          elongation, heating_power);
+}
+
+void tau_e_evaluate_batch(const TauEScaling *law, TauEMode mode,
+                          const float *plasma_current, const float *density_core,
+                          const float *elongation, const float *heating_power,
+                          float *tau_E, uint32_t count) {
+    if (mode == TAU_E_FAST) {
+        const FastLaw c = fast_law(law);
+#pragma GCC ivdep
+        for (uint32_t i = 0; i < count; i++) {
+            tau_E[i] = tau_e_fast(c, plasma_current[i], density_core[i],
+                                  elongation[i], heating_power[i]);
+        }
+        return;
+    }
+    const AccurateLaw c = accurate_law(law);
+#pragma GCC ivdep
+    for (uint32_t i = 0; i < count; i++) {
+        tau_E[i] = tau_e_accurate(c, plasma_current[i], density_core[i],
+                                  elongation[i], heating_power[i]);
+    }
+}
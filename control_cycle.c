@@ -0,0 +1,198 @@
+#include "control_cycle.h"
+#include "plasma_physics.h"
+#include <string.h>
+
+// ================= SETUP =================
+void control_cycle_scenario_init(ScenarioState *scenario,
+                                 const PlasmaControlSystem *control) {
+    memset(scenario, 0, sizeof(*scenario));
+    scenario->plasma_current_ref = control->current_state.plasma_current;
+}
+
+void control_cycle_safety_init(CycleSafety *safety) {
+    memset(safety, 0, sizeof(*safety));
+    disruption_predictor_init(&safety->predictor);
+    safety->system.mitigation_systems.massive_gas_injection_ready = true;
+    safety->system.mitigation_systems.pellet_injection_ready = true;
+    safety->system.mitigation_systems.killer_pulse_ready = true;
+}
+
+// ================= ACTUATORS =================
+float control_cycle_vertical_force(const PlasmaState *state, float plasma_volume,
+                                   float dt) {
+    float mass_plasma = plasma_mass(state->density_core, plasma_volume);
+    return -2.0f * mass_plasma * (VERTICAL_FEEDBACK_GAIN + dt) *
+           state->vertical_position / (dt * dt);
+}
+
+void control_cycle_actuators(PlasmaControlSystem *control, ScenarioState *scenario,
+                             float dt) {
+    PlasmaState *s = &control->current_state;
+    float plasma_volume = machine_plasma_volume(&machine_default, s->elongation);
+    bool heating = control->controller_state == PSQ_STATE_RAMP_UP ||
+                   control->controller_state == PSQ_STATE_FLAT_TOP;
+    bool shutdown = control->controller_state == PSQ_STATE_MITIGATION ||
+                    control->controller_state == PSQ_STATE_SAFE_SHUTDOWN;
+
+    // Loop voltage drives Ip towards LOOP_VOLTAGE_PER_PF_CURRENT *
+    // pf_coil_currents[0]; the proportional term makes Ip track the ramp
+    // despite the L/R lag
+    float *Ip_ref = &scenario->plasma_current_ref;
+    if (control->controller_state == PSQ_STATE_RAMP_UP) {
+        *Ip_ref = fminf(*Ip_ref + SCENARIO_RAMP_RATE * dt,
+                        control->target_state.plasma_current);
+    } else if (control->controller_state == PSQ_STATE_RAMP_DOWN) {
+        *Ip_ref = fmaxf(*Ip_ref - SCENARIO_RAMP_RATE * dt, 0.0f);
+    }
+    float V_ref = *Ip_ref + CURRENT_FEEDBACK_GAIN * (*Ip_ref - s->plasma_current);
+    control->pf_coil_currents[0] = shutdown ? 0.0f :
+        V_ref * (1.0f / LOOP_VOLTAGE_PER_PF_CURRENT);
+
+    for (int i = 0; i < NUM_HEATING_SYSTEMS; i++) {
+        control->heating_systems[i].enabled = heating;
+    }
+    control->fuel_injection_rate = shutdown ? 0.0f :
+        control->target_state.density_core * 1e19f * plasma_volume /
+        PARTICLE_CONFINEMENT_TIME;
+
+    float F_needed = control_cycle_vertical_force(s, plasma_volume, dt);
+    float per_coil = 0.0f;
+    if (fabsf(s->plasma_current) > 1e-3f) {
+        per_coil = F_needed / (NUM_VERTICAL_COILS * s->plasma_current *
+                               VERTICAL_FORCE_COUPLING);
+    }
+    if (scenario->vertical_reversed) per_coil = -per_coil;
+    for (int i = 0; i < NUM_VERTICAL_COILS; i++) {
+        control->vertical_coil_currents[i] = per_coil;
+    }
+}
+
+// ================= WARNINGS & SAFETY =================
+void control_cycle_warnings(PlasmaControlSystem *control, float dt) {
+    if (control->current_state.mhd_activity_level > MHD_WARNING_LEVEL) {
+        control->disruption_warning_time += dt;
+    } else {
+        control->disruption_warning_time = 0.0f;
+    }
+    if (control->disruption_warning_time >= DISRUPTION_WARNING_TIME) {
+        control->disruption_detected = true;
+    }
+}
+
+void control_cycle_diagnostics(const PlasmaControlSystem *control,
+                               CycleSafety *safety, MhdSpectrum *mhd,
+                               DiagnosticsSystem *diag) {
+    mhd_probe_signals(&control->current_state, control->simulation_time,
+                      diag->magnetics_probes);
+    mhd_spectrum_push_diagnostics(mhd, diag);
+    mhd_spectrum_update_flags(mhd, &safety->system);
+}
+
+void control_cycle_safety(PlasmaControlSystem *control, CycleSafety *safety,
+                          float dt) {
+    update_disruption_flags(&safety->system, &control->current_state);
+    predict_disruption(&safety->predictor, &control->current_state,
+                       &safety->system, dt, &safety->prediction);
+    select_mitigation(&safety->prediction, &safety->system, &safety->decision);
+
+    MitigationAction action = safety->decision.action;
+    bool hard = action != MITIGATION_NONE && action != MITIGATION_CONTROL_ADJUST &&
+                control->controller_state == PSQ_STATE_FLAT_TOP;
+    bool fire = false;
+    if (hard && !control->disruption_detected) {
+        control->disruption_detected = true;
+        safety->fired = safety->decision;
+        fire = true;
+    } else if (control->disruption_detected && safety->fired.action == MITIGATION_NONE) {
+        // Declared by control_cycle_warnings(): mitigate as for a certain
+        // locked mode
+        const DisruptionPrediction certain = {
+            .disruption_probability = 1.0f,
+            .time_to_disruption = 0.0f,
+            .most_likely_cause = DISRUPTION_CAUSE_LOCKED_MODE,
+        };
+        select_mitigation(&certain, &safety->system, &safety->fired);
+        fire = true;
+    }
+    if (fire) {
+        safety->system.disruption_count++;
+        safety->system.last_disruption_time = control->simulation_time;
+    }
+    if (control->controller_state == PSQ_STATE_MITIGATION) {
+        action = safety->fired.action;
+        safety->system.gas_injection_valve_position =
+            action == MITIGATION_MGI || action == MITIGATION_MGI_KILLERPULSE ? 1.0f : 0.0f;
+        safety->system.pellet_injection_rate = action == MITIGATION_PELLET ? 1.0f : 0.0f;
+        safety->system.killer_pulse_amplitude =
+            action == MITIGATION_KILLERPULSE || action == MITIGATION_MGI_KILLERPULSE ? 1.0f : 0.0f;
+    }
+}
+
+// ================= CONTROLLER STATE =================
+void control_cycle_controller(PlasmaControlSystem *control, ScenarioState *scenario,
+                              float dt) {
+    PlasmaState *s = &control->current_state;
+    float *state_timer = &scenario->state_timer;
+    *state_timer += dt;
+
+    if (control->disruption_detected &&
+        control->controller_state != PSQ_STATE_DISRUPTION &&
+        control->controller_state != PSQ_STATE_MITIGATION &&
+        control->controller_state != PSQ_STATE_SAFE_SHUTDOWN) {
+        control->controller_state = PSQ_STATE_DISRUPTION;
+        *state_timer = 0.0f;
+        return;
+    }
+
+    switch (control->controller_state) {
+    case PSQ_STATE_INIT:
+        control->controller_state = PSQ_STATE_RAMP_UP;
+        *state_timer = 0.0f;
+        break;
+    case PSQ_STATE_RAMP_UP:
+        if (s->plasma_current >= 0.99f * control->target_state.plasma_current) {
+            control->controller_state = PSQ_STATE_FLAT_TOP;
+            *state_timer = 0.0f;
+        }
+        break;
+    case PSQ_STATE_FLAT_TOP:
+        if (*state_timer >= SCENARIO_FLAT_TOP_TIME) {
+            control->controller_state = PSQ_STATE_RAMP_DOWN;
+            *state_timer = 0.0f;
+        }
+        break;
+    case PSQ_STATE_RAMP_DOWN:
+        if (s->plasma_current <= 0.05f && scenario->plasma_current_ref <= 0.0f) {
+            control->controller_state = PSQ_STATE_SAFE_SHUTDOWN;
+            *state_timer = 0.0f;
+        }
+        break;
+    case PSQ_STATE_DISRUPTION:
+        control->mitigation_activated = true;
+        control->controller_state = PSQ_STATE_MITIGATION;
+        *state_timer = 0.0f;
+        break;
+    case PSQ_STATE_MITIGATION:
+        if (*state_timer >= MITIGATION_RESPONSE_TIME) {
+            control->controller_state = PSQ_STATE_SAFE_SHUTDOWN;
+            *state_timer = 0.0f;
+        }
+        break;
+    case PSQ_STATE_SAFE_SHUTDOWN:
+        break;
+    }
+}
+
+// ================= QUENCH =================
+void control_cycle_quench(PlasmaControlSystem *control, CycleSafety *safety,
+                          float dt) {
+    PlasmaState *s = &control->current_state;
+    if (!safety->quench.active) {
+        disruption_quench_begin(&safety->quench, &machine_default, s, control,
+                                QUENCH_PLASMA_RESISTANCE, control->simulation_time);
+    }
+    if (safety->quench.active) {
+        disruption_quench_state(&safety->quench, control->simulation_time + dt,
+                                s, control);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef CONTROL_CYCLE_H
+#define CONTROL_CYCLE_H
+
+#include "npe_config.h"
+#include "disruption_quench.h"
+#include "mhd_spectrum.h"
+#include "plasma_safety.h"
+
+// ================= SCENARIO CONTROL CYCLE =================
+// The scenario controller of simulation_c/npe_psq_core_sim.c, shared
+// with benchmarks/shot_pipeline_bench.c so both run the same shot. One
+// cycle, in order:
+//   control_cycle_actuators()    current, heating, fuelling and vertical laws
+//   plasma step                  the caller's stepper, or control_cycle_quench()
+//                                in DISRUPTION and MITIGATION
+//   control_cycle_warnings()     MHD warning timer
+//   control_cycle_diagnostics()  magnetics probes and MHD mode detection (drivers)
+//   control_cycle_safety()       predictor, mitigation selection and actuators
+//   control_cycle_controller()   controller_state machine
+// then the caller advances simulation_time and iteration_count. Callers
+// may overwrite actuators between the first two steps (the driver's NMPC
+// and --coils vertical law).
+
+// ================= SCENARIO PARAMETERS =================
+#define SCENARIO_PLASMA_CURRENT 2.0f      // MA, keeps q95 above the limit
+#define SCENARIO_FLAT_TOP_TIME 5.0f       // s
+#define SCENARIO_RAMP_RATE 0.5f           // MA/s
+#define CURRENT_FEEDBACK_GAIN 4.0f
+#define MHD_WARNING_LEVEL 0.5f
+#define VERTICAL_FEEDBACK_GAIN 0.5f
+#define QUENCH_PLASMA_RESISTANCE 1.0f     // current_quench_model() argument
+
+typedef struct {
+    float plasma_current_ref;             // ramped current reference, MA
+    float state_timer;                    // time in controller_state, s
+    bool vertical_reversed;               // feedback polarity fault (bench VDE)
+} ScenarioState;
+
+typedef struct {
+    SafetyMitigationSystem system;
+    DisruptionPredictor predictor;
+    DisruptionPrediction prediction;
+    MitigationDecision decision;
+    MitigationDecision fired;             // decision that triggered mitigation
+    DisruptionQuench quench;              // control_cycle_quench() only
+} CycleSafety;
+
+// Starts the current reference at the plasma's present current
+void control_cycle_scenario_init(ScenarioState *scenario,
+                                 const PlasmaControlSystem *control);
+
+// Clears the safety state and arms every mitigation system
+void control_cycle_safety_init(CycleSafety *safety);
+
+// Vertical feedback force, N: cancels the open-loop growth z*dt and
+// removes a VERTICAL_FEEDBACK_GAIN fraction of the displacement each cycle
+float control_cycle_vertical_force(const PlasmaState *state, float plasma_volume,
+                                   float dt);
+
+// Sets the actuators for the current controller state.
+void control_cycle_actuators(PlasmaControlSystem *control, ScenarioState *scenario,
+                             float dt);
+
+// Disruption warning: MHD activity must stay above the warning level for
+// DISRUPTION_WARNING_TIME before the controller declares a disruption.
+void control_cycle_warnings(PlasmaControlSystem *control, float dt);
+
+// Pushes the magnetics probes of the current state into the MHD spectrum;
+// its locked-mode and NTM detections replace the safety flags, ready for
+// control_cycle_safety(). diag receives the probes and, per window, the
+// spectrum and coherence.
+void control_cycle_diagnostics(const PlasmaControlSystem *control,
+                               CycleSafety *safety, MhdSpectrum *mhd,
+                               DiagnosticsSystem *diag);
+
+// Disruption predictor and mitigation selection. The predictor runs every
+// cycle but is only armed in flat-top: the toy start-up and ramp-down
+// trajectories sit far outside the limits it is calibrated for. An armed
+// hard mitigation decision declares the disruption immediately; control
+// adjustments are left to the plasma controller. A disruption declared by
+// the MHD warning (or by the caller) instead gets the action
+// select_mitigation() picks for a certain locked mode. In MITIGATION the
+// fired action drives the gas valve, pellet and killer-pulse actuators.
+void control_cycle_safety(PlasmaControlSystem *control, CycleSafety *safety,
+                          float dt);
+
+void control_cycle_controller(PlasmaControlSystem *control, ScenarioState *scenario,
+                              float dt);
+
+// Plasma step through the closed-form thermal and current quench,
+// started on the first call after the onset
+void control_cycle_quench(PlasmaControlSystem *control, CycleSafety *safety,
+                          float dt);
+
+#endif // CONTROL_CYCLE_H
@@ -0,0 +1,160 @@
+#include "diagnostics_shm.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static void layout_init(DiagShmLayout *layout) {
+    memset(layout, 0, sizeof(*layout));
+    layout->magic = DIAG_SHM_MAGIC;
+    layout->version = DIAG_SHM_VERSION;
+    layout->slot_count = DIAG_SHM_SLOTS;
+    layout->layout_bytes = (uint32_t)sizeof(DiagShmLayout);
+    atomic_init(&layout->latest, 0);
+    for (int i = 0; i < DIAG_SHM_SLOTS; i++) {
+        atomic_init(&layout->slots[i].seq, 0);
+    }
+}
+
+static bool layout_valid(const DiagShmLayout *layout) {
+    return layout->magic == DIAG_SHM_MAGIC &&
+           layout->version == DIAG_SHM_VERSION &&
+           layout->slot_count == DIAG_SHM_SLOTS &&
+           layout->layout_bytes == sizeof(DiagShmLayout);
+}
+
+// Reattach to a previous writer's segment without disturbing its readers:
+// the cursor continues past the newest published frame, and a slot left
+// odd by a writer that died mid-frame is closed (its sequence made even
+// again, so the next write_begin() reopens it as usual). That slot is
+// never the published one, so readers never see its torn data.
+static void layout_resume(DiagShmLayout *layout) {
+    uint64_t latest = atomic_load_explicit(&layout->latest, memory_order_acquire);
+    if (layout->next_frame < latest) layout->next_frame = latest;
+    for (int i = 0; i < DIAG_SHM_SLOTS; i++) {
+        uint32_t seq = atomic_load_explicit(&layout->slots[i].seq, memory_order_relaxed);
+        if (seq & 1u) {
+            atomic_store_explicit(&layout->slots[i].seq, seq + 1, memory_order_release);
+        }
+    }
+}
+
+int diag_shm_create(DiagShm *shm, const char *name) {
+    memset(shm, 0, sizeof(*shm));
+    snprintf(shm->name, sizeof(shm->name), "%s", name);
+    shm->fd = shm_open(name, O_CREAT | O_RDWR, 0660);
+    if (shm->fd < 0) return -1;
+    if (ftruncate(shm->fd, sizeof(DiagShmLayout)) != 0) {
+        close(shm->fd);
+        return -1;
+    }
+    void *p = mmap(NULL, sizeof(DiagShmLayout), PROT_READ | PROT_WRITE,
+                   MAP_SHARED, shm->fd, 0);
+    if (p == MAP_FAILED) {
+        close(shm->fd);
+        return -1;
+    }
+    shm->layout = p;
+    shm->writer = true;
+    if (layout_valid(shm->layout)) {
+        layout_resume(shm->layout);
+    } else {
+        layout_init(shm->layout);
+    }
+    return 0;
+}
+
+int diag_shm_open(DiagShm *shm, const char *name) {
+    memset(shm, 0, sizeof(*shm));
+    snprintf(shm->name, sizeof(shm->name), "%s", name);
+    shm->fd = shm_open(name, O_RDONLY, 0);
+    if (shm->fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(shm->fd, &st) != 0 || (size_t)st.st_size < sizeof(DiagShmLayout)) {
+        close(shm->fd);
+        return -1;
+    }
+    void *p = mmap(NULL, sizeof(DiagShmLayout), PROT_READ, MAP_SHARED, shm->fd, 0);
+    if (p == MAP_FAILED) {
+        close(shm->fd);
+        return -1;
+    }
+    shm->layout = p;
+    if (!layout_valid(shm->layout)) {
+        diag_shm_close(shm, false);
+        return -1;
+    }
+    return 0;
+}
+
+void diag_shm_close(DiagShm *shm, bool unlink) {
+    if (shm->fd >= 0 && shm->layout) {
+        munmap(shm->layout, sizeof(DiagShmLayout));
+        close(shm->fd);
+        if (unlink && shm->writer) shm_unlink(shm->name);
+    }
+    shm->layout = NULL;
+    shm->fd = -1;
+}
+
+void diag_shm_init_local(DiagShm *shm, DiagShmLayout *layout) {
+    memset(shm, 0, sizeof(*shm));
+    shm->fd = -1;
+    shm->layout = layout;
+    shm->writer = true;
+    layout_init(layout);
+}
+
+DiagnosticsSystem *diag_shm_write_begin(DiagShm *shm) {
+    DiagShmLayout *layout = shm->layout;
+    DiagShmSlot *slot = &layout->slots[layout->next_frame % DIAG_SHM_SLOTS];
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return &slot->data;
+}
+
+void diag_shm_write_commit(DiagShm *shm, uint64_t timestamp_ns) {
+    DiagShmLayout *layout = shm->layout;
+    uint64_t frame = layout->next_frame;
+    DiagShmSlot *slot = &layout->slots[frame % DIAG_SHM_SLOTS];
+    slot->frame_id = frame;
+    slot->timestamp_ns = timestamp_ns;
+
+    uint32_t seq = atomic_load_explicit(&slot->seq, memory_order_relaxed);
+    atomic_store_explicit(&slot->seq, seq + 1, memory_order_release);
+    atomic_store_explicit(&layout->latest, frame + 1, memory_order_release);
+    layout->next_frame = frame + 1;
+}
+
+const DiagnosticsSystem *diag_shm_read_begin(const DiagShm *shm,
+                                             DiagShmReadToken *token) {
+    DiagShmLayout *layout = shm->layout;
+    for (;;) {
+        uint64_t latest = atomic_load_explicit(&layout->latest, memory_order_acquire);
+        if (latest == 0) return NULL;
+
+        const DiagShmSlot *slot = &layout->slots[(latest - 1) % DIAG_SHM_SLOTS];
+        uint32_t seq = atomic_load_explicit(&((DiagShmSlot *)slot)->seq,
+                                            memory_order_acquire);
+        // Odd: the writer has lapped us and is rewriting this slot. It only
+        // reaches it two frames after publishing, so a newer frame is ready.
+        if (seq & 1u) continue;
+
+        token->slot = slot;
+        token->seq = seq;
+        token->frame_id = latest - 1;
+        return &slot->data;
+    }
+}
+
+bool diag_shm_read_end(const DiagShm *shm, const DiagShmReadToken *token) {
+    (void)shm;
+    atomic_thread_fence(memory_order_acquire);
+    uint32_t seq = atomic_load_explicit(&((DiagShmSlot *)token->slot)->seq,
+                                        memory_order_relaxed);
+    return seq == token->seq;
+}
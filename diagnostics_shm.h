@@ -0,0 +1,88 @@
+#ifndef DIAGNOSTICS_SHM_H
+#define DIAGNOSTICS_SHM_H
+
+#include "npe_config.h"
+#include <stdatomic.h>
+
+// ================= DIAGNOSTICS SHARED-MEMORY INGEST =================
+// The acquisition process writes DiagnosticsSystem frames straight into a
+// triple-buffered shared-memory segment; the controller reads the latest
+// complete frame in place. Each slot carries a sequence lock, so the
+// reader never copies and never writes to the segment (it can be mapped
+// read-only), and the writer never waits for the reader.
+//
+// Writer:  DiagnosticsSystem *d = diag_shm_write_begin(shm);
+//          ... fill d ...
+//          diag_shm_write_commit(shm, timestamp_ns);
+//
+// Reader:  DiagShmReadToken t;
+//          const DiagnosticsSystem *d = diag_shm_read_begin(shm, &t);
+//          ... use d ...
+//          if (!diag_shm_read_end(shm, &t)) { frame was overwritten, retry }
+//
+// Everything the writer touches per frame and everything the reader polls
+// sit on separate cache lines.
+
+#define DIAG_SHM_MAGIC 0x4e504544u      // "NPED"
+#define DIAG_SHM_VERSION 1u
+#define DIAG_SHM_SLOTS 3
+#define DIAG_SHM_CACHE_LINE 64
+
+typedef struct {
+    _Alignas(DIAG_SHM_CACHE_LINE) _Atomic uint32_t seq;     // odd while being written
+    uint32_t reserved;
+    uint64_t frame_id;
+    uint64_t timestamp_ns;
+    _Alignas(DIAG_SHM_CACHE_LINE) DiagnosticsSystem data;
+} DiagShmSlot;
+
+typedef struct {
+    // Read-only after creation
+    _Alignas(DIAG_SHM_CACHE_LINE) uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t layout_bytes;
+
+    // Published by the writer
+    _Alignas(DIAG_SHM_CACHE_LINE) _Atomic uint64_t latest;  // frame_id + 1 of the newest complete frame, 0 if none
+
+    // Writer-private cursor (kept in the segment so a restarted writer resumes)
+    _Alignas(DIAG_SHM_CACHE_LINE) uint64_t next_frame;
+
+    DiagShmSlot slots[DIAG_SHM_SLOTS];
+} DiagShmLayout;
+
+typedef struct {
+    DiagShmLayout *layout;
+    int fd;
+    bool writer;
+    char name[64];
+} DiagShm;
+
+typedef struct {
+    const DiagShmSlot *slot;
+    uint32_t seq;
+    uint64_t frame_id;
+} DiagShmReadToken;
+
+// Creates (writer) or opens read-only (reader) a named POSIX shm segment.
+// Both return 0 on success and -1 on failure. Create reattaches to an
+// existing segment of this layout and version, keeping its frames and
+// cursor, so attached readers carry on across a writer restart; anything
+// else is reinitialised. One writer at a time.
+int diag_shm_create(DiagShm *shm, const char *name);
+int diag_shm_open(DiagShm *shm, const char *name);
+void diag_shm_close(DiagShm *shm, bool unlink);
+
+// Places the layout in caller memory instead, for in-process use.
+void diag_shm_init_local(DiagShm *shm, DiagShmLayout *layout);
+
+DiagnosticsSystem *diag_shm_write_begin(DiagShm *shm);
+void diag_shm_write_commit(DiagShm *shm, uint64_t timestamp_ns);
+
+// Returns NULL if no frame has been published yet.
+const DiagnosticsSystem *diag_shm_read_begin(const DiagShm *shm,
+                                             DiagShmReadToken *token);
+bool diag_shm_read_end(const DiagShm *shm, const DiagShmReadToken *token);
+
+#endif // DIAGNOSTICS_SHM_H
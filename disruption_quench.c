@@ -0,0 +1,108 @@
+#include "disruption_quench.h"
+#include "plasma_physics.h"
+#include <string.h>
+
+#define QUENCH_BISECTION_STEPS 60
+
+// Ip(t) / I0 of current_quench_model(), in double
+static double current_fraction(double t, double k) {
+    return exp(-t / CURRENT_QUENCH_TIME) * (1.0 - k * t);
+}
+
+// Time after the TQ at which Ip falls to `fraction` of I0. Both factors
+// of the model decrease, so the root lies below the pure exponential's
+// and below the zero of (1 - k t).
+static double current_fraction_time(double fraction, double k) {
+    double hi = CURRENT_QUENCH_TIME * log(1.0 / fraction);
+    if (k > 0.0 && 1.0 / k < hi) hi = 1.0 / k;
+    double lo = 0.0;
+    for (int i = 0; i < QUENCH_BISECTION_STEPS; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (current_fraction(mid, k) > fraction) lo = mid; else hi = mid;
+    }
+    return 0.5 * (lo + hi);
+}
+
+static float disruption_force_at(const MachineGeometry *machine,
+                                 const PlasmaState *state,
+                                 const PlasmaControlSystem *control,
+                                 float plasma_current) {
+    PlasmaState probe = *state;
+    float coil_currents[NUM_PF_COILS];
+    memcpy(coil_currents, control->pf_coil_currents, sizeof(coil_currents));
+    probe.plasma_current = plasma_current;
+    return calculate_disruption_forces_machine(machine, &probe, coil_currents);
+}
+
+int disruption_quench_begin(DisruptionQuench *quench,
+                            const MachineGeometry *machine,
+                            const PlasmaState *state,
+                            const PlasmaControlSystem *control,
+                            float plasma_resistance, float onset_time) {
+    memset(quench, 0, sizeof(*quench));
+    float W0 = control->stored_energy;
+    float I0 = state->plasma_current;
+    if (W0 <= 0.0f && I0 <= 0.0f) return -1;
+
+    quench->onset_time = onset_time;
+    quench->initial_energy = W0 > 0.0f ? W0 : 0.0f;
+    quench->initial_current = I0 > 0.0f ? I0 : 0.0f;
+    quench->impurity_concentration = state->impurity_concentration;
+    quench->plasma_resistance = plasma_resistance;
+    float plasma_volume = machine_plasma_volume(machine, state->elongation);
+    quench->energy_to_temperature = 1e6 / (1.5f * state->density_core * 1e19 *
+                                           plasma_volume * ELECTRON_CHARGE * 1000.0f);
+
+    // W0 (1 - impurity / 2) exp(-t / tau_TQ) = QUENCH_END_FRACTION W0
+    double retained = 1.0 - 0.5 * quench->impurity_concentration;
+    double t_TQ = retained > QUENCH_END_FRACTION ?
+                  THERMAL_QUENCH_TIME * log(retained / QUENCH_END_FRACTION) : 0.0;
+    quench->thermal_quench_end = (float)t_TQ;
+
+    // dIp/dt = -I0 exp(-t/tau) ((1 - k t) / tau + k) with k = 0.1 R; its
+    // magnitude decreases while Ip > 0, so the peak is at the CQ start
+    double k = 0.1 * plasma_resistance;
+    if (quench->initial_current > 0.0f) {
+        double t_end = current_fraction_time(QUENCH_END_FRACTION, k);
+        double t80 = current_fraction_time(QUENCH_CQ_UPPER_FRACTION, k);
+        double t20 = current_fraction_time(QUENCH_CQ_LOWER_FRACTION, k);
+        quench->current_quench_end = (float)(t_TQ + t_end);
+        quench->current_quench_duration = (float)((t20 - t80) /
+            (QUENCH_CQ_UPPER_FRACTION - QUENCH_CQ_LOWER_FRACTION));
+        quench->peak_dIp_dt = (float)(-quench->initial_current *
+                                      (1.0 / CURRENT_QUENCH_TIME + k));
+        quench->peak_dIp_dt_time = (float)t_TQ;
+    } else {
+        quench->current_quench_end = (float)t_TQ;
+    }
+
+    // The force model is linear in Ip: compare the two ends of the quench
+    float I_end = quench->initial_current * QUENCH_END_FRACTION;
+    float F_start = disruption_force_at(machine, state, control,
+                                        quench->initial_current);
+    float F_end = disruption_force_at(machine, state, control, I_end);
+    bool start = fabsf(F_start) >= fabsf(F_end);
+    quench->peak_force = start ? F_start : F_end;
+    quench->peak_force_time = start ? 0.0f : quench->current_quench_end;
+
+    quench->active = true;
+    return 0;
+}
+
+void disruption_quench_state(const DisruptionQuench *quench, float time,
+                             PlasmaState *state, PlasmaControlSystem *control) {
+    float t = time - quench->onset_time;
+    if (t < 0.0f) t = 0.0f;
+    float W = thermal_quench_model(t, quench->initial_energy,
+                                   quench->impurity_concentration);
+    float Ip = quench->initial_current;
+    if (t > quench->thermal_quench_end) {
+        Ip = current_quench_model(t - quench->thermal_quench_end,
+                                  quench->initial_current,
+                                  quench->plasma_resistance);
+        Ip = Ip > 0.0f ? Ip : 0.0f;
+    }
+    control->stored_energy = W;
+    state->plasma_current = Ip;
+    state->temperature_core = W * quench->energy_to_temperature;
+}
@@ -0,0 +1,64 @@
+#ifndef DISRUPTION_QUENCH_H
+#define DISRUPTION_QUENCH_H
+
+#include "npe_config.h"
+#include "machine_geometry.h"
+
+// ================= ANALYTIC DISRUPTION QUENCH =================
+// Closed-form passage through a disruption, built on the models of
+// plasma_physics.c. At onset the thermal quench starts:
+//   W(t) = thermal_quench_model(t, W0, impurity_concentration).
+// Ip holds at I0 until W falls to QUENCH_END_FRACTION of W0 (the TQ end,
+// t_TQ). The current quench then follows:
+//   Ip(t) = current_quench_model(t - t_TQ, I0, plasma_resistance),
+// clamped at zero.
+//
+// disruption_quench_begin() derives every event in one call, with no time
+// stepping, for disruption-loading studies.
+// disruption_quench_state() sets the plasma to its closed-form value at any
+// time, so a simulation can cross the DISRUPTION and MITIGATION states at
+// its normal dt instead of the microsecond steps that tau_TQ needs.
+//
+// The quench models are monotone: |dIp/dt| peaks at the start of the CQ,
+// and calculate_disruption_forces() is linear in Ip, so its extremum over
+// the quench is at I0 or at the final current. Both peaks are therefore
+// exact, not sampled.
+
+#define QUENCH_END_FRACTION 0.01f
+#define QUENCH_CQ_UPPER_FRACTION 0.8f   // CQ duration from the 80%-20% fall
+#define QUENCH_CQ_LOWER_FRACTION 0.2f
+
+typedef struct {
+    bool active;
+    float onset_time;               // s, simulation time of the onset
+    float initial_energy;           // MJ
+    float initial_current;          // MA
+    float impurity_concentration;
+    float plasma_resistance;        // as passed to current_quench_model()
+    float energy_to_temperature;    // keV per MJ at the onset density
+
+    // Events, s after onset unless noted
+    float thermal_quench_end;
+    float current_quench_end;       // Ip down to QUENCH_END_FRACTION
+    float current_quench_duration;  // (t20 - t80) / 0.6, s
+    float peak_dIp_dt;              // MA/s, most negative
+    float peak_dIp_dt_time;
+    float peak_force;               // calculate_disruption_forces(), largest |F|
+    float peak_force_time;
+} DisruptionQuench;
+
+// Starts a quench from the current state at simulation time onset_time.
+// Returns -1, leaving the quench inactive, if there is no energy or
+// current to quench.
+int disruption_quench_begin(DisruptionQuench *quench,
+                            const MachineGeometry *machine,
+                            const PlasmaState *state,
+                            const PlasmaControlSystem *control,
+                            float plasma_resistance, float onset_time);
+
+// Plasma current, stored energy and core temperature at simulation time
+// `time`, from the closed forms; other fields are left unchanged.
+void disruption_quench_state(const DisruptionQuench *quench, float time,
+                             PlasmaState *state, PlasmaControlSystem *control);
+
+#endif // DISRUPTION_QUENCH_H
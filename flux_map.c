@@ -0,0 +1,166 @@
+#include "flux_map.h"
+#include "machine_geometry.h"
+#include <stdlib.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define FLUX_MAP_STACK_COLUMNS 4096
+
+typedef struct {
+    float R0;
+    float p0;
+    float a2;
+    float inv_a2;
+} FluxCoefficients;
+
+static inline FluxCoefficients flux_coefficients(const float *params) {
+    FluxCoefficients c;
+    c.R0 = machine_default.major_radius;
+    c.p0 = params[0];
+    c.a2 = machine_default.minor_radius * machine_default.minor_radius;
+    c.inv_a2 = 1.0f / c.a2;
+    return c;
+}
+
+static inline float flux_scalar(float d2, const FluxCoefficients *c) {
+    float psi = c->p0 * (1.0f - d2 * c->inv_a2);
+    return d2 < c->a2 ? psi : 0.0f;
+}
+
+// psi for one row: d2 = dR2[i] + z2
+static void flux_row(const float *restrict dR2, float z2,
+                     const FluxCoefficients *c, float *restrict out, uint32_t n) {
+    uint32_t i = 0;
+#if defined(__AVX512F__)
+    const __m512 vz2 = _mm512_set1_ps(z2);
+    const __m512 vp0 = _mm512_set1_ps(c->p0);
+    const __m512 va2 = _mm512_set1_ps(c->a2);
+    const __m512 vinv = _mm512_set1_ps(c->inv_a2);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    for (; i + 16 <= n; i += 16) {
+        __m512 d2 = _mm512_add_ps(_mm512_loadu_ps(dR2 + i), vz2);
+        __m512 psi = _mm512_mul_ps(vp0, _mm512_sub_ps(one, _mm512_mul_ps(d2, vinv)));
+        __mmask16 inside = _mm512_cmp_ps_mask(d2, va2, _CMP_LT_OQ);
+        _mm512_storeu_ps(out + i, _mm512_maskz_mov_ps(inside, psi));
+    }
+#elif defined(__AVX2__)
+    const __m256 vz2 = _mm256_set1_ps(z2);
+    const __m256 vp0 = _mm256_set1_ps(c->p0);
+    const __m256 va2 = _mm256_set1_ps(c->a2);
+    const __m256 vinv = _mm256_set1_ps(c->inv_a2);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m256 d2 = _mm256_add_ps(_mm256_loadu_ps(dR2 + i), vz2);
+        __m256 psi = _mm256_mul_ps(vp0, _mm256_sub_ps(one, _mm256_mul_ps(d2, vinv)));
+        __m256 inside = _mm256_cmp_ps(d2, va2, _CMP_LT_OQ);
+        _mm256_storeu_ps(out + i, _mm256_and_ps(inside, psi));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t vz2 = vdupq_n_f32(z2);
+    const float32x4_t vp0 = vdupq_n_f32(c->p0);
+    const float32x4_t va2 = vdupq_n_f32(c->a2);
+    const float32x4_t vinv = vdupq_n_f32(c->inv_a2);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t d2 = vaddq_f32(vld1q_f32(dR2 + i), vz2);
+        float32x4_t psi = vmulq_f32(vp0, vsubq_f32(one, vmulq_f32(d2, vinv)));
+        uint32x4_t inside = vcltq_f32(d2, va2);
+        vst1q_f32(out + i, vreinterpretq_f32_u32(
+                  vandq_u32(inside, vreinterpretq_u32_f32(psi))));
+    }
+#endif
+    for (; i < n; i++) {
+        out[i] = flux_scalar(dR2[i] + z2, c);
+    }
+}
+
+int grad_shafranov_grid(const float *R_axis, uint32_t nR,
+                        const float *Z_axis, uint32_t nZ,
+                        const float *params, float *psi, int num_threads) {
+    FluxCoefficients c = flux_coefficients(params);
+
+    // (R - R0)^2 is shared by every row
+    float stack_dR2[FLUX_MAP_STACK_COLUMNS];
+    float *dR2 = nR <= FLUX_MAP_STACK_COLUMNS ? stack_dR2 :
+                 malloc((size_t)nR * sizeof(float));
+    if (!dR2) return -1;
+    for (uint32_t i = 0; i < nR; i++) {
+        float dR = R_axis[i] - c.R0;
+        dR2[i] = dR * dR;
+    }
+
+#ifdef _OPENMP
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+    #pragma omp parallel for schedule(static) num_threads(num_threads) if(num_threads > 1)
+#else
+    (void)num_threads;
+#endif
+    for (uint32_t iz = 0; iz < nZ; iz++) {
+        float z = Z_axis[iz];
+        flux_row(dR2, z * z, &c, psi + (size_t)iz * nR, nR);
+    }
+
+    if (dR2 != stack_dR2) free(dR2);
+    return 0;
+}
+
+void grad_shafranov_points(const float *R, const float *Z, size_t n,
+                           const float *params, float *psi) {
+    FluxCoefficients c = flux_coefficients(params);
+    size_t i = 0;
+#if defined(__AVX512F__)
+    const __m512 vR0 = _mm512_set1_ps(c.R0);
+    const __m512 vp0 = _mm512_set1_ps(c.p0);
+    const __m512 va2 = _mm512_set1_ps(c.a2);
+    const __m512 vinv = _mm512_set1_ps(c.inv_a2);
+    const __m512 one = _mm512_set1_ps(1.0f);
+    for (; i + 16 <= n; i += 16) {
+        __m512 dR = _mm512_sub_ps(_mm512_loadu_ps(R + i), vR0);
+        __m512 z = _mm512_loadu_ps(Z + i);
+        __m512 d2 = _mm512_add_ps(_mm512_mul_ps(dR, dR), _mm512_mul_ps(z, z));
+        __m512 v = _mm512_mul_ps(vp0, _mm512_sub_ps(one, _mm512_mul_ps(d2, vinv)));
+        __mmask16 inside = _mm512_cmp_ps_mask(d2, va2, _CMP_LT_OQ);
+        _mm512_storeu_ps(psi + i, _mm512_maskz_mov_ps(inside, v));
+    }
+#elif defined(__AVX2__)
+    const __m256 vR0 = _mm256_set1_ps(c.R0);
+    const __m256 vp0 = _mm256_set1_ps(c.p0);
+    const __m256 va2 = _mm256_set1_ps(c.a2);
+    const __m256 vinv = _mm256_set1_ps(c.inv_a2);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    for (; i + 8 <= n; i += 8) {
+        __m256 dR = _mm256_sub_ps(_mm256_loadu_ps(R + i), vR0);
+        __m256 z = _mm256_loadu_ps(Z + i);
+        __m256 d2 = _mm256_add_ps(_mm256_mul_ps(dR, dR), _mm256_mul_ps(z, z));
+        __m256 v = _mm256_mul_ps(vp0, _mm256_sub_ps(one, _mm256_mul_ps(d2, vinv)));
+        __m256 inside = _mm256_cmp_ps(d2, va2, _CMP_LT_OQ);
+        _mm256_storeu_ps(psi + i, _mm256_and_ps(inside, v));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t vR0 = vdupq_n_f32(c.R0);
+    const float32x4_t vp0 = vdupq_n_f32(c.p0);
+    const float32x4_t va2 = vdupq_n_f32(c.a2);
+    const float32x4_t vinv = vdupq_n_f32(c.inv_a2);
+    const float32x4_t one = vdupq_n_f32(1.0f);
+    for (; i + 4 <= n; i += 4) {
+        float32x4_t dR = vsubq_f32(vld1q_f32(R + i), vR0);
+        float32x4_t z = vld1q_f32(Z + i);
+        float32x4_t d2 = vaddq_f32(vmulq_f32(dR, dR), vmulq_f32(z, z));
+        float32x4_t v = vmulq_f32(vp0, vsubq_f32(one, vmulq_f32(d2, vinv)));
+        uint32x4_t inside = vcltq_f32(d2, va2);
+        vst1q_f32(psi + i, vreinterpretq_f32_u32(
+                  vandq_u32(inside, vreinterpretq_u32_f32(v))));
+    }
+#endif
+    for (; i < n; i++) {
+        float dR = R[i] - c.R0;
+        psi[i] = flux_scalar(dR * dR + Z[i] * Z[i], &c);
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef FLUX_MAP_H
+#define FLUX_MAP_H
+
+#include "npe_config.h"
+#include <stddef.h>
+
+// ================= GRAD-SHAFRANOV FLUX MAPS =================
+// Grid versions of grad_shafranov_solution(). psi = params[0] * (1 - r^2)
+// inside the plasma (r < 1) and 0 outside, evaluated without sqrtf or
+// branches: the boundary test is done on r^2 and applied as a lane mask.
+// Kernels use AVX-512, AVX2 or NEON when the compiler targets them and a
+// scalar loop otherwise. Values agree with grad_shafranov_solution() to a
+// few ULP; points within rounding of r = 1 may land on either side.
+
+// Tensor-product grid: psi[iz * nR + iR] for R_axis[iR], Z_axis[iz].
+// Rows are split across num_threads OpenMP threads when built with
+// -fopenmp (num_threads <= 0 uses the OpenMP default, 1 runs serially).
+// Returns -1, leaving psi unwritten, if a wide grid's row buffer cannot
+// be allocated.
+int grad_shafranov_grid(const float *R_axis, uint32_t nR,
+                        const float *Z_axis, uint32_t nZ,
+                        const float *params, float *psi, int num_threads);
+
+// Scattered points: psi[i] for (R[i], Z[i]).
+void grad_shafranov_points(const float *R, const float *Z, size_t n,
+                           const float *params, float *psi);
+
+#endif // FLUX_MAP_H
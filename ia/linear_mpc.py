@@ -0,0 +1,126 @@
+"""
+NPE-PSQ: BINDING DO MPC LINEAR NATIVO
+Interface ctypes para linear_mpc.c (QP condensado com restrições de caixa)
+Descrição: Substitui o CVXPY no laço de controle; cada solve leva dezenas de µs
+
+Compilação da biblioteca (na raiz do repositório):
+    gcc -std=gnu11 -O3 -march=native -shared -fPIC -o liblinear_mpc.so linear_mpc.c -lm
+
+O caminho pode ser sobrescrito com a variável de ambiente NPE_LINEAR_MPC_LIB.
+
+Uso:
+    mpc = LinearMPC(A, B, Q, R, u_min, u_max)
+    u, cost = mpc.solve(x, x_ref, w)     # w: termo afim constante (ex.: delta_f * dt)
+"""
+
+import ctypes
+import os
+import numpy as np
+
+_LIB_NAME = 'liblinear_mpc.so'
+_lib = None
+
+
+def _load_library():
+    global _lib
+    if _lib is not None:
+        return _lib
+    path = os.environ.get('NPE_LINEAR_MPC_LIB',
+                          os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                       '..', _LIB_NAME))
+    lib = ctypes.CDLL(path)
+    floats = ctypes.POINTER(ctypes.c_float)
+    lib.linear_mpc_create.restype = ctypes.c_void_p
+    lib.linear_mpc_create.argtypes = [floats] * 6
+    lib.linear_mpc_destroy.restype = None
+    lib.linear_mpc_destroy.argtypes = [ctypes.c_void_p]
+    lib.linear_mpc_reset.restype = None
+    lib.linear_mpc_reset.argtypes = [ctypes.c_void_p]
+    lib.linear_mpc_solve.restype = ctypes.c_int
+    lib.linear_mpc_solve.argtypes = [ctypes.c_void_p, floats, floats, floats, floats, floats]
+    lib.linear_mpc_dimensions.restype = None
+    lib.linear_mpc_dimensions.argtypes = [ctypes.POINTER(ctypes.c_uint32)] * 3
+    _lib = lib
+    return lib
+
+
+def dimensions():
+    """(estados, entradas, horizonte) com que a biblioteca foi compilada."""
+    lib = _load_library()
+    dims = [ctypes.c_uint32() for _ in range(3)]
+    lib.linear_mpc_dimensions(*[ctypes.byref(d) for d in dims])
+    return tuple(d.value for d in dims)
+
+
+def _as_floats(array, shape, name):
+    out = np.ascontiguousarray(array, dtype=np.float32)
+    if out.shape != shape:
+        raise ValueError(f'{name}: esperado {shape}, recebido {out.shape}')
+    return out
+
+
+class LinearMPC:
+    """
+    MPC linear nativo. As dimensões são fixas na compilação (ver linear_mpc.h);
+    o objeto guarda o warm start entre chamadas de solve().
+
+    Atributos:
+        iterations: iterações do último solve (0 = ótimo irrestrito, -1 = limite atingido)
+    """
+
+    def __init__(self, A, B, Q, R, u_min, u_max):
+        self._lib = _load_library()
+        self.n, self.m, self.horizon = dimensions()
+        n, m = self.n, self.m
+        self._A = _as_floats(A, (n, n), 'A')
+        self._B = _as_floats(B, (n, m), 'B')
+        self._Q = _as_floats(Q, (n, n), 'Q')
+        self._R = _as_floats(R, (m, m), 'R')
+        self._u_min = _as_floats(u_min, (m,), 'u_min')
+        self._u_max = _as_floats(u_max, (m,), 'u_max')
+        self._handle = self._lib.linear_mpc_create(
+            *[self._ptr(a) for a in (self._A, self._B, self._Q, self._R,
+                                     self._u_min, self._u_max)])
+        if not self._handle:
+            raise ValueError('QP condensado não é definido positivo (verifique R e B)')
+
+        # Buffers reutilizados em todo solve (sem alocação no laço)
+        self._x = np.zeros(n, dtype=np.float32)
+        self._x_ref = np.zeros(n, dtype=np.float32)
+        self._w = np.zeros(n, dtype=np.float32)
+        self._u = np.zeros(m, dtype=np.float32)
+        self._cost = ctypes.c_float()
+        self.iterations = 0
+
+    @staticmethod
+    def _ptr(array):
+        return array.ctypes.data_as(ctypes.POINTER(ctypes.c_float))
+
+    def solve(self, x, x_ref, w=None):
+        """
+        Resolve o QP para o estado x e a referência x_ref.
+
+        Returns:
+            u: primeiro controle do plano (cópia, float64)
+            cost: custo do plano
+        """
+        self._x[:] = x
+        self._x_ref[:] = x_ref
+        w_ptr = None
+        if w is not None:
+            self._w[:] = w
+            w_ptr = self._ptr(self._w)
+        self.iterations = self._lib.linear_mpc_solve(
+            self._handle, self._ptr(self._x), self._ptr(self._x_ref), w_ptr,
+            self._ptr(self._u), ctypes.byref(self._cost))
+        return self._u.astype(np.float64), float(self._cost.value)
+
+    def reset(self):
+        """Descarta o warm start (ex.: após um degrau de referência)."""
+        self._lib.linear_mpc_reset(self._handle)
+
+    def __del__(self):
+        handle = getattr(self, '_handle', None)
+        if handle:
+            self._lib.linear_mpc_destroy(handle)
+            self._handle = None
@@ -19,10 +19,20 @@ except ImportError:
     HAS_CVXPY = False
     print("⚠️ CVXPY não instalado. Usando MPC simplificado.")
 
+try:
+    from linear_mpc import LinearMPC
+    HAS_NATIVE_MPC = True
+except ImportError:
+    HAS_NATIVE_MPC = False
+
 # ============================================================================
 # PARTE 1: REDE NEURAL ADAPTATIVA (LSTM Simplificada)
 # ============================================================================
 
+# Blob de pesos compartilhado com neural_estimator.c
+WEIGHTS_MAGIC = 0x4e4e504e  # "NPNN"
+WEIGHTS_VERSION = 1
+
 class AdaptiveNeuralEstimator:
     """
     Estimador Neural Adaptativo (tipo LSTM) que aprende a dinâmica não-linear
@@ -116,6 +126,37 @@ class AdaptiveNeuralEstimator:
         
         # Isso é uma simplificação (TBPTT completo é mais pesado)
     
+    def save_weights(self, path):
+        """
+        Grava os pesos no blob binário lido por neural_estimator.c
+        (cabeçalho NeuralWeightsHeader + float32 na ordem W_rnn, U_rnn,
+        b_rnn, W_dense, b_dense, h).
+        """
+        header = np.array([WEIGHTS_MAGIC, WEIGHTS_VERSION, self.state_dim,
+                           self.control_dim, self.hidden_dim, 0, 0, 0], dtype='<u4')
+        header[6:7] = np.array([self.lr], dtype='<f4').view('<u4')
+        with open(path, 'wb') as f:
+            f.write(header.tobytes())
+            for array in (self.W_rnn, self.U_rnn, self.b_rnn,
+                          self.W_dense, self.b_dense, self.h):
+                f.write(np.ascontiguousarray(array, dtype='<f4').tobytes())
+    
+    def load_weights(self, path):
+        """Carrega um blob gravado por save_weights() ou neural_estimator_save()."""
+        data = np.fromfile(path, dtype=np.uint8)
+        header = data[:32].view('<u4')
+        if header[0] != WEIGHTS_MAGIC or header[1] != WEIGHTS_VERSION or \
+           tuple(header[2:5]) != (self.state_dim, self.control_dim, self.hidden_dim):
+            raise ValueError(f'{path}: blob de pesos incompatível')
+        self.lr = float(header[6:7].view('<f4')[0])
+        values = data[32:].view('<f4').astype(np.float64)
+        offset = 0
+        for name in ('W_rnn', 'U_rnn', 'b_rnn', 'W_dense', 'b_dense', 'h'):
+            shape = getattr(self, name).shape
+            size = int(np.prod(shape))
+            setattr(self, name, values[offset:offset + size].reshape(shape).copy())
+            offset += size
+    
     def predict_and_learn(self, x, u, x_next_real, dt=0.01):
         """
         Prediz a próxima dinâmica E aprende simultaneamente.
@@ -262,6 +303,17 @@ class AdaptiveMPCController:
         # Histórico
         self.solve_times = []
         self.constraint_violations = []
+        
+        # MPC nativo (linear_mpc.c), se a biblioteca estiver compilada
+        self.u_last = np.zeros(self.m)
+        self.native = None
+        if HAS_NATIVE_MPC:
+            try:
+                native = LinearMPC(A, B, Q, R, self.u_min, self.u_max)
+                if native.horizon == horizon:
+                    self.native = native
+            except (OSError, ValueError):
+                pass
     
     def predict_trajectory(self, x_current, U_seq):
         """
@@ -297,11 +349,27 @@ class AdaptiveMPCController:
         return X_pred
     
     def solve_mpc(self, x_current, x_ref):
-        """Resolve o problema MPC com CVXPY ou fallback."""
-        if HAS_CVXPY:
-            return self._solve_mpc_cvxpy(x_current, x_ref)
+        """Resolve o problema MPC: nativo, CVXPY ou fallback."""
+        if self.native is not None:
+            u, cost = self._solve_mpc_native(x_current, x_ref)
+        elif HAS_CVXPY:
+            u, cost = self._solve_mpc_cvxpy(x_current, x_ref)
         else:
+            u, cost = self._solve_mpc_pd(x_current, x_ref)
+        self.u_last = u
+        return u, cost
+    
+    def _solve_mpc_native(self, x_current, x_ref):
+        """
+        MPC com o QP condensado nativo. A correção neural entra como termo
+        afim constante no horizonte, avaliada no estado atual e no último controle.
+        """
+        delta_f, _ = self.neural.forward(x_current, self.u_last)
+        u, cost = self.native.solve(x_current, x_ref, delta_f * self.dt)
+        if not np.all(np.isfinite(u)):
+            self.native.reset()
             return self._solve_mpc_pd(x_current, x_ref)
+        return u, cost
     
     def _solve_mpc_cvxpy(self, x_current, x_ref):
         """MPC com CVXPY (ótimo)."""
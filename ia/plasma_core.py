@@ -0,0 +1,316 @@
+"""
+NPE-PSQ: BINDING DO NÚCLEO C
+Interface ctypes para plasma_physics.c / plasma_batch.c (ver plasma_abi.h)
+Descrição: Expõe PlasmaState, PlasmaControlSystem, DiagnosticsSystem e o
+integrador em lote com vistas numpy diretamente sobre a memória C, sem cópias.
+A análise em Python passa a usar a mesma física da produção.
+
+Compilação da biblioteca (na raiz do repositório):
+    gcc -std=gnu11 -O3 -fno-math-errno -fno-trapping-math -shared -fPIC \\
+        -o libplasma_core.so plasma_abi.c plasma_physics.c plasma_batch.c plasma_rng.c -lm
+
+O caminho pode ser sobrescrito com a variável de ambiente NPE_PLASMA_CORE_LIB.
+Ao carregar, o layout de cada estrutura é conferido campo a campo contra a
+biblioteca compilada; uma divergência com npe_config.h gera ImportError.
+
+Uso:
+    state, control = PlasmaState(), PlasmaControlSystem()
+    seed_rng(control, 1)
+    v = state_view(state)            # float32[18] sobre o PlasmaState
+    advance(state, control, dt=1e-3, steps=1000)
+
+    batch = Batch(4096)
+    batch.load(k, state, control)
+    batch.density_core[:] *= 1.1     # escreve direto no array C
+    batch.run(1e-3, steps=10000)     # o GIL fica livre durante a chamada
+"""
+
+import ctypes
+import os
+import numpy as np
+
+_LIB_NAME = 'libplasma_core.so'
+ABI_VERSION = 1
+
+# Dimensões de npe_config.h
+NUM_PF_COILS = 10
+NUM_VERTICAL_COILS = 4
+NUM_HORIZONTAL_COILS = 4
+NUM_HEATING_SYSTEMS = 3
+
+PSQ_STATES = ('INIT', 'RAMP_UP', 'FLAT_TOP', 'RAMP_DOWN',
+              'DISRUPTION', 'MITIGATION', 'SAFE_SHUTDOWN')
+
+_f32 = ctypes.c_float
+_pf32 = ctypes.POINTER(ctypes.c_float)
+_pu32 = ctypes.POINTER(ctypes.c_uint32)
+
+
+# ================= ESTRUTURAS (espelho de npe_config.h) =================
+
+STATE_FIELDS = (
+    'plasma_current', 'safety_factor_q95', 'beta_normalized', 'li_inductance',
+    'radial_position', 'vertical_position', 'elongation', 'triangularity',
+    'temperature_core', 'temperature_edge', 'density_core', 'density_edge',
+    'mhd_activity_level', 'ntm_amplitude', 'elm_frequency', 'neutron_rate',
+    'impurity_concentration', 'radiation_power',
+)
+
+
+class PlasmaState(ctypes.Structure):
+    _fields_ = [(name, _f32) for name in STATE_FIELDS]
+
+
+class PlasmaRng(ctypes.Structure):
+    _fields_ = [('s', ctypes.c_uint32 * 4)]
+
+
+class HeatingSystem(ctypes.Structure):
+    _fields_ = [('power', _f32), ('frequency', _f32), ('enabled', ctypes.c_bool)]
+
+
+class PlasmaControlSystem(ctypes.Structure):
+    _fields_ = [
+        ('current_state', PlasmaState),
+        ('target_state', PlasmaState),
+        ('pf_coil_currents', _f32 * NUM_PF_COILS),
+        ('vertical_coil_currents', _f32 * NUM_VERTICAL_COILS),
+        ('horizontal_coil_currents', _f32 * NUM_HORIZONTAL_COILS),
+        ('heating_systems', HeatingSystem * NUM_HEATING_SYSTEMS),
+        ('fuel_injection_rate', _f32),
+        ('impurity_injection_rate', _f32),
+        ('controller_state', ctypes.c_int),
+        ('simulation_time', _f32),
+        ('iteration_count', ctypes.c_uint32),
+        ('history', ctypes.c_void_p),
+        ('rng', PlasmaRng),
+        ('disruption_detected', ctypes.c_bool),
+        ('mitigation_activated', ctypes.c_bool),
+        ('disruption_warning_time', _f32),
+        ('energy_confinement_time', _f32),
+        ('fusion_gain_Q', _f32),
+        ('stored_energy', _f32),
+    ]
+
+
+class DiagnosticsSystem(ctypes.Structure):
+    _fields_ = [
+        ('interferometer_density', _f32 * 32),
+        ('thomson_scattering_temp', _f32 * 20),
+        ('bolometer_channels', _f32 * 48),
+        ('magnetics_probes', _f32 * 64),
+        ('soft_xray_array', _f32 * 64),
+        ('neutron_cameras', _f32 * 8),
+        ('spectroscopy_lines', _f32 * 16),
+        ('mhd_spectrum', _f32 * 1024),
+        ('coherence_analysis', (_f32 * 32) * 32),
+        ('system_ok', ctypes.c_bool),
+        ('data_acquisition_rate', _f32),
+    ]
+
+
+# Arrays de controle por disparo do PlasmaBatch, na ordem do bloco C
+BATCH_CONTROL_FIELDS = ('fuel_injection_rate', 'energy_confinement_time',
+                        'simulation_time', 'stored_energy')
+
+
+class _PlasmaBatch(ctypes.Structure):
+    _fields_ = ([('count', ctypes.c_uint32), ('capacity', ctypes.c_uint32)] +
+                [(name, _pf32) for name in STATE_FIELDS] +
+                [('pf_coil_currents', _pf32 * NUM_PF_COILS),
+                 ('vertical_coil_currents', _pf32 * NUM_VERTICAL_COILS),
+                 ('heating_power', _pf32 * NUM_HEATING_SYSTEMS)] +
+                [(name, _pf32) for name in BATCH_CONTROL_FIELDS] +
+                [('rng_state', _pu32 * 4),
+                 ('mhd_drive', _pf32),
+                 ('block', ctypes.c_void_p)])
+
+
+# ================= BIBLIOTECA =================
+
+class _AbiField(ctypes.Structure):
+    _fields_ = [('name', ctypes.c_char_p), ('offset', ctypes.c_uint32),
+                ('size', ctypes.c_uint32)]
+
+
+# Mesma ordem de PlasmaAbiStruct em plasma_abi.h
+_ABI_STRUCTS = (PlasmaState, PlasmaControlSystem, DiagnosticsSystem, _PlasmaBatch)
+
+_lib = None
+
+
+def _check_layout(lib):
+    count, size = ctypes.c_uint32(), ctypes.c_uint32()
+    for which, mirror in enumerate(_ABI_STRUCTS):
+        fields = lib.plasma_abi_layout(which, ctypes.byref(count), ctypes.byref(size))
+        if not fields:
+            raise ImportError(f'plasma_abi_layout({which}) indisponível')
+        if size.value != ctypes.sizeof(mirror):
+            raise ImportError(f'{mirror.__name__}: {ctypes.sizeof(mirror)} bytes em Python, '
+                              f'{size.value} em C')
+        names = [name for name, _ in mirror._fields_]
+        c_names = [fields[i].name.decode() for i in range(count.value)]
+        if names != c_names:
+            raise ImportError(f'{mirror.__name__}: campos divergem de npe_config.h')
+        for i, name in enumerate(names):
+            py = getattr(mirror, name)
+            if (py.offset, py.size) != (fields[i].offset, fields[i].size):
+                raise ImportError(f'{mirror.__name__}.{name}: offset/tamanho '
+                                  f'({py.offset}, {py.size}) em Python, '
+                                  f'({fields[i].offset}, {fields[i].size}) em C')
+
+
+def _load_library():
+    global _lib
+    if _lib is not None:
+        return _lib
+    path = os.environ.get('NPE_PLASMA_CORE_LIB',
+                          os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                       '..', _LIB_NAME))
+    lib = ctypes.CDLL(path)
+    state_p = ctypes.POINTER(PlasmaState)
+    control_p = ctypes.POINTER(PlasmaControlSystem)
+    batch_p = ctypes.POINTER(_PlasmaBatch)
+    lib.plasma_abi_version.restype = ctypes.c_uint32
+    lib.plasma_abi_version.argtypes = []
+    lib.plasma_abi_layout.restype = ctypes.POINTER(_AbiField)
+    lib.plasma_abi_layout.argtypes = [ctypes.c_int, ctypes.POINTER(ctypes.c_uint32),
+                                      ctypes.POINTER(ctypes.c_uint32)]
+    lib.plasma_abi_run.restype = None
+    lib.plasma_abi_run.argtypes = [state_p, control_p, _f32, ctypes.c_uint32]
+    lib.plasma_abi_run_batch.restype = None
+    lib.plasma_abi_run_batch.argtypes = [batch_p, _f32, ctypes.c_uint32]
+    lib.plasma_rng_seed.restype = None
+    lib.plasma_rng_seed.argtypes = [ctypes.POINTER(PlasmaRng), ctypes.c_uint64,
+                                    ctypes.c_uint64]
+    lib.plasma_batch_init.restype = ctypes.c_int
+    lib.plasma_batch_init.argtypes = [batch_p, ctypes.c_uint32]
+    lib.plasma_batch_free.restype = None
+    lib.plasma_batch_free.argtypes = [batch_p]
+    lib.plasma_batch_load.restype = None
+    lib.plasma_batch_load.argtypes = [batch_p, ctypes.c_uint32, state_p, control_p]
+    lib.plasma_batch_store.restype = None
+    lib.plasma_batch_store.argtypes = [batch_p, ctypes.c_uint32, state_p, control_p]
+    lib.calculate_beta_normalized.restype = _f32
+    lib.calculate_beta_normalized.argtypes = [state_p]
+    lib.energy_confinement_time.restype = _f32
+    lib.energy_confinement_time.argtypes = [state_p, _f32]
+
+    version = lib.plasma_abi_version()
+    if version != ABI_VERSION:
+        raise ImportError(f'{path}: ABI {version}, esperado {ABI_VERSION}')
+    _check_layout(lib)
+    _lib = lib
+    return lib
+
+
+# ================= ESTADO ESCALAR =================
+
+def state_view(state):
+    """Vista float32[18] sobre um PlasmaState (mesma ordem de STATE_FIELDS)."""
+    return np.frombuffer(state, dtype=np.float32)
+
+
+def array_view(field):
+    """Vista numpy de um campo-array ctypes (ex.: control.pf_coil_currents)."""
+    return np.ctypeslib.as_array(field)
+
+
+def diagnostics_views(diagnostics):
+    """Dicionário nome -> vista numpy para cada canal do DiagnosticsSystem."""
+    return {name: np.ctypeslib.as_array(getattr(diagnostics, name))
+            for name, kind in DiagnosticsSystem._fields_
+            if issubclass(kind, ctypes.Array)}
+
+
+def seed_rng(control, seed, stream=0):
+    """Semeia o gerador do disparo (obrigatório antes de integrar)."""
+    _load_library().plasma_rng_seed(ctypes.byref(control.rng), seed, stream)
+
+
+def advance(state, control, dt, steps=1):
+    """steps passos de advance_plasma_state(), avançando simulation_time."""
+    _load_library().plasma_abi_run(ctypes.byref(state), ctypes.byref(control),
+                                   dt, steps)
+
+
+def beta_normalized(state):
+    return _load_library().calculate_beta_normalized(ctypes.byref(state))
+
+
+def confinement_time(state, heating_power):
+    return _load_library().energy_confinement_time(ctypes.byref(state), heating_power)
+
+
+# ================= LOTE =================
+
+class Batch:
+    """
+    PlasmaBatch com vistas numpy sobre os arrays C (sem cópias).
+
+    Atributos com o nome de cada campo de PlasmaState ou de BATCH_CONTROL_FIELDS
+    são vistas float32[count]. Vistas 2D (linha = campo, coluna = disparo):
+        state:                  float32[18, count]
+        pf_coil_currents:       float32[NUM_PF_COILS, count]
+        vertical_coil_currents: float32[NUM_VERTICAL_COILS, count]
+        heating_power:          float32[NUM_HEATING_SYSTEMS, count] (0 = desligado)
+        rng_state:              uint32[4, count]
+    As vistas deixam de ser válidas após close().
+    """
+
+    def __init__(self, count):
+        self._lib = _load_library()
+        self._batch = _PlasmaBatch()
+        if self._lib.plasma_batch_init(ctypes.byref(self._batch), count) != 0:
+            raise MemoryError(f'plasma_batch_init({count})')
+        self.count = count
+        b = self._batch
+        stride = b.capacity
+
+        def rows(first, n):
+            return np.ctypeslib.as_array(first, shape=(n, stride))[:, :count]
+
+        # Os arrays de um PlasmaBatch são linhas consecutivas de um único bloco
+        base = ctypes.cast(b.plasma_current, ctypes.c_void_p).value
+        line = stride * ctypes.sizeof(_f32)
+        for k, name in enumerate(STATE_FIELDS):
+            if ctypes.cast(getattr(b, name), ctypes.c_void_p).value != base + k * line:
+                raise RuntimeError('layout do bloco do PlasmaBatch inesperado')
+        self.state = rows(b.plasma_current, len(STATE_FIELDS))
+        self.pf_coil_currents = rows(b.pf_coil_currents[0], NUM_PF_COILS)
+        self.vertical_coil_currents = rows(b.vertical_coil_currents[0], NUM_VERTICAL_COILS)
+        self.heating_power = rows(b.heating_power[0], NUM_HEATING_SYSTEMS)
+        self.rng_state = rows(b.rng_state[0], 4)
+        self._fields = {name: self.state[k] for k, name in enumerate(STATE_FIELDS)}
+        for name in BATCH_CONTROL_FIELDS:
+            self._fields[name] = np.ctypeslib.as_array(getattr(b, name), shape=(count,))
+
+    def __getattr__(self, name):
+        fields = self.__dict__.get('_fields')
+        if fields is not None and name in fields:
+            return fields[name]
+        raise AttributeError(name)
+
+    def load(self, shot, state, control):
+        """Copia um disparo para a coluna shot (plasma_batch_load)."""
+        self._lib.plasma_batch_load(ctypes.byref(self._batch), shot,
+                                    ctypes.byref(state), ctypes.byref(control))
+
+    def store(self, shot, state, control):
+        """Copia a coluna shot de volta para state e control."""
+        self._lib.plasma_batch_store(ctypes.byref(self._batch), shot,
+                                     ctypes.byref(state), ctypes.byref(control))
+
+    def run(self, dt, steps=1):
+        """steps passos de advance_plasma_batch(); o GIL é liberado na chamada."""
+        self._lib.plasma_abi_run_batch(ctypes.byref(self._batch), dt, steps)
+
+    def close(self):
+        if self._batch.block:
+            self._fields = {}
+            self._lib.plasma_batch_free(ctypes.byref(self._batch))
+
+    def __del__(self):
+        batch = self.__dict__.get('_batch')
+        if batch is not None and batch.block:
+            self.close()
@@ -0,0 +1,214 @@
+"""
+NPE-PSQ: LEITOR DO SHOT LOG BINÁRIO
+Leitura dos arquivos gravados por shot_log.c (simulation_c/npe_psq_core_sim.c --shot-log)
+Descrição: Acesso aleatório por chunk via numpy.memmap; colunas RAW sem cópia
+
+Formato (ver shot_log.h): cabeçalho + tabela de colunas, chunks ROWS/EVENTS
+com cabeçalho de 64 bytes, índice e trailer no fim do arquivo. Colunas RAW
+são float32 contíguos dentro do arquivo e viram views do memmap; colunas
+XOR_SPARSE são decodificadas com operações vetorizadas do numpy.
+
+Uso:
+    log = ShotLog('shot.npsl')
+    t = log.column('time')
+    ip = log.column('plasma_current')
+    for ev in log.events(): ...
+    python shot_log.py shot.npsl        # resumo do arquivo
+"""
+
+import sys
+import numpy as np
+
+MAGIC = b'NPESHOTL'
+TRAILER_MAGIC = b'NPSLINDX'
+CHUNK_MAGIC = 0x4b4e4843
+VERSION = 1
+
+CODEC_RAW = 0
+CODEC_XOR_SPARSE = 1
+
+CHUNK_ROWS = 1
+CHUNK_EVENTS = 2
+CHUNK_INDEX = 3
+
+EVENT_CONTROLLER_STATE = 1
+EVENT_MITIGATION = 2
+EVENT_LIMIT = 3  # valor: índice do limite | ativo << 8 (limit_monitor.h)
+
+CONTROLLER_STATES = ('INIT', 'RAMP_UP', 'FLAT_TOP', 'RAMP_DOWN',
+                     'DISRUPTION', 'MITIGATION', 'SAFE_SHUTDOWN')
+
+# Registros em disco, idênticos às structs de shot_log.h
+HEADER_DTYPE = np.dtype([('magic', 'S8'), ('version', '<u4'), ('header_bytes', '<u4'),
+                         ('num_columns', '<u4'), ('chunk_rows', '<u4'),
+                         ('codec', '<u4'), ('reserved', '<u4', 9)])
+COLUMN_DTYPE = np.dtype([('name', 'S56'), ('type', '<u4'), ('reserved', '<u4')])
+CHUNK_DTYPE = np.dtype([('magic', '<u4'), ('kind', '<u4'), ('rows', '<u4'),
+                        ('reserved0', '<u4'), ('payload_bytes', '<u8'),
+                        ('first_row', '<u8'), ('time_first', '<f4'),
+                        ('time_last', '<f4'), ('reserved', '<u4', 6)])
+COLUMN_REF_DTYPE = np.dtype([('offset', '<u8'), ('codec', '<u4'), ('bytes', '<u4')])
+EVENT_DTYPE = np.dtype([('time', '<f4'), ('type', '<u4'), ('value', '<u4'),
+                        ('reserved', '<u4')])
+INDEX_DTYPE = np.dtype([('offset', '<u8'), ('kind', '<u4'), ('rows', '<u4'),
+                        ('first_row', '<u8'), ('time_first', '<f4'),
+                        ('time_last', '<f4')])
+TRAILER_DTYPE = np.dtype([('index_offset', '<u8'), ('magic', 'S8')])
+
+
+def decode_xor_sparse(block, rows):
+    """
+    Decodifica uma coluna XOR_SPARSE: bytes não nulos + bitmap (LSB primeiro)
+    -> planos de bytes -> palavras XOR -> prefixo XOR -> float32.
+    """
+    count = int(block[:4].view('<u4')[0])
+    nbytes = rows * 4
+    bitmap_bytes = (nbytes + 7) // 8
+    mask = np.unpackbits(block[4:4 + bitmap_bytes], bitorder='little')[:nbytes]
+    planes = np.zeros(nbytes, dtype=np.uint8)
+    planes[mask.astype(bool)] = block[4 + bitmap_bytes:4 + bitmap_bytes + count]
+    words = np.ascontiguousarray(planes.reshape(4, rows).T).view('<u4').ravel()
+    return np.bitwise_xor.accumulate(words).view('<f4')
+
+
+class ShotLog:
+    """
+    Shot log mapeado em memória.
+
+    Atributos:
+        columns: nomes das colunas (a coluna 0 é o tempo)
+        chunks: índice estruturado (INDEX_DTYPE) de todos os chunks
+        chunk_rows: linhas de um chunk completo
+    """
+
+    def __init__(self, path):
+        self._map = np.memmap(path, dtype=np.uint8, mode='r')
+        if self._map.size < HEADER_DTYPE.itemsize:
+            raise ValueError(f'{path}: arquivo curto demais')
+        header = self._map[:HEADER_DTYPE.itemsize].view(HEADER_DTYPE)[0]
+        if header['magic'] != MAGIC or header['version'] != VERSION:
+            raise ValueError(f'{path}: não é um shot log v{VERSION}')
+        self.header_bytes = int(header['header_bytes'])
+        self.chunk_rows = int(header['chunk_rows'])
+        n = int(header['num_columns'])
+        table = self._map[HEADER_DTYPE.itemsize:HEADER_DTYPE.itemsize +
+                          n * COLUMN_DTYPE.itemsize].view(COLUMN_DTYPE)
+        self.columns = [name.decode() for name in table['name']]
+        self._column_index = {name: i for i, name in enumerate(self.columns)}
+        self.chunks = self._load_index()
+
+    def _chunk_header(self, offset):
+        end = offset + CHUNK_DTYPE.itemsize
+        if end > self._map.size:
+            return None
+        header = self._map[offset:end].view(CHUNK_DTYPE)[0]
+        if header['magic'] != CHUNK_MAGIC or \
+           end + int(header['payload_bytes']) > self._map.size:
+            return None
+        return header
+
+    def _load_index(self):
+        size = self._map.size
+        if size >= self.header_bytes + TRAILER_DTYPE.itemsize:
+            trailer = self._map[size - TRAILER_DTYPE.itemsize:].view(TRAILER_DTYPE)[0]
+            if trailer['magic'] == TRAILER_MAGIC:
+                offset = int(trailer['index_offset'])
+                header = self._chunk_header(offset)
+                if header is not None and header['kind'] == CHUNK_INDEX:
+                    start = offset + CHUNK_DTYPE.itemsize
+                    rows = int(header['rows'])
+                    return self._map[start:start + rows * INDEX_DTYPE.itemsize] \
+                        .view(INDEX_DTYPE)
+
+        # Sem índice (gravação interrompida): percorre os cabeçalhos
+        entries = []
+        offset = self.header_bytes
+        while True:
+            header = self._chunk_header(offset)
+            if header is None or header['kind'] == CHUNK_INDEX:
+                break
+            entries.append((offset, header['kind'], header['rows'], header['first_row'],
+                            header['time_first'], header['time_last']))
+            offset += CHUNK_DTYPE.itemsize + int(header['payload_bytes'])
+        return np.array(entries, dtype=INDEX_DTYPE)
+
+    @property
+    def num_rows(self):
+        rows = self.chunks[self.chunks['kind'] == CHUNK_ROWS]['rows']
+        return int(rows.sum())
+
+    def row_chunks(self, t_start=None, t_end=None):
+        """Índices dos chunks ROWS, opcionalmente só os que cobrem [t_start, t_end]."""
+        sel = self.chunks['kind'] == CHUNK_ROWS
+        if t_start is not None:
+            sel &= self.chunks['time_last'] >= t_start
+        if t_end is not None:
+            sel &= self.chunks['time_first'] <= t_end
+        return np.flatnonzero(sel)
+
+    def chunk_column(self, chunk, name):
+        """
+        Coluna de um chunk: view do memmap (sem cópia) se RAW,
+        array decodificado se XOR_SPARSE.
+        """
+        entry = self.chunks[chunk]
+        if entry['kind'] != CHUNK_ROWS:
+            raise ValueError(f'chunk {chunk} não é ROWS')
+        c = self._column_index[name]
+        rows = int(entry['rows'])
+        payload = int(entry['offset']) + CHUNK_DTYPE.itemsize
+        ref = self._map[payload + c * COLUMN_REF_DTYPE.itemsize:
+                        payload + (c + 1) * COLUMN_REF_DTYPE.itemsize] \
+            .view(COLUMN_REF_DTYPE)[0]
+        start = payload + int(ref['offset'])
+        block = self._map[start:start + int(ref['bytes'])]
+        if ref['codec'] == CODEC_RAW:
+            return block.view('<f4')
+        if ref['codec'] == CODEC_XOR_SPARSE:
+            return decode_xor_sparse(np.asarray(block), rows)
+        raise ValueError(f'codec desconhecido {int(ref["codec"])}')
+
+    def column(self, name, t_start=None, t_end=None):
+        """Série completa (ou a dos chunks que cobrem o intervalo) de uma coluna."""
+        parts = [self.chunk_column(k, name) for k in self.row_chunks(t_start, t_end)]
+        if len(parts) == 1:
+            return parts[0]
+        return np.concatenate(parts) if parts else np.empty(0, dtype='<f4')
+
+    def events(self):
+        """Todos os eventos (EVENT_DTYPE), em ordem de gravação."""
+        parts = []
+        for entry in self.chunks[self.chunks['kind'] == CHUNK_EVENTS]:
+            start = int(entry['offset']) + CHUNK_DTYPE.itemsize
+            parts.append(self._map[start:start + int(entry['rows']) *
+                                   EVENT_DTYPE.itemsize].view(EVENT_DTYPE))
+        return np.concatenate(parts) if parts else np.empty(0, dtype=EVENT_DTYPE)
+
+
+def main(argv):
+    if len(argv) != 2:
+        print(f'uso: {argv[0]} ARQUIVO')
+        return 1
+    log = ShotLog(argv[1])
+    rows = log.chunks[log.chunks['kind'] == CHUNK_ROWS]
+    print(f'{argv[1]}: {log.num_rows} linhas em {len(rows)} chunks, '
+          f'{len(log.columns)} colunas')
+    if len(rows):
+        print(f'  t = {rows["time_first"][0]:.4f} .. {rows["time_last"][-1]:.4f} s')
+    for name in log.columns:
+        values = log.column(name)
+        print(f'  {name:<26} min {values.min():12.5g}  max {values.max():12.5g}')
+    for ev in log.events():
+        if ev['type'] == EVENT_CONTROLLER_STATE and ev['value'] < len(CONTROLLER_STATES):
+            what = CONTROLLER_STATES[ev['value']]
+        elif ev['type'] == EVENT_LIMIT:
+            state = 'ativo' if ev['value'] >> 8 else 'normal'
+            what = f'limite {ev["value"] & 0xff} {state}'
+        else:
+            what = f'tipo {ev["type"]} valor {ev["value"]}'
+        print(f'  t = {ev["time"]:9.4f} s  {what}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
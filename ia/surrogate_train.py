@@ -0,0 +1,181 @@
+"""
+NPE-PSQ: TREINO DO SURROGATE DE ROLLOUT
+Ajuste offline do modelo de surrogate.h a partir de shot logs binários (shot_log.py)
+Descrição: Ensemble bootstrap de regressões ridge sobre features quadráticas
+
+Cada par de linhas (t, t + horizonte) de um log vira uma amostra: entradas
+no instante t (atuadores pela média da janela, já que o surrogate os
+congela durante o horizonte) e, como alvo, a variação de Ip, z, n_e e W
+ao fim da janela. Janelas que tocam os estados DISRUPTION, MITIGATION ou
+SAFE_SHUTDOWN ficam de fora: ali a física não é a de advance_plasma_state().
+
+O bootstrap é online (peso Poisson(1) por amostra e membro), então as
+equações normais acumulam em blocos e logs longos não precisam caber na
+memória como matriz de features.
+
+Uso:
+    python surrogate_train.py shot1.npsl shot2.npsl --horizon 0.01 -o surrogate.bin
+    ../simulation_c/npe_psq_scan --lhs 1000000 --surrogate surrogate.bin ...
+"""
+
+import argparse
+import sys
+import numpy as np
+
+from shot_log import ShotLog, EVENT_CONTROLLER_STATE
+
+# Precisam bater com surrogate.h
+MAGIC = 0x4753504e
+VERSION = 1
+MEMBERS = 4
+INPUTS = ('plasma_current', 'vertical_position', 'density_core', 'stored_energy',
+          'elongation', 'pf_coil_0', 'vertical_coils', 'heating_power',
+          'fuel_injection_rate', 'energy_confinement_time')
+OUTPUTS = ('plasma_current', 'vertical_position', 'density_core', 'stored_energy')
+FEATURES = 1 + len(INPUTS) + len(INPUTS) * (len(INPUTS) + 1) // 2
+UNCERTAINTY_DEFAULT = 0.05
+
+# Entradas tomadas pela média da janela (atuadores) em vez do instante t
+WINDOWED = ('elongation', 'pf_coil_0', 'vertical_coils', 'heating_power',
+            'fuel_injection_rate', 'energy_confinement_time')
+EXCLUDED_STATES = (4, 5, 6)  # DISRUPTION, MITIGATION, SAFE_SHUTDOWN
+
+HEADER_DTYPE = np.dtype([('magic', '<u4'), ('version', '<u4'), ('inputs', '<u4'),
+                         ('outputs', '<u4'), ('members', '<u4'), ('features', '<u4'),
+                         ('horizon', '<f4'), ('reserved', '<u4')])
+CHUNK = 65536
+
+
+def log_samples(path, horizon):
+    """Entradas (N, INPUTS) e alvos (N, OUTPUTS) de um shot log."""
+    log = ShotLog(path)
+    t = np.asarray(log.column('time'), dtype=np.float64)
+    if t.size < 2:
+        return np.empty((0, len(INPUTS))), np.empty((0, len(OUTPUTS)))
+    vertical = [name for name in log.columns if name.startswith('vertical_coil_')]
+    series = {}
+    for name in INPUTS:
+        if name == 'vertical_coils':
+            series[name] = sum(np.asarray(log.column(c), dtype=np.float64) for c in vertical)
+        else:
+            series[name] = np.asarray(log.column(name), dtype=np.float64)
+
+    dt = np.median(np.diff(t))
+    i = np.arange(t.size)
+    j = np.searchsorted(t, t + horizon - 0.5 * dt)
+    ok = j < t.size
+    i, j = i[ok], j[ok]
+    ok = np.abs(t[j] - t[i] - horizon) <= 0.25 * dt
+
+    # Estado do controlador em cada linha, reconstruído dos eventos
+    events = log.events()
+    events = events[events['type'] == EVENT_CONTROLLER_STATE]
+    if events.size:
+        k = np.searchsorted(events['time'], t, side='right') - 1
+        state = np.where(k >= 0, events['value'][np.maximum(k, 0)], 0)
+        bad = np.cumsum(np.isin(state, EXCLUDED_STATES))
+        ok &= bad[j] == bad[i] - np.isin(state[i], EXCLUDED_STATES)
+    i, j = i[ok], j[ok]
+
+    x = np.empty((i.size, len(INPUTS)))
+    for c, name in enumerate(INPUTS):
+        s = series[name]
+        if name in WINDOWED:
+            csum = np.concatenate(([0.0], np.cumsum(s)))
+            x[:, c] = (csum[j] - csum[i]) / (j - i)
+        else:
+            x[:, c] = s[i]
+    y = np.stack([series[name][j] - series[name][i] for name in OUTPUTS], axis=1)
+    finite = np.isfinite(x).all(axis=1) & np.isfinite(y).all(axis=1)
+    return x[finite], y[finite]
+
+
+def features(xn):
+    """1, x_i e x_i x_j (i <= j, i externo), na ordem de surrogate.c."""
+    n, d = xn.shape
+    cols = [np.ones(n), *xn.T]
+    for a in range(d):
+        for b in range(a, d):
+            cols.append(xn[:, a] * xn[:, b])
+    return np.stack(cols, axis=1)
+
+
+def fit(x, y, ridge, seed):
+    """Normalização, escalas de saída e pesos (FEATURES, MEMBERS * OUTPUTS)."""
+    lo, hi = x.min(axis=0), x.max(axis=0)
+    center = 0.5 * (lo + hi)
+    half = np.maximum(0.5 * (hi - lo), np.maximum(1e-3 * np.abs(center), 1e-6))
+    scale = 1.0 / half
+    output_scale = y.std(axis=0)
+    output_scale[~(output_scale > 0)] = 1.0
+
+    rng = np.random.default_rng(seed)
+    A = np.zeros((MEMBERS, FEATURES, FEATURES))
+    B = np.zeros((MEMBERS, FEATURES, len(OUTPUTS)))
+    for start in range(0, x.shape[0], CHUNK):
+        phi = features((x[start:start + CHUNK] - center) * scale)
+        yn = y[start:start + CHUNK] / output_scale
+        for k in range(MEMBERS):
+            w = rng.poisson(1.0, phi.shape[0]).astype(np.float64)
+            A[k] += (phi * w[:, None]).T @ phi
+            B[k] += (phi * w[:, None]).T @ yn
+
+    weights = np.empty((FEATURES, MEMBERS * len(OUTPUTS)))
+    reg = ridge * x.shape[0] * np.eye(FEATURES)
+    for k in range(MEMBERS):
+        wk = np.linalg.solve(A[k] + reg, B[k])
+        weights[:, k * len(OUTPUTS):(k + 1) * len(OUTPUTS)] = wk * output_scale
+    return center, scale, output_scale, weights
+
+
+def evaluate(x, center, scale, output_scale, weights):
+    """Média do ensemble e incerteza, como em surrogate_evaluate()."""
+    cols = features((x - center) * scale) @ weights
+    members = cols.reshape(x.shape[0], MEMBERS, len(OUTPUTS))
+    mean = members.mean(axis=1)
+    spread = members.std(axis=1, ddof=1) if MEMBERS > 1 else np.zeros_like(mean)
+    return mean, (spread / output_scale).max(axis=1)
+
+
+def save(path, horizon, center, scale, output_scale, weights):
+    header = np.array([(MAGIC, VERSION, len(INPUTS), len(OUTPUTS), MEMBERS, FEATURES,
+                        horizon, 0)], dtype=HEADER_DTYPE)
+    with open(path, 'wb') as f:
+        f.write(header.tobytes())
+        for array in (center, scale, output_scale, weights):
+            f.write(np.ascontiguousarray(array, dtype='<f4').tobytes())
+
+
+def main(argv):
+    parser = argparse.ArgumentParser(description='Treina o surrogate de surrogate.h')
+    parser.add_argument('logs', nargs='+', help='shot logs (.npsl)')
+    parser.add_argument('--horizon', type=float, default=0.01, help='s (padrão 0.01)')
+    parser.add_argument('--ridge', type=float, default=1e-6,
+                        help='regularização, por amostra (padrão 1e-6)')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('-o', '--out', default='surrogate.bin')
+    args = parser.parse_args(argv[1:])
+
+    parts = [log_samples(path, args.horizon) for path in args.logs]
+    x = np.concatenate([p[0] for p in parts])
+    y = np.concatenate([p[1] for p in parts])
+    if x.shape[0] < FEATURES:
+        print(f'amostras insuficientes: {x.shape[0]} (mínimo {FEATURES})')
+        return 1
+
+    model = fit(x, y, args.ridge, args.seed)
+    save(args.out, args.horizon, *model)
+
+    mean, uncertainty = evaluate(x, *model)
+    rmse = np.sqrt(((mean - y) ** 2).mean(axis=0)) / model[2]
+    print(f'{args.out}: {x.shape[0]} amostras, horizonte {args.horizon:g} s')
+    for name, e in zip(OUTPUTS, rmse):
+        print(f'  {name:<20} rmse / escala {e:.3g}')
+    print(f'  incerteza mediana {np.median(uncertainty):.3g}, '
+          f'{(uncertainty > UNCERTAINTY_DEFAULT).mean() * 100:.1f}% acima de '
+          f'{UNCERTAINTY_DEFAULT}')
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main(sys.argv))
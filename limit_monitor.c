@@ -0,0 +1,218 @@
+#include "limit_monitor.h"
+#include "machine_geometry.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define S LIMIT_SIGNAL_COUNT
+
+const LimitSpec limit_default_table[] = {
+    { "vde", LIMIT_SIGNAL_VERTICAL, LIMIT_ABOVE, VERTICAL_DISPLACEMENT_MAX, 0.005f },
+    { "q95_min", LIMIT_SIGNAL_Q95, LIMIT_BELOW, SAFETY_FACTOR_Q95_MIN, 0.05f },
+    { "greenwald", LIMIT_SIGNAL_GREENWALD, LIMIT_ABOVE, 1.0f, 0.02f },
+    { "beta_n", LIMIT_SIGNAL_BETA_N, LIMIT_ABOVE, BETA_NORMAL_LIMIT, 0.05f },
+    { "radiation", LIMIT_SIGNAL_RADIATION, LIMIT_ABOVE, RADIATION_PEAK_LIMIT, 0.2f },
+    { "wall_load", LIMIT_SIGNAL_WALL_LOAD, LIMIT_ABOVE, WALL_LOAD_LIMIT, 0.02f },
+    { "current_ramp", LIMIT_SIGNAL_PLASMA_CURRENT, LIMIT_RATE_ABOVE, DISRUPTION_CURRENT_RAMP, 0.1f },
+};
+const uint32_t limit_default_count = sizeof(limit_default_table) / sizeof(limit_default_table[0]);
+
+static const char *signal_names[S] = {
+    "q95", "beta_n", "vertical", "greenwald", "radiation", "wall_load",
+    "plasma_current", "mhd",
+};
+
+const char *limit_signal_name(LimitSignal signal) {
+    return (unsigned)signal < S ? signal_names[signal] : "unknown";
+}
+
+// ================= SIGNALS =================
+// First-wall area 4 pi^2 R0 a sqrt((1 + kappa^2) / 2)
+static const float wall_area_coefficient =
+    (float)(4.0 * M_PI * M_PI) * TOKAMAK_MAJOR_RADIUS * TOKAMAK_MINOR_RADIUS;
+
+static inline float greenwald_fraction(float density_core, float plasma_current) {
+    return density_core * 0.1f /
+           (fmaxf(plasma_current, 1e-3f) * machine_default.greenwald_coefficient);
+}
+
+static inline float wall_load(float neutron_rate, float elongation) {
+    float area = wall_area_coefficient * sqrtf(0.5f * (1.0f + elongation * elongation));
+    return neutron_rate * LIMIT_NEUTRON_ENERGY / area;
+}
+
+void limit_signals(const PlasmaState *state, float *values) {
+    values[LIMIT_SIGNAL_Q95] = state->safety_factor_q95;
+    values[LIMIT_SIGNAL_BETA_N] = state->beta_normalized;
+    values[LIMIT_SIGNAL_VERTICAL] = fabsf(state->vertical_position);
+    values[LIMIT_SIGNAL_GREENWALD] = greenwald_fraction(state->density_core,
+                                                        state->plasma_current);
+    values[LIMIT_SIGNAL_RADIATION] = state->radiation_power;
+    values[LIMIT_SIGNAL_WALL_LOAD] = wall_load(state->neutron_rate, state->elongation);
+    values[LIMIT_SIGNAL_PLASMA_CURRENT] = state->plasma_current;
+    values[LIMIT_SIGNAL_MHD] = state->mhd_activity_level;
+}
+
+// ================= COMPILE =================
+int limit_monitor_compile(LimitMonitor *monitor, const LimitSpec *specs, uint32_t count,
+                          LimitCallback callback, void *user) {
+    if (count > LIMIT_MONITOR_MAX_LIMITS) return -1;
+    memset(monitor, 0, sizeof(*monitor));
+    for (uint32_t i = 0; i < count; i++) {
+        const LimitSpec *spec = &specs[i];
+        if ((unsigned)spec->signal >= S || spec->kind > LIMIT_RATE_ABOVE) return -1;
+        // Below-limits are above-limits on the negated input
+        float sign = spec->kind == LIMIT_BELOW ? -1.0f : 1.0f;
+        bool rate = spec->kind == LIMIT_RATE_ABOVE;
+        monitor->index[i] = (uint8_t)(spec->signal + (rate ? S : 0));
+        monitor->sign[i] = sign;
+        monitor->trip[i] = sign * spec->threshold;
+        monitor->clear[i] = sign * spec->threshold - fabsf(spec->hysteresis);
+        monitor->name[i] = spec->name;
+        monitor->rate_mask |= rate ? 1u << i : 0;
+    }
+    monitor->count = count;
+    monitor->callback = callback;
+    monitor->user = user;
+    return 0;
+}
+
+void limit_monitor_reset(LimitMonitor *monitor) {
+    monitor->mask = 0;
+    monitor->primed = false;
+    memset(monitor->previous, 0, sizeof(monitor->previous));
+}
+
+// ================= EVALUATION =================
+static inline uint32_t evaluate(const LimitMonitor *monitor, const float *input,
+                                uint32_t mask) {
+    uint32_t next = 0;
+    for (uint32_t i = 0; i < monitor->count; i++) {
+        float x = monitor->sign[i] * input[monitor->index[i]];
+        float threshold = mask >> i & 1u ? monitor->clear[i] : monitor->trip[i];
+        next |= (uint32_t)!(x <= threshold) << i;
+    }
+    return next;
+}
+
+static void fire(const LimitMonitor *monitor, uint32_t lane, uint32_t changed,
+                 uint32_t mask, const float *input, float time) {
+    while (changed) {
+        uint32_t i = (uint32_t)__builtin_ctz(changed);
+        changed &= changed - 1;
+        monitor->callback(monitor->user, lane, i, mask >> i & 1u,
+                          input[monitor->index[i]], time);
+    }
+}
+
+uint32_t limit_monitor_update(LimitMonitor *monitor, const PlasmaState *state,
+                              float dt, float time) {
+    float input[2 * S];
+    limit_signals(state, input);
+    bool rates = monitor->primed && dt > 0.0f;
+    for (int s = 0; s < S; s++) {
+        input[S + s] = rates ? fabsf(input[s] - monitor->previous[s]) / dt : 0.0f;
+    }
+    memcpy(monitor->previous, input, sizeof(monitor->previous));
+    monitor->primed = true;
+
+    uint32_t next = evaluate(monitor, input, monitor->mask);
+    uint32_t changed = next ^ monitor->mask;
+    monitor->mask = next;
+    if (changed) {
+        monitor->transitions += (uint64_t)__builtin_popcount(changed);
+        if (monitor->callback) fire(monitor, 0, changed, next, input, time);
+    }
+    return next;
+}
+
+// ================= BATCHED =================
+#define LIMIT_LANES_ARRAYS (3 * S + 2)
+#define LIMIT_BATCH_BLOCK 64              // lanes per evaluation block
+
+int limit_lanes_init(LimitMonitorLanes *lanes, uint32_t capacity) {
+    memset(lanes, 0, sizeof(*lanes));
+    uint32_t per_line = PLASMA_BATCH_ALIGN / sizeof(float);
+    uint32_t stride = (capacity + per_line - 1) / per_line * per_line;
+    if (stride == 0) stride = per_line;
+    size_t bytes = (size_t)stride * sizeof(float) * LIMIT_LANES_ARRAYS;
+    float *block = aligned_alloc(PLASMA_BATCH_ALIGN, bytes);
+    if (!block) return -1;
+    memset(block, 0, bytes);
+    for (int s = 0; s < S; s++) lanes->previous[s] = block + (size_t)s * stride;
+    for (int s = 0; s < 2 * S; s++) lanes->input[s] = block + (size_t)(S + s) * stride;
+    lanes->mask = (uint32_t *)(block + (size_t)3 * S * stride);
+    lanes->primed = (uint8_t *)(block + (size_t)(3 * S + 1) * stride);
+    lanes->capacity = stride;
+    lanes->block = block;
+    return 0;
+}
+
+void limit_lanes_free(LimitMonitorLanes *lanes) {
+    free(lanes->block);
+    memset(lanes, 0, sizeof(*lanes));
+}
+
+void limit_lanes_reset(LimitMonitorLanes *lanes, uint32_t lane) {
+    lanes->mask[lane] = 0;
+    lanes->primed[lane] = 0;
+    for (int s = 0; s < S; s++) lanes->previous[s][lane] = 0.0f;
+}
+
+void limit_monitor_update_batch(const LimitMonitor *monitor, LimitMonitorLanes *lanes,
+                                const PlasmaBatch *batch, float dt) {
+    const uint32_t n = batch->count < lanes->capacity ? batch->count : lanes->capacity;
+    float *const *in = lanes->input;
+
+    // Signals, one array per signal
+    for (uint32_t l = 0; l < n; l++) {
+        in[LIMIT_SIGNAL_Q95][l] = batch->safety_factor_q95[l];
+        in[LIMIT_SIGNAL_BETA_N][l] = batch->beta_normalized[l];
+        in[LIMIT_SIGNAL_VERTICAL][l] = fabsf(batch->vertical_position[l]);
+        in[LIMIT_SIGNAL_GREENWALD][l] = greenwald_fraction(batch->density_core[l],
+                                                           batch->plasma_current[l]);
+        in[LIMIT_SIGNAL_RADIATION][l] = batch->radiation_power[l];
+        in[LIMIT_SIGNAL_WALL_LOAD][l] = wall_load(batch->neutron_rate[l],
+                                                  batch->elongation[l]);
+        in[LIMIT_SIGNAL_PLASMA_CURRENT][l] = batch->plasma_current[l];
+        in[LIMIT_SIGNAL_MHD][l] = batch->mhd_activity_level[l];
+    }
+    for (int s = 0; s < S; s++) {
+        float *restrict value = in[s];
+        float *restrict rate = in[S + s];
+        float *restrict previous = lanes->previous[s];
+        for (uint32_t l = 0; l < n; l++) {
+            float r = fabsf(value[l] - previous[l]) / dt;
+            rate[l] = lanes->primed[l] && dt > 0.0f ? r : 0.0f;
+            previous[l] = value[l];
+        }
+    }
+
+    // One pass per limit over the lanes, then transitions per lane
+    uint32_t *restrict mask = lanes->mask;
+    uint32_t next_mask[LIMIT_BATCH_BLOCK];
+    for (uint32_t base = 0; base < n; base += LIMIT_BATCH_BLOCK) {
+        uint32_t end = base + LIMIT_BATCH_BLOCK < n ? base + LIMIT_BATCH_BLOCK : n;
+        for (uint32_t l = base; l < end; l++) next_mask[l - base] = 0;
+        for (uint32_t i = 0; i < monitor->count; i++) {
+            const float *restrict x = in[monitor->index[i]];
+            const float sign = monitor->sign[i];
+            const float trip = monitor->trip[i], clear = monitor->clear[i];
+            for (uint32_t l = base; l < end; l++) {
+                float threshold = mask[l] >> i & 1u ? clear : trip;
+                next_mask[l - base] |= (uint32_t)!(sign * x[l] <= threshold) << i;
+            }
+        }
+        for (uint32_t l = base; l < end; l++) {
+            uint32_t next = next_mask[l - base];
+            uint32_t changed = next ^ mask[l];
+            mask[l] = next;
+            lanes->primed[l] = 1;
+            if (!changed) continue;
+            lanes->transitions += (uint64_t)__builtin_popcount(changed);
+            if (!monitor->callback) continue;
+            float input[2 * S];
+            for (int s = 0; s < 2 * S; s++) input[s] = in[s][l];
+            fire(monitor, l, changed, next, input, batch->simulation_time[l]);
+        }
+    }
+}
@@ -0,0 +1,119 @@
+#ifndef LIMIT_MONITOR_H
+#define LIMIT_MONITOR_H
+
+#include "npe_config.h"
+#include "plasma_batch.h"
+
+// ================= LIMIT MONITOR =================
+// Table-driven operational limit checks. A LimitSpec names a signal
+// derived from the plasma state, a direction (above, below, or rate of
+// change above), a threshold and a hysteresis band. limit_monitor_compile()
+// turns a table of them into flat arrays, so one update is the same
+// straight-line loop for any table:
+//
+//   x      = sign[i] * input[index[i]]        (value or |rate| of a signal)
+//   active = !(x <= (was_active ? clear[i] : trip[i]))
+//
+// giving one bit per limit in a uint32_t mask. A NaN input reads as a
+// violation. The callback fires only for the bits that changed since the
+// previous update, so steady-state cycles cost the evaluation and nothing
+// more. Adding a limit means adding a table row, not a branch.
+//
+// limit_monitor_update() keeps its state in the monitor (one shot).
+// limit_monitor_update_batch() evaluates the same compiled table over a
+// PlasmaBatch with per-lane state in LimitMonitorLanes.
+//
+// The MHD drive that advance_plasma_state() adds beyond the q95, beta_N
+// and vertical limits is part of the plasma model and stays there; this
+// monitor only observes.
+
+#define LIMIT_MONITOR_MAX_LIMITS 32
+#define LIMIT_NEUTRON_ENERGY 2.259e-18f     // 14.1 MeV in MJ
+
+typedef enum {
+    LIMIT_SIGNAL_Q95,
+    LIMIT_SIGNAL_BETA_N,
+    LIMIT_SIGNAL_VERTICAL,          // |z|, m
+    LIMIT_SIGNAL_GREENWALD,         // n_e / n_G
+    LIMIT_SIGNAL_RADIATION,         // MW
+    LIMIT_SIGNAL_WALL_LOAD,         // neutron wall load, MW/m^2
+    LIMIT_SIGNAL_PLASMA_CURRENT,    // MA
+    LIMIT_SIGNAL_MHD,
+    LIMIT_SIGNAL_COUNT
+} LimitSignal;
+
+typedef enum {
+    LIMIT_ABOVE,
+    LIMIT_BELOW,
+    LIMIT_RATE_ABOVE                // |d signal / dt|
+} LimitKind;
+
+typedef struct {
+    const char *name;
+    LimitSignal signal;
+    LimitKind kind;
+    float threshold;
+    float hysteresis;               // an active limit clears this far inside
+} LimitSpec;
+
+// lane is 0 for limit_monitor_update(); value is the checked input
+typedef void (*LimitCallback)(void *user, uint32_t lane, uint32_t limit,
+                              bool active, float value, float time);
+
+typedef struct {
+    uint32_t count;
+    uint32_t rate_mask;             // limits on a rate
+    uint8_t index[LIMIT_MONITOR_MAX_LIMITS];   // into value[] ++ rate[]
+    float sign[LIMIT_MONITOR_MAX_LIMITS];
+    float trip[LIMIT_MONITOR_MAX_LIMITS];
+    float clear[LIMIT_MONITOR_MAX_LIMITS];
+    const char *name[LIMIT_MONITOR_MAX_LIMITS];
+    LimitCallback callback;
+    void *user;
+
+    // Single-shot state
+    uint32_t mask;
+    bool primed;
+    float previous[LIMIT_SIGNAL_COUNT];
+    uint64_t transitions;
+} LimitMonitor;
+
+typedef struct {
+    uint32_t capacity;
+    uint32_t *mask;
+    uint8_t *primed;
+    float *previous[LIMIT_SIGNAL_COUNT];
+    float *input[2 * LIMIT_SIGNAL_COUNT];      // scratch: values, then rates
+    uint64_t transitions;
+    void *block;
+} LimitMonitorLanes;
+
+// VDE, q95, Greenwald, beta_N, radiation, wall load and current ramp
+// limits of npe_config.h
+extern const LimitSpec limit_default_table[];
+extern const uint32_t limit_default_count;
+
+const char *limit_signal_name(LimitSignal signal);
+
+// Returns -1 for more than LIMIT_MONITOR_MAX_LIMITS limits or an unknown
+// signal or kind. callback may be NULL.
+int limit_monitor_compile(LimitMonitor *monitor, const LimitSpec *specs, uint32_t count,
+                          LimitCallback callback, void *user);
+void limit_monitor_reset(LimitMonitor *monitor);
+
+// Signal values of one state (LIMIT_SIGNAL_COUNT entries)
+void limit_signals(const PlasmaState *state, float *values);
+
+// Returns the active-limit mask; rate limits stay clear on the first update
+uint32_t limit_monitor_update(LimitMonitor *monitor, const PlasmaState *state,
+                              float dt, float time);
+
+int limit_lanes_init(LimitMonitorLanes *lanes, uint32_t capacity);
+void limit_lanes_free(LimitMonitorLanes *lanes);
+void limit_lanes_reset(LimitMonitorLanes *lanes, uint32_t lane);
+
+// Updates lanes [0, batch->count); masks land in lanes->mask
+void limit_monitor_update_batch(const LimitMonitor *monitor, LimitMonitorLanes *lanes,
+                                const PlasmaBatch *batch, float dt);
+
+#endif // LIMIT_MONITOR_H
@@ -0,0 +1,351 @@
+#include "linear_mpc.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define NX MPC_NX
+#define NU MPC_NU
+#define NV MPC_NV
+#define N LINEAR_MPC_HORIZON
+
+// ================= CONDENSING (double, create only) =================
+// out = P' Q M for an NX x NU block P and an NX x NX block M; out is NU x NX
+static void quad_block(const double *P, const double *Q, const double *M,
+                       double *out) {
+    double QM[NX][NX];
+    for (int i = 0; i < NX; i++) {
+        for (int j = 0; j < NX; j++) {
+            double s = 0.0;
+            for (int k = 0; k < NX; k++) s += Q[i * NX + k] * M[k * NX + j];
+            QM[i][j] = s;
+        }
+    }
+    for (int a = 0; a < NU; a++) {
+        for (int j = 0; j < NX; j++) {
+            double s = 0.0;
+            for (int k = 0; k < NX; k++) s += P[k * NU + a] * QM[k][j];
+            out[a * NX + j] = s;
+        }
+    }
+}
+
+// In-place Cholesky of an NV x NV matrix (lower triangle); -1 if not PD
+static int cholesky(double *L) {
+    for (int j = 0; j < NV; j++) {
+        double d = L[j * NV + j];
+        for (int k = 0; k < j; k++) d -= L[j * NV + k] * L[j * NV + k];
+        if (!(d > 0.0) || !isfinite(d)) return -1;
+        d = sqrt(d);
+        L[j * NV + j] = d;
+        for (int i = j + 1; i < NV; i++) {
+            double s = L[i * NV + j];
+            for (int k = 0; k < j; k++) s -= L[i * NV + k] * L[j * NV + k];
+            L[i * NV + j] = s / d;
+        }
+    }
+    return 0;
+}
+
+static double largest_eigenvalue(const double *H) {
+    double v[NV], Hv[NV];
+    for (int i = 0; i < NV; i++) v[i] = 1.0 / sqrt((double)NV);
+    double lambda = 0.0;
+    for (int it = 0; it < LINEAR_MPC_POWER_ITERATIONS; it++) {
+        double norm = 0.0;
+        for (int i = 0; i < NV; i++) {
+            double s = 0.0;
+            for (int j = 0; j < NV; j++) s += H[i * NV + j] * v[j];
+            Hv[i] = s;
+            norm += s * s;
+        }
+        norm = sqrt(norm);
+        if (!(norm > 0.0)) return 0.0;
+        lambda = norm;
+        for (int i = 0; i < NV; i++) v[i] = Hv[i] / norm;
+    }
+    return lambda;
+}
+
+static int build_qp(LinearMpc *mpc, const float *A, const float *B,
+                    const float *Q, const float *R) {
+    // A^t (t = 0..N), A^j B (j = 0..N-1), sum_{j<t} A^j (t = 0..N)
+    double (*Apow)[NX * NX] = malloc((N + 1) * sizeof(*Apow));
+    double (*Sw)[NX * NX] = malloc((N + 1) * sizeof(*Sw));
+    double (*P)[NX * NU] = malloc(N * sizeof(*P));
+    double *H = malloc((size_t)NV * NV * sizeof(double));
+    if (!Apow || !Sw || !P || !H) {
+        free(Apow); free(Sw); free(P); free(H);
+        return -1;
+    }
+    double Qd[NX * NX], I[NX * NX];
+    for (int i = 0; i < NX * NX; i++) Qd[i] = Q[i];
+    for (int i = 0; i < NX; i++) {
+        for (int j = 0; j < NX; j++) I[i * NX + j] = i == j;
+    }
+    memcpy(Apow[0], I, sizeof(I));
+    memset(Sw[0], 0, sizeof(Sw[0]));
+    for (int t = 1; t <= N; t++) {
+        for (int i = 0; i < NX; i++) {
+            for (int j = 0; j < NX; j++) {
+                double s = 0.0;
+                for (int k = 0; k < NX; k++) s += A[i * NX + k] * Apow[t - 1][k * NX + j];
+                Apow[t][i * NX + j] = s;
+                Sw[t][i * NX + j] = Sw[t - 1][i * NX + j] + Apow[t - 1][i * NX + j];
+            }
+        }
+    }
+    for (int j = 0; j < N; j++) {
+        for (int i = 0; i < NX; i++) {
+            for (int a = 0; a < NU; a++) {
+                double s = 0.0;
+                for (int k = 0; k < NX; k++) s += Apow[j][i * NX + k] * B[k * NU + a];
+                P[j][i * NU + a] = s;
+            }
+        }
+    }
+
+    // x_t = A^t x0 + sum_{k<t} A^(t-1-k) (B u_k + w): input k reaches x_t
+    // through P[t-1-k] for every t > k
+    memset(H, 0, (size_t)NV * NV * sizeof(double));
+    for (int k = 0; k < N; k++) {
+        double F[NU * NX] = {0}, Gw[NU * NX] = {0}, Gr[NU * NX] = {0};
+        for (int t = k + 1; t <= N; t++) {
+            double blk[NU * NX];
+            quad_block(P[t - 1 - k], Qd, Apow[t], blk);
+            for (int i = 0; i < NU * NX; i++) F[i] += blk[i];
+            quad_block(P[t - 1 - k], Qd, Sw[t], blk);
+            for (int i = 0; i < NU * NX; i++) Gw[i] += blk[i];
+            quad_block(P[t - 1 - k], Qd, I, blk);
+            for (int i = 0; i < NU * NX; i++) Gr[i] += blk[i];
+        }
+        for (int a = 0; a < NU; a++) {
+            for (int j = 0; j < NX; j++) {
+                mpc->F[k * NU + a][j] = (float)F[a * NX + j];
+                mpc->G_w[k * NU + a][j] = (float)Gw[a * NX + j];
+                mpc->G_r[k * NU + a][j] = (float)Gr[a * NX + j];
+            }
+        }
+        for (int l = 0; l < N; l++) {
+            // sum over t > max(k, l) of P[t-1-k]' Q P[t-1-l]
+            for (int t = (k > l ? k : l) + 1; t <= N; t++) {
+                const double *Pk = P[t - 1 - k], *Pl = P[t - 1 - l];
+                for (int a = 0; a < NU; a++) {
+                    for (int b = 0; b < NU; b++) {
+                        double s = 0.0;
+                        for (int i = 0; i < NX; i++) {
+                            for (int j = 0; j < NX; j++) {
+                                s += Pk[i * NU + a] * Qd[i * NX + j] * Pl[j * NU + b];
+                            }
+                        }
+                        H[(k * NU + a) * NV + l * NU + b] += s;
+                    }
+                }
+            }
+        }
+        for (int a = 0; a < NU; a++) {
+            for (int b = 0; b < NU; b++) H[(k * NU + a) * NV + k * NU + b] += R[a * NU + b];
+        }
+    }
+
+    int rc = -1;
+    double *L = malloc((size_t)NV * NV * sizeof(double));
+    double lambda = largest_eigenvalue(H);
+    if (L && lambda > 0.0 && isfinite(lambda)) {
+        memcpy(L, H, (size_t)NV * NV * sizeof(double));
+        if (cholesky(L) == 0) {
+            // Column c of H^-1 from L L' x = e_c
+            for (int c = 0; c < NV; c++) {
+                double x[NV];
+                for (int i = 0; i < NV; i++) {
+                    double s = i == c;
+                    for (int k = 0; k < i; k++) s -= L[i * NV + k] * x[k];
+                    x[i] = s / L[i * NV + i];
+                }
+                for (int i = NV - 1; i >= 0; i--) {
+                    double s = x[i];
+                    for (int k = i + 1; k < NV; k++) s -= L[k * NV + i] * x[k];
+                    x[i] = s / L[i * NV + i];
+                }
+                for (int i = 0; i < NV; i++) mpc->H_inv[i][c] = (float)x[i];
+            }
+            for (int i = 0; i < NV; i++) {
+                for (int j = 0; j < NV; j++) mpc->H[i][j] = (float)H[i * NV + j];
+            }
+            mpc->step = (float)(1.0 / (lambda * 1.01));
+            rc = 0;
+        }
+    }
+    free(L); free(Apow); free(Sw); free(P); free(H);
+    return rc;
+}
+
+LinearMpc *linear_mpc_create(const float *A, const float *B, const float *Q,
+                             const float *R, const float *u_min, const float *u_max) {
+    LinearMpc *mpc = aligned_alloc(LINEAR_MPC_ALIGN,
+                                   (sizeof(LinearMpc) + LINEAR_MPC_ALIGN - 1) /
+                                   LINEAR_MPC_ALIGN * LINEAR_MPC_ALIGN);
+    if (!mpc) return NULL;
+    memset(mpc, 0, sizeof(*mpc));
+    for (int a = 0; a < NU; a++) {
+        if (!(u_max[a] >= u_min[a])) {
+            free(mpc);
+            return NULL;
+        }
+    }
+    if (build_qp(mpc, A, B, Q, R) != 0) {
+        free(mpc);
+        return NULL;
+    }
+    memcpy(mpc->A, A, sizeof(mpc->A));
+    memcpy(mpc->B, B, sizeof(mpc->B));
+    memcpy(mpc->Q, Q, sizeof(mpc->Q));
+    memcpy(mpc->R, R, sizeof(mpc->R));
+    for (int k = 0; k < N; k++) {
+        for (int a = 0; a < NU; a++) {
+            mpc->lower[k * NU + a] = u_min[a];
+            mpc->upper[k * NU + a] = u_max[a];
+        }
+    }
+    mpc->max_iterations = LINEAR_MPC_MAX_ITERATIONS;
+    mpc->tolerance = LINEAR_MPC_TOLERANCE;
+    return mpc;
+}
+
+void linear_mpc_destroy(LinearMpc *mpc) {
+    free(mpc);
+}
+
+void linear_mpc_reset(LinearMpc *mpc) {
+    mpc->warm = false;
+}
+
+void linear_mpc_dimensions(uint32_t *states, uint32_t *inputs, uint32_t *horizon) {
+    *states = NX;
+    *inputs = NU;
+    *horizon = N;
+}
+
+// ================= SOLVE =================
+static inline float clampf(float x, float lo, float hi) {
+    x = x < lo ? lo : x;
+    return x > hi ? hi : x;
+}
+
+// M is NV x NV, row-major
+static void mat_vec(const float *M, const float *x, float *out) {
+    for (int i = 0; i < NV; i++) {
+        const float *row = M + i * NV;
+        float s = 0.0f;
+        #pragma GCC ivdep
+        for (int j = 0; j < NV; j++) s += row[j] * x[j];
+        out[i] = s;
+    }
+}
+
+static float plan_cost(const LinearMpc *mpc, const float *x0, const float *x_ref,
+                       const float *w, const float *U) {
+    float x[NX], cost = 0.0f;
+    memcpy(x, x0, sizeof(x));
+    for (int t = 0; t < N; t++) {
+        const float *u = U + t * NU;
+        float next[NX];
+        for (int i = 0; i < NX; i++) {
+            float s = w ? w[i] : 0.0f;
+            for (int j = 0; j < NX; j++) s += mpc->A[i][j] * x[j];
+            for (int a = 0; a < NU; a++) s += mpc->B[i][a] * u[a];
+            next[i] = s;
+        }
+        memcpy(x, next, sizeof(x));
+        for (int i = 0; i < NX; i++) {
+            for (int j = 0; j < NX; j++) {
+                cost += (x[i] - x_ref[i]) * mpc->Q[i][j] * (x[j] - x_ref[j]);
+            }
+        }
+        for (int a = 0; a < NU; a++) {
+            for (int b = 0; b < NU; b++) cost += u[a] * mpc->R[a][b] * u[b];
+        }
+    }
+    return cost;
+}
+
+int linear_mpc_solve(LinearMpc *mpc, const float *x0, const float *x_ref,
+                     const float *w, float *u, float *cost) {
+    _Alignas(LINEAR_MPC_ALIGN) float g[NV];
+    _Alignas(LINEAR_MPC_ALIGN) float z[NV];
+    _Alignas(LINEAR_MPC_ALIGN) float y[NV];
+    _Alignas(LINEAR_MPC_ALIGN) float grad[NV];
+    for (int i = 0; i < NV; i++) {
+        float s = 0.0f;
+        for (int j = 0; j < NX; j++) {
+            s += mpc->F[i][j] * x0[j] - mpc->G_r[i][j] * x_ref[j];
+            if (w) s += mpc->G_w[i][j] * w[j];
+        }
+        g[i] = s;
+    }
+
+    // 1. Unconstrained optimum
+    mat_vec(&mpc->H_inv[0][0], g, z);
+    bool inside = true;
+    for (int i = 0; i < NV; i++) {
+        z[i] = -z[i];
+        inside &= z[i] >= mpc->lower[i] && z[i] <= mpc->upper[i];
+    }
+    int iterations = 0;
+    bool converged = true;
+    if (!inside) {
+        // 2. FISTA from the shifted previous plan (or the clipped optimum)
+        if (mpc->warm) {
+            memcpy(z, mpc->U + NU, (NV - NU) * sizeof(float));
+            memcpy(z + NV - NU, mpc->U + NV - NU, NU * sizeof(float));
+        }
+        for (int i = 0; i < NV; i++) z[i] = clampf(z[i], mpc->lower[i], mpc->upper[i]);
+        memcpy(y, z, sizeof(y));
+        float t = 1.0f;
+        converged = false;
+        while (iterations < (int)mpc->max_iterations) {
+            iterations++;
+            mat_vec(&mpc->H[0][0], y, grad);
+            float change = 0.0f, restart = 0.0f;
+            for (int i = 0; i < NV; i++) {
+                float next = clampf(y[i] - mpc->step * (grad[i] + g[i]),
+                                    mpc->lower[i], mpc->upper[i]);
+                float width = mpc->upper[i] - mpc->lower[i];
+                float d = next - z[i];
+                float rel = fabsf(d) / (width > 0.0f ? width : 1.0f);
+                change = rel > change ? rel : change;
+                restart += (y[i] - next) * d;
+                grad[i] = d;            // reused as the step
+                z[i] = next;
+            }
+            if (change <= mpc->tolerance) {
+                converged = true;
+                break;
+            }
+            if (restart > 0.0f) {
+                // Momentum points uphill: restart from the projected point
+                t = 1.0f;
+                memcpy(y, z, sizeof(y));
+            } else {
+                float t_next = 0.5f * (1.0f + sqrtf(1.0f + 4.0f * t * t));
+                float beta = (t - 1.0f) / t_next;
+                for (int i = 0; i < NV; i++) y[i] = z[i] + beta * grad[i];
+                t = t_next;
+            }
+        }
+    }
+
+    memcpy(mpc->U, z, sizeof(mpc->U));
+    mpc->warm = true;
+    uint32_t active = 0;
+    for (int i = 0; i < NV; i++) active += z[i] <= mpc->lower[i] || z[i] >= mpc->upper[i];
+    memcpy(u, z, NU * sizeof(float));
+    if (cost) *cost = plan_cost(mpc, x0, x_ref, w, z);
+
+    LinearMpcStats *s = &mpc->stats;
+    s->solves++;
+    s->unconstrained += inside;
+    s->iterations_last = (uint32_t)iterations;
+    if ((uint32_t)iterations > s->iterations_max) s->iterations_max = (uint32_t)iterations;
+    s->not_converged += !converged;
+    s->active_last = inside ? 0 : active;
+    return converged ? iterations : -1;
+}
@@ -0,0 +1,105 @@
+#ifndef LINEAR_MPC_H
+#define LINEAR_MPC_H
+
+#include "npe_config.h"
+
+// ================= CONDENSED LINEAR MPC =================
+// Box-constrained linear MPC for the A/B/Q/R model of
+// ia/npe_adaptive_control.py (AdaptiveMPCController):
+//   x_{t+1} = A x_t + B u_t + w
+//   min  sum_{t=1..N} (x_t - r)' Q (x_t - r) + sum_{t=0..N-1} u_t' R u_t
+//   s.t. u_min <= u_t <= u_max
+// The affine term w is held over the horizon, e.g. the neural
+// correction delta_f * dt.
+//
+// Condensing eliminates the states: with U the stacked inputs,
+//   min 1/2 U' H U + g' U,   g = F x0 + G_w w - G_r r.
+// Only g depends on the solve inputs. linear_mpc_create() builds
+// H, F, G_w and G_r once, in double, and factorizes H. A solve then:
+//   1. forms g and the unconstrained optimum U* = -H^-1 g (one mat-vec);
+//      if U* is inside the box it is the solution;
+//   2. otherwise runs accelerated projected gradient (FISTA, step 1/L,
+//      adaptive restart), warm-started from the previous solution shifted
+//      by one step, until the step falls below tolerance.
+// No allocation happens after create.
+//
+// Dimensions are fixed at compile time (override with -D), so every loop
+// has a constant trip count. The defaults are the Python controller's
+// 3 states, 3 inputs and horizon 15, giving a 45-variable QP.
+
+#ifndef LINEAR_MPC_STATES
+#define LINEAR_MPC_STATES 3
+#endif
+#ifndef LINEAR_MPC_INPUTS
+#define LINEAR_MPC_INPUTS 3
+#endif
+#ifndef LINEAR_MPC_HORIZON
+#define LINEAR_MPC_HORIZON 15
+#endif
+
+#define LINEAR_MPC_VARIABLES (LINEAR_MPC_INPUTS * LINEAR_MPC_HORIZON)
+#define LINEAR_MPC_ALIGN 64
+#define LINEAR_MPC_MAX_ITERATIONS 500
+#define LINEAR_MPC_TOLERANCE 1e-5f          // step size relative to the box width
+#define LINEAR_MPC_POWER_ITERATIONS 200
+
+#define MPC_NX LINEAR_MPC_STATES
+#define MPC_NU LINEAR_MPC_INPUTS
+#define MPC_NV LINEAR_MPC_VARIABLES
+
+typedef struct {
+    uint32_t solves;
+    uint32_t unconstrained;         // solves settled by step 1
+    uint32_t iterations_last;
+    uint32_t iterations_max;
+    uint32_t not_converged;
+    uint32_t active_last;           // inputs on a bound, last solve
+} LinearMpcStats;
+
+typedef struct {
+    // QP, row-major; H and H_inv are NV x NV, the gains NV x NX
+    _Alignas(LINEAR_MPC_ALIGN) float H[MPC_NV][MPC_NV];
+    _Alignas(LINEAR_MPC_ALIGN) float H_inv[MPC_NV][MPC_NV];
+    _Alignas(LINEAR_MPC_ALIGN) float F[MPC_NV][MPC_NX];
+    float G_w[MPC_NV][MPC_NX];
+    float G_r[MPC_NV][MPC_NX];
+    float lower[MPC_NV];
+    float upper[MPC_NV];
+    float step;                     // 1 / (largest eigenvalue of H)
+
+    // Model, for the cost of the returned plan
+    float A[MPC_NX][MPC_NX];
+    float B[MPC_NX][MPC_NU];
+    float Q[MPC_NX][MPC_NX];
+    float R[MPC_NU][MPC_NU];
+
+    // Solver state
+    _Alignas(LINEAR_MPC_ALIGN) float U[MPC_NV];     // last plan, warm start
+    bool warm;
+    uint32_t max_iterations;
+    float tolerance;
+    LinearMpcStats stats;
+} LinearMpc;
+
+// Builds the condensed QP. A is NX x NX, B NX x NU, Q NX x NX, R NU x NU,
+// all row-major; u_min / u_max have NU entries. Returns NULL if H is not
+// positive definite (R must be, or B must have full column rank with
+// Q positive definite) or the allocation fails.
+LinearMpc *linear_mpc_create(const float *A, const float *B, const float *Q,
+                             const float *R, const float *u_min, const float *u_max);
+void linear_mpc_destroy(LinearMpc *mpc);
+
+// Drops the warm start, e.g. after a reference step
+void linear_mpc_reset(LinearMpc *mpc);
+
+// Solves for state x0, reference x_ref and affine term w (NULL for none),
+// writing the first input to u (NU entries) and, if cost is not NULL, the
+// plan's cost. Returns the iteration count (0 when unconstrained), or -1
+// when the iteration cap was hit; u holds the best feasible plan either way.
+int linear_mpc_solve(LinearMpc *mpc, const float *x0, const float *x_ref,
+                     const float *w, float *u, float *cost);
+
+// Compiled dimensions, for bindings
+void linear_mpc_dimensions(uint32_t *states, uint32_t *inputs, uint32_t *horizon);
+
+#endif // LINEAR_MPC_H
@@ -0,0 +1,185 @@
+#ifndef MACHINE_GEOMETRY_H
+#define MACHINE_GEOMETRY_H
+
+#include "npe_config.h"
+
+// ================= MACHINE DESCRIPTION =================
+// Device geometry and every quantity derived from it alone, fixed once per
+// machine. MACHINE_GEOMETRY() is a constant initializer, so a machine can
+// be either
+//   - a compile-time constant: machine_default (the TOKAMAK_* device) is a
+//     static const visible in every translation unit, and the inline
+//     kernels below fold to literals when given its address, or
+//   - a runtime object: machine_geometry_init() fills one from parameters,
+//     for tools that compare several devices in one process.
+//
+// plasma_physics.h exposes each geometry-dependent model twice: the
+// original name on machine_default and a *_machine() variant taking a
+// MachineGeometry. Both share one body, so they agree to the bit for the
+// same machine.
+//
+// Coil and heating counts may be smaller than, but never exceed, the
+// NUM_* capacities that size the arrays in PlasmaControlSystem.
+//
+// The IPB98 geometry factor needs pow(), which is not a constant
+// expression, so MACHINE_GEOMETRY() takes it as an argument:
+// machine_default passes the precomputed MACHINE_DEFAULT_TAU_GEOMETRY and
+// machine_geometry_init() evaluates machine_tau_geometry().
+//
+// The derived coefficients are folded in double and rounded to float
+// once, where the kernels before MachineGeometry evaluated the same
+// products in float at every call. safety_factor_profile(),
+// calculate_beta_normalized(), energy_confinement_time() and
+// calculate_disruption_forces() therefore round differently from those
+// expressions: most results move by a few ULP, up to about 5e-7 relative.
+// Every path shares these coefficients, so "bit-identical" elsewhere in
+// the tree compares paths against each other, not against the
+// pre-MachineGeometry code.
+
+typedef struct {
+    // Base parameters
+    float major_radius;             // m
+    float minor_radius;             // m
+    float toroidal_field;           // T
+    float plasma_current;           // nominal, MA
+    uint8_t num_pf_coils;
+    uint8_t num_vertical_coils;
+    uint8_t num_horizontal_coils;
+    uint8_t num_heating_systems;
+
+    // Derived
+    float volume_per_elongation;    // 2 pi^2 R0 a^2, m^3 (times kappa)
+    float f_ce;                     // on-axis electron cyclotron frequency, Hz
+    float q_coefficient;            // 2 pi B a^2 / mu0 R0 (over Ip in A)
+    float b_pol_per_ma;             // mu0 1e6 / 2 pi a, T per MA
+    float beta_n_coefficient;       // a B (beta_N = beta[%] a B / Ip)
+    float greenwald_coefficient;    // 1 / pi a^2
+    float tau_geometry;             // 0.0562 B^0.15 R0^1.97 a^0.58 of the IPB98 fit
+} MachineGeometry;
+
+#define MACHINE_GEOMETRY(R0, a, Bt, Ip, n_pf, n_vertical, n_horizontal,         \
+                         n_heating, tau_E_geometry) {                           \
+    .major_radius = (R0),                                                       \
+    .minor_radius = (a),                                                        \
+    .toroidal_field = (Bt),                                                     \
+    .plasma_current = (Ip),                                                     \
+    .num_pf_coils = (n_pf),                                                     \
+    .num_vertical_coils = (n_vertical),                                         \
+    .num_horizontal_coils = (n_horizontal),                                     \
+    .num_heating_systems = (n_heating),                                         \
+    .volume_per_elongation = (float)(2.0 * M_PI * M_PI * (R0) * (a) * (a)),     \
+    .f_ce = (float)(ELECTRON_CHARGE * (Bt) / (2.0 * M_PI * ELECTRON_MASS)),     \
+    .q_coefficient = (float)(2.0 * M_PI * (Bt) * (a) * (a) / (MU0 * (R0))),     \
+    .b_pol_per_ma = (float)(MU0 * 1e6 / (2.0 * M_PI * (a))),                    \
+    .beta_n_coefficient = (float)((a) * (Bt)),                                  \
+    .greenwald_coefficient = (float)(1.0 / (M_PI * (a) * (a))),                 \
+    .tau_geometry = (tau_E_geometry),                                           \
+}
+
+static inline float machine_tau_geometry(float major_radius, float minor_radius,
+                                         float toroidal_field) {
+    return (float)(0.0562 * pow(toroidal_field, 0.15) * pow(major_radius, 1.97) *
+                   pow(minor_radius, 0.58));
+}
+
+// machine_tau_geometry(TOKAMAK_MAJOR_RADIUS, TOKAMAK_MINOR_RADIUS,
+// TOKAMAK_TOROIDAL_FIELD), i.e. 0.0562 * 5.3^0.15 * 1.8^1.97 * 0.6^0.58
+// rounded to float (0x1.5de1eap-3); update it with those constants
+#define MACHINE_DEFAULT_TAU_GEOMETRY 0.170841053f
+
+static const MachineGeometry machine_default = MACHINE_GEOMETRY(
+    TOKAMAK_MAJOR_RADIUS, TOKAMAK_MINOR_RADIUS, TOKAMAK_TOROIDAL_FIELD,
+    TOKAMAK_PLASMA_CURRENT, NUM_PF_COILS, NUM_VERTICAL_COILS,
+    NUM_HORIZONTAL_COILS, NUM_HEATING_SYSTEMS, MACHINE_DEFAULT_TAU_GEOMETRY);
+
+// Returns 0 on success, -1 if the geometry is unphysical or a count
+// exceeds its NUM_* capacity.
+static inline int machine_geometry_init(MachineGeometry *machine,
+                                        float major_radius, float minor_radius,
+                                        float toroidal_field, float plasma_current,
+                                        int num_pf_coils, int num_vertical_coils,
+                                        int num_horizontal_coils,
+                                        int num_heating_systems) {
+    if (major_radius <= minor_radius || minor_radius <= 0.0f ||
+        toroidal_field <= 0.0f ||
+        num_pf_coils < 0 || num_pf_coils > NUM_PF_COILS ||
+        num_vertical_coils < 0 || num_vertical_coils > NUM_VERTICAL_COILS ||
+        num_horizontal_coils < 0 || num_horizontal_coils > NUM_HORIZONTAL_COILS ||
+        num_heating_systems < 0 || num_heating_systems > NUM_HEATING_SYSTEMS) {
+        return -1;
+    }
+    *machine = (MachineGeometry)MACHINE_GEOMETRY(
+        major_radius, minor_radius, toroidal_field, plasma_current,
+        num_pf_coils, num_vertical_coils, num_horizontal_coils,
+        num_heating_systems,
+        machine_tau_geometry(major_radius, minor_radius, toroidal_field));
+    return 0;
+}
+
+// Bodies written against a MachineGeometry are declared MACHINE_SPECIALIZE
+// so every caller gets its own inlined copy: the one called with
+// &machine_default is specialised to constants, like a template
+// instantiation, instead of sharing a single out-of-line body.
+#define MACHINE_SPECIALIZE static inline __attribute__((always_inline))
+
+// ================= GEOMETRY KERNELS =================
+// Shared by plasma_physics.c, plasma_batch.c and profile_cache.c so every
+// path rounds identically.
+
+MACHINE_SPECIALIZE float machine_plasma_volume(const MachineGeometry *machine,
+                                               float elongation) {
+    return machine->volume_per_elongation * elongation;
+}
+
+MACHINE_SPECIALIZE float machine_safety_factor(const MachineGeometry *machine,
+                                               float r_normalized,
+                                               float plasma_current) {
+    float I_p = plasma_current * 1e6f;
+    float q = machine->q_coefficient * r_normalized * r_normalized / I_p;
+    return q * (1.0f + 0.5f * r_normalized * r_normalized);
+}
+
+MACHINE_SPECIALIZE float machine_beta(const MachineGeometry *machine,
+                                      float plasma_current, float density_core,
+                                      float temperature_core) {
+    float pressure_avg = (density_core * 1e19f * temperature_core *
+                         1.602e-16f) / 3.0f;
+    float B_pol = machine->b_pol_per_ma * plasma_current;
+    float B_total2 = machine->toroidal_field * machine->toroidal_field +
+                     B_pol * B_pol;
+    return 2.0f * (float)MU0 * pressure_avg / B_total2;
+}
+
+MACHINE_SPECIALIZE float machine_beta_normalized(const MachineGeometry *machine,
+                                                 float plasma_current,
+                                                 float density_core,
+                                                 float temperature_core) {
+    float beta = machine_beta(machine, plasma_current, density_core,
+                              temperature_core) * 100.0f;
+    return beta * machine->beta_n_coefficient / plasma_current;
+}
+
+// IPB98-style energy confinement time (s), density_core in 1e19 m^-3
+MACHINE_SPECIALIZE float machine_confinement_time(const MachineGeometry *machine,
+                                                  float plasma_current,
+                                                  float density_core,
+                                                  float elongation,
+                                                  float heating_power) {
+    float n = density_core * 0.1f;
+    float tau_E = machine->tau_geometry * powf(plasma_current, 0.93f) *
+                 powf(n, 0.41f) * powf(elongation, 0.78f);
+    tau_E *= powf(heating_power, -0.69f);
+    return tau_E;
+}
+
+// ECRH absorption fraction for a source at `frequency` (Hz)
+MACHINE_SPECIALIZE float machine_ecrh_absorption(const MachineGeometry *machine,
+                                                 float frequency) {
+    float detuning = frequency - machine->f_ce;
+    if (fabsf(detuning) < 1e9f) {
+        return 0.8f;
+    }
+    return 0.3f * expf(-(detuning * detuning) / (2.0f * 1e18f));
+}
+
+#endif // MACHINE_GEOMETRY_H
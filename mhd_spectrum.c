@@ -0,0 +1,433 @@
+#include "mhd_spectrum.h"
+#include <stdlib.h>
+#include <string.h>
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#define MHD_CSD_SIZE (MHD_COHERENCE_PROBES * MHD_COHERENCE_PROBES)
+#define MHD_FFT_FLOATS ((size_t)MHD_FFT_SIZE * MHD_FFT_CHANNELS)
+
+int mhd_spectrum_init(MhdSpectrum *mhd, float sample_rate, uint32_t hop) {
+    memset(mhd, 0, sizeof(*mhd));
+    if (sample_rate <= 0.0f) return -1;
+    if (hop == 0) hop = MHD_FFT_SIZE / 4;
+    if (hop < MHD_ANALYSIS_STEPS || hop > MHD_FFT_SIZE) return -1;
+
+    size_t sizes[] = {
+        (size_t)MHD_FFT_SIZE * MHD_NUM_PROBES,  // ring
+        MHD_FFT_SIZE,                           // window
+        MHD_FFT_SIZE, MHD_FFT_SIZE,             // twiddles
+        MHD_FFT_FLOATS, MHD_FFT_FLOATS,         // fft_re
+        MHD_FFT_FLOATS, MHD_FFT_FLOATS,         // fft_im
+        MHD_SPECTRUM_BINS,
+        MHD_CSD_SIZE, MHD_CSD_SIZE, MHD_CSD_SIZE, MHD_CSD_SIZE
+    };
+    float **arrays[] = {
+        &mhd->ring, &mhd->window, &mhd->twiddle_re, &mhd->twiddle_im,
+        &mhd->fft_re[0], &mhd->fft_re[1], &mhd->fft_im[0], &mhd->fft_im[1],
+        &mhd->spectrum,
+        &mhd->csd_re, &mhd->csd_im, &mhd->window_csd_re, &mhd->window_csd_im
+    };
+    const int count = sizeof(sizes) / sizeof(sizes[0]);
+    const size_t lanes = MHD_SPECTRUM_ALIGN / sizeof(float);
+
+    size_t total = 0;
+    for (int i = 0; i < count; i++) total += (sizes[i] + lanes - 1) / lanes * lanes;
+    float *block = aligned_alloc(MHD_SPECTRUM_ALIGN, total * sizeof(float));
+    if (!block) return -1;
+    memset(block, 0, total * sizeof(float));
+
+    float *p = block;
+    for (int i = 0; i < count; i++) {
+        *arrays[i] = p;
+        p += (sizes[i] + lanes - 1) / lanes * lanes;
+    }
+    mhd->block = block;
+
+    mhd->sample_rate = sample_rate;
+    mhd->hop = hop;
+    float bin_hz = sample_rate / MHD_FFT_SIZE;
+    uint32_t band = (uint32_t)(MHD_BAND_MAX_HZ / bin_hz) + 1;
+    mhd->band_bins = band < 2 ? 2 : band > MHD_SPECTRUM_BINS ? MHD_SPECTRUM_BINS : band;
+    uint32_t ntm = (uint32_t)ceilf(MHD_NTM_MIN_HZ / bin_hz);
+    mhd->ntm_bin = ntm < 1 ? 1 : ntm;
+    uint32_t lock = (uint32_t)(MHD_LOCK_MAX_HZ / bin_hz);
+    mhd->lock_bin = lock < 1 ? 1 : lock;
+
+    float window_power = 0.0f;
+    for (int n = 0; n < MHD_FFT_SIZE; n++) {
+        float w = 0.5f - 0.5f * cosf(2.0f * M_PI * n / MHD_FFT_SIZE);
+        mhd->window[n] = w;
+        window_power += w * w;
+    }
+    // One-sided PSD normalisation
+    mhd->psd_scale = 2.0f / (sample_rate * window_power);
+
+    for (int t = 0; t < MHD_FFT_SIZE; t++) {
+        double angle = 2.0 * M_PI * t / MHD_FFT_SIZE;
+        mhd->twiddle_re[t] = (float)cos(angle);
+        mhd->twiddle_im[t] = (float)-sin(angle);
+    }
+
+    uint8_t probes[MHD_COHERENCE_PROBES];
+    for (int i = 0; i < MHD_COHERENCE_PROBES; i++) probes[i] = (uint8_t)i;
+    mhd_spectrum_select_probes(mhd, probes);
+    return 0;
+}
+
+void mhd_spectrum_free(MhdSpectrum *mhd) {
+    free(mhd->block);
+    memset(mhd, 0, sizeof(*mhd));
+}
+
+void mhd_spectrum_select_probes(MhdSpectrum *mhd,
+                                const uint8_t probes[MHD_COHERENCE_PROBES]) {
+    for (int i = 0; i < MHD_COHERENCE_PROBES; i++) {
+        uint8_t p = probes[i] % MHD_NUM_PROBES;
+        mhd->coherence_probe[i] = p;
+        // Unpacked bins hold even probes in [0, 32) and odd ones in [32, 64)
+        mhd->coherence_slot[i] = (uint8_t)((p & 1u) * MHD_FFT_CHANNELS + p / 2);
+    }
+    // Restart the averages so the new CSD is not mixed with the old one
+    mhd->windows = 0;
+    mhd->analysing = false;
+}
+
+// ================= FFT =================
+
+// FFT buffers are [MHD_FFT_BLOCKS][MHD_FFT_SIZE][MHD_FFT_LANES]
+static inline size_t mhd_fft_index(int channel, uint32_t n) {
+    return ((size_t)(channel / MHD_FFT_LANES) * MHD_FFT_SIZE + n) * MHD_FFT_LANES +
+           channel % MHD_FFT_LANES;
+}
+
+// One radix-4 Stockham pass: sub-transforms of length n, stride s
+static void mhd_fft_radix4(const MhdSpectrum *mhd, uint32_t n, uint32_t s,
+                           const float *xr, const float *xi, float *yr, float *yi) {
+    const uint32_t quarter = n / 4;
+    const uint32_t width = s * MHD_FFT_LANES;
+    for (uint32_t p = 0; p < quarter; p++) {
+        const float w1r = mhd->twiddle_re[p * s], w1i = mhd->twiddle_im[p * s];
+        const float w2r = mhd->twiddle_re[2 * p * s], w2i = mhd->twiddle_im[2 * p * s];
+        const float w3r = mhd->twiddle_re[3 * p * s], w3i = mhd->twiddle_im[3 * p * s];
+        const float *ar = xr + (size_t)p * width, *ai = xi + (size_t)p * width;
+        const float *br = ar + (size_t)quarter * width, *bi = ai + (size_t)quarter * width;
+        const float *cr = br + (size_t)quarter * width, *ci = bi + (size_t)quarter * width;
+        const float *dr = cr + (size_t)quarter * width, *di = ci + (size_t)quarter * width;
+        float *y0r = yr + (size_t)(4 * p) * width, *y0i = yi + (size_t)(4 * p) * width;
+        float *y1r = y0r + width, *y1i = y0i + width;
+        float *y2r = y1r + width, *y2i = y1i + width;
+        float *y3r = y2r + width, *y3i = y2i + width;
+
+#pragma GCC ivdep
+        for (uint32_t q = 0; q < width; q++) {
+            float apc_r = ar[q] + cr[q], apc_i = ai[q] + ci[q];
+            float amc_r = ar[q] - cr[q], amc_i = ai[q] - ci[q];
+            float bpd_r = br[q] + dr[q], bpd_i = bi[q] + di[q];
+            // j (b - d)
+            float jbmd_r = di[q] - bi[q], jbmd_i = br[q] - dr[q];
+
+            y0r[q] = apc_r + bpd_r;
+            y0i[q] = apc_i + bpd_i;
+
+            float t1r = amc_r - jbmd_r, t1i = amc_i - jbmd_i;
+            y1r[q] = t1r * w1r - t1i * w1i;
+            y1i[q] = t1r * w1i + t1i * w1r;
+
+            float t2r = apc_r - bpd_r, t2i = apc_i - bpd_i;
+            y2r[q] = t2r * w2r - t2i * w2i;
+            y2i[q] = t2r * w2i + t2i * w2r;
+
+            float t3r = amc_r + jbmd_r, t3i = amc_i + jbmd_i;
+            y3r[q] = t3r * w3r - t3i * w3i;
+            y3i[q] = t3r * w3i + t3i * w3r;
+        }
+    }
+}
+
+// Final radix-2 pass when log2(N) is odd (sub-transform length 2)
+static void mhd_fft_radix2(uint32_t s, const float *xr, const float *xi,
+                           float *yr, float *yi) {
+    const uint32_t width = s * MHD_FFT_LANES;
+#pragma GCC ivdep
+    for (uint32_t q = 0; q < width; q++) {
+        float ar = xr[q], ai = xi[q], br = xr[q + width], bi = xi[q + width];
+        yr[q] = ar + br;
+        yi[q] = ai + bi;
+        yr[q + width] = ar - br;
+        yi[q + width] = ai - bi;
+    }
+}
+
+// Ping-pong Stockham FFT (radix-4 passes, one radix-2 pass if needed) of
+// one block of MHD_FFT_LANES channels, whose working set stays cache
+// resident. Returns the buffer index holding the natural-order result,
+// the same for every block.
+static int mhd_fft_block(MhdSpectrum *mhd, uint32_t b) {
+    const size_t base = (size_t)b * MHD_FFT_SIZE * MHD_FFT_LANES;
+    int src = 0;
+    uint32_t n = MHD_FFT_SIZE, s = 1;
+    for (; n >= 4; n /= 4, s *= 4) {
+        mhd_fft_radix4(mhd, n, s,
+                       mhd->fft_re[src] + base, mhd->fft_im[src] + base,
+                       mhd->fft_re[src ^ 1] + base, mhd->fft_im[src ^ 1] + base);
+        src ^= 1;
+    }
+    if (n == 2) {
+        mhd_fft_radix2(s, mhd->fft_re[src] + base, mhd->fft_im[src] + base,
+                       mhd->fft_re[src ^ 1] + base, mhd->fft_im[src ^ 1] + base);
+        src ^= 1;
+    }
+    return src;
+}
+
+// ================= WINDOW ANALYSIS =================
+// A window is analysed in MHD_ANALYSIS_STEPS steps, one per pushed frame:
+//   step 0                      window the ring into the FFT input
+//   steps 0..MHD_FFT_BLOCKS-1   FFT of one channel block each
+//   the MHD_CSD_SLICES after    spectrum and CSD of a slice of the bins
+//   the last step               CSD average, coherence and mode estimate
+
+_Static_assert(MHD_SPECTRUM_BINS % MHD_CSD_SLICES == 0, "CSD slices split the bins");
+
+// Flush-to-zero and denormals-are-zero for one analysis step. A probe
+// signal decaying towards zero leaves subnormal products in every FFT pass
+// and CSD update, each one a microcode assist that slows the window ~10x.
+static inline uint64_t mhd_fp_flush_begin(void) {
+#if defined(__SSE__)
+    uint32_t csr = _mm_getcsr();
+    _mm_setcsr(csr | 0x8040u);                  // FTZ | DAZ
+    return csr;
+#elif defined(__aarch64__)
+    uint64_t fpcr;
+    __asm__ volatile("mrs %0, fpcr" : "=r"(fpcr));
+    __asm__ volatile("msr fpcr, %0" : : "r"(fpcr | (1u << 24)));   // FZ
+    return fpcr;
+#else
+    return 0;
+#endif
+}
+
+static inline void mhd_fp_flush_end(uint64_t saved) {
+#if defined(__SSE__)
+    _mm_setcsr((uint32_t)saved);
+#elif defined(__aarch64__)
+    __asm__ volatile("msr fpcr, %0" : : "r"(saved));
+#else
+    (void)saved;
+#endif
+}
+
+static void mhd_window_frames(MhdSpectrum *mhd) {
+    // Window the newest MHD_FFT_SIZE frames (oldest is at head) into
+    // packed channels: probe 2c -> real part, probe 2c+1 -> imaginary part
+    float *zr = mhd->fft_re[0], *zi = mhd->fft_im[0];
+    for (uint32_t n = 0; n < MHD_FFT_SIZE; n++) {
+        const float *frame = mhd->ring +
+            (size_t)((mhd->head + n) % MHD_FFT_SIZE) * MHD_NUM_PROBES;
+        const float w = mhd->window[n];
+        for (int b = 0; b < MHD_FFT_BLOCKS; b++) {
+            const float *in = frame + 2 * b * MHD_FFT_LANES;
+            float *out_r = zr + mhd_fft_index(b * MHD_FFT_LANES, n);
+            float *out_i = zi + mhd_fft_index(b * MHD_FFT_LANES, n);
+            for (int l = 0; l < MHD_FFT_LANES; l++) {
+                out_r[l] = in[2 * l] * w;
+                out_i[l] = in[2 * l + 1] * w;
+            }
+        }
+    }
+    memset(mhd->window_csd_re, 0, MHD_CSD_SIZE * sizeof(float));
+    memset(mhd->window_csd_im, 0, MHD_CSD_SIZE * sizeof(float));
+}
+
+// Spectrum and window CSD of bins [k0, k1)
+static void mhd_accumulate_bins(MhdSpectrum *mhd, uint32_t k0, uint32_t k1) {
+    const int C = MHD_FFT_CHANNELS;
+    const float *zr = mhd->fft_re[mhd->fft_out], *zi = mhd->fft_im[mhd->fft_out];
+    float *Sr = mhd->window_csd_re, *Si = mhd->window_csd_im;
+    const float alpha = mhd->windows == 0 ? 1.0f : MHD_SPECTRUM_AVERAGING;
+    const float scale = mhd->psd_scale / MHD_NUM_PROBES;
+
+    for (uint32_t k = k0; k < k1; k++) {
+        // Split the packed channel: X = (Z[k] + conj Z[N-k]) / 2 is the even
+        // probe, Y = (Z[k] - conj Z[N-k]) / 2i the odd one
+        const uint32_t m = (MHD_FFT_SIZE - k) % MHD_FFT_SIZE;
+        float xr[MHD_NUM_PROBES], xi[MHD_NUM_PROBES];
+        float power = 0.0f;
+        for (int b = 0; b < MHD_FFT_BLOCKS; b++) {
+            const int c0 = b * MHD_FFT_LANES;
+            const float *ar = zr + mhd_fft_index(c0, k), *ai = zi + mhd_fft_index(c0, k);
+            const float *br = zr + mhd_fft_index(c0, m), *bi = zi + mhd_fft_index(c0, m);
+            for (int l = 0; l < MHD_FFT_LANES; l++) {
+                xr[c0 + l] = 0.5f * (ar[l] + br[l]);
+                xi[c0 + l] = 0.5f * (ai[l] - bi[l]);
+                xr[C + c0 + l] = 0.5f * (ai[l] + bi[l]);
+                xi[C + c0 + l] = -0.5f * (ar[l] - br[l]);
+            }
+        }
+        for (int c = 0; c < MHD_NUM_PROBES; c++) {
+            power += xr[c] * xr[c] + xi[c] * xi[c];
+        }
+        mhd->spectrum[k] += alpha * (power * scale - mhd->spectrum[k]);
+
+        if (k == 0 || k >= mhd->band_bins) continue;
+
+        // Rank-1 cross-spectral update, S_ij += X_i conj(X_j)
+        float vr[MHD_COHERENCE_PROBES], vi[MHD_COHERENCE_PROBES];
+        for (int i = 0; i < MHD_COHERENCE_PROBES; i++) {
+            vr[i] = xr[mhd->coherence_slot[i]];
+            vi[i] = xi[mhd->coherence_slot[i]];
+        }
+        for (int i = 0; i < MHD_COHERENCE_PROBES; i++) {
+            float *row_r = Sr + i * MHD_COHERENCE_PROBES;
+            float *row_i = Si + i * MHD_COHERENCE_PROBES;
+            for (int j = 0; j < MHD_COHERENCE_PROBES; j++) {
+                row_r[j] += vr[i] * vr[j] + vi[i] * vi[j];
+                row_i[j] += vi[i] * vr[j] - vr[i] * vi[j];
+            }
+        }
+    }
+}
+
+static void mhd_finish_window(MhdSpectrum *mhd) {
+    const float *Sr = mhd->window_csd_re, *Si = mhd->window_csd_im;
+    const float alpha = mhd->windows == 0 ? 1.0f : MHD_SPECTRUM_AVERAGING;
+    for (int i = 0; i < MHD_CSD_SIZE; i++) {
+        mhd->csd_re[i] += alpha * (Sr[i] - mhd->csd_re[i]);
+        mhd->csd_im[i] += alpha * (Si[i] - mhd->csd_im[i]);
+    }
+
+    float coherence_sum = 0.0f;
+    for (int i = 0; i < MHD_COHERENCE_PROBES; i++) {
+        for (int j = 0; j < MHD_COHERENCE_PROBES; j++) {
+            float re = mhd->csd_re[i * MHD_COHERENCE_PROBES + j];
+            float im = mhd->csd_im[i * MHD_COHERENCE_PROBES + j];
+            float auto_ii = mhd->csd_re[i * MHD_COHERENCE_PROBES + i];
+            float auto_jj = mhd->csd_re[j * MHD_COHERENCE_PROBES + j];
+            float denom = auto_ii * auto_jj;
+            float coh = denom > 0.0f ? (re * re + im * im) / denom : 0.0f;
+            mhd->coherence[i][j] = coh;
+            if (i != j) coherence_sum += coh;
+        }
+    }
+
+    // Dominant mode in the band
+    uint32_t peak = 1;
+    float band_sum = 0.0f;
+    for (uint32_t k = 1; k < mhd->band_bins; k++) {
+        band_sum += mhd->spectrum[k];
+        peak = mhd->spectrum[k] > mhd->spectrum[peak] ? k : peak;
+    }
+    MhdModeEstimate *mode = &mhd->mode;
+    mode->peak_frequency = peak * mhd->sample_rate / MHD_FFT_SIZE;
+    mode->peak_power = mhd->spectrum[peak];
+    mode->band_power = band_sum / (mhd->band_bins - 1);
+    mode->mean_coherence = coherence_sum /
+        (MHD_COHERENCE_PROBES * (MHD_COHERENCE_PROBES - 1));
+
+    bool coherent_mode = mode->peak_power > MHD_PEAK_RATIO * mode->band_power &&
+                         mode->mean_coherence > MHD_COHERENCE_MIN;
+    mode->ntm_detected = coherent_mode && peak >= mhd->ntm_bin;
+    mode->locked_mode_detected = coherent_mode && peak <= mhd->lock_bin;
+
+    mhd->windows++;
+}
+
+// One analysis step of the current window; returns 1 on the last one
+static int mhd_analysis_step(MhdSpectrum *mhd) {
+    uint32_t step = mhd->step++;
+    if (step < MHD_FFT_BLOCKS) {
+        if (step == 0) mhd_window_frames(mhd);
+        mhd->fft_out = mhd_fft_block(mhd, step);
+        return 0;
+    }
+    const uint32_t bins = MHD_SPECTRUM_BINS / MHD_CSD_SLICES;
+    uint32_t slice = step - MHD_FFT_BLOCKS;
+    mhd_accumulate_bins(mhd, slice * bins, (slice + 1) * bins);
+    if (slice + 1 < MHD_CSD_SLICES) return 0;
+    mhd_finish_window(mhd);
+    mhd->analysing = false;
+    return 1;
+}
+
+// ================= STREAMING INTERFACE =================
+
+int mhd_spectrum_push(MhdSpectrum *mhd, const float *frames, uint32_t n_frames) {
+    // Only the newest MHD_FFT_SIZE frames can reach the next window
+    uint32_t skip = n_frames > MHD_FFT_SIZE ? n_frames - MHD_FFT_SIZE : 0;
+    for (uint32_t f = skip; f < n_frames; f++) {
+        memcpy(mhd->ring + (size_t)mhd->head * MHD_NUM_PROBES,
+               frames + (size_t)f * MHD_NUM_PROBES, MHD_NUM_PROBES * sizeof(float));
+        mhd->head = (mhd->head + 1) % MHD_FFT_SIZE;
+    }
+    // The push that fills the ring completes the first window; frames past
+    // that count towards the next one. Skips are only counted once full.
+    uint32_t was_filled = mhd->filled;
+    if (was_filled + n_frames < MHD_FFT_SIZE) {
+        mhd->filled = was_filled + n_frames;
+        return 0;
+    }
+    mhd->filled = MHD_FFT_SIZE;
+    if (was_filled < MHD_FFT_SIZE) {
+        mhd->pending = mhd->hop + (was_filled + n_frames - MHD_FFT_SIZE);
+    } else {
+        mhd->pending += n_frames;
+    }
+
+    // Each pushed frame pays for one analysis step
+    uint32_t budget = n_frames;
+    int completed = 0;
+    uint64_t fp = mhd_fp_flush_begin();
+    for (; mhd->analysing && budget; budget--) completed |= mhd_analysis_step(mhd);
+    if (mhd->pending >= mhd->hop) {
+        mhd->windows_skipped += mhd->pending / mhd->hop - 1;
+        mhd->pending %= mhd->hop;
+        // Only a bulk push can start a window before the last one is done
+        while (mhd->analysing) completed |= mhd_analysis_step(mhd);
+        mhd->analysing = true;
+        mhd->step = 0;
+        if (!budget) budget = 1;
+        for (; mhd->analysing && budget; budget--) completed |= mhd_analysis_step(mhd);
+    }
+    mhd_fp_flush_end(fp);
+    return completed;
+}
+
+void mhd_spectrum_publish(const MhdSpectrum *mhd, DiagnosticsSystem *diag) {
+    memcpy(diag->mhd_spectrum, mhd->spectrum, sizeof(diag->mhd_spectrum));
+    memcpy(diag->coherence_analysis, mhd->coherence, sizeof(diag->coherence_analysis));
+}
+
+int mhd_spectrum_push_diagnostics(MhdSpectrum *mhd, DiagnosticsSystem *diag) {
+    int analysed = mhd_spectrum_push(mhd, diag->magnetics_probes, 1);
+    if (analysed) {
+        mhd_spectrum_publish(mhd, diag);
+    }
+    return analysed;
+}
+
+void mhd_spectrum_update_flags(const MhdSpectrum *mhd,
+                               SafetyMitigationSystem *safety) {
+    safety->disruption_flags.locked_mode_detected = mhd->mode.locked_mode_detected;
+    safety->disruption_flags.ntm_detected = mhd->mode.ntm_detected;
+}
+
+// ================= SYNTHETIC PROBES =================
+
+void mhd_probe_signals(const PlasmaState *state, double time,
+                       float probes[MHD_NUM_PROBES]) {
+    // Reduced to one turn in double: f * t outgrows float within seconds
+    double turns = MHD_PROBE_ROTATION_HZ * time;
+    float phase = (float)(2.0 * M_PI * (turns - floor(turns)));
+    // cos(n phi_i - phase), stepping exp(i (n phi_i - phase)) probe to probe
+    float step = 2.0f * (float)M_PI * MHD_PROBE_MODE_N / MHD_NUM_PROBES;
+    float step_re = cosf(step), step_im = sinf(step);
+    float re = cosf(phase), im = -sinf(phase);
+    for (int i = 0; i < MHD_NUM_PROBES; i++) {
+        probes[i] = state->ntm_amplitude * re;
+        float next_re = re * step_re - im * step_im;
+        im = re * step_im + im * step_re;
+        re = next_re;
+    }
+}
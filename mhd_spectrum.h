@@ -0,0 +1,139 @@
+#ifndef MHD_SPECTRUM_H
+#define MHD_SPECTRUM_H
+
+#include "npe_config.h"
+
+// ================= MHD SPECTRUM & COHERENCE =================
+// Streaming spectral analysis of the 64 magnetics_probes. Samples are
+// pushed as they arrive; every `hop` samples the newest MHD_FFT_SIZE-long
+// Hann window is transformed and folded into exponentially averaged
+// estimates of
+//   - the probe-averaged power spectrum (DiagnosticsSystem.mhd_spectrum),
+//   - the band-integrated cross-spectral density of 32 selected probes,
+//     from which coherence_analysis[32][32] = |S_ij|^2 / (S_ii S_jj).
+//
+// The 64 real probe signals are packed two per complex channel, and the 32
+// channels are transformed MHD_FFT_LANES at a time by a radix-4 Stockham
+// FFT with the channel index innermost, so every butterfly is a contiguous
+// vector operation sharing one precomputed twiddle and each block's
+// working set stays in cache. The CSD is a rank-1 update per bin.
+//
+// Cost is bounded per push: a window is analysed in MHD_ANALYSIS_STEPS
+// steps, one per pushed frame, so a control loop pushing one frame a cycle
+// pays about 1/MHD_ANALYSIS_STEPS of a window each cycle and sees the
+// result that many frames after the window closes. A bulk push runs as
+// many steps as it carries frames. If the caller falls behind by more than
+// one hop, only the newest window is analysed and the missed windows are
+// counted in windows_skipped. Nothing allocates after mhd_spectrum_init().
+//
+// Build with -O3 -fno-math-errno so the inner loops vectorize.
+
+#define MHD_FFT_SIZE 2048
+#define MHD_SPECTRUM_BINS 1024                // = MHD_FFT_SIZE / 2, Nyquist dropped
+#define MHD_NUM_PROBES 64
+#define MHD_FFT_CHANNELS (MHD_NUM_PROBES / 2) // two real probes per complex channel
+#define MHD_FFT_LANES 8                       // channels transformed side by side
+#define MHD_FFT_BLOCKS (MHD_FFT_CHANNELS / MHD_FFT_LANES)
+#define MHD_COHERENCE_PROBES 32
+#define MHD_SPECTRUM_ALIGN 64
+#define MHD_CSD_SLICES 64                     // bin slices of the spectrum and CSD
+#define MHD_ANALYSIS_STEPS (MHD_FFT_BLOCKS + MHD_CSD_SLICES)
+
+#define MHD_SPECTRUM_AVERAGING 0.25f          // weight of the newest window
+#define MHD_BAND_MAX_HZ 50e3f                 // upper edge of the analysed mode band
+#define MHD_NTM_MIN_HZ 1e3f                   // rotating tearing modes sit above this
+#define MHD_LOCK_MAX_HZ 200.0f                // a mode below this is treated as locked
+#define MHD_PEAK_RATIO 10.0f                  // peak / band-mean power for a coherent mode
+#define MHD_COHERENCE_MIN 0.5f                // mean off-diagonal coherence for a mode
+
+#define MHD_PROBE_MODE_N 2                    // toroidal mode number of the synthetic NTM
+#define MHD_PROBE_ROTATION_HZ 3.3e3f          // its rotation frequency
+
+typedef struct {
+    float peak_frequency;       // Hz
+    float peak_power;
+    float band_power;           // mean power over the mode band
+    float mean_coherence;       // mean off-diagonal coherence
+    bool ntm_detected;
+    bool locked_mode_detected;
+} MhdModeEstimate;
+
+typedef struct {
+    float sample_rate;          // Hz
+    uint32_t hop;               // samples between windows (MHD_FFT_SIZE / 4 = 75% overlap)
+    uint32_t band_bins;         // bins 1..band_bins-1 form the mode band
+    uint32_t ntm_bin;
+    uint32_t lock_bin;
+
+    // Probes used for coherence_analysis, as indices into magnetics_probes.
+    // Defaults to 0..31; call mhd_spectrum_select_probes() to change.
+    uint8_t coherence_probe[MHD_COHERENCE_PROBES];
+    uint8_t coherence_slot[MHD_COHERENCE_PROBES];
+
+    // Sample ring, MHD_FFT_SIZE frames of MHD_NUM_PROBES
+    float *ring;
+    uint32_t head;
+    uint32_t filled;
+    uint32_t pending;
+
+    // Analysis of the newest window, one step per pushed frame
+    bool analysing;
+    uint32_t step;
+    int fft_out;                // fft_re/fft_im index of the transform
+
+    // Precomputed tables
+    float *window;
+    float *twiddle_re;          // exp(-2 pi i t / N), t < N
+    float *twiddle_im;
+    float psd_scale;
+
+    // FFT ping-pong buffers, [MHD_FFT_BLOCKS][MHD_FFT_SIZE][MHD_FFT_LANES]
+    float *fft_re[2];
+    float *fft_im[2];
+
+    // Averaged outputs
+    float *spectrum;            // [MHD_SPECTRUM_BINS]
+    float *csd_re;              // [MHD_COHERENCE_PROBES][MHD_COHERENCE_PROBES]
+    float *csd_im;
+    float *window_csd_re;
+    float *window_csd_im;
+    float coherence[MHD_COHERENCE_PROBES][MHD_COHERENCE_PROBES];
+    MhdModeEstimate mode;
+
+    uint64_t windows;
+    uint64_t windows_skipped;
+    void *block;
+} MhdSpectrum;
+
+// hop = 0 selects MHD_FFT_SIZE / 4; otherwise MHD_ANALYSIS_STEPS <= hop <=
+// MHD_FFT_SIZE. Returns 0 on success, -1 on failure.
+int mhd_spectrum_init(MhdSpectrum *mhd, float sample_rate, uint32_t hop);
+void mhd_spectrum_free(MhdSpectrum *mhd);
+void mhd_spectrum_select_probes(MhdSpectrum *mhd,
+                                const uint8_t probes[MHD_COHERENCE_PROBES]);
+
+// Pushes n_frames samples, each MHD_NUM_PROBES floats in magnetics_probes
+// order. Returns 1 if the analysis of a window completed, 0 otherwise.
+int mhd_spectrum_push(MhdSpectrum *mhd, const float *frames, uint32_t n_frames);
+
+// Pushes diag->magnetics_probes as one sample and, when the analysis of a
+// window completes, writes mhd_spectrum and coherence_analysis into diag.
+int mhd_spectrum_push_diagnostics(MhdSpectrum *mhd, DiagnosticsSystem *diag);
+
+void mhd_spectrum_publish(const MhdSpectrum *mhd, DiagnosticsSystem *diag);
+
+// Copies the mode detections into safety->disruption_flags.
+void mhd_spectrum_update_flags(const MhdSpectrum *mhd,
+                               SafetyMitigationSystem *safety);
+
+// Synthetic magnetics_probes for drivers without a probe array: an
+// n = MHD_PROBE_MODE_N mode of amplitude ntm_amplitude, rotating at
+// MHD_PROBE_ROTATION_HZ past probes evenly spaced in toroidal angle.
+// Sampled at the control rate, the mode aliases below
+// 2 * MHD_PROBE_ROTATION_HZ. The n = 0 vertical displacement is left out:
+// it is coherent on every probe, and a slow drift would read as a locked
+// mode.
+void mhd_probe_signals(const PlasmaState *state, double time,
+                       float probes[MHD_NUM_PROBES]);
+
+#endif // MHD_SPECTRUM_H
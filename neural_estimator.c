@@ -0,0 +1,298 @@
+#include "neural_estimator.h"
+#include "plasma_rng.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#define H NEURAL_HIDDEN
+#define S NEURAL_STATES
+#define I NEURAL_INPUTS
+#define TANH_LAST (NEURAL_TANH_ENTRIES - 1)
+
+// Right shifts that bring each product back to the accumulator format
+#define SHIFT_INPUT (NEURAL_Q_INPUT + NEURAL_Q_WEIGHT - NEURAL_Q_ACCUM)
+#define SHIFT_HIDDEN (NEURAL_Q_HIDDEN + NEURAL_Q_WEIGHT - NEURAL_Q_ACCUM)
+#define SHIFT_TANH (NEURAL_Q_ACCUM - NEURAL_TANH_STEP_BITS)
+
+// ================= KERNELS =================
+// acc[0..H) += col[0..H) * s. Unaligned loads, like the Q15 kernel: rows
+// of W_in and U_t start on a vector boundary only when H is a multiple of
+// the vector width.
+static inline void axpy_f32(float *restrict acc, const float *restrict col, float s) {
+    int i = 0;
+#if defined(__AVX512F__)
+    const __m512 vs = _mm512_set1_ps(s);
+    for (; i + 16 <= H; i += 16) {
+        __m512 a = _mm512_loadu_ps(acc + i);
+        _mm512_storeu_ps(acc + i, _mm512_add_ps(a, _mm512_mul_ps(_mm512_loadu_ps(col + i), vs)));
+    }
+#elif defined(__AVX2__)
+    const __m256 vs = _mm256_set1_ps(s);
+    for (; i + 8 <= H; i += 8) {
+        __m256 a = _mm256_loadu_ps(acc + i);
+        _mm256_storeu_ps(acc + i, _mm256_add_ps(a, _mm256_mul_ps(_mm256_loadu_ps(col + i), vs)));
+    }
+#elif defined(__ARM_NEON)
+    const float32x4_t vs = vdupq_n_f32(s);
+    for (; i + 4 <= H; i += 4) {
+        float32x4_t a = vld1q_f32(acc + i);
+        vst1q_f32(acc + i, vaddq_f32(a, vmulq_f32(vld1q_f32(col + i), vs)));
+    }
+#endif
+    for (; i < H; i++) acc[i] += col[i] * s;
+}
+
+// acc[0..H) += (col[0..H) * s) >> shift, products exact in int32
+static inline void axpy_q16(int32_t *restrict acc, const int16_t *restrict col,
+                            int16_t s, int shift) {
+    int i = 0;
+#if defined(__AVX512F__)
+    const __m512i vs = _mm512_set1_epi32(s);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    for (; i + 16 <= H; i += 16) {
+        __m512i w = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i *)(col + i)));
+        __m512i p = _mm512_sra_epi32(_mm512_mullo_epi32(w, vs), count);
+        __m512i a = _mm512_loadu_si512(acc + i);
+        _mm512_storeu_si512(acc + i, _mm512_add_epi32(a, p));
+    }
+#elif defined(__AVX2__)
+    const __m256i vs = _mm256_set1_epi32(s);
+    const __m128i count = _mm_cvtsi32_si128(shift);
+    for (; i + 8 <= H; i += 8) {
+        __m256i w = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *)(col + i)));
+        __m256i p = _mm256_sra_epi32(_mm256_mullo_epi32(w, vs), count);
+        __m256i a = _mm256_loadu_si256((const __m256i *)(acc + i));
+        _mm256_storeu_si256((__m256i *)(acc + i), _mm256_add_epi32(a, p));
+    }
+#elif defined(__ARM_NEON)
+    const int32x4_t right = vdupq_n_s32(-shift);
+    for (; i + 4 <= H; i += 4) {
+        int32x4_t p = vshlq_s32(vmull_n_s16(vld1_s16(col + i), s), right);
+        vst1q_s32(acc + i, vaddq_s32(vld1q_s32(acc + i), p));
+    }
+#endif
+    for (; i < H; i++) acc[i] += ((int32_t)col[i] * s) >> shift;
+}
+
+// ================= TANH TABLES =================
+static void build_tanh_table(float *table) {
+    for (int i = 0; i < NEURAL_TANH_ENTRIES; i++) {
+        table[i] = tanhf((float)i / (1 << NEURAL_TANH_STEP_BITS) - NEURAL_TANH_RANGE);
+    }
+}
+
+static inline float tanh_lookup(const float *table, float v) {
+    float p = (v + NEURAL_TANH_RANGE) * (1 << NEURAL_TANH_STEP_BITS);
+    if (!(p > 0.0f)) return table[0];
+    if (p >= TANH_LAST) return table[TANH_LAST];
+    int k = (int)p;
+    float frac = p - (float)k;
+    return table[k] + frac * (table[k + 1] - table[k]);
+}
+
+static inline int16_t tanh_lookup_q16(const int16_t *table, int32_t v) {
+    int32_t p = v + (NEURAL_TANH_RANGE << NEURAL_Q_ACCUM);
+    if (p <= 0) return table[0];
+    int32_t k = p >> SHIFT_TANH;
+    if (k >= TANH_LAST) return table[TANH_LAST];
+    int32_t frac = p & ((1 << SHIFT_TANH) - 1);
+    return (int16_t)(table[k] + (((table[k + 1] - table[k]) * frac) >> SHIFT_TANH));
+}
+
+float neural_estimator_tanh(const NeuralEstimator *est, float v) {
+    return tanh_lookup(est->tanh_table, v);
+}
+
+// ================= FLOAT32 =================
+void neural_estimator_init(NeuralEstimator *est, float learning_rate, uint64_t seed) {
+    memset(est, 0, sizeof(*est));
+    PlasmaRng rng;
+    plasma_rng_seed(&rng, seed, 0);
+    float *weights[] = { &est->W_in[0][0], &est->U_t[0][0], &est->W_dense[0][0] };
+    const int counts[] = { I * H, H * H, H * S };
+    for (int w = 0; w < 3; w++) {
+        for (int k = 0; k < counts[w]; k++) {
+            // Box-Muller
+            float u1 = 1.0f - plasma_rng_uniform(&rng);
+            float u2 = plasma_rng_uniform(&rng);
+            weights[w][k] = NEURAL_INIT_SCALE * sqrtf(-2.0f * logf(u1)) *
+                            cosf(2.0f * (float)M_PI * u2);
+        }
+    }
+    est->learning_rate = learning_rate;
+    build_tanh_table(est->tanh_table);
+}
+
+void neural_estimator_reset_state(NeuralEstimator *est) {
+    memset(est->h, 0, sizeof(est->h));
+}
+
+void neural_estimator_forward(const NeuralEstimator *est, const float *x, const float *u,
+                              float *delta_f, float *h_new) {
+    _Alignas(NEURAL_ALIGN) float pre[H];
+    memcpy(pre, est->b_rnn, sizeof(pre));
+    for (int k = 0; k < NEURAL_STATES; k++) axpy_f32(pre, est->W_in[k], x[k]);
+    for (int k = 0; k < NEURAL_CONTROLS; k++) {
+        axpy_f32(pre, est->W_in[NEURAL_STATES + k], u[k]);
+    }
+    for (int j = 0; j < H; j++) axpy_f32(pre, est->U_t[j], est->h[j]);
+    for (int j = 0; j < H; j++) pre[j] = tanh_lookup(est->tanh_table, pre[j]);
+
+    for (int s = 0; s < S; s++) delta_f[s] = est->b_dense[s];
+    for (int j = 0; j < H; j++) {
+        for (int s = 0; s < S; s++) delta_f[s] += est->W_dense[j][s] * pre[j];
+    }
+    if (h_new) memcpy(h_new, pre, sizeof(pre));
+}
+
+float neural_estimator_step(NeuralEstimator *est, const float *x, const float *u,
+                            const float *x_next_real, float dt, float *x_next_pred) {
+    float delta_f[S], error[S];
+    neural_estimator_forward(est, x, u, delta_f, est->h);
+    float loss = 0.0f;
+    for (int s = 0; s < S; s++) {
+        x_next_pred[s] = x[s] + delta_f[s] * dt;
+        error[s] = x_next_pred[s] - x_next_real[s];
+        loss += error[s] * error[s];
+    }
+    // backward(): dL/d(delta_f) = -error on the dense layer only
+    const float lr = est->learning_rate;
+    for (int j = 0; j < H; j++) {
+        for (int s = 0; s < S; s++) est->W_dense[j][s] += lr * est->h[j] * error[s];
+    }
+    for (int s = 0; s < S; s++) est->b_dense[s] += lr * error[s];
+    return sqrtf(loss);
+}
+
+// ================= INT16 FIXED POINT =================
+static int16_t quantize_q16(float v, int bits, uint32_t *saturated) {
+    float r = rintf(v * (float)(1 << bits));
+    if (!(r >= -32768.0f && r <= 32767.0f)) {
+        (*saturated)++;
+        return r > 0.0f ? 32767 : r < 0.0f ? -32768 : 0;
+    }
+    return (int16_t)r;
+}
+
+static int32_t quantize_q32(float v, int bits, uint32_t *saturated) {
+    double r = rint((double)v * (double)(1 << bits));
+    if (!(r >= -2147483648.0 && r <= 2147483647.0)) {
+        (*saturated)++;
+        return r > 0.0 ? INT32_MAX : r < 0.0 ? INT32_MIN : 0;
+    }
+    return (int32_t)r;
+}
+
+// Inputs saturate silently to the Q7.8 range
+static inline int16_t input_q16(float v) {
+    float r = rintf(v * (float)(1 << NEURAL_Q_INPUT));
+    r = r > 32767.0f ? 32767.0f : r;
+    r = r < -32768.0f ? -32768.0f : r;
+    return r == r ? (int16_t)r : 0;
+}
+
+void neural_estimator_quantize(const NeuralEstimator *est, NeuralEstimatorQ16 *q) {
+    uint32_t sat = 0;
+    for (int k = 0; k < I; k++) {
+        for (int j = 0; j < H; j++) q->W_in[k][j] = quantize_q16(est->W_in[k][j], NEURAL_Q_WEIGHT, &sat);
+    }
+    for (int k = 0; k < H; k++) {
+        for (int j = 0; j < H; j++) q->U_t[k][j] = quantize_q16(est->U_t[k][j], NEURAL_Q_WEIGHT, &sat);
+        for (int s = 0; s < S; s++) {
+            q->W_dense[k][s] = quantize_q16(est->W_dense[k][s], NEURAL_Q_WEIGHT, &sat);
+        }
+        q->b_rnn[k] = quantize_q32(est->b_rnn[k], NEURAL_Q_ACCUM, &sat);
+        q->h[k] = quantize_q16(est->h[k], NEURAL_Q_HIDDEN, &sat);
+    }
+    for (int s = 0; s < S; s++) q->b_dense[s] = quantize_q32(est->b_dense[s], NEURAL_Q_ACCUM, &sat);
+    q->saturated = sat;
+    for (int i = 0; i < NEURAL_TANH_ENTRIES; i++) {
+        q->tanh_table[i] = (int16_t)rintf(est->tanh_table[i] * (float)(1 << NEURAL_Q_HIDDEN));
+    }
+}
+
+void neural_q16_forward(const NeuralEstimatorQ16 *q, const float *x, const float *u,
+                        float *delta_f, int16_t *h_new) {
+    _Alignas(NEURAL_ALIGN) int32_t pre[H];
+    _Alignas(NEURAL_ALIGN) int16_t hn[H];
+    memcpy(pre, q->b_rnn, sizeof(pre));
+    for (int k = 0; k < NEURAL_STATES; k++) axpy_q16(pre, q->W_in[k], input_q16(x[k]), SHIFT_INPUT);
+    for (int k = 0; k < NEURAL_CONTROLS; k++) {
+        axpy_q16(pre, q->W_in[NEURAL_STATES + k], input_q16(u[k]), SHIFT_INPUT);
+    }
+    for (int j = 0; j < H; j++) axpy_q16(pre, q->U_t[j], q->h[j], SHIFT_HIDDEN);
+    for (int j = 0; j < H; j++) hn[j] = tanh_lookup_q16(q->tanh_table, pre[j]);
+
+    int32_t acc[S];
+    for (int s = 0; s < S; s++) acc[s] = q->b_dense[s];
+    for (int j = 0; j < H; j++) {
+        for (int s = 0; s < S; s++) acc[s] += ((int32_t)q->W_dense[j][s] * hn[j]) >> SHIFT_HIDDEN;
+    }
+    for (int s = 0; s < S; s++) delta_f[s] = (float)acc[s] * (1.0f / (1 << NEURAL_Q_ACCUM));
+    if (h_new) memcpy(h_new, hn, sizeof(hn));
+}
+
+void neural_q16_step(NeuralEstimatorQ16 *q, const float *x, const float *u, float dt,
+                     float *x_next_pred) {
+    float delta_f[S];
+    neural_q16_forward(q, x, u, delta_f, q->h);
+    for (int s = 0; s < S; s++) x_next_pred[s] = x[s] + delta_f[s] * dt;
+}
+
+// ================= WEIGHT BLOB =================
+int neural_estimator_save(const NeuralEstimator *est, const char *path) {
+    NeuralWeightsHeader header = {
+        .magic = NEURAL_WEIGHTS_MAGIC, .version = NEURAL_WEIGHTS_VERSION,
+        .states = S, .controls = NEURAL_CONTROLS, .hidden = H,
+        .learning_rate = est->learning_rate,
+    };
+    float U_rnn[H][H];
+    for (int i = 0; i < H; i++) {
+        for (int j = 0; j < H; j++) U_rnn[i][j] = est->U_t[j][i];
+    }
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+              fwrite(est->W_in, sizeof(est->W_in), 1, f) == 1 &&
+              fwrite(U_rnn, sizeof(U_rnn), 1, f) == 1 &&
+              fwrite(est->b_rnn, sizeof(est->b_rnn), 1, f) == 1 &&
+              fwrite(est->W_dense, sizeof(est->W_dense), 1, f) == 1 &&
+              fwrite(est->b_dense, sizeof(est->b_dense), 1, f) == 1 &&
+              fwrite(est->h, sizeof(est->h), 1, f) == 1;
+    if (fclose(f) != 0 || !ok) return -1;
+    return 0;
+}
+
+int neural_estimator_load(NeuralEstimator *est, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    NeuralWeightsHeader header;
+    float U_rnn[H][H];
+    NeuralEstimator loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+              header.magic == NEURAL_WEIGHTS_MAGIC &&
+              header.version == NEURAL_WEIGHTS_VERSION &&
+              header.states == S && header.controls == NEURAL_CONTROLS &&
+              header.hidden == H &&
+              fread(loaded.W_in, sizeof(loaded.W_in), 1, f) == 1 &&
+              fread(U_rnn, sizeof(U_rnn), 1, f) == 1 &&
+              fread(loaded.b_rnn, sizeof(loaded.b_rnn), 1, f) == 1 &&
+              fread(loaded.W_dense, sizeof(loaded.W_dense), 1, f) == 1 &&
+              fread(loaded.b_dense, sizeof(loaded.b_dense), 1, f) == 1 &&
+              fread(loaded.h, sizeof(loaded.h), 1, f) == 1;
+    fclose(f);
+    if (!ok) return -1;
+    for (int i = 0; i < H; i++) {
+        for (int j = 0; j < H; j++) loaded.U_t[j][i] = U_rnn[i][j];
+    }
+    loaded.learning_rate = header.learning_rate;
+    build_tanh_table(loaded.tanh_table);
+    memcpy(est, &loaded, sizeof(loaded));
+    return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef NEURAL_ESTIMATOR_H
+#define NEURAL_ESTIMATOR_H
+
+#include "npe_config.h"
+
+// ================= NEURAL ESTIMATOR =================
+// Native engine for AdaptiveNeuralEstimator (ia/npe_adaptive_control.py):
+//   h'      = tanh(W_rnn' [x; u] + U_rnn h + b_rnn)
+//   delta_f = W_dense' h' + b_dense
+// with the same online update of the dense layer as the Python backward().
+//
+// Two variants share one set of weights:
+//   NeuralEstimator     float32, inference and online learning
+//   NeuralEstimatorQ16  int16 weights and activations, int32 accumulators,
+//                       inference only; the fixed-point layout intended
+//                       for the FPGA/NPU path. Learning stays in float and
+//                       neural_estimator_quantize() refreshes the copy.
+// Both evaluate tanh from a lookup table with linear interpolation, held
+// in the struct the way the hardware holds it in ROM.
+//
+// The matrix-vector kernels run over the hidden dimension (AVX-512, AVX2
+// or NEON, scalar tail), so weights are stored column-wise: W_in is the
+// Python W_rnn as is, U_t is U_rnn transposed.
+//
+// Weights are exchanged as a blob: NeuralWeightsHeader, then float32
+// arrays in the Python shapes and order W_rnn, U_rnn, b_rnn, W_dense,
+// b_dense, h (row-major, native-endian). AdaptiveNeuralEstimator's
+// save_weights()/load_weights() read and write the same file.
+
+#ifndef NEURAL_STATES
+#define NEURAL_STATES 3
+#endif
+#ifndef NEURAL_CONTROLS
+#define NEURAL_CONTROLS 3
+#endif
+#ifndef NEURAL_HIDDEN
+#define NEURAL_HIDDEN 16
+#endif
+#define NEURAL_INPUTS (NEURAL_STATES + NEURAL_CONTROLS)
+#define NEURAL_ALIGN 64
+
+#define NEURAL_WEIGHTS_MAGIC 0x4e4e504eu    // "NPNN"
+#define NEURAL_WEIGHTS_VERSION 1
+#define NEURAL_INIT_SCALE 0.1f              // randn * 0.1, as in Python
+
+// tanh table: [-RANGE, RANGE] in steps of 1 / 2^STEP_BITS; saturates outside
+#define NEURAL_TANH_RANGE 8
+#define NEURAL_TANH_STEP_BITS 7
+#define NEURAL_TANH_ENTRIES (2 * NEURAL_TANH_RANGE * (1 << NEURAL_TANH_STEP_BITS) + 1)
+
+// Fixed-point formats (fractional bits)
+#define NEURAL_Q_INPUT 8                    // x, u: Q7.8, |v| < 128
+#define NEURAL_Q_WEIGHT 13                  // weights: Q2.13, |w| < 4
+#define NEURAL_Q_HIDDEN 14                  // h: Q1.14
+#define NEURAL_Q_ACCUM 16                   // pre-activations, biases, delta_f (int32)
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t states;
+    uint32_t controls;
+    uint32_t hidden;
+    uint32_t reserved0;
+    float learning_rate;
+    uint32_t reserved1;
+} NeuralWeightsHeader;
+
+typedef struct {
+    _Alignas(NEURAL_ALIGN) float W_in[NEURAL_INPUTS][NEURAL_HIDDEN];
+    _Alignas(NEURAL_ALIGN) float U_t[NEURAL_HIDDEN][NEURAL_HIDDEN];
+    _Alignas(NEURAL_ALIGN) float b_rnn[NEURAL_HIDDEN];
+    _Alignas(NEURAL_ALIGN) float h[NEURAL_HIDDEN];
+    float W_dense[NEURAL_HIDDEN][NEURAL_STATES];
+    float b_dense[NEURAL_STATES];
+    float learning_rate;
+    _Alignas(NEURAL_ALIGN) float tanh_table[NEURAL_TANH_ENTRIES];
+} NeuralEstimator;
+
+typedef struct {
+    _Alignas(NEURAL_ALIGN) int16_t W_in[NEURAL_INPUTS][NEURAL_HIDDEN];
+    _Alignas(NEURAL_ALIGN) int16_t U_t[NEURAL_HIDDEN][NEURAL_HIDDEN];
+    _Alignas(NEURAL_ALIGN) int32_t b_rnn[NEURAL_HIDDEN];
+    _Alignas(NEURAL_ALIGN) int16_t h[NEURAL_HIDDEN];
+    int16_t W_dense[NEURAL_HIDDEN][NEURAL_STATES];
+    int32_t b_dense[NEURAL_STATES];
+    uint32_t saturated;             // weights clipped by neural_estimator_quantize()
+    _Alignas(NEURAL_ALIGN) int16_t tanh_table[NEURAL_TANH_ENTRIES];
+} NeuralEstimatorQ16;
+
+// Random weights (randn * NEURAL_INIT_SCALE from stream seed), zero biases
+// and hidden state
+void neural_estimator_init(NeuralEstimator *est, float learning_rate, uint64_t seed);
+void neural_estimator_reset_state(NeuralEstimator *est);
+
+// forward(): delta_f (NEURAL_STATES) and h_new (NEURAL_HIDDEN, may be NULL);
+// the hidden state is not advanced
+void neural_estimator_forward(const NeuralEstimator *est, const float *x, const float *u,
+                              float *delta_f, float *h_new);
+
+// predict_and_learn(): advances h, writes x_next_pred = x + delta_f * dt,
+// updates the dense layer from x_next_real and returns |error|
+float neural_estimator_step(NeuralEstimator *est, const float *x, const float *u,
+                            const float *x_next_real, float dt, float *x_next_pred);
+
+float neural_estimator_tanh(const NeuralEstimator *est, float v);
+
+// Fixed-point copy of the float model, hidden state included
+void neural_estimator_quantize(const NeuralEstimator *est, NeuralEstimatorQ16 *q);
+void neural_q16_forward(const NeuralEstimatorQ16 *q, const float *x, const float *u,
+                        float *delta_f, int16_t *h_new);
+// Inference step: advances h and writes x_next_pred = x + delta_f * dt
+void neural_q16_step(NeuralEstimatorQ16 *q, const float *x, const float *u, float dt,
+                     float *x_next_pred);
+
+// Blob I/O; load returns -1 on a missing file or a dimension mismatch
+int neural_estimator_save(const NeuralEstimator *est, const char *path);
+int neural_estimator_load(NeuralEstimator *est, const char *path);
+
+#endif // NEURAL_ESTIMATOR_H
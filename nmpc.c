@@ -0,0 +1,467 @@
+#include "nmpc.h"
+#include "machine_geometry.h"
+#include "plasma_physics.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define N NMPC_HORIZON
+#define NX NMPC_STATES
+#define NU NMPC_INPUTS
+#define NY NMPC_OUTPUTS
+#define NV NMPC_VARIABLES
+#define DW NMPC_DUAL_WIDTH
+
+#define NMPC_POWER_ITERATIONS_COLD 50
+
+// Structural nonzeros as (row, column); [A B] columns are x then u
+static const uint8_t jacobian_pattern[NMPC_JACOBIAN_NNZ][2] = {
+    { NMPC_X_CURRENT, NMPC_X_CURRENT }, { NMPC_X_CURRENT, NX + NMPC_U_LOOP },
+    { NMPC_X_ENERGY, NMPC_X_ENERGY }, { NMPC_X_ENERGY, NX + NMPC_U_HEATING },
+    { NMPC_X_DENSITY, NMPC_X_DENSITY }, { NMPC_X_DENSITY, NX + NMPC_U_FUEL },
+    { NMPC_X_POSITION, NMPC_X_CURRENT }, { NMPC_X_POSITION, NMPC_X_DENSITY },
+    { NMPC_X_POSITION, NMPC_X_POSITION }, { NMPC_X_POSITION, NX + NMPC_U_LOOP },
+    { NMPC_X_POSITION, NX + NMPC_U_FUEL }, { NMPC_X_POSITION, NX + NMPC_U_VERTICAL },
+};
+
+static const uint8_t output_pattern[NMPC_OUTPUT_NNZ][2] = {
+    { NMPC_Y_CURRENT, NMPC_X_CURRENT },
+    { NMPC_Y_TEMPERATURE, NMPC_X_ENERGY }, { NMPC_Y_TEMPERATURE, NMPC_X_DENSITY },
+    { NMPC_Y_DENSITY, NMPC_X_DENSITY },
+    { NMPC_Y_POSITION, NMPC_X_POSITION },
+};
+
+// ================= DUAL NUMBERS =================
+// Value and derivatives along DW seed directions (the states, then the inputs)
+typedef struct {
+    double v;
+    double d[DW];
+} Dual;
+
+static inline Dual dual_const(double v) {
+    Dual r = { .v = v };
+    return r;
+}
+
+static inline Dual dual_seed(double v, int k) {
+    Dual r = { .v = v };
+    r.d[k] = 1.0;
+    return r;
+}
+
+static inline Dual dual_add(Dual a, Dual b) {
+    a.v += b.v;
+    for (int k = 0; k < DW; k++) a.d[k] += b.d[k];
+    return a;
+}
+
+static inline Dual dual_sub(Dual a, Dual b) {
+    a.v -= b.v;
+    for (int k = 0; k < DW; k++) a.d[k] -= b.d[k];
+    return a;
+}
+
+static inline Dual dual_scale(Dual a, double s) {
+    a.v *= s;
+    for (int k = 0; k < DW; k++) a.d[k] *= s;
+    return a;
+}
+
+static inline Dual dual_mul(Dual a, Dual b) {
+    Dual r = { .v = a.v * b.v };
+    for (int k = 0; k < DW; k++) r.d[k] = a.d[k] * b.v + a.v * b.d[k];
+    return r;
+}
+
+static inline Dual dual_div(Dual a, Dual b) {
+    double inv = 1.0 / b.v;
+    Dual r = { .v = a.v * inv };
+    for (int k = 0; k < DW; k++) r.d[k] = (a.d[k] - r.v * b.d[k]) * inv;
+    return r;
+}
+
+// ================= MODEL =================
+// The blocks of advance_plasma_state() in its order: circuit, energy,
+// particles, then the vertical map with the new current and mass
+static void model(const Nmpc *nmpc, const Dual *x, const Dual *u, Dual *x_next) {
+    const double dt = nmpc->config.dt;
+    Dual drive = dual_sub(dual_scale(u[NMPC_U_LOOP], LOOP_VOLTAGE_PER_PF_CURRENT),
+                          dual_scale(x[NMPC_X_CURRENT], PLASMA_RESISTANCE * 1e6));
+    Dual Ip = dual_add(x[NMPC_X_CURRENT],
+                       dual_scale(drive, dt / (PLASMA_INDUCTANCE * 1e6)));
+
+    Dual loss = dual_scale(x[NMPC_X_ENERGY], 1.0 / nmpc->config.energy_confinement_time);
+    Dual W = dual_add(x[NMPC_X_ENERGY],
+                      dual_scale(dual_sub(u[NMPC_U_HEATING], loss), dt));
+
+    Dual source = dual_scale(u[NMPC_U_FUEL],
+                             NMPC_FUEL_UNIT / (nmpc->plasma_volume * 1e19));
+    Dual sink = dual_scale(x[NMPC_X_DENSITY], 1.0 / PARTICLE_CONFINEMENT_TIME);
+    Dual n = dual_add(x[NMPC_X_DENSITY], dual_scale(dual_sub(source, sink), dt));
+
+    Dual mass = dual_scale(n, nmpc->mass_per_density);
+    Dual force = dual_scale(dual_mul(u[NMPC_U_VERTICAL], Ip),
+                            VERTICAL_FORCE_COUPLING * nmpc->vertical_coils);
+    Dual accel = dual_div(dual_sub(force, dual_scale(x[NMPC_X_POSITION], VERTICAL_DAMPING)),
+                          mass);
+    Dual z = dual_add(dual_scale(x[NMPC_X_POSITION], 1.0 + dt),
+                      dual_scale(accel, 0.5 * dt * dt));
+
+    x_next[NMPC_X_CURRENT] = Ip;
+    x_next[NMPC_X_ENERGY] = W;
+    x_next[NMPC_X_DENSITY] = n;
+    x_next[NMPC_X_POSITION] = z;
+}
+
+static void output(const Nmpc *nmpc, const Dual *x, Dual *y) {
+    y[NMPC_Y_CURRENT] = x[NMPC_X_CURRENT];
+    y[NMPC_Y_TEMPERATURE] = dual_scale(dual_div(x[NMPC_X_ENERGY], x[NMPC_X_DENSITY]),
+                                       nmpc->temperature_scale);
+    y[NMPC_Y_DENSITY] = x[NMPC_X_DENSITY];
+    y[NMPC_Y_POSITION] = x[NMPC_X_POSITION];
+}
+
+static void model_value(const Nmpc *nmpc, const double *x, const double *u,
+                        double *x_next) {
+    Dual xd[NX], ud[NU], next[NX];
+    for (int i = 0; i < NX; i++) xd[i] = dual_const(x[i]);
+    for (int j = 0; j < NU; j++) ud[j] = dual_const(u[j]);
+    model(nmpc, xd, ud, next);
+    for (int i = 0; i < NX; i++) x_next[i] = next[i].v;
+}
+
+void nmpc_model_step(const Nmpc *nmpc, const float *x, const float *u, float *x_next) {
+    double xd[NX], ud[NU], next[NX];
+    for (int i = 0; i < NX; i++) xd[i] = x[i];
+    for (int j = 0; j < NU; j++) ud[j] = u[j];
+    model_value(nmpc, xd, ud, next);
+    for (int i = 0; i < NX; i++) x_next[i] = (float)next[i];
+}
+
+void nmpc_state_from_plasma(const PlasmaState *state,
+                            const PlasmaControlSystem *control, float *x) {
+    x[NMPC_X_CURRENT] = state->plasma_current;
+    x[NMPC_X_ENERGY] = control->stored_energy;
+    x[NMPC_X_DENSITY] = state->density_core;
+    x[NMPC_X_POSITION] = state->vertical_position;
+}
+
+void nmpc_apply_inputs(const float *u, PlasmaControlSystem *control) {
+    const MachineGeometry *m = &machine_default;
+    control->pf_coil_currents[0] = u[NMPC_U_LOOP];
+    float per_system = u[NMPC_U_HEATING] / (float)m->num_heating_systems;
+    for (int h = 0; h < m->num_heating_systems; h++) {
+        control->heating_systems[h].enabled = per_system > 0.0f;
+        if (per_system > 0.0f) control->heating_systems[h].power = per_system;
+    }
+    control->fuel_injection_rate = u[NMPC_U_FUEL] * NMPC_FUEL_UNIT;
+    for (int c = 0; c < m->num_vertical_coils; c++) {
+        control->vertical_coil_currents[c] = u[NMPC_U_VERTICAL];
+    }
+}
+
+// ================= CREATE =================
+void nmpc_config_default(NmpcConfig *config, float dt) {
+    static const float q[NY] = { 10.0f, 0.0f, 0.1f, 1e4f };
+    static const float r[NU] = { 1e-4f, 1.0f, 1e-2f, 1e-2f };
+    static const float u_min[NU] = { 0.0f, 0.0f, 0.0f, -1.0f };
+    static const float u_max[NU] = { 100.0f, NUM_HEATING_SYSTEMS * 0.4f, 20.0f, 1.0f };
+    memset(config, 0, sizeof(*config));
+    config->dt = dt;
+    config->energy_confinement_time = ENERGY_CONFINEMENT_TIME;
+    config->elongation = 1.7f;
+    memcpy(config->q, q, sizeof(q));
+    memcpy(config->r, r, sizeof(r));
+    memcpy(config->u_min, u_min, sizeof(u_min));
+    memcpy(config->u_max, u_max, sizeof(u_max));
+    config->qp_iterations = NMPC_QP_ITERATIONS_DEFAULT;
+}
+
+Nmpc *nmpc_create(const NmpcConfig *config) {
+    if (!(config->dt > 0.0f) || !(config->energy_confinement_time > 0.0f) ||
+        !(config->elongation > 0.0f)) {
+        return NULL;
+    }
+    for (int i = 0; i < NY; i++) {
+        if (!(config->q[i] >= 0.0f)) return NULL;
+    }
+    for (int j = 0; j < NU; j++) {
+        if (!(config->r[j] >= 0.0f) || !(config->u_max[j] >= config->u_min[j])) return NULL;
+    }
+    Nmpc *nmpc = aligned_alloc(NMPC_ALIGN, (sizeof(Nmpc) + NMPC_ALIGN - 1) /
+                                           NMPC_ALIGN * NMPC_ALIGN);
+    if (!nmpc) return NULL;
+    memset(nmpc, 0, sizeof(*nmpc));
+    nmpc->config = *config;
+
+    const MachineGeometry *m = &machine_default;
+    nmpc->plasma_volume = machine_plasma_volume(m, config->elongation);
+    nmpc->temperature_scale = 1e6 / (1.5 * 1e19 * nmpc->plasma_volume *
+                                     ELECTRON_CHARGE * 1000.0);
+    nmpc->mass_per_density = 1e19 * nmpc->plasma_volume * (PROTON_MASS + ELECTRON_MASS);
+    nmpc->vertical_coils = m->num_vertical_coils;
+
+    float x[NX] = { 0.0f, 0.0f, 1.0f, 0.0f };
+    float u[NU];
+    for (int j = 0; j < NU; j++) u[j] = config->u_min[j];
+    nmpc_reset(nmpc, x, u);
+    return nmpc;
+}
+
+void nmpc_destroy(Nmpc *nmpc) {
+    free(nmpc);
+}
+
+static inline double clamp(double x, double lo, double hi) {
+    x = x < lo ? lo : x;
+    return x > hi ? hi : x;
+}
+
+void nmpc_reset(Nmpc *nmpc, const float *x, const float *u) {
+    const NmpcConfig *c = &nmpc->config;
+    for (int j = 0; j < NU; j++) {
+        double uj = clamp(u[j], c->u_min[j], c->u_max[j]);
+        nmpc->u_applied[j] = uj;
+        for (int k = 0; k < N; k++) nmpc->u[k][j] = uj;
+    }
+    for (int i = 0; i < NX; i++) nmpc->x_predicted[i] = x[i];
+    for (int i = 0; i < NV; i++) nmpc->eigenvector[i] = 1.0 / sqrt((double)NV);
+    nmpc->lipschitz = 0.0;
+    nmpc->shift = false;
+    nmpc->prepared = false;
+}
+
+int nmpc_set_input_bounds(Nmpc *nmpc, uint32_t input, float lo, float hi) {
+    if (input >= NU || !(hi >= lo)) return -1;
+    nmpc->config.u_min[input] = lo;
+    nmpc->config.u_max[input] = hi;
+    return 0;
+}
+
+// ================= PREPARATION =================
+// Variable scaling 1/sqrt(H_ii): the columns of H differ by orders of
+// magnitude (z responds to the coils within a step, Ip and n_e barely move
+// over the horizon), and unscaled the step size is set by the stiffest one.
+// H_ii is the weighted response of the outputs to a unit du, propagated
+// down the horizon, plus its move weights.
+static void jacobi_scale(Nmpc *nmpc) {
+    const NmpcConfig *c = &nmpc->config;
+    for (int k = 0; k < N; k++) {
+        for (int j = 0; j < NU; j++) {
+            double dx[NX] = { 0.0 }, next[NX];
+            for (int e = 0; e < NMPC_JACOBIAN_NNZ; e++) {
+                if (jacobian_pattern[e][1] == NX + j) {
+                    dx[jacobian_pattern[e][0]] += nmpc->J[k][e];
+                }
+            }
+            double h = c->r[j] * (k + 1 < N ? 2.0 : 1.0);
+            for (int t = k + 1; t <= N; t++) {
+                double e[NY] = { 0.0 };
+                for (int p = 0; p < NMPC_OUTPUT_NNZ; p++) {
+                    e[output_pattern[p][0]] += nmpc->C[t][p] * dx[output_pattern[p][1]];
+                }
+                for (int i = 0; i < NY; i++) h += c->q[i] * e[i] * e[i];
+                if (t == N) break;
+                for (int i = 0; i < NX; i++) next[i] = 0.0;
+                for (int p = 0; p < NMPC_JACOBIAN_NNZ; p++) {
+                    if (jacobian_pattern[p][1] < NX) {
+                        next[jacobian_pattern[p][0]] += nmpc->J[t][p] * dx[jacobian_pattern[p][1]];
+                    }
+                }
+                memcpy(dx, next, sizeof(dx));
+            }
+            nmpc->scale[k * NU + j] = h > 0.0 ? 1.0 / sqrt(h) : 1.0;
+        }
+    }
+}
+
+void nmpc_prepare(Nmpc *nmpc) {
+    if (nmpc->shift) {
+        memmove(nmpc->u[0], nmpc->u[1], (N - 1) * sizeof(nmpc->u[0]));
+    }
+    memcpy(nmpc->x[0], nmpc->x_predicted, sizeof(nmpc->x[0]));
+
+    Dual x[NX], u[NU], next[NX], y[NY];
+    for (int k = 0; k <= N; k++) {
+        for (int i = 0; i < NX; i++) x[i] = dual_seed(nmpc->x[k][i], i);
+        if (k > 0) {
+            output(nmpc, x, y);
+            for (int i = 0; i < NY; i++) nmpc->y[k][i] = y[i].v;
+            for (int e = 0; e < NMPC_OUTPUT_NNZ; e++) {
+                nmpc->C[k][e] = y[output_pattern[e][0]].d[output_pattern[e][1]];
+            }
+        }
+        if (k == N) break;
+        for (int j = 0; j < NU; j++) u[j] = dual_seed(nmpc->u[k][j], NX + j);
+        model(nmpc, x, u, next);
+        for (int e = 0; e < NMPC_JACOBIAN_NNZ; e++) {
+            nmpc->J[k][e] = next[jacobian_pattern[e][0]].d[jacobian_pattern[e][1]];
+        }
+        for (int i = 0; i < NX; i++) nmpc->x[k + 1][i] = next[i].v;
+    }
+    jacobi_scale(nmpc);
+    nmpc->prepared = true;
+}
+
+// ================= QP =================
+// Linearized cost of the scaled input corrections v and its gradient:
+// a forward sweep of dx_{k+1} = A_k dx_k + B_k du_k, then the adjoint
+// sweep backwards. With dx0 and reference NULL only the quadratic part is
+// kept, so grad = H v.
+static double sweep(Nmpc *nmpc, const double *v, const double *dx0,
+                    const double *reference, double *grad) {
+    const NmpcConfig *c = &nmpc->config;
+    double (*dx)[NX] = nmpc->dx;
+    for (int i = 0; i < NX; i++) dx[0][i] = dx0 ? dx0[i] : 0.0;
+    for (int k = 0; k < N; k++) {
+        double z[NX + NU];
+        memcpy(z, dx[k], sizeof(dx[k]));
+        for (int j = 0; j < NU; j++) z[NX + j] = nmpc->scale[k * NU + j] * v[k * NU + j];
+        for (int i = 0; i < NX; i++) dx[k + 1][i] = 0.0;
+        for (int e = 0; e < NMPC_JACOBIAN_NNZ; e++) {
+            dx[k + 1][jacobian_pattern[e][0]] += nmpc->J[k][e] * z[jacobian_pattern[e][1]];
+        }
+    }
+
+    double cost = 0.0;
+    double *lambda = nmpc->adjoint;
+    for (int i = 0; i < NX; i++) lambda[i] = 0.0;
+    for (int k = N; k >= 1; k--) {
+        double e[NY];
+        for (int i = 0; i < NY; i++) {
+            e[i] = reference ? nmpc->y[k][i] - reference[i] : 0.0;
+        }
+        for (int p = 0; p < NMPC_OUTPUT_NNZ; p++) {
+            e[output_pattern[p][0]] += nmpc->C[k][p] * dx[k][output_pattern[p][1]];
+        }
+        for (int i = 0; i < NY; i++) {
+            cost += 0.5 * c->q[i] * e[i] * e[i];
+            e[i] *= c->q[i];
+        }
+        for (int p = 0; p < NMPC_OUTPUT_NNZ; p++) {
+            lambda[output_pattern[p][1]] += nmpc->C[k][p] * e[output_pattern[p][0]];
+        }
+        double previous[NX + NU] = { 0.0 };
+        for (int p = 0; p < NMPC_JACOBIAN_NNZ; p++) {
+            previous[jacobian_pattern[p][1]] += nmpc->J[k - 1][p] * lambda[jacobian_pattern[p][0]];
+        }
+        memcpy(lambda, previous, NX * sizeof(double));
+        for (int j = 0; j < NU; j++) grad[(k - 1) * NU + j] = previous[NX + j];
+    }
+
+    // Input moves, u_{-1} the input applied last cycle
+    for (int k = 0; k < N; k++) {
+        for (int j = 0; j < NU; j++) {
+            double du = nmpc->scale[k * NU + j] * v[k * NU + j];
+            double du_prev = k ? nmpc->scale[(k - 1) * NU + j] * v[(k - 1) * NU + j] : 0.0;
+            double move = du - du_prev;
+            if (reference) {
+                move += nmpc->u[k][j] - (k ? nmpc->u[k - 1][j] : nmpc->u_applied[j]);
+            }
+            cost += 0.5 * c->r[j] * move * move;
+            grad[k * NU + j] += c->r[j] * move;
+            if (k) grad[(k - 1) * NU + j] -= c->r[j] * move;
+        }
+    }
+    for (int k = 0; k < N; k++) {
+        for (int j = 0; j < NU; j++) grad[k * NU + j] *= nmpc->scale[k * NU + j];
+    }
+    return cost;
+}
+
+// Largest eigenvalue of H by power iteration from the previous eigenvector
+static double lipschitz_estimate(Nmpc *nmpc, int iterations) {
+    double *u = nmpc->eigenvector, *Hu = nmpc->grad;
+    double lambda = 0.0;
+    for (int it = 0; it < iterations; it++) {
+        sweep(nmpc, u, NULL, NULL, Hu);
+        double norm = 0.0;
+        for (int i = 0; i < NV; i++) norm += Hu[i] * Hu[i];
+        norm = sqrt(norm);
+        if (!(norm > 0.0)) return 0.0;
+        lambda = norm;
+        for (int i = 0; i < NV; i++) u[i] = Hu[i] / norm;
+    }
+    return lambda;
+}
+
+// ================= FEEDBACK =================
+int nmpc_feedback(Nmpc *nmpc, const float *x, const float *reference, float *u) {
+    if (!nmpc->prepared) nmpc_prepare(nmpc);
+    const NmpcConfig *c = &nmpc->config;
+    double dx0[NX], r[NY];
+    for (int i = 0; i < NX; i++) dx0[i] = (double)x[i] - nmpc->x[0][i];
+    for (int i = 0; i < NY; i++) r[i] = reference[i];
+
+    for (int k = 0; k < N; k++) {
+        for (int j = 0; j < NU; j++) {
+            double scale = nmpc->scale[k * NU + j];
+            nmpc->lower[k * NU + j] = ((double)c->u_min[j] - nmpc->u[k][j]) / scale;
+            nmpc->upper[k * NU + j] = ((double)c->u_max[j] - nmpc->u[k][j]) / scale;
+        }
+    }
+    double lambda = lipschitz_estimate(nmpc, nmpc->lipschitz > 0.0 ?
+                                       NMPC_POWER_ITERATIONS : NMPC_POWER_ITERATIONS_COLD);
+    nmpc->lipschitz = lambda;
+    double step = lambda > 0.0 ? 1.0 / (NMPC_STEP_SAFETY * lambda) : 0.0;
+
+    // FISTA from the shifted plan (zero correction, clipped to the box)
+    double *v = nmpc->v, *w = nmpc->w, *grad = nmpc->grad;
+    for (int i = 0; i < NV; i++) v[i] = clamp(0.0, nmpc->lower[i], nmpc->upper[i]);
+    memcpy(w, v, sizeof(nmpc->w));
+    double t = 1.0;
+    uint32_t iterations = 0;
+    bool converged = false;
+    while (iterations < c->qp_iterations && step > 0.0) {
+        iterations++;
+        sweep(nmpc, w, dx0, r, grad);
+        double change = 0.0, restart = 0.0;
+        for (int i = 0; i < NV; i++) {
+            double next = clamp(w[i] - step * grad[i], nmpc->lower[i], nmpc->upper[i]);
+            double d = next - v[i];
+            change = fabs(d) > change ? fabs(d) : change;
+            restart += (w[i] - next) * d;
+            grad[i] = d;                // reused as the step
+            v[i] = next;
+        }
+        if (change <= NMPC_QP_TOLERANCE) {
+            converged = true;
+            break;
+        }
+        if (restart > 0.0) {
+            // Momentum points uphill: restart from the projected point
+            t = 1.0;
+            memcpy(w, v, sizeof(nmpc->w));
+        } else {
+            double t_next = 0.5 * (1.0 + sqrt(1.0 + 4.0 * t * t));
+            double beta = (t - 1.0) / t_next;
+            for (int i = 0; i < NV; i++) w[i] = v[i] + beta * grad[i];
+            t = t_next;
+        }
+    }
+    float cost = (float)sweep(nmpc, v, dx0, r, grad);
+
+    // Take the step; the plan starts the next cycle from the predicted state
+    for (int k = 0; k < N; k++) {
+        for (int j = 0; j < NU; j++) {
+            nmpc->u[k][j] = clamp(nmpc->u[k][j] + nmpc->scale[k * NU + j] * v[k * NU + j],
+                                  c->u_min[j], c->u_max[j]);
+        }
+    }
+    double xm[NX];
+    for (int i = 0; i < NX; i++) xm[i] = x[i];
+    memcpy(nmpc->u_applied, nmpc->u[0], sizeof(nmpc->u_applied));
+    model_value(nmpc, xm, nmpc->u[0], nmpc->x_predicted);
+    for (int j = 0; j < NU; j++) u[j] = (float)nmpc->u[0][j];
+    nmpc->shift = true;
+    nmpc->prepared = false;
+
+    NmpcStats *s = &nmpc->stats;
+    s->cycles++;
+    s->qp_iterations += iterations;
+    s->qp_iterations_last = iterations;
+    if (iterations > s->qp_iterations_max) s->qp_iterations_max = iterations;
+    s->capped += !converged;
+    s->cost_last = cost;
+    s->lipschitz = (float)lambda;
+    return (int)iterations;
+}
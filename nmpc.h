@@ -0,0 +1,169 @@
+#ifndef NMPC_H
+#define NMPC_H
+
+#include "npe_config.h"
+
+// ================= REAL-TIME NONLINEAR MPC =================
+// Nonlinear MPC on the 0D model of advance_plasma_state(), with
+// derivatives from automatic differentiation of the model itself:
+//
+//   x = (Ip [MA], W [MJ], n_e [1e19 m^-3], z [m])
+//   u = (pf coil 0 [V_loop / LOOP_VOLTAGE_PER_PF_CURRENT], heating power [MW],
+//        fuelling [NMPC_FUEL_UNIT particles/s], vertical coil current, per coil)
+//   y = (Ip, T_e [keV], n_e, z),  T_e = W / (1.5 n_e V e)
+//
+//   min  sum_{k=1..N} |y_k - r|^2_Q + sum_{k=0..N-1} |u_k - u_{k-1}|^2_R
+//   s.t. x_{k+1} = f(x_k, u_k),  u_min <= u_k <= u_max
+//
+// where u_{-1} is the input applied on the previous cycle.
+//
+// Derivatives: f and y are written once against forward-mode dual numbers
+// NMPC_STATES + NMPC_INPUTS wide, so one evaluation returns the value and
+// the full stage Jacobian [A_k B_k] (and C_k = dy/dx). The model couples
+// sparsely: Ip, W and n_e each depend on themselves and one actuator; only
+// z sees the others. Only the structural nonzeros of A_k, B_k and C_k
+// (nmpc.c) are kept, and the QP works on them alone.
+//
+// Real-time iteration: one Gauss-Newton SQP step per control cycle,
+// warm-started from the previous plan.
+//   nmpc_prepare()   shifts the plan by one step, simulates it from the
+//                    predicted state and linearizes along it. It does not
+//                    need the measurement, so it can run in the previous
+//                    cycle's slack.
+//   nmpc_feedback()  takes the measured state and solves the box-constrained
+//                    QP in the input corrections with accelerated projected
+//                    gradient (FISTA with restart). The gradient comes from a
+//                    forward sweep of the linearized dynamics and a reverse
+//                    (adjoint) sweep, O(N) per iteration, and the step from a
+//                    power iteration warm-started across cycles. Variables are
+//                    scaled by 1/sqrt(diag H), computed in the preparation
+//                    phase, since the inputs act on very different time
+//                    scales (z within a step, Ip over L/R). Iterations stop at
+//                    qp_iterations or when the scaled step drops below
+//                    NMPC_QP_TOLERANCE; an inexact step is corrected on the
+//                    next cycle.
+// The QP is deliberately truncated. The loop-voltage corrections move Ip
+// almost collinearly over the horizon, so some cycles, with every bound of
+// a ramp plan active, need 250-300 iterations (~1 ms) to converge; most
+// take 30-60. The default cap of 150 (~0.5 ms) keeps the feedback phase
+// inside a 1 kHz cycle, and on an Ip ramp costs ~4% of closed-loop
+// tracking against exact solves.
+// All workspace lives in the Nmpc struct: nothing is allocated after
+// nmpc_create().
+
+#ifndef NMPC_HORIZON
+#define NMPC_HORIZON 20
+#endif
+
+#define NMPC_STATES 4
+#define NMPC_INPUTS 4
+#define NMPC_OUTPUTS 4
+#define NMPC_DUAL_WIDTH (NMPC_STATES + NMPC_INPUTS)
+#define NMPC_VARIABLES (NMPC_INPUTS * NMPC_HORIZON)
+#define NMPC_ALIGN 64
+
+#define NMPC_JACOBIAN_NNZ 12            // [A B] structural nonzeros
+#define NMPC_OUTPUT_NNZ 5               // C structural nonzeros
+
+#define NMPC_FUEL_UNIT 1e20f            // particles/s per fuelling unit
+#define NMPC_QP_ITERATIONS_DEFAULT 150
+#define NMPC_QP_TOLERANCE 3e-5f         // scaled step
+#define NMPC_POWER_ITERATIONS 4         // per cycle, warm-started
+#define NMPC_STEP_SAFETY 1.2f           // over the Lipschitz estimate
+
+enum { NMPC_X_CURRENT, NMPC_X_ENERGY, NMPC_X_DENSITY, NMPC_X_POSITION };
+enum { NMPC_U_LOOP, NMPC_U_HEATING, NMPC_U_FUEL, NMPC_U_VERTICAL };
+enum { NMPC_Y_CURRENT, NMPC_Y_TEMPERATURE, NMPC_Y_DENSITY, NMPC_Y_POSITION };
+
+typedef struct {
+    float dt;                       // control cycle, s
+    float energy_confinement_time;  // tau_E of the model, s
+    float elongation;               // plasma volume
+    float q[NMPC_OUTPUTS];          // output weights
+    float r[NMPC_INPUTS];           // input-move weights
+    float u_min[NMPC_INPUTS];
+    float u_max[NMPC_INPUTS];
+    uint32_t qp_iterations;         // cap per cycle
+} NmpcConfig;
+
+typedef struct {
+    uint64_t cycles;
+    uint64_t qp_iterations;         // total
+    uint32_t qp_iterations_last;
+    uint32_t qp_iterations_max;
+    uint64_t capped;                // cycles that hit the cap
+    float cost_last;                // linearized cost after the step
+    float lipschitz;                // current step-size estimate
+} NmpcStats;
+
+typedef struct {
+    NmpcConfig config;
+
+    // Model constants, from the config and npe_config.h
+    double plasma_volume;
+    double temperature_scale;       // T_e = scale * W / n_e
+    double mass_per_density;        // plasma mass per unit n_e, kg
+    double vertical_coils;
+
+    // Plan (the SQP iterate) and its linearization
+    _Alignas(NMPC_ALIGN) double u[NMPC_HORIZON][NMPC_INPUTS];
+    double x[NMPC_HORIZON + 1][NMPC_STATES];
+    double y[NMPC_HORIZON + 1][NMPC_OUTPUTS];
+    double J[NMPC_HORIZON][NMPC_JACOBIAN_NNZ];
+    double C[NMPC_HORIZON + 1][NMPC_OUTPUT_NNZ];
+    double x_predicted[NMPC_STATES];  // start of the next plan
+    double u_applied[NMPC_INPUTS];    // u_{-1}
+    bool shift;                       // a feedback step has been taken
+    bool prepared;
+
+    // QP workspace, all in scaled variables
+    _Alignas(NMPC_ALIGN) double scale[NMPC_VARIABLES];   // 1 / sqrt(H_ii)
+    double lower[NMPC_VARIABLES];
+    double upper[NMPC_VARIABLES];
+    double v[NMPC_VARIABLES];         // iterate
+    double w[NMPC_VARIABLES];         // extrapolated point
+    double grad[NMPC_VARIABLES];
+    double eigenvector[NMPC_VARIABLES];
+    double dx[NMPC_HORIZON + 1][NMPC_STATES];
+    double adjoint[NMPC_STATES];
+    double lipschitz;                 // 0 until the first estimate
+
+    NmpcStats stats;
+} Nmpc;
+
+// Output weights on Ip and z, input moves lightly penalized, and boxes
+// around the driver's operating range
+void nmpc_config_default(NmpcConfig *config, float dt);
+
+// Returns NULL for dt <= 0, a weight < 0, an empty box or a failed
+// allocation
+Nmpc *nmpc_create(const NmpcConfig *config);
+void nmpc_destroy(Nmpc *nmpc);
+
+// Restarts from a constant plan u (NMPC_INPUTS entries, clamped to the box)
+// and the state x
+void nmpc_reset(Nmpc *nmpc, const float *x, const float *u);
+
+// Changes one input's box, e.g. to pin an actuator the scenario owns;
+// returns -1 for an unknown input or lo > hi
+int nmpc_set_input_bounds(Nmpc *nmpc, uint32_t input, float lo, float hi);
+
+// Preparation phase: shift, simulate and linearize
+void nmpc_prepare(Nmpc *nmpc);
+
+// Feedback phase for measured state x and constant reference r
+// (NMPC_OUTPUTS entries). Writes the input to apply to u and returns the
+// QP iteration count. Prepares first if nmpc_prepare() was not called.
+int nmpc_feedback(Nmpc *nmpc, const float *x, const float *reference, float *u);
+
+// Model state of a shot, and the model's inputs applied to its actuators:
+// pf coil 0, heating split evenly (zero disables the systems and keeps
+// their power setting), fuelling and every vertical coil
+void nmpc_state_from_plasma(const PlasmaState *state,
+                            const PlasmaControlSystem *control, float *x);
+void nmpc_apply_inputs(const float *u, PlasmaControlSystem *control);
+
+// One model step, x_next = f(x, u), as used for the prediction
+void nmpc_model_step(const Nmpc *nmpc, const float *x, const float *u, float *x_next);
+
+#endif // NMPC_H
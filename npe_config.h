@@ -40,8 +40,22 @@
 #define ENERGY_CONFINEMENT_TIME 5.0f
 #define DISRUPTION_WARNING_TIME 0.05f
 #define MITIGATION_RESPONSE_TIME 0.01f
+#define THERMAL_QUENCH_TIME 0.001f
+#define CURRENT_QUENCH_TIME 0.01f
+
+// ================= PHYSICAL CONSTANTS =================
+#define MU0 (4.0e-7 * M_PI)
+#define ELECTRON_CHARGE 1.602e-19
+#define ELECTRON_MASS 9.109e-31
+#define PROTON_MASS 1.673e-27
 
 // ================= DATA STRUCTURES =================
+struct StateHistory;
+
+typedef struct {
+    uint32_t s[4];
+} PlasmaRng;
+
 typedef struct {
     float plasma_current;
     float safety_factor_q95;
@@ -91,7 +105,8 @@ typedef struct {
     
     float simulation_time;
     uint32_t iteration_count;
-    float state_history[1000][10];
+    struct StateHistory *history;   // optional, see state_history.h
+    PlasmaRng rng;                  // per-instance noise stream, see plasma_rng.h
     bool disruption_detected;
     bool mitigation_activated;
     float disruption_warning_time;
@@ -117,6 +132,7 @@ typedef struct {
 typedef struct {
     struct {
         bool locked_mode_detected;
+        bool ntm_detected;
         bool vertical_displacement_event;
         bool density_limit_exceeded;
         bool beta_limit_exceeded;
@@ -140,10 +156,21 @@ typedef struct {
 } SafetyMitigationSystem;
 
 // Types for plasma_safety.c
+typedef enum {
+    DISRUPTION_CAUSE_NONE,
+    DISRUPTION_CAUSE_LOW_Q95,
+    DISRUPTION_CAUSE_BETA_LIMIT,
+    DISRUPTION_CAUSE_DENSITY_LIMIT,
+    DISRUPTION_CAUSE_VDE,
+    DISRUPTION_CAUSE_LOCKED_MODE,
+    DISRUPTION_CAUSE_RADIATION,
+    DISRUPTION_CAUSE_COUNT
+} DisruptionCause;
+
 typedef struct {
     float disruption_probability;
     float time_to_disruption;
-    char most_likely_cause[64];
+    DisruptionCause most_likely_cause;
 } DisruptionPrediction;
 
 typedef enum {
@@ -155,10 +182,21 @@ typedef enum {
     MITIGATION_CONTROL_ADJUST
 } MitigationAction;
 
+typedef enum {
+    CONTROL_ADJUST_NONE,
+    CONTROL_ADJUST_REDUCE_CURRENT,
+    CONTROL_ADJUST_REDUCE_HEATING,
+    CONTROL_ADJUST_REDUCE_FUELING,
+    CONTROL_ADJUST_VERTICAL_GAIN,
+    CONTROL_ADJUST_ECRH_STABILIZE,
+    CONTROL_ADJUST_REDUCE_IMPURITY
+} ControlAdjustment;
+
 typedef struct {
     MitigationAction action;
     float urgency;
-    char control_adjustment[128];
+    ControlAdjustment control_adjustment;
+    float adjustment_magnitude;     // fractional change requested, 0..1
 } MitigationDecision;
 
 #endif // NPE_CONFIG_H
@@ -0,0 +1,358 @@
+#include "parameter_scan.h"
+#include "plasma_batch.h"
+#include "plasma_rng.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+// Hypercube draws use their own seeds so they never share a stream with
+// a shot's MHD noise, (seed, shot)
+#define SCAN_STRATA_SEED_SALT 0x5354524154410000ull
+#define SCAN_JITTER_SEED_SALT 0x4a49545445520000ull
+
+static const char *const parameter_names[SCAN_PARAMETER_COUNT] = {
+    [SCAN_FUEL_INJECTION_RATE] = "fuel_injection_rate",
+    [SCAN_HEATING_POWER] = "heating_power",
+    [SCAN_PF_COIL_CURRENT] = "pf_coil_current",
+    [SCAN_ENERGY_CONFINEMENT_TIME] = "energy_confinement_time",
+    [SCAN_STORED_ENERGY] = "stored_energy",
+    [SCAN_PLASMA_CURRENT] = "plasma_current",
+    [SCAN_DENSITY_CORE] = "density_core",
+    [SCAN_ELONGATION] = "elongation",
+    [SCAN_VERTICAL_POSITION] = "vertical_position",
+    [SCAN_IMPURITY_CONCENTRATION] = "impurity_concentration",
+};
+
+static const char *const limit_names[SCAN_LIMIT_COUNT] = {
+    [SCAN_LIMIT_NONE] = "none",
+    [SCAN_LIMIT_NONFINITE] = "nonfinite",
+    [SCAN_LIMIT_Q95] = "q95",
+    [SCAN_LIMIT_BETA_N] = "beta_N",
+    [SCAN_LIMIT_VERTICAL] = "vertical",
+};
+
+const char *scan_parameter_name(ScanParameter parameter) {
+    return (unsigned)parameter < SCAN_PARAMETER_COUNT ?
+           parameter_names[parameter] : "unknown";
+}
+
+const char *scan_limit_name(ScanLimit limit) {
+    return (unsigned)limit < SCAN_LIMIT_COUNT ? limit_names[limit] : "unknown";
+}
+
+static bool axis_valid(const ScanAxis *axis, ScanMode mode) {
+    if ((unsigned)axis->parameter >= SCAN_PARAMETER_COUNT) return false;
+    if (axis->parameter == SCAN_HEATING_POWER && axis->index >= NUM_HEATING_SYSTEMS) {
+        return false;
+    }
+    if (axis->parameter == SCAN_PF_COIL_CURRENT && axis->index >= NUM_PF_COILS) {
+        return false;
+    }
+    if (!(axis->max >= axis->min)) return false;
+    return mode != SCAN_GRID || axis->points > 0;
+}
+
+int parameter_scan_init(ParameterScan *scan, const ScanSpec *spec) {
+    memset(scan, 0, sizeof(*scan));
+    if (spec->num_axes > SCAN_MAX_AXES) return -1;
+    if (!(spec->dt > 0.0f) || !(spec->duration >= spec->dt)) return -1;
+    if (spec->mode != SCAN_GRID && spec->mode != SCAN_LATIN_HYPERCUBE) return -1;
+    for (uint32_t a = 0; a < spec->num_axes; a++) {
+        if (!axis_valid(&spec->axes[a], spec->mode)) return -1;
+    }
+
+    uint64_t count = 1;
+    if (spec->mode == SCAN_GRID) {
+        for (uint32_t a = 0; a < spec->num_axes; a++) {
+            if (count > UINT64_MAX / spec->axes[a].points) return -1;
+            count *= spec->axes[a].points;
+        }
+    } else {
+        if (spec->samples == 0) return -1;
+        count = spec->samples;
+    }
+    scan->spec = *spec;
+    scan->shot_count = count;
+    scan->steps_per_shot = (uint32_t)(spec->duration / spec->dt + 0.5f);
+
+    if (spec->mode == SCAN_LATIN_HYPERCUBE && spec->num_axes > 0) {
+        uint32_t n = spec->samples;
+        scan->strata = malloc((size_t)spec->num_axes * n * sizeof(uint32_t));
+        if (!scan->strata) return -1;
+        // One Fisher-Yates permutation of the strata per axis
+        for (uint32_t a = 0; a < spec->num_axes; a++) {
+            uint32_t *perm = scan->strata + (size_t)a * n;
+            PlasmaRng rng;
+            plasma_rng_seed(&rng, spec->seed ^ SCAN_STRATA_SEED_SALT, a);
+            for (uint32_t i = 0; i < n; i++) perm[i] = i;
+            for (uint32_t i = n - 1; i > 0; i--) {
+                uint32_t j = (uint32_t)(((uint64_t)plasma_rng_next(&rng) * (i + 1)) >> 32);
+                uint32_t t = perm[i];
+                perm[i] = perm[j];
+                perm[j] = t;
+            }
+        }
+    }
+    return 0;
+}
+
+void parameter_scan_free(ParameterScan *scan) {
+    free(scan->strata);
+    memset(scan, 0, sizeof(*scan));
+}
+
+void parameter_scan_point(const ParameterScan *scan, uint64_t shot, float *values) {
+    const ScanSpec *spec = &scan->spec;
+    if (spec->mode == SCAN_GRID) {
+        uint64_t rest = shot;
+        for (uint32_t a = 0; a < spec->num_axes; a++) {
+            const ScanAxis *axis = &spec->axes[a];
+            uint32_t k = (uint32_t)(rest % axis->points);
+            rest /= axis->points;
+            float u = axis->points > 1 ? (float)k / (float)(axis->points - 1) : 0.0f;
+            values[a] = axis->min + (axis->max - axis->min) * u;
+        }
+        return;
+    }
+    PlasmaRng rng;
+    plasma_rng_seed(&rng, spec->seed ^ SCAN_JITTER_SEED_SALT, shot);
+    for (uint32_t a = 0; a < spec->num_axes; a++) {
+        const ScanAxis *axis = &spec->axes[a];
+        uint32_t stratum = scan->strata[(size_t)a * spec->samples + shot];
+        float u = ((float)stratum + plasma_rng_uniform(&rng)) / (float)spec->samples;
+        values[a] = axis->min + (axis->max - axis->min) * u;
+    }
+}
+
+void parameter_scan_prepare(const ParameterScan *scan, const PlasmaControlSystem *base,
+                            uint64_t shot, PlasmaControlSystem *control) {
+    float values[SCAN_MAX_AXES];
+    parameter_scan_point(scan, shot, values);
+    *control = *base;
+    control->history = NULL;
+    plasma_rng_seed(&control->rng, scan->spec.seed, shot);
+    PlasmaState *s = &control->current_state;
+    for (uint32_t a = 0; a < scan->spec.num_axes; a++) {
+        const ScanAxis *axis = &scan->spec.axes[a];
+        float v = values[a];
+        switch (axis->parameter) {
+        case SCAN_FUEL_INJECTION_RATE: control->fuel_injection_rate = v; break;
+        case SCAN_HEATING_POWER:
+            control->heating_systems[axis->index].power = v;
+            control->heating_systems[axis->index].enabled = true;
+            break;
+        case SCAN_PF_COIL_CURRENT: control->pf_coil_currents[axis->index] = v; break;
+        case SCAN_ENERGY_CONFINEMENT_TIME: control->energy_confinement_time = v; break;
+        case SCAN_STORED_ENERGY: control->stored_energy = v; break;
+        case SCAN_PLASMA_CURRENT: s->plasma_current = v; break;
+        case SCAN_DENSITY_CORE: s->density_core = v; break;
+        case SCAN_ELONGATION: s->elongation = v; break;
+        case SCAN_VERTICAL_POSITION: s->vertical_position = v; break;
+        case SCAN_IMPURITY_CONCENTRATION: s->impurity_concentration = v; break;
+        default: break;
+        }
+    }
+}
+
+typedef struct {
+    const ParameterScan *scan;
+    const PlasmaControlSystem *base;
+    FILE *out;
+    _Atomic uint64_t next_shot;
+    atomic_bool failed;
+} ScanShared;
+
+typedef struct {
+    ScanShared *shared;
+    PlasmaBatch batch;
+    uint64_t shot[SCAN_BATCH_LANES];
+    uint32_t steps[SCAN_BATCH_LANES];
+    float max_vde[SCAN_BATCH_LANES];
+    uint64_t claim_next;
+    uint64_t claim_end;
+    char *rows;
+    size_t row_bytes;
+    ScanStats stats;
+} ScanWorker;
+
+static bool claim_shot(ScanWorker *w, uint64_t *shot) {
+    if (w->claim_next == w->claim_end) {
+        uint64_t total = w->shared->scan->shot_count;
+        uint64_t begin = atomic_fetch_add_explicit(&w->shared->next_shot,
+                                                   SCAN_CLAIM_CHUNK,
+                                                   memory_order_relaxed);
+        if (begin >= total) return false;
+        w->claim_next = begin;
+        w->claim_end = begin + SCAN_CLAIM_CHUNK < total ? begin + SCAN_CLAIM_CHUNK : total;
+    }
+    *shot = w->claim_next++;
+    return true;
+}
+
+static void start_shot(ScanWorker *w, uint32_t lane, uint64_t shot) {
+    PlasmaControlSystem control;
+    parameter_scan_prepare(w->shared->scan, w->shared->base, shot, &control);
+    plasma_batch_load(&w->batch, lane, &control.current_state, &control);
+    w->shot[lane] = shot;
+    w->steps[lane] = 0;
+    w->max_vde[lane] = fabsf(control.current_state.vertical_position);
+}
+
+// Moves the shot in lane `from` to lane `to`. The batch stores only the
+// evolving fields back, so the actuators are rebuilt from the spec.
+static void move_shot(ScanWorker *w, uint32_t to, uint32_t from) {
+    PlasmaControlSystem control;
+    parameter_scan_prepare(w->shared->scan, w->shared->base, w->shot[from], &control);
+    plasma_batch_store(&w->batch, from, &control.current_state, &control);
+    control.simulation_time = w->batch.simulation_time[from];
+    plasma_batch_load(&w->batch, to, &control.current_state, &control);
+    w->shot[to] = w->shot[from];
+    w->steps[to] = w->steps[from];
+    w->max_vde[to] = w->max_vde[from];
+}
+
+static void flush_rows(ScanWorker *w) {
+    if (w->row_bytes > 0) {
+        fwrite(w->rows, 1, w->row_bytes, w->shared->out);
+        w->row_bytes = 0;
+    }
+}
+
+static void finish_shot(ScanWorker *w, uint32_t lane, ScanLimit limit) {
+    const ParameterScan *scan = w->shared->scan;
+    const PlasmaBatch *b = &w->batch;
+    float values[SCAN_MAX_AXES];
+    parameter_scan_point(scan, w->shot[lane], values);
+
+    if (SCAN_FLUSH_BYTES - w->row_bytes < SCAN_ROW_MAX) flush_rows(w);
+    char *row = w->rows + w->row_bytes;
+    size_t room = SCAN_FLUSH_BYTES - w->row_bytes;
+    int n = snprintf(row, room, "%llu", (unsigned long long)w->shot[lane]);
+    for (uint32_t a = 0; a < scan->spec.num_axes; a++) {
+        n += snprintf(row + n, room - n, ",%.9g", values[a]);
+    }
+    float time_to_limit = limit == SCAN_LIMIT_NONE ? NAN :
+                          (float)w->steps[lane] * scan->spec.dt;
+    n += snprintf(row + n, room - n, ",%s,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n",
+                  scan_limit_name(limit), time_to_limit, w->max_vde[lane],
+                  b->stored_energy[lane], b->plasma_current[lane],
+                  b->safety_factor_q95[lane], b->beta_normalized[lane]);
+    w->row_bytes += (size_t)n;
+
+    w->stats.shots++;
+    w->stats.limited[limit]++;
+    w->stats.steps += w->steps[lane];
+}
+
+static ScanLimit lane_limit(const PlasmaBatch *b, uint32_t i) {
+    float z = b->vertical_position[i];
+    if (!isfinite(b->plasma_current[i]) || !isfinite(b->stored_energy[i]) ||
+        !isfinite(z)) {
+        return SCAN_LIMIT_NONFINITE;
+    }
+    if (b->safety_factor_q95[i] < SAFETY_FACTOR_Q95_MIN) return SCAN_LIMIT_Q95;
+    if (b->beta_normalized[i] > BETA_NORMAL_LIMIT) return SCAN_LIMIT_BETA_N;
+    if (fabsf(z) > VERTICAL_DISPLACEMENT_MAX) return SCAN_LIMIT_VERTICAL;
+    return SCAN_LIMIT_NONE;
+}
+
+static void scan_worker(ScanShared *shared, ScanStats *stats) {
+    ScanWorker *w = calloc(1, sizeof(*w));
+    char *rows = malloc(SCAN_FLUSH_BYTES);
+    if (!w || !rows || plasma_batch_init(&w->batch, SCAN_BATCH_LANES) != 0) {
+        atomic_store(&shared->failed, true);
+        free(rows);
+        free(w);
+        return;
+    }
+    w->shared = shared;
+    w->rows = rows;
+    const float dt = shared->scan->spec.dt;
+    const uint32_t steps_per_shot = shared->scan->steps_per_shot;
+
+    uint32_t count = 0;
+    uint64_t shot;
+    while (count < SCAN_BATCH_LANES && claim_shot(w, &shot)) {
+        start_shot(w, count++, shot);
+    }
+    PlasmaBatch *b = &w->batch;
+    while (count > 0) {
+        b->count = count;
+        advance_plasma_batch(b, dt);
+        for (uint32_t i = 0; i < count; i++) b->simulation_time[i] += dt;
+
+        for (uint32_t i = 0; i < count; i++) {
+            w->steps[i]++;
+            float vde = fabsf(b->vertical_position[i]);
+            if (vde > w->max_vde[i]) w->max_vde[i] = vde;
+            ScanLimit limit = lane_limit(b, i);
+            if (limit == SCAN_LIMIT_NONE && w->steps[i] < steps_per_shot) continue;
+
+            finish_shot(w, i, limit);
+            if (claim_shot(w, &shot)) {
+                start_shot(w, i, shot);
+            } else if (i < --count) {
+                // Last lane moves into the hole and is checked this pass
+                move_shot(w, i, count);
+                i--;
+            }
+        }
+    }
+    flush_rows(w);
+    *stats = w->stats;
+    plasma_batch_free(&w->batch);
+    free(rows);
+    free(w);
+}
+
+int parameter_scan_run(const ParameterScan *scan, const PlasmaControlSystem *base,
+                       FILE *out, ScanStats *stats) {
+    fprintf(out, "shot");
+    for (uint32_t a = 0; a < scan->spec.num_axes; a++) {
+        const ScanAxis *axis = &scan->spec.axes[a];
+        if (axis->parameter == SCAN_HEATING_POWER ||
+            axis->parameter == SCAN_PF_COIL_CURRENT) {
+            fprintf(out, ",%s_%u", scan_parameter_name(axis->parameter), axis->index);
+        } else {
+            fprintf(out, ",%s", scan_parameter_name(axis->parameter));
+        }
+    }
+    fprintf(out, ",limit,time_to_limit,max_vde,final_W,final_Ip,final_q95,final_beta_N\n");
+
+    ScanShared shared = { .scan = scan, .base = base, .out = out };
+    atomic_init(&shared.next_shot, 0);
+    atomic_init(&shared.failed, false);
+
+    int num_threads = scan->spec.num_threads;
+#ifdef _OPENMP
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+#else
+    num_threads = 1;
+#endif
+    ScanStats *thread_stats = calloc((size_t)num_threads, sizeof(ScanStats));
+    if (!thread_stats) return -1;
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads) if(num_threads > 1)
+    scan_worker(&shared, &thread_stats[omp_get_thread_num()]);
+#else
+    scan_worker(&shared, &thread_stats[0]);
+#endif
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        for (int t = 0; t < num_threads; t++) {
+            stats->shots += thread_stats[t].shots;
+            stats->steps += thread_stats[t].steps;
+            for (int l = 0; l < SCAN_LIMIT_COUNT; l++) {
+                stats->limited[l] += thread_stats[t].limited[l];
+            }
+        }
+    }
+    free(thread_stats);
+    fflush(out);
+    return atomic_load(&shared.failed) ? -1 : 0;
+}
@@ -0,0 +1,129 @@
+#ifndef PARAMETER_SCAN_H
+#define PARAMETER_SCAN_H
+
+#include "npe_config.h"
+#include <stdio.h>
+
+// ================= PARAMETER-SCAN ENGINE =================
+// Maps the operating space by running many open-loop shots from one base
+// PlasmaControlSystem. Each axis overrides an actuator setting or an
+// initial PlasmaState field. A shot runs for `duration` at fixed `dt` and
+// ends early at its first operating limit:
+//   q95 < SAFETY_FACTOR_Q95_MIN, beta_N > BETA_NORMAL_LIMIT,
+//   |z| > VERTICAL_DISPLACEMENT_MAX, or a non-finite Ip, W or z.
+//
+// Points come from a full grid (axis 0 varies fastest) or a Latin
+// hypercube of `samples` points. In the hypercube, every axis is cut into
+// `samples` strata, each stratum is used exactly once, and the point is
+// jittered uniformly within its stratum. Shot k's point and its MHD noise
+// stream, (seed, k), depend only on the spec. A scan therefore reproduces
+// bit for bit whatever the thread count or completion order.
+//
+// Shots run SCAN_BATCH_LANES at a time through advance_plasma_batch().
+// Each worker claims SCAN_CLAIM_CHUNK shot indices at a time from a shared
+// atomic counter. When a shot ends, its lane is refilled at once, so
+// short (limited) and long shots balance across threads without a
+// separate stealing pass. Once no shots are left, lanes are compacted
+// so the batch only steps live shots.
+//
+// Summaries stream to `out` as CSV rows in completion order. Sort by the
+// shot column for index order. Rows are staged in SCAN_FLUSH_BYTES
+// per-thread buffers and written with one fwrite() each.
+//
+// With -fopenmp, num_threads workers run (num_threads <= 0 uses the
+// OpenMP default); without OpenMP the scan is serial. Build with -O3
+// -fno-math-errno -fno-trapping-math, as for plasma_batch.c.
+
+#define SCAN_MAX_AXES 8
+#define SCAN_BATCH_LANES 64
+#define SCAN_CLAIM_CHUNK 16
+#define SCAN_FLUSH_BYTES 65536
+#define SCAN_ROW_MAX 512
+
+typedef enum {
+    SCAN_FUEL_INJECTION_RATE,
+    SCAN_HEATING_POWER,             // MW of heating_systems[index], enables it
+    SCAN_PF_COIL_CURRENT,           // pf_coil_currents[index]
+    SCAN_ENERGY_CONFINEMENT_TIME,
+    SCAN_STORED_ENERGY,             // initial W, MJ
+    SCAN_PLASMA_CURRENT,            // initial PlasmaState fields from here on
+    SCAN_DENSITY_CORE,
+    SCAN_ELONGATION,
+    SCAN_VERTICAL_POSITION,
+    SCAN_IMPURITY_CONCENTRATION,
+    SCAN_PARAMETER_COUNT
+} ScanParameter;
+
+typedef enum {
+    SCAN_GRID,
+    SCAN_LATIN_HYPERCUBE
+} ScanMode;
+
+typedef enum {
+    SCAN_LIMIT_NONE,
+    SCAN_LIMIT_NONFINITE,
+    SCAN_LIMIT_Q95,
+    SCAN_LIMIT_BETA_N,
+    SCAN_LIMIT_VERTICAL,
+    SCAN_LIMIT_COUNT
+} ScanLimit;
+
+typedef struct {
+    ScanParameter parameter;
+    uint32_t index;                 // coil or heating system, array parameters only
+    float min;
+    float max;
+    uint32_t points;                // grid only; 1 pins the axis at min
+} ScanAxis;
+
+typedef struct {
+    ScanMode mode;
+    uint32_t num_axes;
+    ScanAxis axes[SCAN_MAX_AXES];
+    uint32_t samples;               // Latin hypercube only
+    uint64_t seed;
+    float dt;                       // s
+    float duration;                 // s per shot
+    int num_threads;
+} ScanSpec;
+
+typedef struct {
+    uint64_t shots;
+    uint64_t limited[SCAN_LIMIT_COUNT];   // shots ending at each limit
+    uint64_t steps;
+} ScanStats;
+
+typedef struct {
+    ScanSpec spec;
+    uint64_t shot_count;
+    uint32_t steps_per_shot;
+    uint32_t *strata;               // Latin hypercube, [axis][shot]
+} ParameterScan;
+
+// Validates the spec and, for a Latin hypercube, draws the strata.
+// Returns -1 on an empty or invalid spec (bad axis index, dt <= 0, ...)
+// or a failed allocation.
+int parameter_scan_init(ParameterScan *scan, const ScanSpec *spec);
+void parameter_scan_free(ParameterScan *scan);
+
+const char *scan_parameter_name(ScanParameter parameter);
+const char *scan_limit_name(ScanLimit limit);
+
+// Axis values of shot `shot`, one per axis
+void parameter_scan_point(const ParameterScan *scan, uint64_t shot, float *values);
+
+// Initial state and actuators of shot `shot`: the base with its axes
+// applied and the shot's noise stream, (seed, shot)
+void parameter_scan_prepare(const ParameterScan *scan, const PlasmaControlSystem *base,
+                            uint64_t shot, PlasmaControlSystem *control);
+
+// Runs every shot from `base` (current_state and actuator settings) and
+// writes a CSV header plus one row per shot to `out`:
+//   shot, <axes>, limit, time_to_limit, max_vde, final_W, final_Ip,
+//   final_q95, final_beta_N
+// time_to_limit is nan for shots that reach `duration`. stats may be NULL.
+// Returns 0, or -1 if a worker could not allocate its batch.
+int parameter_scan_run(const ParameterScan *scan, const PlasmaControlSystem *base,
+                       FILE *out, ScanStats *stats);
+
+#endif // PARAMETER_SCAN_H
@@ -0,0 +1,138 @@
+#include "plasma_abi.h"
+#include "plasma_physics.h"
+#include <stddef.h>
+
+#define FIELD(type, member) \
+    { #member, (uint32_t)offsetof(type, member), (uint32_t)sizeof(((type *)0)->member) }
+
+static const PlasmaAbiField state_fields[] = {
+    FIELD(PlasmaState, plasma_current),
+    FIELD(PlasmaState, safety_factor_q95),
+    FIELD(PlasmaState, beta_normalized),
+    FIELD(PlasmaState, li_inductance),
+    FIELD(PlasmaState, radial_position),
+    FIELD(PlasmaState, vertical_position),
+    FIELD(PlasmaState, elongation),
+    FIELD(PlasmaState, triangularity),
+    FIELD(PlasmaState, temperature_core),
+    FIELD(PlasmaState, temperature_edge),
+    FIELD(PlasmaState, density_core),
+    FIELD(PlasmaState, density_edge),
+    FIELD(PlasmaState, mhd_activity_level),
+    FIELD(PlasmaState, ntm_amplitude),
+    FIELD(PlasmaState, elm_frequency),
+    FIELD(PlasmaState, neutron_rate),
+    FIELD(PlasmaState, impurity_concentration),
+    FIELD(PlasmaState, radiation_power),
+};
+
+static const PlasmaAbiField control_fields[] = {
+    FIELD(PlasmaControlSystem, current_state),
+    FIELD(PlasmaControlSystem, target_state),
+    FIELD(PlasmaControlSystem, pf_coil_currents),
+    FIELD(PlasmaControlSystem, vertical_coil_currents),
+    FIELD(PlasmaControlSystem, horizontal_coil_currents),
+    FIELD(PlasmaControlSystem, heating_systems),
+    FIELD(PlasmaControlSystem, fuel_injection_rate),
+    FIELD(PlasmaControlSystem, impurity_injection_rate),
+    FIELD(PlasmaControlSystem, controller_state),
+    FIELD(PlasmaControlSystem, simulation_time),
+    FIELD(PlasmaControlSystem, iteration_count),
+    FIELD(PlasmaControlSystem, history),
+    FIELD(PlasmaControlSystem, rng),
+    FIELD(PlasmaControlSystem, disruption_detected),
+    FIELD(PlasmaControlSystem, mitigation_activated),
+    FIELD(PlasmaControlSystem, disruption_warning_time),
+    FIELD(PlasmaControlSystem, energy_confinement_time),
+    FIELD(PlasmaControlSystem, fusion_gain_Q),
+    FIELD(PlasmaControlSystem, stored_energy),
+};
+
+static const PlasmaAbiField diagnostics_fields[] = {
+    FIELD(DiagnosticsSystem, interferometer_density),
+    FIELD(DiagnosticsSystem, thomson_scattering_temp),
+    FIELD(DiagnosticsSystem, bolometer_channels),
+    FIELD(DiagnosticsSystem, magnetics_probes),
+    FIELD(DiagnosticsSystem, soft_xray_array),
+    FIELD(DiagnosticsSystem, neutron_cameras),
+    FIELD(DiagnosticsSystem, spectroscopy_lines),
+    FIELD(DiagnosticsSystem, mhd_spectrum),
+    FIELD(DiagnosticsSystem, coherence_analysis),
+    FIELD(DiagnosticsSystem, system_ok),
+    FIELD(DiagnosticsSystem, data_acquisition_rate),
+};
+
+static const PlasmaAbiField batch_fields[] = {
+    FIELD(PlasmaBatch, count),
+    FIELD(PlasmaBatch, capacity),
+    FIELD(PlasmaBatch, plasma_current),
+    FIELD(PlasmaBatch, safety_factor_q95),
+    FIELD(PlasmaBatch, beta_normalized),
+    FIELD(PlasmaBatch, li_inductance),
+    FIELD(PlasmaBatch, radial_position),
+    FIELD(PlasmaBatch, vertical_position),
+    FIELD(PlasmaBatch, elongation),
+    FIELD(PlasmaBatch, triangularity),
+    FIELD(PlasmaBatch, temperature_core),
+    FIELD(PlasmaBatch, temperature_edge),
+    FIELD(PlasmaBatch, density_core),
+    FIELD(PlasmaBatch, density_edge),
+    FIELD(PlasmaBatch, mhd_activity_level),
+    FIELD(PlasmaBatch, ntm_amplitude),
+    FIELD(PlasmaBatch, elm_frequency),
+    FIELD(PlasmaBatch, neutron_rate),
+    FIELD(PlasmaBatch, impurity_concentration),
+    FIELD(PlasmaBatch, radiation_power),
+    FIELD(PlasmaBatch, pf_coil_currents),
+    FIELD(PlasmaBatch, vertical_coil_currents),
+    FIELD(PlasmaBatch, heating_power),
+    FIELD(PlasmaBatch, fuel_injection_rate),
+    FIELD(PlasmaBatch, energy_confinement_time),
+    FIELD(PlasmaBatch, simulation_time),
+    FIELD(PlasmaBatch, stored_energy),
+    FIELD(PlasmaBatch, rng_state),
+    FIELD(PlasmaBatch, mhd_drive),
+    FIELD(PlasmaBatch, block),
+};
+
+#define LAYOUT(fields, type) { fields, sizeof(fields) / sizeof(fields[0]), sizeof(type) }
+
+static const struct {
+    const PlasmaAbiField *fields;
+    uint32_t count;
+    uint32_t size;
+} layouts[PLASMA_ABI_STRUCT_COUNT] = {
+    [PLASMA_ABI_STATE] = LAYOUT(state_fields, PlasmaState),
+    [PLASMA_ABI_CONTROL] = LAYOUT(control_fields, PlasmaControlSystem),
+    [PLASMA_ABI_DIAGNOSTICS] = LAYOUT(diagnostics_fields, DiagnosticsSystem),
+    [PLASMA_ABI_BATCH] = LAYOUT(batch_fields, PlasmaBatch),
+};
+
+uint32_t plasma_abi_version(void) {
+    return PLASMA_ABI_VERSION;
+}
+
+const PlasmaAbiField *plasma_abi_layout(PlasmaAbiStruct which, uint32_t *count,
+                                        uint32_t *struct_size) {
+    if ((unsigned)which >= PLASMA_ABI_STRUCT_COUNT) return NULL;
+    *count = layouts[which].count;
+    *struct_size = layouts[which].size;
+    return layouts[which].fields;
+}
+
+void plasma_abi_run(PlasmaState *state, PlasmaControlSystem *control,
+                    float dt, uint32_t steps) {
+    for (uint32_t k = 0; k < steps; k++) {
+        advance_plasma_state(state, control, dt);
+        control->simulation_time += dt;
+    }
+}
+
+void plasma_abi_run_batch(PlasmaBatch *batch, float dt, uint32_t steps) {
+    const uint32_t n = batch->count;
+    float *restrict time = batch->simulation_time;
+    for (uint32_t k = 0; k < steps; k++) {
+        advance_plasma_batch(batch, dt);
+        for (uint32_t i = 0; i < n; i++) time[i] += dt;
+    }
+}
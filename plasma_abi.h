@@ -0,0 +1,54 @@
+#ifndef PLASMA_ABI_H
+#define PLASMA_ABI_H
+
+#include "npe_config.h"
+#include "plasma_batch.h"
+
+// ================= FOREIGN-CALLER ABI =================
+// Entry points for bindings that drive the C core through the plain C ABI
+// (ia/plasma_core.py, over ctypes). Structs are shared by pointer and
+// never copied: the binding allocates PlasmaState, PlasmaControlSystem and
+// DiagnosticsSystem in its own memory with the same layout, and maps
+// numpy arrays straight onto them and onto the PlasmaBatch arrays.
+//
+// The layout tables give offset and size of every field as compiled, so a
+// binding can check its struct mirrors field by field when it loads the
+// library; a change to npe_config.h then fails at import instead of
+// reading shifted memory. Bump PLASMA_ABI_VERSION when an entry point
+// changes.
+//
+// The *_run() calls loop in C and hold no foreign-runtime lock, so a
+// long batch run does not block other Python threads (ctypes releases
+// the GIL around every call into a CDLL).
+
+#define PLASMA_ABI_VERSION 1
+
+typedef enum {
+    PLASMA_ABI_STATE,
+    PLASMA_ABI_CONTROL,
+    PLASMA_ABI_DIAGNOSTICS,
+    PLASMA_ABI_BATCH,
+    PLASMA_ABI_STRUCT_COUNT
+} PlasmaAbiStruct;
+
+typedef struct {
+    const char *name;
+    uint32_t offset;
+    uint32_t size;
+} PlasmaAbiField;
+
+uint32_t plasma_abi_version(void);
+
+// Field table of a struct in declaration order; NULL for an unknown struct
+const PlasmaAbiField *plasma_abi_layout(PlasmaAbiStruct which, uint32_t *count,
+                                        uint32_t *struct_size);
+
+// steps calls of advance_plasma_state(), advancing control->simulation_time
+// by dt after each, as the control loop does
+void plasma_abi_run(PlasmaState *state, PlasmaControlSystem *control,
+                    float dt, uint32_t steps);
+
+// The same over every shot of a batch
+void plasma_abi_run_batch(PlasmaBatch *batch, float dt, uint32_t steps);
+
+#endif // PLASMA_ABI_H
@@ -0,0 +1,211 @@
+#include "plasma_batch.h"
+#include "machine_geometry.h"
+#include "plasma_physics.h"
+#include "plasma_rng.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define PLASMA_BATCH_STATE_ARRAYS 18
+#define PLASMA_BATCH_CONTROL_ARRAYS (NUM_PF_COILS + NUM_VERTICAL_COILS + \
+                                     NUM_HEATING_SYSTEMS + 4)
+#define PLASMA_BATCH_RNG_ARRAYS 4
+#define PLASMA_BATCH_ARRAYS (PLASMA_BATCH_STATE_ARRAYS + \
+                             PLASMA_BATCH_CONTROL_ARRAYS + \
+                             PLASMA_BATCH_RNG_ARRAYS + 1)
+
+int plasma_batch_init(PlasmaBatch *batch, uint32_t capacity) {
+    memset(batch, 0, sizeof(*batch));
+    uint32_t lanes = PLASMA_BATCH_ALIGN / sizeof(float);
+    uint32_t stride = (capacity + lanes - 1) / lanes * lanes;
+    if (stride == 0) stride = lanes;
+
+    // RNG words share the float stride (both are 32-bit)
+    size_t bytes = (size_t)stride * sizeof(float) * PLASMA_BATCH_ARRAYS;
+    float *block = aligned_alloc(PLASMA_BATCH_ALIGN, bytes);
+    if (!block) return -1;
+    memset(block, 0, bytes);
+
+    float **arrays[PLASMA_BATCH_ARRAYS];
+    int n = 0;
+    arrays[n++] = &batch->plasma_current;
+    arrays[n++] = &batch->safety_factor_q95;
+    arrays[n++] = &batch->beta_normalized;
+    arrays[n++] = &batch->li_inductance;
+    arrays[n++] = &batch->radial_position;
+    arrays[n++] = &batch->vertical_position;
+    arrays[n++] = &batch->elongation;
+    arrays[n++] = &batch->triangularity;
+    arrays[n++] = &batch->temperature_core;
+    arrays[n++] = &batch->temperature_edge;
+    arrays[n++] = &batch->density_core;
+    arrays[n++] = &batch->density_edge;
+    arrays[n++] = &batch->mhd_activity_level;
+    arrays[n++] = &batch->ntm_amplitude;
+    arrays[n++] = &batch->elm_frequency;
+    arrays[n++] = &batch->neutron_rate;
+    arrays[n++] = &batch->impurity_concentration;
+    arrays[n++] = &batch->radiation_power;
+    for (int c = 0; c < NUM_PF_COILS; c++) arrays[n++] = &batch->pf_coil_currents[c];
+    for (int c = 0; c < NUM_VERTICAL_COILS; c++) arrays[n++] = &batch->vertical_coil_currents[c];
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) arrays[n++] = &batch->heating_power[h];
+    arrays[n++] = &batch->fuel_injection_rate;
+    arrays[n++] = &batch->energy_confinement_time;
+    arrays[n++] = &batch->simulation_time;
+    arrays[n++] = &batch->stored_energy;
+    arrays[n++] = &batch->mhd_drive;
+
+    for (int k = 0; k < n; k++) {
+        *arrays[k] = block + (size_t)k * stride;
+    }
+    for (int w = 0; w < PLASMA_BATCH_RNG_ARRAYS; w++) {
+        batch->rng_state[w] = (uint32_t *)(block + (size_t)(n + w) * stride);
+    }
+    batch->block = block;
+    batch->capacity = stride;
+    batch->count = capacity;
+    return 0;
+}
+
+void plasma_batch_free(PlasmaBatch *batch) {
+    free(batch->block);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void plasma_batch_load(PlasmaBatch *batch, uint32_t shot,
+                       const PlasmaState *state,
+                       const PlasmaControlSystem *control) {
+    batch->plasma_current[shot] = state->plasma_current;
+    batch->safety_factor_q95[shot] = state->safety_factor_q95;
+    batch->beta_normalized[shot] = state->beta_normalized;
+    batch->li_inductance[shot] = state->li_inductance;
+    batch->radial_position[shot] = state->radial_position;
+    batch->vertical_position[shot] = state->vertical_position;
+    batch->elongation[shot] = state->elongation;
+    batch->triangularity[shot] = state->triangularity;
+    batch->temperature_core[shot] = state->temperature_core;
+    batch->temperature_edge[shot] = state->temperature_edge;
+    batch->density_core[shot] = state->density_core;
+    batch->density_edge[shot] = state->density_edge;
+    batch->mhd_activity_level[shot] = state->mhd_activity_level;
+    batch->ntm_amplitude[shot] = state->ntm_amplitude;
+    batch->elm_frequency[shot] = state->elm_frequency;
+    batch->neutron_rate[shot] = state->neutron_rate;
+    batch->impurity_concentration[shot] = state->impurity_concentration;
+    batch->radiation_power[shot] = state->radiation_power;
+
+    for (int c = 0; c < NUM_PF_COILS; c++) {
+        batch->pf_coil_currents[c][shot] = control->pf_coil_currents[c];
+    }
+    for (int c = 0; c < NUM_VERTICAL_COILS; c++) {
+        batch->vertical_coil_currents[c][shot] = control->vertical_coil_currents[c];
+    }
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        batch->heating_power[h][shot] = control->heating_systems[h].enabled ?
+                                        control->heating_systems[h].power : 0.0f;
+    }
+    batch->fuel_injection_rate[shot] = control->fuel_injection_rate;
+    batch->energy_confinement_time[shot] = control->energy_confinement_time;
+    batch->simulation_time[shot] = control->simulation_time;
+    batch->stored_energy[shot] = control->stored_energy;
+    for (int w = 0; w < PLASMA_BATCH_RNG_ARRAYS; w++) {
+        batch->rng_state[w][shot] = control->rng.s[w];
+    }
+}
+
+void plasma_batch_store(const PlasmaBatch *batch, uint32_t shot,
+                        PlasmaState *state, PlasmaControlSystem *control) {
+    state->plasma_current = batch->plasma_current[shot];
+    state->safety_factor_q95 = batch->safety_factor_q95[shot];
+    state->beta_normalized = batch->beta_normalized[shot];
+    state->li_inductance = batch->li_inductance[shot];
+    state->radial_position = batch->radial_position[shot];
+    state->vertical_position = batch->vertical_position[shot];
+    state->elongation = batch->elongation[shot];
+    state->triangularity = batch->triangularity[shot];
+    state->temperature_core = batch->temperature_core[shot];
+    state->temperature_edge = batch->temperature_edge[shot];
+    state->density_core = batch->density_core[shot];
+    state->density_edge = batch->density_edge[shot];
+    state->mhd_activity_level = batch->mhd_activity_level[shot];
+    state->ntm_amplitude = batch->ntm_amplitude[shot];
+    state->elm_frequency = batch->elm_frequency[shot];
+    state->neutron_rate = batch->neutron_rate[shot];
+    state->impurity_concentration = batch->impurity_concentration[shot];
+    state->radiation_power = batch->radiation_power[shot];
+    if (control) {
+        control->stored_energy = batch->stored_energy[shot];
+        for (int w = 0; w < PLASMA_BATCH_RNG_ARRAYS; w++) {
+            control->rng.s[w] = batch->rng_state[w][shot];
+        }
+    }
+}
+
+void advance_plasma_batch(PlasmaBatch *batch, float dt) {
+    const uint32_t n = batch->count;
+
+    float *restrict Ip = batch->plasma_current;
+    float *restrict q95 = batch->safety_factor_q95;
+    float *restrict beta_N = batch->beta_normalized;
+    float *restrict z = batch->vertical_position;
+    const float *restrict kappa = batch->elongation;
+    float *restrict Te = batch->temperature_core;
+    float *restrict ne = batch->density_core;
+    float *restrict mhd = batch->mhd_activity_level;
+    const float *restrict pf0 = batch->pf_coil_currents[0];
+    const float *restrict fuel = batch->fuel_injection_rate;
+    const float *restrict tau_E = batch->energy_confinement_time;
+    float *restrict W = batch->stored_energy;
+    const float *restrict drive = batch->mhd_drive;
+    const float *restrict P_h[NUM_HEATING_SYSTEMS];
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) P_h[h] = batch->heating_power[h];
+    const float *restrict I_vc[NUM_VERTICAL_COILS];
+    for (int c = 0; c < NUM_VERTICAL_COILS; c++) I_vc[c] = batch->vertical_coil_currents[c];
+
+    // MHD drive: one draw from each shot's own stream, then the sinf term
+    plasma_rng_fill_lanes(batch->rng_state[0], batch->rng_state[1],
+                          batch->rng_state[2], batch->rng_state[3],
+                          batch->mhd_drive, n);
+    for (uint32_t i = 0; i < n; i++) {
+        batch->mhd_drive[i] = 0.1f * sinf(batch->simulation_time[i] * 100.0f) +
+                              0.05f * batch->mhd_drive[i];
+    }
+
+    // Every array is a disjoint slice of batch->block.
+#pragma GCC ivdep
+    for (uint32_t i = 0; i < n; i++) {
+        // Block updates, on the plasma_physics.h kernels
+        Ip[i] = plasma_current_step(pf0[i], Ip[i], dt);
+
+        float P_heating = 0.0f;
+        for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+            P_heating += P_h[h][i];
+        }
+        W[i] = plasma_energy_step(W[i], P_heating, tau_E[i], dt);
+
+        float plasma_volume = machine_plasma_volume(&machine_default, kappa[i]);
+        Te[i] = plasma_core_temperature(W[i], ne[i], plasma_volume);
+        ne[i] = plasma_density_step(fuel[i], ne[i], plasma_volume, dt);
+
+        float mass_plasma = plasma_mass(ne[i], plasma_volume);
+        float F_vertical = 0.0f;
+        for (int c = 0; c < NUM_VERTICAL_COILS; c++) {
+            F_vertical += plasma_vertical_force(I_vc[c][i], Ip[i]);
+        }
+        z[i] = plasma_position_step(z[i], F_vertical, mass_plasma, dt);
+
+        // Stability updates
+        q95[i] = machine_safety_factor(&machine_default, 0.95f, Ip[i]);
+        beta_N[i] = machine_beta_normalized(&machine_default, Ip[i], ne[i], Te[i]);
+        float activity = drive[i];
+
+        // Disruption conditions. Each increment is computed unconditionally
+        // and selected, so the loop if-converts without changing rounding.
+        float bumped = activity + 0.5f;
+        activity = q95[i] < SAFETY_FACTOR_Q95_MIN ? bumped : activity;
+        bumped = activity + 0.3f;
+        activity = beta_N[i] > BETA_NORMAL_LIMIT ? bumped : activity;
+        bumped = activity + 0.7f;
+        activity = fabsf(z[i]) > VERTICAL_DISPLACEMENT_MAX ? bumped : activity;
+        mhd[i] = activity;
+    }
+}
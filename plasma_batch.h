@@ -0,0 +1,72 @@
+#ifndef PLASMA_BATCH_H
+#define PLASMA_BATCH_H
+
+#include "npe_config.h"
+
+// ================= BATCHED ENSEMBLE STEPPER =================
+// Structure-of-arrays view of N independent shots. Every PlasmaState field
+// gets its own array, plus the per-shot PlasmaControlSystem quantities that
+// advance_plasma_state() reads or writes, including each shot's RNG
+// stream. advance_plasma_batch() is bit-identical to calling
+// advance_plasma_state() on each shot, in any order, provided both are
+// built with the same -ffp-contract setting (use -ffp-contract=off when
+// comparing the two paths). Shots run on machine_default, through the
+// same geometry kernels as advance_plasma_state().
+//
+// Build with -O3 -fno-math-errno -fno-trapping-math so the per-shot loop
+// vectorizes; neither flag changes the computed values.
+
+#define PLASMA_BATCH_ALIGN 64
+
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+
+    // PlasmaState
+    float *plasma_current;
+    float *safety_factor_q95;
+    float *beta_normalized;
+    float *li_inductance;
+    float *radial_position;
+    float *vertical_position;
+    float *elongation;
+    float *triangularity;
+    float *temperature_core;
+    float *temperature_edge;
+    float *density_core;
+    float *density_edge;
+    float *mhd_activity_level;
+    float *ntm_amplitude;
+    float *elm_frequency;
+    float *neutron_rate;
+    float *impurity_concentration;
+    float *radiation_power;
+
+    // PlasmaControlSystem
+    float *pf_coil_currents[NUM_PF_COILS];
+    float *vertical_coil_currents[NUM_VERTICAL_COILS];
+    float *heating_power[NUM_HEATING_SYSTEMS];  // 0 when the system is disabled
+    float *fuel_injection_rate;
+    float *energy_confinement_time;
+    float *simulation_time;
+    float *stored_energy;
+    uint32_t *rng_state[4];                     // PlasmaRng words, per shot
+
+    // Scratch
+    float *mhd_drive;
+
+    void *block;
+} PlasmaBatch;
+
+int plasma_batch_init(PlasmaBatch *batch, uint32_t capacity);
+void plasma_batch_free(PlasmaBatch *batch);
+
+void plasma_batch_load(PlasmaBatch *batch, uint32_t shot,
+                       const PlasmaState *state,
+                       const PlasmaControlSystem *control);
+void plasma_batch_store(const PlasmaBatch *batch, uint32_t shot,
+                        PlasmaState *state, PlasmaControlSystem *control);
+
+void advance_plasma_batch(PlasmaBatch *batch, float dt);
+
+#endif // PLASMA_BATCH_H
@@ -0,0 +1,191 @@
+#include "plasma_bus.h"
+#include <stdlib.h>
+#include <string.h>
+
+static inline size_t round_line(size_t bytes) {
+    return (bytes + BUS_CACHE_LINE - 1) / BUS_CACHE_LINE * BUS_CACHE_LINE;
+}
+
+static inline BusSlotHeader *slot_at(const BusTopic *topic, uint64_t message) {
+    return (BusSlotHeader *)(topic->slots + (size_t)(message & topic->mask) * topic->slot_size);
+}
+
+static inline void *slot_data(BusSlotHeader *slot) {
+    return (unsigned char *)slot + sizeof(BusSlotHeader);
+}
+
+// ================= TOPICS =================
+size_t bus_topic_storage(size_t message_size, uint32_t depth) {
+    return (size_t)depth * round_line(sizeof(BusSlotHeader) + message_size);
+}
+
+int bus_topic_init(BusTopic *topic, const char *name, size_t message_size,
+                   uint32_t depth, void *storage) {
+    if (depth < 2 || (depth & (depth - 1)) != 0 || message_size > UINT32_MAX / 2) {
+        return -1;
+    }
+    memset(topic, 0, sizeof(*topic));
+    atomic_init(&topic->published, 0);
+    topic->next = 0;
+    topic->message_size = (uint32_t)message_size;
+    topic->slot_size = (uint32_t)round_line(sizeof(BusSlotHeader) + message_size);
+    topic->depth = depth;
+    topic->mask = depth - 1;
+    topic->name = name;
+    topic->slots = storage;
+    memset(storage, 0, bus_topic_storage(message_size, depth));
+    for (uint32_t i = 0; i < depth; i++) atomic_init(&slot_at(topic, i)->seq, 0);
+    return 0;
+}
+
+// ================= PUBLISHER =================
+void *bus_publish_begin(BusTopic *topic) {
+    uint64_t m = topic->next;
+    BusSlotHeader *slot = slot_at(topic, m);
+    atomic_store_explicit(&slot->seq, 2 * m + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return slot_data(slot);
+}
+
+void bus_publish_commit(BusTopic *topic, uint64_t timestamp_ns) {
+    uint64_t m = topic->next;
+    BusSlotHeader *slot = slot_at(topic, m);
+    slot->timestamp_ns = timestamp_ns;
+    atomic_store_explicit(&slot->seq, 2 * m + 2, memory_order_release);
+    atomic_store_explicit(&topic->published, m + 1, memory_order_release);
+    topic->next = m + 1;
+}
+
+void bus_publish(BusTopic *topic, const void *message, uint64_t timestamp_ns) {
+    memcpy(bus_publish_begin(topic), message, topic->message_size);
+    bus_publish_commit(topic, timestamp_ns);
+}
+
+// ================= READERS =================
+// Copies message m if its slot holds it whole: the sequence must read the
+// same completed value before and after the copy
+static bool try_copy(const BusTopic *topic, uint64_t m, void *out,
+                     uint64_t *timestamp_ns) {
+    BusSlotHeader *slot = slot_at(topic, m);
+    uint64_t expected = 2 * m + 2;
+    if (atomic_load_explicit(&slot->seq, memory_order_acquire) != expected) return false;
+    memcpy(out, slot_data(slot), topic->message_size);
+    uint64_t timestamp = slot->timestamp_ns;
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != expected) return false;
+    if (timestamp_ns) *timestamp_ns = timestamp;
+    return true;
+}
+
+BusReadResult bus_read_latest(const BusTopic *topic, BusCursor *cursor,
+                              void *out, uint64_t *timestamp_ns) {
+    uint64_t published = bus_published(topic);
+    if (published <= cursor->last) return BUS_READ_NONE;
+    // Newest first; older slots only while they are still newer than the
+    // cursor and cannot have been lapped by more than the ring
+    uint64_t oldest = published > topic->depth ? published - topic->depth : 0;
+    if (oldest < cursor->last) oldest = cursor->last;
+    for (uint64_t m = published; m > oldest; m--) {
+        if (try_copy(topic, m - 1, out, timestamp_ns)) {
+            cursor->last = m;
+            return BUS_READ_NEW;
+        }
+    }
+    cursor->overruns++;
+    return BUS_READ_OVERRUN;
+}
+
+BusReadResult bus_read_next(const BusTopic *topic, BusCursor *cursor,
+                            void *out, uint64_t *timestamp_ns) {
+    for (uint32_t attempt = 0; attempt < topic->depth; attempt++) {
+        uint64_t published = bus_published(topic);
+        if (published <= cursor->last) return BUS_READ_NONE;
+        uint64_t m = cursor->last;
+        // Keep one slot of margin: the oldest one may be the next written
+        uint64_t oldest = published + 1 > topic->depth ? published + 1 - topic->depth : 0;
+        if (m < oldest) {
+            cursor->missed += oldest - m;
+            m = oldest;
+        }
+        cursor->last = m + 1;
+        if (try_copy(topic, m, out, timestamp_ns)) return BUS_READ_NEW;
+        // Lapped during the copy: that one is lost too
+        cursor->missed++;
+    }
+    cursor->overruns++;
+    return BUS_READ_OVERRUN;
+}
+
+// ================= PLASMA TOPICS =================
+static const char *topic_names[BUS_TOPIC_COUNT] = {
+    "diagnostics", "state", "command", "safety",
+};
+
+static const size_t topic_sizes[BUS_TOPIC_COUNT] = {
+    sizeof(DiagnosticsSystem), sizeof(BusStateMessage),
+    sizeof(BusCommandMessage), sizeof(BusSafetyMessage),
+};
+
+const char *bus_topic_name(BusTopicId id) {
+    return (unsigned)id < BUS_TOPIC_COUNT ? topic_names[id] : "unknown";
+}
+
+int plasma_bus_init(PlasmaBus *bus, uint32_t depth) {
+    memset(bus, 0, sizeof(*bus));
+    if (depth < 2 || (depth & (depth - 1)) != 0) return -1;
+    size_t bytes = 0;
+    for (int t = 0; t < BUS_TOPIC_COUNT; t++) bytes += bus_topic_storage(topic_sizes[t], depth);
+    unsigned char *block = aligned_alloc(BUS_CACHE_LINE, bytes);
+    if (!block) return -1;
+    size_t offset = 0;
+    for (int t = 0; t < BUS_TOPIC_COUNT; t++) {
+        bus_topic_init(&bus->topics[t], topic_names[t], topic_sizes[t], depth,
+                       block + offset);
+        offset += bus_topic_storage(topic_sizes[t], depth);
+    }
+    bus->block = block;
+    return 0;
+}
+
+void plasma_bus_free(PlasmaBus *bus) {
+    free(bus->block);
+    memset(bus, 0, sizeof(*bus));
+}
+
+void bus_state_from_control(BusStateMessage *message,
+                            const PlasmaControlSystem *control) {
+    message->time = control->simulation_time;
+    message->cycle = control->iteration_count;
+    message->state = control->current_state;
+    message->stored_energy = control->stored_energy;
+}
+
+void bus_command_from_control(BusCommandMessage *message,
+                              const PlasmaControlSystem *control) {
+    message->time = control->simulation_time;
+    message->cycle = control->iteration_count;
+    message->controller_state = control->controller_state;
+    memcpy(message->pf_coil_currents, control->pf_coil_currents,
+           sizeof(message->pf_coil_currents));
+    memcpy(message->vertical_coil_currents, control->vertical_coil_currents,
+           sizeof(message->vertical_coil_currents));
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        message->heating_power[h] = control->heating_systems[h].enabled ?
+                                    control->heating_systems[h].power : 0.0f;
+    }
+    message->fuel_injection_rate = control->fuel_injection_rate;
+}
+
+void bus_command_apply(const BusCommandMessage *message,
+                       PlasmaControlSystem *control) {
+    memcpy(control->pf_coil_currents, message->pf_coil_currents,
+           sizeof(message->pf_coil_currents));
+    memcpy(control->vertical_coil_currents, message->vertical_coil_currents,
+           sizeof(message->vertical_coil_currents));
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        float power = message->heating_power[h];
+        control->heating_systems[h].enabled = power > 0.0f;
+        if (power > 0.0f) control->heating_systems[h].power = power;
+    }
+    control->fuel_injection_rate = message->fuel_injection_rate;
+}
@@ -0,0 +1,160 @@
+#ifndef PLASMA_BUS_H
+#define PLASMA_BUS_H
+
+#include "npe_config.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+// ================= IN-PROCESS PUBLISH/SUBSCRIBE BUS =================
+// Lock-free message bus between the acquisition, control and safety
+// threads. Each topic is a ring of depth fixed-size slots with one
+// publisher and any number of readers:
+//
+//   publisher  msg = bus_publish_begin(topic);  ... fill msg ...
+//              bus_publish_commit(topic, timestamp_ns);
+//   reader     BusCursor cursor = { 0 };
+//              int r = bus_read_latest(topic, &cursor, &msg, &timestamp_ns);
+//
+// The publisher never waits: it overwrites the oldest slot whatever the
+// readers are doing. Readers never write to the topic, so any number of
+// them cost the publisher nothing, and each read is wait-free: a slot
+// carries a sequence number (odd while being written) checked before and
+// after the copy, and a reader whose copy was torn falls back to the next
+// older slot, at most depth attempts. A reader therefore gets the newest
+// message it could copy whole, and the safety thread can never be held up
+// by the controller or the other way round.
+//
+// Every slot, the published counter and the publisher's cursor start on
+// their own cache lines, so a reader polling for news does not share a
+// line with the slot being written.
+//
+// A slow reader loses messages rather than slowing anyone down:
+// bus_read_next() delivers in order and counts the ones overwritten
+// before it got to them.
+
+#define BUS_CACHE_LINE 64
+#define BUS_DEPTH_DEFAULT 8             // power of two
+
+typedef enum {
+    BUS_READ_OVERRUN = -1,              // every candidate slot was torn
+    BUS_READ_NONE = 0,                  // nothing newer than the cursor
+    BUS_READ_NEW = 1,
+} BusReadResult;
+
+typedef struct {
+    _Alignas(BUS_CACHE_LINE) _Atomic uint64_t seq;  // 2m + 1 writing message m, 2m + 2 done
+    uint64_t timestamp_ns;
+} BusSlotHeader;
+
+typedef struct {
+    // Published by the writer
+    _Alignas(BUS_CACHE_LINE) _Atomic uint64_t published;  // messages committed
+
+    // Writer-private
+    _Alignas(BUS_CACHE_LINE) uint64_t next;
+
+    // Read-only after init
+    _Alignas(BUS_CACHE_LINE) uint32_t message_size;
+    uint32_t slot_size;                 // header + message, whole cache lines
+    uint32_t depth;
+    uint32_t mask;
+    const char *name;
+    unsigned char *slots;
+} BusTopic;
+
+typedef struct {
+    uint64_t last;                      // messages seen up to, 0 for none
+    uint64_t missed;                    // overwritten before bus_read_next() got them
+    uint64_t overruns;                  // BUS_READ_OVERRUN results
+} BusCursor;
+
+// Topic over caller storage of bus_topic_storage() bytes, aligned to
+// BUS_CACHE_LINE. Returns -1 for a depth that is not a power of two >= 2.
+size_t bus_topic_storage(size_t message_size, uint32_t depth);
+int bus_topic_init(BusTopic *topic, const char *name, size_t message_size,
+                   uint32_t depth, void *storage);
+
+// Publisher side: one thread per topic
+void *bus_publish_begin(BusTopic *topic);
+void bus_publish_commit(BusTopic *topic, uint64_t timestamp_ns);
+void bus_publish(BusTopic *topic, const void *message, uint64_t timestamp_ns);
+
+// Reader side: newest message, or the next one after the cursor. Both
+// copy message_size bytes to out; timestamp_ns may be NULL.
+BusReadResult bus_read_latest(const BusTopic *topic, BusCursor *cursor,
+                              void *out, uint64_t *timestamp_ns);
+BusReadResult bus_read_next(const BusTopic *topic, BusCursor *cursor,
+                            void *out, uint64_t *timestamp_ns);
+
+static inline uint64_t bus_published(const BusTopic *topic) {
+    return atomic_load_explicit(&((BusTopic *)topic)->published, memory_order_acquire);
+}
+
+// ================= PLASMA TOPICS =================
+// The messages exchanged by the three threads of the plasma control
+// system. Each thread owns the topics it publishes and keeps private
+// copies of the structs it works on.
+//   BUS_TOPIC_DIAGNOSTICS  acquisition -> control, safety: DiagnosticsSystem
+//   BUS_TOPIC_STATE        acquisition -> control, safety: BusStateMessage
+//   BUS_TOPIC_COMMAND      control -> acquisition (actuators): BusCommandMessage
+//   BUS_TOPIC_SAFETY       safety -> control, acquisition: BusSafetyMessage
+
+typedef enum {
+    BUS_TOPIC_DIAGNOSTICS,
+    BUS_TOPIC_STATE,
+    BUS_TOPIC_COMMAND,
+    BUS_TOPIC_SAFETY,
+    BUS_TOPIC_COUNT
+} BusTopicId;
+
+typedef struct {
+    float time;                     // simulation time, s
+    uint32_t cycle;
+    PlasmaState state;
+    float stored_energy;            // MJ
+    bool locked_mode_detected;      // MHD spectrum of the acquisition thread
+    bool ntm_detected;
+} BusStateMessage;
+
+typedef struct {
+    float time;                     // of the state the command answers
+    uint32_t cycle;
+    int32_t controller_state;       // PlasmaControlSystem.controller_state
+    float pf_coil_currents[NUM_PF_COILS];
+    float vertical_coil_currents[NUM_VERTICAL_COILS];
+    float heating_power[NUM_HEATING_SYSTEMS];   // 0 disables the system
+    float fuel_injection_rate;
+} BusCommandMessage;
+
+typedef struct {
+    float time;
+    uint32_t cycle;
+    DisruptionPrediction prediction;
+    MitigationDecision decision;
+    bool mitigation_fired;          // hard mitigation requested
+    SafetyMitigationSystem system;
+} BusSafetyMessage;
+
+typedef struct {
+    BusTopic topics[BUS_TOPIC_COUNT];
+    void *block;
+} PlasmaBus;
+
+int plasma_bus_init(PlasmaBus *bus, uint32_t depth);
+void plasma_bus_free(PlasmaBus *bus);
+
+static inline BusTopic *plasma_bus_topic(PlasmaBus *bus, BusTopicId id) {
+    return &bus->topics[id];
+}
+
+const char *bus_topic_name(BusTopicId id);
+
+// Conversions between messages and the control-system structs
+void bus_state_from_control(BusStateMessage *message,
+                            const PlasmaControlSystem *control);
+void bus_command_from_control(BusCommandMessage *message,
+                              const PlasmaControlSystem *control);
+void bus_command_apply(const BusCommandMessage *message,
+                       PlasmaControlSystem *control);
+
+#endif // PLASMA_BUS_H
@@ -1,50 +1,72 @@
-#include "npe_config.h"
+#include "plasma_physics.h"
+#include "machine_geometry.h"
+#include "plasma_rng.h"
+#include "plasma_trace.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <complex.h>
+#include <float.h>
+#include <string.h>
 
-#define MU0 (4.0e-7 * M_PI)
-#define ELECTRON_CHARGE 1.602e-19
-#define ELECTRON_MASS 9.109e-31
-#define PROTON_MASS 1.673e-27
+// Geometry-dependent models are written once as MACHINE_SPECIALIZE bodies
+// taking a MachineGeometry. The public functions instantiate them on
+// machine_default, where every geometry load folds to a constant, and the
+// *_machine() variants on a runtime machine.
 
-float grad_shafranov_solution(float R, float Z, float *params) {
-    float a = TOKAMAK_MINOR_RADIUS;
-    float R0 = TOKAMAK_MAJOR_RADIUS;
+// ================= EQUILIBRIUM & PROFILES =================
+
+MACHINE_SPECIALIZE float grad_shafranov_body(const MachineGeometry *machine,
+                                             float R, float Z, float *params) {
+    float a = machine->minor_radius;
+    float R0 = machine->major_radius;
     float r = sqrtf((R - R0)*(R - R0) + Z*Z) / a;
     if (r >= 1.0f) return 0.0f;
     float psi = params[0] * (1.0f - r*r);
     return psi;
 }
 
+float grad_shafranov_solution(float R, float Z, float *params) {
+    return grad_shafranov_body(&machine_default, R, Z, params);
+}
+
+float grad_shafranov_solution_machine(const MachineGeometry *machine,
+                                      float R, float Z, float *params) {
+    return grad_shafranov_body(machine, R, Z, params);
+}
+
 float safety_factor_profile(float r_normalized, PlasmaState *state) {
-    float R0 = TOKAMAK_MAJOR_RADIUS;
-    float B_toroidal = TOKAMAK_TOROIDAL_FIELD;
-    float I_p = state->plasma_current * 1e6;
-    float q = (2.0f * M_PI * B_toroidal * r_normalized * r_normalized *
-              TOKAMAK_MINOR_RADIUS * TOKAMAK_MINOR_RADIUS) /
-              (MU0 * R0 * I_p);
-    q *= (1.0f + 0.5f * r_normalized * r_normalized);
-    return q;
+    return machine_safety_factor(&machine_default, r_normalized,
+                                 state->plasma_current);
+}
+
+float safety_factor_profile_machine(const MachineGeometry *machine,
+                                    float r_normalized, PlasmaState *state) {
+    return machine_safety_factor(machine, r_normalized, state->plasma_current);
 }
 
 float calculate_beta(PlasmaState *state) {
-    float pressure_avg = (state->density_core * 1e19 * state->temperature_core *
-                        1.602e-16) / 3.0f;
-    float B_total = sqrtf(TOKAMAK_TOROIDAL_FIELD * TOKAMAK_TOROIDAL_FIELD +
-                         powf(MU0 * state->plasma_current * 1e6 /
-                         (2.0f * M_PI * TOKAMAK_MINOR_RADIUS), 2));
-    float beta = 2.0f * MU0 * pressure_avg / (B_total * B_total);
-    return beta;
+    return machine_beta(&machine_default, state->plasma_current,
+                        state->density_core, state->temperature_core);
+}
+
+float calculate_beta_machine(const MachineGeometry *machine, PlasmaState *state) {
+    return machine_beta(machine, state->plasma_current,
+                        state->density_core, state->temperature_core);
 }
 
 float calculate_beta_normalized(PlasmaState *state) {
-    float beta = calculate_beta(state) * 100.0f;
-    float beta_N = beta * TOKAMAK_MINOR_RADIUS * TOKAMAK_TOROIDAL_FIELD /
-                   state->plasma_current;
-    return beta_N;
+    return machine_beta_normalized(&machine_default, state->plasma_current,
+                                   state->density_core, state->temperature_core);
+}
+
+float calculate_beta_normalized_machine(const MachineGeometry *machine,
+                                        PlasmaState *state) {
+    return machine_beta_normalized(machine, state->plasma_current,
+                                   state->density_core, state->temperature_core);
 }
 
+// ================= MHD & TRANSIENTS =================
+
 float ntm_island_growth(float w, float w_sat, float delta_prime,
                        float alpha, float beta, float dt) {
     float growth_rate = delta_prime * w +
@@ -63,7 +85,7 @@ float elm_cycle_model(float time, float pedestal_pressure,
 
 float thermal_quench_model(float time_since_onset, float initial_energy,
                           float impurity_concentration) {
-    float tau_TQ = 0.001f;
+    float tau_TQ = THERMAL_QUENCH_TIME;
     float energy_loss = initial_energy * expf(-time_since_onset / tau_TQ);
     energy_loss *= (1.0f - 0.5f * impurity_concentration);
     return energy_loss;
@@ -71,38 +93,47 @@ float thermal_quench_model(float time_since_onset, float initial_energy,
 
 float current_quench_model(float time_since_TQ, float initial_current,
                           float plasma_resistance) {
-    float tau_CQ = 0.01f;
+    float tau_CQ = CURRENT_QUENCH_TIME;
     float current = initial_current * expf(-time_since_TQ / tau_CQ);
     current *= (1.0f - 0.1f * plasma_resistance * time_since_TQ);
     return current;
 }
 
-float calculate_disruption_forces(PlasmaState *state, float *coil_currents) {
+MACHINE_SPECIALIZE float disruption_forces_body(const MachineGeometry *machine,
+                                                PlasmaState *state,
+                                                float *coil_currents) {
     float dIp_dt = -state->plasma_current / 0.01f;
     float B_coil = 0.0f;
-    for (int i = 0; i < NUM_PF_COILS; i++) {
+    for (int i = 0; i < machine->num_pf_coils; i++) {
         B_coil += coil_currents[i] * 1e-6f /
-                 (2.0f * M_PI * TOKAMAK_MAJOR_RADIUS);
+                 (2.0f * M_PI * machine->major_radius);
     }
-    float lorentz_force = dIp_dt * B_coil * TOKAMAK_MINOR_RADIUS;
-    float B_total = sqrtf(TOKAMAK_TOROIDAL_FIELD * TOKAMAK_TOROIDAL_FIELD +
-                         (MU0 * state->plasma_current * 1e6) /
-                         (2.0f * M_PI * TOKAMAK_MINOR_RADIUS));
+    float lorentz_force = dIp_dt * B_coil * machine->minor_radius;
+    // B_pol enters unsquared here, as in the original model
+    float B_total = sqrtf(machine->toroidal_field * machine->toroidal_field +
+                          machine->b_pol_per_ma * state->plasma_current);
     float magnetic_pressure = B_total * B_total / (2.0f * MU0);
-    float force_total = lorentz_force + magnetic_pressure * TOKAMAK_MINOR_RADIUS;
+    float force_total = lorentz_force + magnetic_pressure * machine->minor_radius;
     return force_total;
 }
 
-float ecrh_heating_model(float power, float frequency,
-                        PlasmaState *state, float *deposition_profile) {
-    float f_ce = ELECTRON_CHARGE * TOKAMAK_TOROIDAL_FIELD /
-                (2.0f * M_PI * ELECTRON_MASS);
-    float absorption = 0.0f;
-    if (fabsf(frequency - f_ce) < 1e9) {
-        absorption = 0.8f;
-    } else {
-        absorption = 0.3f * expf(-powf(frequency - f_ce, 2) / (2.0f * 1e18f));
-    }
+float calculate_disruption_forces(PlasmaState *state, float *coil_currents) {
+    return disruption_forces_body(&machine_default, state, coil_currents);
+}
+
+float calculate_disruption_forces_machine(const MachineGeometry *machine,
+                                          PlasmaState *state,
+                                          float *coil_currents) {
+    return disruption_forces_body(machine, state, coil_currents);
+}
+
+// ================= HEATING & TRANSPORT =================
+
+MACHINE_SPECIALIZE float ecrh_heating_body(const MachineGeometry *machine,
+                                           float power, float frequency,
+                                           PlasmaState *state,
+                                           float *deposition_profile) {
+    float absorption = machine_ecrh_absorption(machine, frequency);
     float power_deposited = power * absorption;
     for (int i = 0; i < 10; i++) {
         float r = i / 10.0f;
@@ -113,71 +144,65 @@ float ecrh_heating_model(float power, float frequency,
     return delta_T;
 }
 
+float ecrh_heating_model(float power, float frequency,
+                        PlasmaState *state, float *deposition_profile) {
+    return ecrh_heating_body(&machine_default, power, frequency, state,
+                             deposition_profile);
+}
+
+float ecrh_heating_model_machine(const MachineGeometry *machine,
+                                 float power, float frequency,
+                                 PlasmaState *state, float *deposition_profile) {
+    return ecrh_heating_body(machine, power, frequency, state, deposition_profile);
+}
+
 float energy_confinement_time(PlasmaState *state, float heating_power) {
-    float Ip = state->plasma_current;
-    float Bt = TOKAMAK_TOROIDAL_FIELD;
-    float n = state->density_core * 0.1f;
-    float R = TOKAMAK_MAJOR_RADIUS;
-    float a = TOKAMAK_MINOR_RADIUS;
-    float kappa = state->elongation;
-    float tau_E = 0.0562f * powf(Ip, 0.93f) * powf(Bt, 0.15f) *
-                 powf(n, 0.41f) * powf(R, 1.97f) *
-                 powf(a, 0.58f) * powf(kappa, 0.78f);
-    tau_E *= powf(heating_power, -0.69f);
-    return tau_E;
+    return machine_confinement_time(&machine_default, state->plasma_current,
+                                    state->density_core, state->elongation,
+                                    heating_power);
 }
 
-void advance_plasma_state(PlasmaState *state, PlasmaControlSystem *control,
-                         float dt) {
-    // Current evolution
-    float Lp = 5.0e-7f;
-    float Rp = 1.0e-6f;
-    float V_loop = control->pf_coil_currents[0] * 0.1f;
-    float dIp_dt = (V_loop - Rp * state->plasma_current * 1e6) / Lp;
-    state->plasma_current += dIp_dt * dt / 1e6;
-    
-    // Energy balance
+float energy_confinement_time_machine(const MachineGeometry *machine,
+                                      PlasmaState *state, float heating_power) {
+    return machine_confinement_time(machine, state->plasma_current,
+                                    state->density_core, state->elongation,
+                                    heating_power);
+}
+
+// ================= TIME STEPPING =================
+
+MACHINE_SPECIALIZE float heating_power_body(const MachineGeometry *machine,
+                                            const PlasmaControlSystem *control) {
     float P_heating = 0.0f;
-    for (int i = 0; i < NUM_HEATING_SYSTEMS; i++) {
+    for (int i = 0; i < machine->num_heating_systems; i++) {
         if (control->heating_systems[i].enabled) {
             P_heating += control->heating_systems[i].power;
         }
     }
-    float P_loss = state->stored_energy / control->energy_confinement_time;
-    float dW_dt = P_heating - P_loss;
-    state->stored_energy += dW_dt * dt;
-    
-    float plasma_volume = 2.0f * M_PI * M_PI * TOKAMAK_MAJOR_RADIUS *
-                         TOKAMAK_MINOR_RADIUS * TOKAMAK_MINOR_RADIUS *
-                         state->elongation;
-    state->temperature_core = state->stored_energy * 1e6 /
-                            (1.5f * state->density_core * 1e19 *
-                            plasma_volume * ELECTRON_CHARGE * 1000.0f);
-    
-    // Density evolution
-    float S_in = control->fuel_injection_rate;
-    float tau_p = 10.0f;
-    float S_out = state->density_core * 1e19 * plasma_volume / tau_p;
-    float dn_dt = (S_in - S_out) / plasma_volume;
-    state->density_core += dn_dt * dt / 1e19;
-    
-    // Position evolution
-    float mass_plasma = state->density_core * 1e19 * plasma_volume *
-                       (PROTON_MASS + ELECTRON_MASS);
+    return P_heating;
+}
+
+MACHINE_SPECIALIZE float vertical_force_body(const MachineGeometry *machine,
+                                             const PlasmaState *state,
+                                             const PlasmaControlSystem *control) {
     float F_vertical = 0.0f;
-    for (int i = 0; i < NUM_VERTICAL_COILS; i++) {
-        F_vertical += control->vertical_coil_currents[i] *
-                     state->plasma_current * 0.1f;
+    for (int i = 0; i < machine->num_vertical_coils; i++) {
+        F_vertical += plasma_vertical_force(control->vertical_coil_currents[i],
+                                            state->plasma_current);
     }
-    float damping = 0.1f;
-    float dVz_dt = (F_vertical - damping * state->vertical_position) / mass_plasma;
-    state->vertical_position += state->vertical_position * dt + 0.5f * dVz_dt * dt * dt;
-    
-    // Stability updates
-    state->safety_factor_q95 = safety_factor_profile(0.95f, state);
-    state->beta_normalized = calculate_beta_normalized(state);
+    return F_vertical;
+}
+
+MACHINE_SPECIALIZE void stability_update_body(const MachineGeometry *machine,
+                                              PlasmaState *state,
+                                              PlasmaControlSystem *control) {
+    state->safety_factor_q95 = machine_safety_factor(machine, 0.95f,
+                                                     state->plasma_current);
+    state->beta_normalized = machine_beta_normalized(machine, state->plasma_current,
+                                                     state->density_core,
+                                                     state->temperature_core);
     state->mhd_activity_level = 0.1f * sinf(control->simulation_time * 100.0f) +
-                               0.05f * ((float)rand() / RAND_MAX);
+                               0.05f * plasma_rng_uniform(&control->rng);
     
     // Disruption conditions
     if (state->safety_factor_q95 < SAFETY_FACTOR_Q95_MIN) {
@@ -190,3 +215,488 @@ void advance_plasma_state(PlasmaState *state, PlasmaControlSystem *control,
         state->mhd_activity_level += 0.7f;
     }
 }
+
+// Block updates shared by the single-rate, integrated and scheduled paths,
+// on the plasma_physics.h kernels
+static inline float current_step(const PlasmaControlSystem *control,
+                                 float plasma_current, float dt) {
+    return plasma_current_step(control->pf_coil_currents[0], plasma_current, dt);
+}
+
+MACHINE_SPECIALIZE float energy_step(const MachineGeometry *machine,
+                                     const PlasmaControlSystem *control,
+                                     float stored_energy, float dt) {
+    return plasma_energy_step(stored_energy, heating_power_body(machine, control),
+                              control->energy_confinement_time, dt);
+}
+
+static inline float density_step(const PlasmaControlSystem *control,
+                                 float density_core, float plasma_volume,
+                                 float dt) {
+    return plasma_density_step(control->fuel_injection_rate, density_core,
+                               plasma_volume, dt);
+}
+
+static inline float position_step(const PlasmaState *state, float F_vertical,
+                                  float mass_plasma, float dt) {
+    return plasma_position_step(state->vertical_position, F_vertical, mass_plasma, dt);
+}
+
+// force_per_ma NULL takes the vertical force from the coil currents as in
+// vertical_force_body(); otherwise F = *force_per_ma * Ip
+MACHINE_SPECIALIZE void advance_plasma_body(const MachineGeometry *machine,
+                                            PlasmaState *state,
+                                            PlasmaControlSystem *control,
+                                            const float *force_per_ma,
+                                            float dt) {
+    PLASMA_TRACE_MARK(trace_ticks);
+
+    state->plasma_current = current_step(control, state->plasma_current, dt);
+    PLASMA_TRACE_STAGE(TRACE_STAGE_CURRENT, trace_ticks);
+
+    float plasma_volume = machine_plasma_volume(machine, state->elongation);
+    control->stored_energy = energy_step(machine, control, control->stored_energy, dt);
+    state->temperature_core = plasma_core_temperature(control->stored_energy,
+                                                      state->density_core,
+                                                      plasma_volume);
+    PLASMA_TRACE_STAGE(TRACE_STAGE_ENERGY, trace_ticks);
+
+    state->density_core = density_step(control, state->density_core,
+                                       plasma_volume, dt);
+    PLASMA_TRACE_STAGE(TRACE_STAGE_DENSITY, trace_ticks);
+
+    float mass_plasma = plasma_mass(state->density_core, plasma_volume);
+    float F_vertical = force_per_ma ? *force_per_ma * state->plasma_current
+                                    : vertical_force_body(machine, state, control);
+    state->vertical_position = position_step(state, F_vertical, mass_plasma, dt);
+    PLASMA_TRACE_STAGE(TRACE_STAGE_POSITION, trace_ticks);
+
+    stability_update_body(machine, state, control);
+    PLASMA_TRACE_STAGE(TRACE_STAGE_STABILITY, trace_ticks);
+}
+
+void advance_plasma_state(PlasmaState *state, PlasmaControlSystem *control,
+                         float dt) {
+    advance_plasma_body(&machine_default, state, control, NULL, dt);
+}
+
+void advance_plasma_state_machine(const MachineGeometry *machine,
+                                  PlasmaState *state,
+                                  PlasmaControlSystem *control, float dt) {
+    advance_plasma_body(machine, state, control, NULL, dt);
+}
+
+void advance_plasma_state_coupled(PlasmaState *state, PlasmaControlSystem *control,
+                                  float vertical_force_per_ma, float dt) {
+    advance_plasma_body(&machine_default, state, control, &vertical_force_per_ma, dt);
+}
+
+void advance_plasma_state_coupled_machine(const MachineGeometry *machine,
+                                          PlasmaState *state,
+                                          PlasmaControlSystem *control,
+                                          float vertical_force_per_ma, float dt) {
+    advance_plasma_body(machine, state, control, &vertical_force_per_ma, dt);
+}
+
+// ================= STIFF & ADAPTIVE TIME STEPPING =================
+// Over one call the actuators are frozen, so the circuit, energy and
+// particle balances are linear relaxations
+//   Ip' = (Ip_eq - Ip) Rp / Lp,  W' = P - W / tau_E,  n' = (n_eq - n) / tau_p
+// unless confinement_scaling makes tau_E depend on (Ip, n). The vertical
+// update is a per-call map rather than an ODE (the driver's feedback
+// cancels its growth term for the call's dt), so every mode applies it
+// once per call and never substeps it.
+
+void plasma_integrator_init(PlasmaIntegrator *integrator, IntegratorMode mode) {
+    memset(integrator, 0, sizeof(*integrator));
+    integrator->mode = mode;
+    integrator->confinement_scaling = false;
+    integrator->relative_tolerance = INTEGRATOR_DEFAULT_RTOL;
+    integrator->absolute_tolerance = INTEGRATOR_DEFAULT_ATOL;
+    integrator->substep_min = INTEGRATOR_SUBSTEP_MIN;
+    integrator->substep_max = INTEGRATOR_SUBSTEP_MAX;
+    integrator->stats.substep_min = FLT_MAX;
+}
+
+const char *integrator_mode_name(IntegratorMode mode) {
+    switch (mode) {
+    case INTEGRATOR_EULER: return "euler";
+    case INTEGRATOR_SEMI_IMPLICIT: return "semi-implicit";
+    case INTEGRATOR_ADAPTIVE: return "adaptive";
+    }
+    return "unknown";
+}
+
+static void record_substep(IntegratorStats *stats, float h, float error) {
+    stats->substeps++;
+    stats->substep_last = h;
+    if (h < stats->substep_min) stats->substep_min = h;
+    if (h > stats->substep_max) stats->substep_max = h;
+    stats->error_last = error;
+}
+
+// Inputs of the slow balances, frozen over one call
+typedef struct {
+    float current_rate;             // Rp / Lp, 1/s
+    float current_equilibrium;      // MA
+    float heating_power;            // MW
+    float density_equilibrium;      // 1e19 m^-3
+    float elongation;
+    float tau_E;                    // used unless scaling applies
+    bool scaling;
+} SlowInputs;
+
+typedef struct {
+    float plasma_current;
+    float stored_energy;
+    float density_core;
+} SlowState;
+
+MACHINE_SPECIALIZE float slow_tau_E(const MachineGeometry *machine,
+                                    const SlowInputs *in, const SlowState *y) {
+    if (!in->scaling) return in->tau_E;
+    return machine_confinement_time(machine, y->plasma_current, y->density_core,
+                                    in->elongation, in->heating_power);
+}
+
+MACHINE_SPECIALIZE SlowState slow_rates(const MachineGeometry *machine,
+                                        const SlowInputs *in, const SlowState *y) {
+    float tau_E = slow_tau_E(machine, in, y);
+    return (SlowState){
+        in->current_rate * (in->current_equilibrium - y->plasma_current),
+        in->heating_power - y->stored_energy / tau_E,
+        (in->density_equilibrium - y->density_core) / PARTICLE_CONFINEMENT_TIME,
+    };
+}
+
+static inline SlowState slow_axpy(const SlowState *y, float h, const SlowState *k) {
+    return (SlowState){ y->plasma_current + h * k->plasma_current,
+                        y->stored_energy + h * k->stored_energy,
+                        y->density_core + h * k->density_core };
+}
+
+// Exact relaxation x -> x_eq over dt at rate `rate`
+static inline float relax(float x, float x_eq, float rate, float dt) {
+    return x + (x - x_eq) * expm1f(-rate * dt);
+}
+
+MACHINE_SPECIALIZE void slow_semi_implicit(const MachineGeometry *machine,
+                                           PlasmaIntegrator *integrator,
+                                           const SlowInputs *in, SlowState *y,
+                                           float dt) {
+    float tau_E = slow_tau_E(machine, in, y);
+    y->plasma_current = relax(y->plasma_current, in->current_equilibrium,
+                              in->current_rate, dt);
+    y->stored_energy = relax(y->stored_energy, in->heating_power * tau_E,
+                             1.0f / tau_E, dt);
+    y->density_core = relax(y->density_core, in->density_equilibrium,
+                            1.0f / PARTICLE_CONFINEMENT_TIME, dt);
+    record_substep(&integrator->stats, dt, 0.0f);
+}
+
+// Bogacki-Shampine 3(2) with the 2nd-order solution as error estimate
+MACHINE_SPECIALIZE void slow_adaptive(const MachineGeometry *machine,
+                                      PlasmaIntegrator *integrator,
+                                      const SlowInputs *in, SlowState *y,
+                                      float dt) {
+    IntegratorStats *stats = &integrator->stats;
+    float h_max = integrator->substep_max < dt ? integrator->substep_max : dt;
+    float h = integrator->substep > 0.0f ? integrator->substep : h_max;
+    h = h > h_max ? h_max : h;
+    h = h < integrator->substep_min ? integrator->substep_min : h;
+
+    SlowState k1 = slow_rates(machine, in, y);
+    float t = 0.0f;
+    while (t < dt) {
+        float remaining = dt - t;
+        bool last = h >= remaining;
+        float step = last ? remaining : h;
+
+        SlowState y2 = slow_axpy(y, 0.5f * step, &k1);
+        SlowState k2 = slow_rates(machine, in, &y2);
+        SlowState y3 = slow_axpy(y, 0.75f * step, &k2);
+        SlowState k3 = slow_rates(machine, in, &y3);
+        SlowState y_new = {
+            y->plasma_current + step * (2.0f / 9.0f * k1.plasma_current +
+                1.0f / 3.0f * k2.plasma_current + 4.0f / 9.0f * k3.plasma_current),
+            y->stored_energy + step * (2.0f / 9.0f * k1.stored_energy +
+                1.0f / 3.0f * k2.stored_energy + 4.0f / 9.0f * k3.stored_energy),
+            y->density_core + step * (2.0f / 9.0f * k1.density_core +
+                1.0f / 3.0f * k2.density_core + 4.0f / 9.0f * k3.density_core),
+        };
+        SlowState k4 = slow_rates(machine, in, &y_new);
+
+        // y_new - y_hat, y_hat the embedded 2nd-order solution
+        float e[3] = {
+            step * (-5.0f / 72.0f * k1.plasma_current + 1.0f / 12.0f * k2.plasma_current +
+                    1.0f / 9.0f * k3.plasma_current - 1.0f / 8.0f * k4.plasma_current),
+            step * (-5.0f / 72.0f * k1.stored_energy + 1.0f / 12.0f * k2.stored_energy +
+                    1.0f / 9.0f * k3.stored_energy - 1.0f / 8.0f * k4.stored_energy),
+            step * (-5.0f / 72.0f * k1.density_core + 1.0f / 12.0f * k2.density_core +
+                    1.0f / 9.0f * k3.density_core - 1.0f / 8.0f * k4.density_core),
+        };
+        float scale[3] = { fabsf(y_new.plasma_current), fabsf(y_new.stored_energy),
+                           fabsf(y_new.density_core) };
+        float error = 0.0f;
+        for (int c = 0; c < 3; c++) {
+            float tol = integrator->absolute_tolerance +
+                        integrator->relative_tolerance * scale[c];
+            float ratio = fabsf(e[c]) / tol;
+            error = ratio > error ? ratio : error;
+        }
+
+        // Standard controller for a 3rd-order pair, growth limited to
+        // [INTEGRATOR_SHRINK_MIN, INTEGRATOR_GROWTH_MAX] per substep
+        float factor = error > 0.0f ?
+            INTEGRATOR_SAFETY * powf(error, -1.0f / 3.0f) : INTEGRATOR_GROWTH_MAX;
+        factor = factor > INTEGRATOR_GROWTH_MAX ? INTEGRATOR_GROWTH_MAX : factor;
+        factor = factor < INTEGRATOR_SHRINK_MIN ? INTEGRATOR_SHRINK_MIN : factor;
+        float h_next = step * factor;
+        h_next = h_next > integrator->substep_max ? integrator->substep_max : h_next;
+        h_next = h_next < integrator->substep_min ? integrator->substep_min : h_next;
+
+        if (error <= 1.0f || step <= integrator->substep_min) {
+            *y = y_new;
+            k1 = k4;                // first same as last
+            t = last ? dt : t + step;
+            record_substep(stats, step, error);
+            // A step cut short by the end of the call does not shrink the next
+            if (!last || h_next < h) h = h_next;
+        } else {
+            stats->rejected++;
+            h = h_next;
+        }
+    }
+    integrator->substep = h;
+}
+
+MACHINE_SPECIALIZE void advance_integrated_body(const MachineGeometry *machine,
+                                                PlasmaIntegrator *integrator,
+                                                PlasmaState *state,
+                                                PlasmaControlSystem *control,
+                                                float dt) {
+    IntegratorStats *stats = &integrator->stats;
+    stats->steps++;
+    float P_heating = heating_power_body(machine, control);
+    bool scaling = integrator->confinement_scaling && P_heating > 0.0f;
+
+    if (integrator->mode == INTEGRATOR_EULER) {
+        if (scaling) {
+            control->energy_confinement_time = machine_confinement_time(
+                machine, state->plasma_current, state->density_core,
+                state->elongation, P_heating);
+        }
+        advance_plasma_body(machine, state, control, NULL, dt);
+        record_substep(stats, dt, 0.0f);
+        return;
+    }
+
+    float plasma_volume = machine_plasma_volume(machine, state->elongation);
+    SlowInputs in = {
+        .current_rate = PLASMA_RESISTANCE / PLASMA_INDUCTANCE,
+        .current_equilibrium = control->pf_coil_currents[0] *
+                               LOOP_VOLTAGE_PER_PF_CURRENT / (PLASMA_RESISTANCE * 1e6f),
+        .heating_power = P_heating,
+        .density_equilibrium = control->fuel_injection_rate *
+                               PARTICLE_CONFINEMENT_TIME /
+                               (plasma_volume * 1e19f),
+        .elongation = state->elongation,
+        .tau_E = control->energy_confinement_time,
+        .scaling = scaling,
+    };
+    SlowState y = { state->plasma_current, control->stored_energy,
+                    state->density_core };
+    if (integrator->mode == INTEGRATOR_ADAPTIVE) {
+        slow_adaptive(machine, integrator, &in, &y, dt);
+    } else {
+        slow_semi_implicit(machine, integrator, &in, &y, dt);
+    }
+    state->plasma_current = y.plasma_current;
+    control->stored_energy = y.stored_energy;
+    state->density_core = y.density_core;
+    if (scaling) control->energy_confinement_time = slow_tau_E(machine, &in, &y);
+
+    state->temperature_core = plasma_core_temperature(control->stored_energy,
+                                                      state->density_core,
+                                                      plasma_volume);
+
+    // Vertical map with the damping term taken at the new position, so it
+    // stays bounded at any dt; it agrees with the explicit map as dt -> 0
+    float mass_plasma = plasma_mass(state->density_core, plasma_volume);
+    float F_vertical = vertical_force_body(machine, state, control);
+    float z = state->vertical_position;
+    float half_dt2 = 0.5f * dt * dt;
+    state->vertical_position = (z + z * dt + half_dt2 * F_vertical / mass_plasma) /
+                               (1.0f + half_dt2 * VERTICAL_DAMPING / mass_plasma);
+
+    stability_update_body(machine, state, control);
+}
+
+void advance_plasma_state_integrated(PlasmaIntegrator *integrator,
+                                     PlasmaState *state,
+                                     PlasmaControlSystem *control, float dt) {
+    advance_integrated_body(&machine_default, integrator, state, control, dt);
+}
+
+void advance_plasma_state_integrated_machine(const MachineGeometry *machine,
+                                             PlasmaIntegrator *integrator,
+                                             PlasmaState *state,
+                                             PlasmaControlSystem *control,
+                                             float dt) {
+    advance_integrated_body(machine, integrator, state, control, dt);
+}
+
+// ================= MULTI-RATE STEPPING =================
+
+static const char *const block_names[PLASMA_BLOCK_COUNT] = {
+    [PLASMA_BLOCK_CURRENT] = "current",
+    [PLASMA_BLOCK_ENERGY] = "energy",
+    [PLASMA_BLOCK_DENSITY] = "density",
+    [PLASMA_BLOCK_POSITION] = "position",
+    [PLASMA_BLOCK_STABILITY] = "stability",
+};
+
+const char *plasma_block_name(PlasmaBlock block) {
+    return (unsigned)block < PLASMA_BLOCK_COUNT ? block_names[block] : "unknown";
+}
+
+int plasma_scheduler_set_period(PlasmaScheduler *scheduler, PlasmaBlock block,
+                                uint32_t period, uint32_t phase) {
+    if ((unsigned)block >= PLASMA_BLOCK_COUNT || period == 0 || phase >= period) {
+        return -1;
+    }
+    PlasmaBlockSchedule *b = &scheduler->blocks[block];
+    b->period = period;
+    b->phase = phase;
+    b->countdown = phase;
+    b->step_scale = (float)period;
+    return 0;
+}
+
+int plasma_scheduler_init(PlasmaScheduler *scheduler, uint32_t slow_period) {
+    memset(scheduler, 0, sizeof(*scheduler));
+    if (slow_period == 0) return -1;
+    for (int b = 0; b < PLASMA_BLOCK_COUNT; b++) {
+        plasma_scheduler_set_period(scheduler, (PlasmaBlock)b, 1, 0);
+    }
+    // The two slow blocks fall on different ticks
+    plasma_scheduler_set_period(scheduler, PLASMA_BLOCK_ENERGY, slow_period, 0);
+    plasma_scheduler_set_period(scheduler, PLASMA_BLOCK_DENSITY, slow_period,
+                                slow_period / 2);
+    return 0;
+}
+
+MACHINE_SPECIALIZE void scheduler_sync_body(const MachineGeometry *machine,
+                                            PlasmaScheduler *scheduler,
+                                            const PlasmaState *state,
+                                            const PlasmaControlSystem *control) {
+    float plasma_volume = machine_plasma_volume(machine, state->elongation);
+    PlasmaSlowHandoff *front = &scheduler->slot[scheduler->front];
+    front->stored_energy = control->stored_energy;
+    front->temperature_core = state->temperature_core;
+    front->density_core = state->density_core;
+    front->mass = plasma_mass(state->density_core, plasma_volume);
+    scheduler->slot[scheduler->front ^ 1] = *front;
+    scheduler->synced = true;
+}
+
+void plasma_scheduler_sync(PlasmaScheduler *scheduler, const PlasmaState *state,
+                           const PlasmaControlSystem *control) {
+    scheduler_sync_body(&machine_default, scheduler, state, control);
+}
+
+void plasma_scheduler_sync_machine(const MachineGeometry *machine,
+                                   PlasmaScheduler *scheduler,
+                                   const PlasmaState *state,
+                                   const PlasmaControlSystem *control) {
+    scheduler_sync_body(machine, scheduler, state, control);
+}
+
+// Counts the block down to its next run; on a run returns its step
+static inline bool block_due(PlasmaBlockSchedule *block, float dt, float *h) {
+    if (block->countdown) {
+        block->countdown--;
+        return false;
+    }
+    block->countdown = block->period - 1;
+    block->runs++;
+    *h = dt * block->step_scale;
+    return true;
+}
+
+// The back slot starts as a copy of the front, so a block changes only its
+// own outputs
+static inline PlasmaSlowHandoff *handoff_back(PlasmaScheduler *scheduler) {
+    PlasmaSlowHandoff *back = &scheduler->slot[scheduler->front ^ 1];
+    *back = scheduler->slot[scheduler->front];
+    return back;
+}
+
+static inline void handoff_publish(PlasmaScheduler *scheduler, PlasmaState *state,
+                                   PlasmaControlSystem *control) {
+    scheduler->front ^= 1;
+    scheduler->published++;
+    const PlasmaSlowHandoff *front = &scheduler->slot[scheduler->front];
+    control->stored_energy = front->stored_energy;
+    state->temperature_core = front->temperature_core;
+    state->density_core = front->density_core;
+}
+
+MACHINE_SPECIALIZE void advance_scheduled_body(const MachineGeometry *machine,
+                                               PlasmaScheduler *scheduler,
+                                               PlasmaState *state,
+                                               PlasmaControlSystem *control,
+                                               float dt) {
+    PLASMA_TRACE_MARK(trace_ticks);
+    if (!scheduler->synced) scheduler_sync_body(machine, scheduler, state, control);
+    PlasmaBlockSchedule *blocks = scheduler->blocks;
+    float plasma_volume = machine_plasma_volume(machine, state->elongation);
+    float h;
+
+    if (block_due(&blocks[PLASMA_BLOCK_CURRENT], dt, &h)) {
+        state->plasma_current = current_step(control, state->plasma_current, h);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_CURRENT, trace_ticks);
+    }
+    if (block_due(&blocks[PLASMA_BLOCK_ENERGY], dt, &h)) {
+        PlasmaSlowHandoff *back = handoff_back(scheduler);
+        back->stored_energy = energy_step(machine, control, back->stored_energy, h);
+        back->temperature_core = plasma_core_temperature(back->stored_energy,
+                                                         back->density_core,
+                                                         plasma_volume);
+        handoff_publish(scheduler, state, control);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_ENERGY, trace_ticks);
+    }
+    if (block_due(&blocks[PLASMA_BLOCK_DENSITY], dt, &h)) {
+        PlasmaSlowHandoff *back = handoff_back(scheduler);
+        back->density_core = density_step(control, back->density_core,
+                                          plasma_volume, h);
+        back->mass = plasma_mass(back->density_core, plasma_volume);
+        handoff_publish(scheduler, state, control);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_DENSITY, trace_ticks);
+    }
+
+    const PlasmaSlowHandoff *front = &scheduler->slot[scheduler->front];
+    if (block_due(&blocks[PLASMA_BLOCK_POSITION], dt, &h)) {
+        float F_vertical = vertical_force_body(machine, state, control);
+        state->vertical_position = position_step(state, F_vertical, front->mass, h);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_POSITION, trace_ticks);
+    }
+    if (block_due(&blocks[PLASMA_BLOCK_STABILITY], dt, &h)) {
+        stability_update_body(machine, state, control);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_STABILITY, trace_ticks);
+    }
+    scheduler->tick++;
+}
+
+void advance_plasma_state_scheduled(PlasmaScheduler *scheduler, PlasmaState *state,
+                                    PlasmaControlSystem *control, float dt) {
+    advance_scheduled_body(&machine_default, scheduler, state, control, dt);
+}
+
+void advance_plasma_state_scheduled_machine(const MachineGeometry *machine,
+                                            PlasmaScheduler *scheduler,
+                                            PlasmaState *state,
+                                            PlasmaControlSystem *control,
+                                            float dt) {
+    advance_scheduled_body(machine, scheduler, state, control, dt);
+}
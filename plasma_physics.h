@@ -0,0 +1,282 @@
+#ifndef PLASMA_PHYSICS_H
+#define PLASMA_PHYSICS_H
+
+#include "npe_config.h"
+#include "machine_geometry.h"
+
+// Functions without a MachineGeometry run on machine_default; each has a
+// *_machine() variant for an arbitrary device (see machine_geometry.h).
+
+// ================= EQUILIBRIUM & PROFILES =================
+float grad_shafranov_solution(float R, float Z, float *params);
+float safety_factor_profile(float r_normalized, PlasmaState *state);
+float calculate_beta(PlasmaState *state);
+float calculate_beta_normalized(PlasmaState *state);
+
+float grad_shafranov_solution_machine(const MachineGeometry *machine,
+                                      float R, float Z, float *params);
+float safety_factor_profile_machine(const MachineGeometry *machine,
+                                    float r_normalized, PlasmaState *state);
+float calculate_beta_machine(const MachineGeometry *machine, PlasmaState *state);
+float calculate_beta_normalized_machine(const MachineGeometry *machine,
+                                        PlasmaState *state);
+
+// ================= MHD & TRANSIENTS =================
+float ntm_island_growth(float w, float w_sat, float delta_prime,
+                       float alpha, float beta, float dt);
+float elm_cycle_model(float time, float pedestal_pressure,
+                     float pedestal_current, float *params);
+float thermal_quench_model(float time_since_onset, float initial_energy,
+                          float impurity_concentration);
+float current_quench_model(float time_since_TQ, float initial_current,
+                          float plasma_resistance);
+float calculate_disruption_forces(PlasmaState *state, float *coil_currents);
+float calculate_disruption_forces_machine(const MachineGeometry *machine,
+                                          PlasmaState *state,
+                                          float *coil_currents);
+
+// ================= HEATING & TRANSPORT =================
+float ecrh_heating_model(float power, float frequency,
+                        PlasmaState *state, float *deposition_profile);
+float energy_confinement_time(PlasmaState *state, float heating_power);
+float ecrh_heating_model_machine(const MachineGeometry *machine,
+                                 float power, float frequency,
+                                 PlasmaState *state, float *deposition_profile);
+float energy_confinement_time_machine(const MachineGeometry *machine,
+                                      PlasmaState *state, float heating_power);
+
+// ================= TIME STEPPING =================
+// Circuit and transport constants of the 0D model
+#define PLASMA_INDUCTANCE 5.0e-7f
+#define PLASMA_RESISTANCE 1.0e-6f
+#define PARTICLE_CONFINEMENT_TIME 10.0f
+#define VERTICAL_DAMPING 0.1f
+#define LOOP_VOLTAGE_PER_PF_CURRENT 0.1f    // V_loop = 0.1 * pf_coil_currents[0]
+#define VERTICAL_FORCE_COUPLING 0.1f        // F per coil = 0.1 * I_coil * Ip
+
+// Explicit block updates on plain values, shared by advance_plasma_state()
+// and advance_plasma_batch() so the single-shot and batched plants use the
+// same constants and round identically
+static inline float plasma_current_step(float pf_coil_current, float plasma_current,
+                                        float dt) {
+    float Lp = PLASMA_INDUCTANCE;
+    float Rp = PLASMA_RESISTANCE;
+    float V_loop = pf_coil_current * LOOP_VOLTAGE_PER_PF_CURRENT;
+    float dIp_dt = (V_loop - Rp * plasma_current * 1e6) / Lp;
+    return plasma_current + dIp_dt * dt / 1e6;
+}
+
+static inline float plasma_energy_step(float stored_energy, float P_heating,
+                                       float energy_confinement_time, float dt) {
+    float P_loss = stored_energy / energy_confinement_time;
+    float dW_dt = P_heating - P_loss;
+    return stored_energy + dW_dt * dt;
+}
+
+static inline float plasma_core_temperature(float stored_energy, float density_core,
+                                            float plasma_volume) {
+    return stored_energy * 1e6 / (1.5f * density_core * 1e19 *
+                                  plasma_volume * ELECTRON_CHARGE * 1000.0f);
+}
+
+static inline float plasma_density_step(float fuel_injection_rate, float density_core,
+                                        float plasma_volume, float dt) {
+    float S_in = fuel_injection_rate;
+    float tau_p = PARTICLE_CONFINEMENT_TIME;
+    float S_out = density_core * 1e19 * plasma_volume / tau_p;
+    float dn_dt = (S_in - S_out) / plasma_volume;
+    return density_core + dn_dt * dt / 1e19;
+}
+
+static inline float plasma_mass(float density_core, float plasma_volume) {
+    return density_core * 1e19 * plasma_volume * (PROTON_MASS + ELECTRON_MASS);
+}
+
+static inline float plasma_vertical_force(float coil_current, float plasma_current) {
+    return coil_current * plasma_current * VERTICAL_FORCE_COUPLING;
+}
+
+static inline float plasma_position_step(float z, float F_vertical, float mass_plasma,
+                                         float dt) {
+    float damping = VERTICAL_DAMPING;
+    float dVz_dt = (F_vertical - damping * z) / mass_plasma;
+    return z + (z * dt + 0.5f * dVz_dt * dt * dt);
+}
+
+void advance_plasma_state(PlasmaState *state, PlasmaControlSystem *control,
+                         float dt);
+void advance_plasma_state_machine(const MachineGeometry *machine,
+                                  PlasmaState *state,
+                                  PlasmaControlSystem *control, float dt);
+
+// The same step with the vertical force F = vertical_force_per_ma * Ip
+// supplied by the caller (coil_response.h) in place of the per-coil
+// 0.1 * I_coil * Ip sum; Ip is the value after this step's circuit update
+void advance_plasma_state_coupled(PlasmaState *state, PlasmaControlSystem *control,
+                                  float vertical_force_per_ma, float dt);
+void advance_plasma_state_coupled_machine(const MachineGeometry *machine,
+                                          PlasmaState *state,
+                                          PlasmaControlSystem *control,
+                                          float vertical_force_per_ma, float dt);
+
+// ================= STIFF & ADAPTIVE TIME STEPPING =================
+// advance_plasma_state() is explicit Euler: the vertical damping term goes
+// unstable above dt ~ 0.06 s and the circuit and transport balances lose
+// accuracy well before that. advance_plasma_state_integrated() advances the
+// same model with a runtime-selected integrator:
+//   INTEGRATOR_EULER          advance_plasma_state() itself (reference)
+//   INTEGRATOR_SEMI_IMPLICIT  circuit, energy and particle balances relaxed
+//                             exactly over dt (exponential Euler), vertical
+//                             damping implicit; one evaluation per call, at
+//                             any dt
+//   INTEGRATOR_ADAPTIVE       the three balances by an embedded
+//                             Bogacki-Shampine 3(2) pair with step-size
+//                             control, vertical map as semi-implicit; for
+//                             confinement_scaling runs, where tau_E follows
+//                             the IPB98 law along the substeps
+// Actuators are held over the call. With confinement_scaling set (and
+// heating on), tau_E is taken from energy_confinement_time() of the evolving
+// state instead of control->energy_confinement_time, and the final value is
+// written back there. The substep size carries over between calls.
+
+typedef enum {
+    INTEGRATOR_EULER,
+    INTEGRATOR_SEMI_IMPLICIT,
+    INTEGRATOR_ADAPTIVE
+} IntegratorMode;
+
+#define INTEGRATOR_DEFAULT_RTOL 1e-4f
+#define INTEGRATOR_DEFAULT_ATOL 1e-6f
+#define INTEGRATOR_SUBSTEP_MIN 1e-6f      // s
+#define INTEGRATOR_SUBSTEP_MAX 1.0f       // s
+#define INTEGRATOR_SAFETY 0.9f
+#define INTEGRATOR_GROWTH_MAX 5.0f
+#define INTEGRATOR_SHRINK_MIN 0.2f
+
+typedef struct {
+    uint64_t steps;                 // calls
+    uint64_t substeps;              // accepted substeps
+    uint64_t rejected;              // rejected adaptive substeps
+    float substep_last;             // s
+    float substep_min;
+    float substep_max;
+    float error_last;               // normalized error of the last substep, <= 1
+} IntegratorStats;
+
+typedef struct {
+    IntegratorMode mode;
+    bool confinement_scaling;
+    float relative_tolerance;
+    float absolute_tolerance;       // state units (MA, MJ, 1e19 m^-3)
+    float substep_min;
+    float substep_max;
+    float substep;                  // adaptive step carried between calls
+    IntegratorStats stats;
+} PlasmaIntegrator;
+
+void plasma_integrator_init(PlasmaIntegrator *integrator, IntegratorMode mode);
+const char *integrator_mode_name(IntegratorMode mode);
+
+void advance_plasma_state_integrated(PlasmaIntegrator *integrator,
+                                     PlasmaState *state,
+                                     PlasmaControlSystem *control, float dt);
+void advance_plasma_state_integrated_machine(const MachineGeometry *machine,
+                                             PlasmaIntegrator *integrator,
+                                             PlasmaState *state,
+                                             PlasmaControlSystem *control,
+                                             float dt);
+
+// ================= MULTI-RATE STEPPING =================
+// advance_plasma_state() updates all five blocks of the 0D model every
+// call, although their time scales are far apart: the vertical map must
+// follow every control cycle, the circuit follows the coil voltage, while
+// density (tau_p = 10 s) and stored energy (tau_E ~ 5 s) move on seconds.
+// advance_plasma_state_scheduled() runs each block at its own period, a
+// whole number of calls (ticks):
+//
+//   block      default period   reads                      writes
+//   current    1                coil voltage, Ip           Ip
+//   energy     slow_period      heating, W, n (handoff)    W, T_e
+//   density    slow_period      fuelling, n                n, plasma mass
+//   position   1                Ip, z, mass (handoff)      z
+//   stability  1                Ip, n, T_e, z              q95, beta_N, MHD
+//
+// A block with period N and phase p runs on ticks p, p + N, ... and steps
+// N * dt with the explicit update of advance_plasma_state(), so a slow
+// period must stay well below its block's time constant. Blocks run in the
+// table order whatever their periods, so a tick is a fixed sequence: the
+// fast blocks every time, plus whichever slow block is due. By default the
+// density block is half a period out of phase with the energy block, so no
+// tick carries both.
+//
+// Slow outputs reach the fast blocks through a double-buffered handoff. A
+// slow block fills the back slot (from a copy of the front) and publishes
+// it by flipping the front index; fast blocks read only the front, never
+// a half-written set. Published values are mirrored into the PlasmaState
+// and control->stored_energy for everything observing them. The handoff
+// loads from the state on the first tick; call plasma_scheduler_sync()
+// again whenever something else writes n, T_e or W (a snapshot restore,
+// the quench model).
+//
+// With every period 1 a tick is bit-identical to advance_plasma_state().
+
+typedef enum {
+    PLASMA_BLOCK_CURRENT,
+    PLASMA_BLOCK_ENERGY,
+    PLASMA_BLOCK_DENSITY,
+    PLASMA_BLOCK_POSITION,
+    PLASMA_BLOCK_STABILITY,
+    PLASMA_BLOCK_COUNT
+} PlasmaBlock;
+
+#define PLASMA_SLOW_PERIOD_DEFAULT 10     // ticks
+
+typedef struct {
+    uint32_t period;                // ticks
+    uint32_t phase;                 // first tick, < period
+    uint32_t countdown;             // ticks to the next run
+    float step_scale;               // period, as the dt multiplier
+    uint64_t runs;
+} PlasmaBlockSchedule;
+
+// Outputs of the slow blocks read by the fast ones
+typedef struct {
+    float stored_energy;            // MJ
+    float temperature_core;         // keV
+    float density_core;             // 1e19 m^-3
+    float mass;                     // plasma mass, kg
+} PlasmaSlowHandoff;
+
+typedef struct {
+    PlasmaBlockSchedule blocks[PLASMA_BLOCK_COUNT];
+    PlasmaSlowHandoff slot[2];
+    uint32_t front;                 // slot the fast blocks read
+    bool synced;
+    uint64_t published;
+    uint64_t tick;
+} PlasmaScheduler;
+
+// Energy and density at slow_period, everything else every tick; returns
+// -1 for a zero period
+int plasma_scheduler_init(PlasmaScheduler *scheduler, uint32_t slow_period);
+// Returns -1 for an unknown block, a zero period or phase >= period
+int plasma_scheduler_set_period(PlasmaScheduler *scheduler, PlasmaBlock block,
+                                uint32_t period, uint32_t phase);
+const char *plasma_block_name(PlasmaBlock block);
+
+void plasma_scheduler_sync(PlasmaScheduler *scheduler, const PlasmaState *state,
+                           const PlasmaControlSystem *control);
+void plasma_scheduler_sync_machine(const MachineGeometry *machine,
+                                   PlasmaScheduler *scheduler,
+                                   const PlasmaState *state,
+                                   const PlasmaControlSystem *control);
+
+void advance_plasma_state_scheduled(PlasmaScheduler *scheduler, PlasmaState *state,
+                                    PlasmaControlSystem *control, float dt);
+void advance_plasma_state_scheduled_machine(const MachineGeometry *machine,
+                                            PlasmaScheduler *scheduler,
+                                            PlasmaState *state,
+                                            PlasmaControlSystem *control,
+                                            float dt);
+
+#endif // PLASMA_PHYSICS_H
@@ -0,0 +1,45 @@
+#include "plasma_rng.h"
+
+static uint64_t splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void plasma_rng_seed(PlasmaRng *rng, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ splitmix64(&stream);
+    uint64_t a = splitmix64(&x);
+    uint64_t b = splitmix64(&x);
+    rng->s[0] = (uint32_t)a;
+    rng->s[1] = (uint32_t)(a >> 32);
+    rng->s[2] = (uint32_t)b;
+    rng->s[3] = (uint32_t)(b >> 32);
+    if ((rng->s[0] | rng->s[1] | rng->s[2] | rng->s[3]) == 0) {
+        rng->s[0] = 1;
+    }
+}
+
+void plasma_rng_fill_uniform(PlasmaRng *rng, float *out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        out[i] = plasma_rng_uniform(rng);
+    }
+}
+
+void plasma_rng_fill_lanes(uint32_t *restrict s0, uint32_t *restrict s1,
+                           uint32_t *restrict s2, uint32_t *restrict s3,
+                           float *restrict out, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t result = s0[i] + s3[i];
+        uint32_t t = s1[i] << 9;
+        uint32_t x2 = s2[i] ^ s0[i];
+        uint32_t x3 = s3[i] ^ s1[i];
+        uint32_t x1 = s1[i] ^ x2;
+        uint32_t x0 = s0[i] ^ x3;
+        s0[i] = x0;
+        s1[i] = x1;
+        s2[i] = x2 ^ t;
+        s3[i] = plasma_rng_rotl(x3, 11);
+        out[i] = (float)(result >> 8) * 0x1.0p-24f;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef PLASMA_RNG_H
+#define PLASMA_RNG_H
+
+#include "npe_config.h"
+#include <stddef.h>
+
+// ================= PER-STREAM RNG =================
+// xoshiro128+ generator owned by each simulation instance
+// (PlasmaControlSystem.rng) instead of the global rand() state. A stream is
+// fully determined by (seed, stream id), so a shot reproduces bit for bit
+// regardless of thread count or the order in which shots run. An all-zero
+// state is a fixed point: seed every PlasmaControlSystem before stepping.
+
+void plasma_rng_seed(PlasmaRng *rng, uint64_t seed, uint64_t stream);
+
+static inline uint32_t plasma_rng_rotl(uint32_t x, int k) {
+    return (x << k) | (x >> (32 - k));
+}
+
+static inline uint32_t plasma_rng_next(PlasmaRng *rng) {
+    uint32_t *s = rng->s;
+    uint32_t result = s[0] + s[3];
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = plasma_rng_rotl(s[3], 11);
+    return result;
+}
+
+// Uniform in [0, 1) from the top 24 bits
+static inline float plasma_rng_uniform(PlasmaRng *rng) {
+    return (float)(plasma_rng_next(rng) >> 8) * 0x1.0p-24f;
+}
+
+void plasma_rng_fill_uniform(PlasmaRng *rng, float *out, size_t n);
+
+// One draw per lane from n independent streams stored as structure of
+// arrays (s[k][i] is word k of stream i), as used by PlasmaBatch.
+void plasma_rng_fill_lanes(uint32_t *s0, uint32_t *s1, uint32_t *s2,
+                           uint32_t *s3, float *out, size_t n);
+
+#endif // PLASMA_RNG_H
@@ -0,0 +1,215 @@
+#include "plasma_safety.h"
+#include "machine_geometry.h"
+#include <string.h>
+
+static const ControlAdjustment cause_adjustment[DISRUPTION_CAUSE_COUNT] = {
+    [DISRUPTION_CAUSE_NONE] = CONTROL_ADJUST_NONE,
+    [DISRUPTION_CAUSE_LOW_Q95] = CONTROL_ADJUST_REDUCE_CURRENT,
+    [DISRUPTION_CAUSE_BETA_LIMIT] = CONTROL_ADJUST_REDUCE_HEATING,
+    [DISRUPTION_CAUSE_DENSITY_LIMIT] = CONTROL_ADJUST_REDUCE_FUELING,
+    [DISRUPTION_CAUSE_VDE] = CONTROL_ADJUST_VERTICAL_GAIN,
+    [DISRUPTION_CAUSE_LOCKED_MODE] = CONTROL_ADJUST_ECRH_STABILIZE,
+    [DISRUPTION_CAUSE_RADIATION] = CONTROL_ADJUST_REDUCE_IMPURITY,
+};
+
+void disruption_predictor_init(DisruptionPredictor *predictor) {
+    memset(predictor, 0, sizeof(*predictor));
+}
+
+// Greenwald fraction with density_core in 1e19 m^-3 and Ip in MA
+static inline float greenwald_fraction(const PlasmaState *state) {
+    float n_G = fmaxf(state->plasma_current, 1e-3f) *
+                machine_default.greenwald_coefficient;
+    return (state->density_core * 0.1f) / n_G;
+}
+
+void update_disruption_flags(SafetyMitigationSystem *safety,
+                             const PlasmaState *state) {
+    safety->disruption_flags.vertical_displacement_event =
+        fabsf(state->vertical_position) > VERTICAL_DISPLACEMENT_MAX;
+    safety->disruption_flags.density_limit_exceeded =
+        greenwald_fraction(state) > 1.0f;
+    safety->disruption_flags.beta_limit_exceeded =
+        state->beta_normalized > BETA_NORMAL_LIMIT;
+}
+
+void predict_disruption(DisruptionPredictor *predictor,
+                        const PlasmaState *state,
+                        const SafetyMitigationSystem *safety,
+                        float dt, DisruptionPrediction *prediction) {
+    float margin[DISRUPTION_CAUSE_COUNT];
+    float locked = fmaxf(state->ntm_amplitude / PREDICTOR_NTM_LOCK_AMPLITUDE,
+                         state->mhd_activity_level / PREDICTOR_MHD_LOCK_LEVEL);
+
+    margin[DISRUPTION_CAUSE_NONE] = 1.0f;
+    margin[DISRUPTION_CAUSE_LOW_Q95] =
+        (state->safety_factor_q95 - SAFETY_FACTOR_Q95_MIN) / SAFETY_FACTOR_Q95_MIN;
+    margin[DISRUPTION_CAUSE_BETA_LIMIT] =
+        (BETA_NORMAL_LIMIT - state->beta_normalized) / BETA_NORMAL_LIMIT;
+    margin[DISRUPTION_CAUSE_DENSITY_LIMIT] = 1.0f - greenwald_fraction(state);
+    margin[DISRUPTION_CAUSE_VDE] =
+        (VERTICAL_DISPLACEMENT_MAX - fabsf(state->vertical_position)) /
+        VERTICAL_DISPLACEMENT_MAX;
+    margin[DISRUPTION_CAUSE_LOCKED_MODE] = 1.0f - locked;
+    margin[DISRUPTION_CAUSE_RADIATION] =
+        (RADIATION_PEAK_LIMIT - state->radiation_power) / RADIATION_PEAK_LIMIT;
+
+    // Flags raised by diagnostics pin the matching margin at the limit
+    if (safety->disruption_flags.locked_mode_detected)
+        margin[DISRUPTION_CAUSE_LOCKED_MODE] = fminf(margin[DISRUPTION_CAUSE_LOCKED_MODE], 0.0f);
+    // A rotating NTM is the usual precursor of a locked mode
+    if (safety->disruption_flags.ntm_detected)
+        margin[DISRUPTION_CAUSE_LOCKED_MODE] = fminf(margin[DISRUPTION_CAUSE_LOCKED_MODE], PREDICTOR_MARGIN_KNEE);
+    if (safety->disruption_flags.vertical_displacement_event)
+        margin[DISRUPTION_CAUSE_VDE] = fminf(margin[DISRUPTION_CAUSE_VDE], 0.0f);
+    if (safety->disruption_flags.density_limit_exceeded)
+        margin[DISRUPTION_CAUSE_DENSITY_LIMIT] = fminf(margin[DISRUPTION_CAUSE_DENSITY_LIMIT], 0.0f);
+    if (safety->disruption_flags.beta_limit_exceeded)
+        margin[DISRUPTION_CAUSE_BETA_LIMIT] = fminf(margin[DISRUPTION_CAUSE_BETA_LIMIT], 0.0f);
+
+    float survive = 1.0f;
+    float best_p = 0.0f;
+    int best = DISRUPTION_CAUSE_NONE;
+    for (int k = DISRUPTION_CAUSE_NONE + 1; k < DISRUPTION_CAUSE_COUNT; k++) {
+        float p = 1.0f / (1.0f + expf(PREDICTOR_SHARPNESS *
+                                      (margin[k] - PREDICTOR_MARGIN_KNEE)));
+        predictor->probability[k] = p;
+        survive *= 1.0f - p;
+        best = p > best_p ? k : best;
+        best_p = fmaxf(p, best_p);
+    }
+    float probability = 1.0f - survive;
+
+    // A quench already under way means the disruption is happening now
+    bool quench = safety->disruption_flags.thermal_quench_detected ||
+                  safety->disruption_flags.current_quench_detected;
+
+    float m = margin[best];
+    float closing = predictor->primed && dt > 0.0f ?
+                    (predictor->margin[best] - m) / dt : 0.0f;
+    float ttd = closing > 0.0f ? m / closing : PREDICTOR_TTD_MAX;
+    ttd = m <= 0.0f || quench ? 0.0f : fminf(fmaxf(ttd, 0.0f), PREDICTOR_TTD_MAX);
+
+    memcpy(predictor->margin, margin, sizeof(margin));
+    predictor->primed = true;
+
+    prediction->disruption_probability = quench ? 1.0f : probability;
+    prediction->time_to_disruption = ttd;
+    prediction->most_likely_cause = best_p >= PREDICTOR_CAUSE_PROBABILITY || quench ?
+                                    (DisruptionCause)best : DISRUPTION_CAUSE_NONE;
+}
+
+// First ready system in order of preference, MITIGATION_NONE if none is
+static MitigationAction first_ready(const SafetyMitigationSystem *safety,
+                                    MitigationAction a, MitigationAction b,
+                                    MitigationAction c) {
+    const MitigationAction order[3] = { a, b, c };
+    for (int i = 0; i < 3; i++) {
+        bool ready = false;
+        switch (order[i]) {
+        case MITIGATION_MGI:
+            ready = safety->mitigation_systems.massive_gas_injection_ready;
+            break;
+        case MITIGATION_PELLET:
+            ready = safety->mitigation_systems.pellet_injection_ready;
+            break;
+        case MITIGATION_KILLERPULSE:
+            ready = safety->mitigation_systems.killer_pulse_ready;
+            break;
+        case MITIGATION_MGI_KILLERPULSE:
+            ready = safety->mitigation_systems.massive_gas_injection_ready &&
+                    safety->mitigation_systems.killer_pulse_ready;
+            break;
+        default:
+            break;
+        }
+        if (ready) return order[i];
+    }
+    return MITIGATION_NONE;
+}
+
+void select_mitigation(const DisruptionPrediction *prediction,
+                       const SafetyMitigationSystem *safety,
+                       MitigationDecision *decision) {
+    float p = prediction->disruption_probability;
+    float ttd = prediction->time_to_disruption;
+    DisruptionCause cause = prediction->most_likely_cause;
+
+    decision->action = MITIGATION_NONE;
+    decision->control_adjustment = CONTROL_ADJUST_NONE;
+    decision->adjustment_magnitude = 0.0f;
+    decision->urgency = fmaxf(p, 1.0f - ttd / DISRUPTION_WARNING_TIME);
+    decision->urgency = fminf(fmaxf(decision->urgency, 0.0f), 1.0f);
+
+    if (p < MITIGATION_ADJUST_PROBABILITY) {
+        return;
+    }
+
+    // Enough time left to steer away from the limit
+    if (p < MITIGATION_TRIGGER_PROBABILITY && ttd > DISRUPTION_WARNING_TIME) {
+        decision->action = MITIGATION_CONTROL_ADJUST;
+        decision->control_adjustment = cause_adjustment[cause];
+        decision->adjustment_magnitude = p;
+        return;
+    }
+
+    MitigationAction action;
+    bool runaway = safety->mitigation_systems.runaway_electron_mitigation;
+    switch (cause) {
+    case DISRUPTION_CAUSE_VDE:
+    case DISRUPTION_CAUSE_LOCKED_MODE:
+        action = runaway ?
+            first_ready(safety, MITIGATION_MGI_KILLERPULSE, MITIGATION_MGI, MITIGATION_PELLET) :
+            first_ready(safety, MITIGATION_MGI, MITIGATION_PELLET, MITIGATION_KILLERPULSE);
+        break;
+    case DISRUPTION_CAUSE_LOW_Q95:
+    case DISRUPTION_CAUSE_BETA_LIMIT:
+        action = first_ready(safety, MITIGATION_PELLET, MITIGATION_MGI, MITIGATION_KILLERPULSE);
+        break;
+    default:
+        action = first_ready(safety, MITIGATION_MGI, MITIGATION_PELLET, MITIGATION_KILLERPULSE);
+        break;
+    }
+
+    if (action == MITIGATION_NONE) {
+        // Nothing ready: the best remaining option is to steer
+        decision->action = MITIGATION_CONTROL_ADJUST;
+        decision->control_adjustment = cause_adjustment[cause];
+        decision->adjustment_magnitude = 1.0f;
+        return;
+    }
+    decision->action = action;
+}
+
+const char *disruption_cause_name(DisruptionCause cause) {
+    static const char *names[DISRUPTION_CAUSE_COUNT] = {
+        "none", "low q95", "beta limit", "density limit",
+        "vertical displacement", "locked mode", "radiation"
+    };
+    return (unsigned)cause < DISRUPTION_CAUSE_COUNT ? names[cause] : "unknown";
+}
+
+const char *mitigation_action_name(MitigationAction action) {
+    switch (action) {
+    case MITIGATION_NONE: return "none";
+    case MITIGATION_MGI: return "massive gas injection";
+    case MITIGATION_PELLET: return "shattered pellet";
+    case MITIGATION_KILLERPULSE: return "killer pulse";
+    case MITIGATION_MGI_KILLERPULSE: return "MGI + killer pulse";
+    case MITIGATION_CONTROL_ADJUST: return "control adjustment";
+    }
+    return "unknown";
+}
+
+const char *control_adjustment_name(ControlAdjustment adjustment) {
+    switch (adjustment) {
+    case CONTROL_ADJUST_NONE: return "none";
+    case CONTROL_ADJUST_REDUCE_CURRENT: return "reduce plasma current";
+    case CONTROL_ADJUST_REDUCE_HEATING: return "reduce heating power";
+    case CONTROL_ADJUST_REDUCE_FUELING: return "reduce fueling";
+    case CONTROL_ADJUST_VERTICAL_GAIN: return "raise vertical feedback gain";
+    case CONTROL_ADJUST_ECRH_STABILIZE: return "ECRH mode stabilisation";
+    case CONTROL_ADJUST_REDUCE_IMPURITY: return "reduce impurity injection";
+    }
+    return "unknown";
+}
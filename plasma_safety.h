@@ -0,0 +1,53 @@
+#ifndef PLASMA_SAFETY_H
+#define PLASMA_SAFETY_H
+
+#include "npe_config.h"
+
+// ================= DISRUPTION PREDICTION =================
+// Each control cycle, predict_disruption() turns the distance of the plasma
+// to each operational limit into a per-cause probability, combines them,
+// and estimates the time to disruption from how fast the dominant margin is
+// closing. select_mitigation() then maps the prediction and the readiness
+// of SafetyMitigationSystem onto a MitigationDecision.
+//
+// Both run a fixed number of operations (no data-dependent loops, no
+// allocation, no strings), so their cost is constant per cycle. Cause and
+// action names are only produced by the *_name() helpers, for logging.
+
+#define PREDICTOR_MARGIN_KNEE 0.15f       // margin at which p_cause = 0.5
+#define PREDICTOR_SHARPNESS 20.0f
+#define PREDICTOR_TTD_MAX 10.0f           // s, reported when margins are not closing
+#define PREDICTOR_NTM_LOCK_AMPLITUDE 0.1f // island width treated as locked
+#define PREDICTOR_MHD_LOCK_LEVEL 1.0f
+#define PREDICTOR_CAUSE_PROBABILITY 0.1f  // below this the cause is reported as none
+#define MITIGATION_ADJUST_PROBABILITY 0.3f
+#define MITIGATION_TRIGGER_PROBABILITY 0.7f
+
+typedef struct {
+    float margin[DISRUPTION_CAUSE_COUNT];       // normalised: 1 far, 0 at limit
+    float probability[DISRUPTION_CAUSE_COUNT];
+    bool primed;
+} DisruptionPredictor;
+
+void disruption_predictor_init(DisruptionPredictor *predictor);
+
+// Sets the disruption flags that follow directly from the plasma state
+// (VDE, density and beta limits). Locked-mode, NTM, TQ and CQ flags come
+// from diagnostics (see mhd_spectrum.h) and are left untouched.
+void update_disruption_flags(SafetyMitigationSystem *safety,
+                             const PlasmaState *state);
+
+void predict_disruption(DisruptionPredictor *predictor,
+                        const PlasmaState *state,
+                        const SafetyMitigationSystem *safety,
+                        float dt, DisruptionPrediction *prediction);
+
+void select_mitigation(const DisruptionPrediction *prediction,
+                       const SafetyMitigationSystem *safety,
+                       MitigationDecision *decision);
+
+const char *disruption_cause_name(DisruptionCause cause);
+const char *mitigation_action_name(MitigationAction action);
+const char *control_adjustment_name(ControlAdjustment adjustment);
+
+#endif // PLASMA_SAFETY_H
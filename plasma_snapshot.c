@@ -0,0 +1,75 @@
+#include "plasma_snapshot.h"
+#include "plasma_rng.h"
+#include <stdio.h>
+#include <string.h>
+
+static bool snapshot_layout_matches(const PlasmaSnapshot *snapshot) {
+    return snapshot->magic == PLASMA_SNAPSHOT_MAGIC &&
+           snapshot->version == PLASMA_SNAPSHOT_VERSION &&
+           snapshot->state_bytes == sizeof(PlasmaSystemState) &&
+           snapshot->control_bytes == sizeof(PlasmaControlSystem) &&
+           snapshot->diagnostics_bytes == sizeof(DiagnosticsSystem) &&
+           snapshot->safety_bytes == sizeof(SafetyMitigationSystem) &&
+           snapshot->predictor_bytes == sizeof(DisruptionPredictor);
+}
+
+void plasma_snapshot_take(PlasmaSnapshot *snapshot, const PlasmaSystemState *live) {
+    snapshot->magic = PLASMA_SNAPSHOT_MAGIC;
+    snapshot->version = PLASMA_SNAPSHOT_VERSION;
+    snapshot->state_bytes = sizeof(PlasmaSystemState);
+    snapshot->control_bytes = sizeof(PlasmaControlSystem);
+    snapshot->diagnostics_bytes = sizeof(DiagnosticsSystem);
+    snapshot->safety_bytes = sizeof(SafetyMitigationSystem);
+    snapshot->predictor_bytes = sizeof(DisruptionPredictor);
+    snapshot->iteration_count = live->control.iteration_count;
+    snapshot->simulation_time = live->control.simulation_time;
+    memset(snapshot->reserved, 0, sizeof(snapshot->reserved));
+    memcpy(&snapshot->state, live, sizeof(PlasmaSystemState));
+    snapshot->state.control.history = NULL;
+}
+
+int plasma_snapshot_restore(const PlasmaSnapshot *snapshot, PlasmaSystemState *dst) {
+    if (!snapshot_layout_matches(snapshot)) return -1;
+    struct StateHistory *history = dst->control.history;
+    memcpy(dst, &snapshot->state, sizeof(PlasmaSystemState));
+    dst->control.history = history;
+    return 0;
+}
+
+int plasma_snapshot_fork(const PlasmaSnapshot *snapshot, PlasmaSystemState *branches,
+                         uint32_t count) {
+    if (!snapshot_layout_matches(snapshot)) return -1;
+    for (uint32_t b = 0; b < count; b++) {
+        memcpy(&branches[b], &snapshot->state, sizeof(PlasmaSystemState));
+    }
+    return 0;
+}
+
+int plasma_snapshot_fork_batch(const PlasmaSnapshot *snapshot, PlasmaBatch *batch,
+                               uint32_t first, uint32_t count, uint64_t seed) {
+    if (!snapshot_layout_matches(snapshot)) return -1;
+    if (first > batch->capacity || count > batch->capacity - first) return -1;
+    PlasmaControlSystem control = snapshot->state.control;
+    for (uint32_t i = 0; i < count; i++) {
+        plasma_rng_seed(&control.rng, seed, first + i);
+        plasma_batch_load(batch, first + i, &control.current_state, &control);
+    }
+    return 0;
+}
+
+int plasma_snapshot_save(const PlasmaSnapshot *snapshot, const char *path) {
+    FILE *f = fopen(path, "wb");
+    if (!f) return -1;
+    size_t written = fwrite(snapshot, sizeof(*snapshot), 1, f);
+    if (fclose(f) != 0 || written != 1) return -1;
+    return 0;
+}
+
+int plasma_snapshot_load(PlasmaSnapshot *snapshot, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    size_t read = fread(snapshot, sizeof(*snapshot), 1, f);
+    fclose(f);
+    if (read != 1 || !snapshot_layout_matches(snapshot)) return -1;
+    return 0;
+}
@@ -0,0 +1,73 @@
+#ifndef PLASMA_SNAPSHOT_H
+#define PLASMA_SNAPSHOT_H
+
+#include "npe_config.h"
+#include "plasma_batch.h"
+#include "plasma_safety.h"
+
+// ================= SNAPSHOT / FORK =================
+// Checkpoint of a complete simulation instance, a PlasmaSystemState, as one
+// versioned POD blob. Taking and restoring a snapshot is a single memcpy
+// of the state, a few microseconds, so a what-if study can branch many
+// continuations from one flat-top state instead of replaying the ramp-up
+// for every branch.
+//
+// Everything in PlasmaSystemState is plain data except
+// PlasmaControlSystem.history. That is the owning instance's logging ring,
+// so it is cleared in the snapshot and left untouched on restore.
+//
+// Branches made by plasma_snapshot_fork() keep the snapshot's RNG stream.
+// They see the same MHD noise, so differences between branches come only
+// from what each one changes (common random numbers). Reseed a branch
+// with plasma_rng_seed() to sample the noise instead.
+//
+// A snapshot is only valid for the struct layout that wrote it. The
+// header records PLASMA_SNAPSHOT_VERSION and the size of every component,
+// and restore/load refuse a mismatch. Saved files are native-endian.
+
+#define PLASMA_SNAPSHOT_MAGIC 0x50534e50u    // "PNSP"
+#define PLASMA_SNAPSHOT_VERSION 1
+#define PLASMA_SNAPSHOT_ALIGN 64
+
+typedef struct {
+    PlasmaControlSystem control;
+    DiagnosticsSystem diagnostics;
+    SafetyMitigationSystem safety;
+    DisruptionPredictor predictor;
+} PlasmaSystemState;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t state_bytes;           // sizeof(PlasmaSystemState)
+    uint32_t control_bytes;
+    uint32_t diagnostics_bytes;
+    uint32_t safety_bytes;
+    uint32_t predictor_bytes;
+    uint32_t iteration_count;       // of the snapshot, for bookkeeping
+    float simulation_time;
+    uint32_t reserved[7];
+    _Alignas(PLASMA_SNAPSHOT_ALIGN) PlasmaSystemState state;
+} PlasmaSnapshot;
+
+void plasma_snapshot_take(PlasmaSnapshot *snapshot, const PlasmaSystemState *live);
+
+// Copies the snapshot into dst, keeping dst's history ring. Returns -1
+// if the snapshot was written with a different layout.
+int plasma_snapshot_restore(const PlasmaSnapshot *snapshot, PlasmaSystemState *dst);
+
+// Restores the snapshot into branches[0..count), with no history ring.
+int plasma_snapshot_fork(const PlasmaSnapshot *snapshot, PlasmaSystemState *branches,
+                         uint32_t count);
+
+// Loads the snapshot's plasma into lanes [first, first + count) of a
+// batch for an ensemble continuation. Lane i gets RNG stream
+// (seed, first + i). Returns -1 on a layout mismatch or lanes past the
+// batch's capacity.
+int plasma_snapshot_fork_batch(const PlasmaSnapshot *snapshot, PlasmaBatch *batch,
+                               uint32_t first, uint32_t count, uint64_t seed);
+
+int plasma_snapshot_save(const PlasmaSnapshot *snapshot, const char *path);
+int plasma_snapshot_load(PlasmaSnapshot *snapshot, const char *path);
+
+#endif // PLASMA_SNAPSHOT_H
@@ -0,0 +1,210 @@
+#include "plasma_trace.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define TRACE_CALIBRATION_NS 10000000ull   // minimum span for the tick rate
+
+_Thread_local PlasmaTraceBuffer *plasma_trace_local;
+
+static _Atomic(PlasmaTraceBuffer *) trace_threads;
+static _Atomic uint32_t trace_thread_count;
+static pthread_once_t trace_epoch_once = PTHREAD_ONCE_INIT;
+static uint64_t trace_epoch_ticks;
+static uint64_t trace_epoch_ns;
+
+static const char *const stage_names[TRACE_STAGE_COUNT] = {
+    [TRACE_STAGE_CURRENT] = "current",
+    [TRACE_STAGE_ENERGY] = "energy",
+    [TRACE_STAGE_DENSITY] = "density",
+    [TRACE_STAGE_POSITION] = "position",
+    [TRACE_STAGE_STABILITY] = "stability",
+    [TRACE_STAGE_CYCLE_ACTUATORS] = "actuators",
+    [TRACE_STAGE_CYCLE_PLASMA] = "plasma",
+    [TRACE_STAGE_CYCLE_WARNINGS] = "warnings",
+    [TRACE_STAGE_CYCLE_SAFETY] = "safety",
+    [TRACE_STAGE_CYCLE_CONTROLLER] = "controller",
+    [TRACE_STAGE_CYCLE_HISTORY] = "history",
+};
+
+const char *trace_stage_name(TraceStage stage) {
+    return (unsigned)stage < TRACE_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+static const char *trace_stage_category(uint32_t stage) {
+    return stage < TRACE_STAGE_CYCLE_ACTUATORS ? "advance_plasma_state" : "cycle";
+}
+
+static uint64_t monotonic_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+}
+
+static void trace_epoch_init(void) {
+    trace_epoch_ns = monotonic_ns();
+    trace_epoch_ticks = plasma_trace_now();
+}
+
+// Ticks per ns, measured against CLOCK_MONOTONIC since the first thread
+// registered; waits out a too short span rather than guess
+static double trace_tick_rate(void) {
+    uint64_t ns = monotonic_ns();
+    while (ns - trace_epoch_ns < TRACE_CALIBRATION_NS) ns = monotonic_ns();
+    uint64_t ticks = plasma_trace_now();
+    return (double)(ticks - trace_epoch_ticks) / (double)(ns - trace_epoch_ns);
+}
+
+int plasma_trace_thread_init(const char *name) {
+    if (plasma_trace_local) return 0;
+    pthread_once(&trace_epoch_once, trace_epoch_init);
+
+    PlasmaTraceBuffer *buffer = calloc(1, sizeof(*buffer));
+    if (!buffer) return -1;
+    buffer->events = aligned_alloc(64, PLASMA_TRACE_CAPACITY * sizeof(TraceEvent));
+    if (!buffer->events) {
+        free(buffer);
+        return -1;
+    }
+    // Fault the ring in now, not on the first events of the loop
+    memset(buffer->events, 0, PLASMA_TRACE_CAPACITY * sizeof(TraceEvent));
+    atomic_init(&buffer->head, 0);
+    buffer->thread_index = atomic_fetch_add(&trace_thread_count, 1);
+    if (name) {
+        snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+    } else {
+        snprintf(buffer->name, sizeof(buffer->name), "thread %u",
+                 buffer->thread_index);
+    }
+
+    PlasmaTraceBuffer *head = atomic_load_explicit(&trace_threads,
+                                                   memory_order_relaxed);
+    do {
+        buffer->next = head;
+    } while (!atomic_compare_exchange_weak_explicit(&trace_threads, &head, buffer,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+    plasma_trace_local = buffer;
+    return 0;
+}
+
+// Copies the ring's live events, oldest first. Events the owner overwrote
+// during the copy are dropped. Returns the count, or -1 on allocation failure.
+static long trace_snapshot(const PlasmaTraceBuffer *buffer, TraceEvent **out) {
+    uint64_t end = atomic_load_explicit(&buffer->head, memory_order_acquire);
+    uint64_t begin = end > PLASMA_TRACE_CAPACITY ? end - PLASMA_TRACE_CAPACITY : 0;
+    TraceEvent *events = malloc((size_t)(end - begin + 1) * sizeof(TraceEvent));
+    if (!events) return -1;
+    for (uint64_t i = begin; i < end; i++) {
+        events[i - begin] = buffer->events[i & (PLASMA_TRACE_CAPACITY - 1)];
+    }
+    atomic_thread_fence(memory_order_acquire);
+    uint64_t now = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    // Slot now & (CAP - 1) may be mid-write with event now, so event
+    // now - CAP that it held is lost too
+    uint64_t valid = now + 1 > PLASMA_TRACE_CAPACITY ? now + 1 - PLASMA_TRACE_CAPACITY : 0;
+    if (valid > end) valid = end;
+    if (valid > begin) {
+        memmove(events, events + (valid - begin),
+                (size_t)(end - valid) * sizeof(TraceEvent));
+        begin = valid;
+    }
+    *out = events;
+    return (long)(end - begin);
+}
+
+int plasma_trace_export_chrome(const char *path) {
+    PlasmaTraceBuffer *threads = atomic_load_explicit(&trace_threads,
+                                                      memory_order_acquire);
+    if (!threads) return -1;
+    FILE *f = fopen(path, "w");
+    if (!f) return -1;
+
+    double ticks_per_us = trace_tick_rate() * 1000.0;
+    int pid = (int)getpid();
+    int rc = 0;
+    bool first = true;
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    for (PlasmaTraceBuffer *t = threads; t; t = t->next) {
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,"
+                "\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                first ? "" : ",\n", pid, t->thread_index, t->name);
+        first = false;
+
+        TraceEvent *events;
+        long count = trace_snapshot(t, &events);
+        if (count < 0) {
+            rc = -1;
+            continue;
+        }
+        for (long i = 0; i < count; i++) {
+            const TraceEvent *e = &events[i];
+            double ts = (double)(int64_t)(e->start - trace_epoch_ticks) / ticks_per_us;
+            fprintf(f, ",\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+                    "\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                    trace_stage_name((TraceStage)e->stage),
+                    trace_stage_category(e->stage), pid, t->thread_index,
+                    ts, e->duration / ticks_per_us);
+        }
+        free(events);
+    }
+    fprintf(f, "\n]}\n");
+    if (fclose(f) != 0) rc = -1;
+    return rc;
+}
+
+static int compare_u32(const void *a, const void *b) {
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+void plasma_trace_summary(FILE *out) {
+    long total = 0;
+    TraceEvent *all = NULL;
+    for (PlasmaTraceBuffer *t = atomic_load_explicit(&trace_threads,
+                                                     memory_order_acquire);
+         t; t = t->next) {
+        TraceEvent *events;
+        long count = trace_snapshot(t, &events);
+        if (count <= 0) {
+            if (count == 0) free(events);
+            continue;
+        }
+        TraceEvent *grown = realloc(all, (size_t)(total + count) * sizeof(TraceEvent));
+        if (grown) {
+            all = grown;
+            memcpy(all + total, events, (size_t)count * sizeof(TraceEvent));
+            total += count;
+        }
+        free(events);
+    }
+    uint32_t *durations = total > 0 ? malloc((size_t)total * sizeof(uint32_t)) : NULL;
+    if (!durations) {
+        free(all);
+        fprintf(out, "Stage trace: no events\n");
+        return;
+    }
+
+    double ns_per_tick = 1.0 / trace_tick_rate();
+    fprintf(out, "Stage trace (%ld events)\n", total);
+    fprintf(out, "  %-12s %9s %10s %10s %10s\n", "stage", "count",
+            "mean ns", "p99 ns", "max ns");
+    for (uint32_t s = 0; s < TRACE_STAGE_COUNT; s++) {
+        long n = 0;
+        double sum = 0.0;
+        for (long i = 0; i < total; i++) {
+            if (all[i].stage != s) continue;
+            durations[n++] = all[i].duration;
+            sum += all[i].duration;
+        }
+        if (n == 0) continue;
+        qsort(durations, (size_t)n, sizeof(uint32_t), compare_u32);
+        fprintf(out, "  %-12s %9ld %10.1f %10.1f %10.1f\n",
+                trace_stage_name((TraceStage)s), n, sum / n * ns_per_tick,
+                durations[(n - 1) * 99 / 100] * ns_per_tick,
+                durations[n - 1] * ns_per_tick);
+    }
+    free(durations);
+    free(all);
+}
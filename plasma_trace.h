@@ -0,0 +1,123 @@
+#ifndef PLASMA_TRACE_H
+#define PLASMA_TRACE_H
+
+#include "npe_config.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// ================= HOT-PATH STAGE TRACING =================
+// Per-stage timestamps for advance_plasma_state() and the driver's control
+// cycle, compiled in only with -DPLASMA_TRACE. Without it the macros below
+// expand to nothing and the hot path is unchanged.
+//
+// A stage costs one timestamp read (RDTSC on x86, CNTVCT on AArch64,
+// CLOCK_MONOTONIC elsewhere) and one 16-byte store: each stage ends where
+// the next begins, so a chain of stages shares timestamps:
+//   PLASMA_TRACE_MARK(t);
+//   ...current evolution...
+//   PLASMA_TRACE_STAGE(TRACE_STAGE_CURRENT, t);
+//   ...energy balance...
+//   PLASMA_TRACE_STAGE(TRACE_STAGE_ENERGY, t);
+//
+// Every thread writes its own ring of PLASMA_TRACE_CAPACITY events, with
+// no locks or shared cache lines; when full, the oldest events are
+// overwritten. Call plasma_trace_thread_init() before a real-time loop so
+// the ring is allocated and faulted in up front; otherwise the first event
+// on a thread allocates it. Exports may run while other threads trace:
+// events overwritten during the copy are dropped, never torn.
+
+#define PLASMA_TRACE_CAPACITY 65536       // events per thread, power of two
+#define PLASMA_TRACE_NAME_MAX 32
+
+typedef enum {
+    // advance_plasma_state()
+    TRACE_STAGE_CURRENT,
+    TRACE_STAGE_ENERGY,
+    TRACE_STAGE_DENSITY,
+    TRACE_STAGE_POSITION,
+    TRACE_STAGE_STABILITY,
+    // Driver control cycle
+    TRACE_STAGE_CYCLE_ACTUATORS,
+    TRACE_STAGE_CYCLE_PLASMA,
+    TRACE_STAGE_CYCLE_WARNINGS,
+    TRACE_STAGE_CYCLE_SAFETY,
+    TRACE_STAGE_CYCLE_CONTROLLER,
+    TRACE_STAGE_CYCLE_HISTORY,
+    TRACE_STAGE_COUNT
+} TraceStage;
+
+typedef struct {
+    uint64_t start;                 // timestamp ticks
+    uint32_t duration;              // ticks
+    uint32_t stage;
+} TraceEvent;
+
+typedef struct PlasmaTraceBuffer {
+    _Atomic uint64_t head;          // events written; only the owner stores
+    struct PlasmaTraceBuffer *next; // registry link
+    uint32_t thread_index;
+    char name[PLASMA_TRACE_NAME_MAX];
+    TraceEvent *events;
+} PlasmaTraceBuffer;
+
+extern _Thread_local PlasmaTraceBuffer *plasma_trace_local;
+
+// Registers the calling thread under `name` (NULL for "thread N") and
+// allocates its ring. Returns 0, or -1 if the allocation fails.
+int plasma_trace_thread_init(const char *name);
+
+const char *trace_stage_name(TraceStage stage);
+
+// Chrome trace / Perfetto JSON of every registered thread's ring
+int plasma_trace_export_chrome(const char *path);
+
+// Per-stage count, mean, p99 and max in ns
+void plasma_trace_summary(FILE *out);
+
+static inline uint64_t plasma_trace_now(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t ticks;
+    __asm__ volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ull + (uint64_t)t.tv_nsec;
+#endif
+}
+
+// Records [start, now) for `stage` and returns now, the next stage's start
+static inline uint64_t plasma_trace_stage(TraceStage stage, uint64_t start) {
+    uint64_t now = plasma_trace_now();
+    PlasmaTraceBuffer *buffer = plasma_trace_local;
+    if (__builtin_expect(buffer == NULL, 0)) {
+        if (plasma_trace_thread_init(NULL) != 0) return now;
+        buffer = plasma_trace_local;
+    }
+    uint64_t head = atomic_load_explicit(&buffer->head, memory_order_relaxed);
+    TraceEvent *event = &buffer->events[head & (PLASMA_TRACE_CAPACITY - 1)];
+    uint64_t duration = now - start;
+    event->start = start;
+    event->duration = duration > UINT32_MAX ? UINT32_MAX : (uint32_t)duration;
+    event->stage = (uint32_t)stage;
+    atomic_store_explicit(&buffer->head, head + 1, memory_order_release);
+    return now;
+}
+
+#ifdef PLASMA_TRACE
+#define PLASMA_TRACE_ENABLED 1
+#define PLASMA_TRACE_MARK(t) uint64_t t = plasma_trace_now()
+#define PLASMA_TRACE_STAGE(stage, t) ((t) = plasma_trace_stage((stage), (t)))
+#else
+#define PLASMA_TRACE_ENABLED 0
+#define PLASMA_TRACE_MARK(t) ((void)0)
+#define PLASMA_TRACE_STAGE(stage, t) ((void)0)
+#endif
+
+#endif // PLASMA_TRACE_H
@@ -0,0 +1,63 @@
+#include "profile_cache.h"
+#include <stdlib.h>
+#include <string.h>
+
+int profile_cache_init(ProfileCache *cache, uint32_t num_points) {
+    memset(cache, 0, sizeof(*cache));
+    if (num_points == 0) return -1;
+
+    float *block = malloc((size_t)num_points * 3 * sizeof(float));
+    if (!block) return -1;
+    cache->num_points = num_points;
+    cache->r = block;
+    cache->q_shape = block + num_points;
+    cache->deposition = block + 2 * (size_t)num_points;
+
+    for (uint32_t i = 0; i < num_points; i++) {
+        float r = (float)i / (float)num_points;
+        cache->r[i] = r;
+        cache->q_shape[i] = r * r * (1.0f + 0.5f * r * r);
+        cache->deposition[i] = expf(-powf(r - 0.5f, 2) / 0.1f);
+    }
+    return 0;
+}
+
+void profile_cache_free(ProfileCache *cache) {
+    free(cache->r);
+    memset(cache, 0, sizeof(*cache));
+}
+
+void profile_cache_update(ProfileCache *cache, const PlasmaState *state,
+                          const PlasmaControlSystem *control) {
+    if (!cache->valid || state->plasma_current != cache->plasma_current) {
+        float I_p = state->plasma_current * 1e6f;
+        cache->q_coefficient = machine_default.q_coefficient / I_p;
+        cache->plasma_current = state->plasma_current;
+        cache->q_rebuilds++;
+    }
+
+    bool heating_changed = !cache->valid;
+    for (int h = 0; h < NUM_HEATING_SYSTEMS && !heating_changed; h++) {
+        heating_changed = control->heating_systems[h].power != cache->heating_key[h].power ||
+                          control->heating_systems[h].frequency != cache->heating_key[h].frequency ||
+                          control->heating_systems[h].enabled != cache->heating_key[h].enabled;
+    }
+    if (heating_changed) {
+        cache->power_deposited_total = 0.0f;
+        for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+            cache->heating_key[h].power = control->heating_systems[h].power;
+            cache->heating_key[h].frequency = control->heating_systems[h].frequency;
+            cache->heating_key[h].enabled = control->heating_systems[h].enabled;
+
+            cache->absorption[h] = machine_ecrh_absorption(&machine_default,
+                                                           control->heating_systems[h].frequency);
+            cache->power_deposited[h] = control->heating_systems[h].power *
+                                        cache->absorption[h];
+            if (control->heating_systems[h].enabled) {
+                cache->power_deposited_total += cache->power_deposited[h];
+            }
+        }
+        cache->heating_rebuilds++;
+    }
+    cache->valid = true;
+}
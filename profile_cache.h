@@ -0,0 +1,69 @@
+#ifndef PROFILE_CACHE_H
+#define PROFILE_CACHE_H
+
+#include "machine_geometry.h"
+#include "npe_config.h"
+
+// ================= RADIAL PROFILE CACHE =================
+// Precomputed q(r) and ECRH deposition profiles on a radial grid
+// r_i = i / num_points (num_points = 10 reproduces the deposition_profile
+// written by ecrh_heating_model()).
+//
+// The radial shapes are built once at init. profile_cache_update() only
+// recomputes what depends on its keys: the q normalisation when
+// plasma_current changes, and the per-system absorption / deposited power
+// when the heating configuration changes. Grid resolution therefore has no
+// per-step cost.
+
+typedef struct {
+    uint32_t num_points;
+    float *r;
+    float *q_shape;                 // r^2 (1 + r^2 / 2)
+    float *deposition;              // exp(-(r - 0.5)^2 / 0.1)
+
+    // Keys
+    bool valid;
+    float plasma_current;
+    struct {
+        float power;
+        float frequency;
+        bool enabled;
+    } heating_key[NUM_HEATING_SYSTEMS];
+
+    // Derived from the keys
+    float q_coefficient;            // 2 pi B a^2 / (mu0 R0 Ip)
+    float absorption[NUM_HEATING_SYSTEMS];
+    float power_deposited[NUM_HEATING_SYSTEMS];
+    float power_deposited_total;
+
+    uint32_t q_rebuilds;
+    uint32_t heating_rebuilds;
+} ProfileCache;
+
+int profile_cache_init(ProfileCache *cache, uint32_t num_points);
+void profile_cache_free(ProfileCache *cache);
+
+// Refreshes whatever depends on inputs that changed since the last call.
+void profile_cache_update(ProfileCache *cache, const PlasmaState *state,
+                          const PlasmaControlSystem *control);
+
+// Same as safety_factor_profile() for the cached plasma current.
+static inline float profile_cache_q(const ProfileCache *cache, float r_normalized) {
+    return machine_safety_factor(&machine_default, r_normalized, cache->plasma_current);
+}
+
+// q at grid point i from the cached shape; within a few ULP of
+// profile_cache_q(cache->r[i]), not bit-identical.
+static inline float profile_cache_q_at(const ProfileCache *cache, uint32_t i) {
+    return cache->q_coefficient * cache->q_shape[i];
+}
+
+// Same as the return value of ecrh_heating_model() for heating system h.
+static inline float profile_cache_ecrh_delta_T(const ProfileCache *cache,
+                                               uint32_t h,
+                                               const PlasmaState *state) {
+    return cache->power_deposited[h] / (state->density_core * 1e19 *
+           ELECTRON_CHARGE * 1000.0f);
+}
+
+#endif // PROFILE_CACHE_H
@@ -0,0 +1,168 @@
+#include "psq_checker.h"
+#include "machine_geometry.h"
+#include <string.h>
+
+static const uint8_t check_cause[PSQ_CHECK_COUNT] = {
+    DISRUPTION_CAUSE_VDE,
+    DISRUPTION_CAUSE_LOW_Q95,
+    DISRUPTION_CAUSE_DENSITY_LIMIT,
+    DISRUPTION_CAUSE_BETA_LIMIT,
+    DISRUPTION_CAUSE_RADIATION,
+};
+
+// ================= QUANTIZATION =================
+// NaN maps to fail, the value that trips the matching check
+static uint16_t quantize_u16(float v, int bits, uint16_t fail, int *saturated) {
+    float r = rintf(v * (float)(1 << bits));
+    if (r != r) {
+        (*saturated)++;
+        return fail;
+    }
+    if (r < 0.0f || r > 65535.0f) {
+        (*saturated)++;
+        return r < 0.0f ? 0 : 65535;
+    }
+    return (uint16_t)r;
+}
+
+static int16_t quantize_s16(float v, int bits, int *saturated) {
+    float r = rintf(v * (float)(1 << bits));
+    if (r != r) {
+        (*saturated)++;
+        return INT16_MAX;
+    }
+    if (r < -32768.0f || r > 32767.0f) {
+        (*saturated)++;
+        return r < 0.0f ? INT16_MIN : INT16_MAX;
+    }
+    return (int16_t)r;
+}
+
+void psq_limits_default(PsqLimits *limits) {
+    int sat = 0;
+    const float keep = 1.0f - PSQ_WARNING_MARGIN;
+    limits->q95_min = quantize_u16(SAFETY_FACTOR_Q95_MIN, PSQ_Q_Q95, 0, &sat);
+    limits->q95_warn = quantize_u16(SAFETY_FACTOR_Q95_MIN * (1.0f + PSQ_WARNING_MARGIN),
+                                    PSQ_Q_Q95, 0, &sat);
+    limits->beta_n_max = quantize_u16(BETA_NORMAL_LIMIT, PSQ_Q_BETA, 0, &sat);
+    limits->beta_n_warn = quantize_u16(BETA_NORMAL_LIMIT * keep, PSQ_Q_BETA, 0, &sat);
+    limits->z_max = quantize_u16(VERTICAL_DISPLACEMENT_MAX, PSQ_Q_POSITION, 0, &sat);
+    limits->z_warn = quantize_u16(VERTICAL_DISPLACEMENT_MAX * keep, PSQ_Q_POSITION, 0, &sat);
+    limits->radiation_max = quantize_u16(RADIATION_PEAK_LIMIT, PSQ_Q_RADIATION, 0, &sat);
+    limits->radiation_warn = quantize_u16(RADIATION_PEAK_LIMIT * keep, PSQ_Q_RADIATION, 0, &sat);
+    // n_G / 1e19 = 10 Ip / (pi a^2)
+    limits->greenwald_scale = quantize_u16(10.0f * machine_default.greenwald_coefficient,
+                                           PSQ_Q_GREENWALD, 0, &sat);
+    limits->greenwald_warn = quantize_u16(keep, PSQ_Q_FRACTION, 0, &sat);
+}
+
+int psq_sample_from_state(const PlasmaState *state, uint32_t tag, PsqSample *sample) {
+    int sat = 0;
+    sample->tag = tag;
+    sample->q95 = quantize_u16(state->safety_factor_q95, PSQ_Q_Q95, 0, &sat);
+    sample->beta_n = quantize_u16(state->beta_normalized, PSQ_Q_BETA, UINT16_MAX, &sat);
+    sample->density = quantize_u16(state->density_core, PSQ_Q_DENSITY, UINT16_MAX, &sat);
+    sample->current = quantize_u16(state->plasma_current, PSQ_Q_CURRENT, 0, &sat);
+    sample->z = quantize_s16(state->vertical_position, PSQ_Q_POSITION, &sat);
+    sample->radiation = quantize_u16(state->radiation_power, PSQ_Q_RADIATION, UINT16_MAX, &sat);
+    return sat;
+}
+
+// ================= STAGE LOGIC =================
+// Shared by the pipeline and the combinational specification
+static void stage1(const PsqLimits *limits, const PsqSample *in, PsqChecker *c) {
+    c->s1.tag = in->tag;
+    c->s1.q95 = in->q95;
+    c->s1.beta_n = in->beta_n;
+    c->s1.abs_z = (uint16_t)(in->z < 0 ? -(int32_t)in->z : in->z);
+    c->s1.radiation = in->radiation;
+    // Q24 on both sides: density << 16 against Ip * scale << 8
+    uint64_t n_g = (uint64_t)in->current * limits->greenwald_scale;
+    c->s1.n_e = (uint64_t)in->density << (PSQ_Q_CURRENT + PSQ_Q_GREENWALD);
+    c->s1.n_limit = n_g << PSQ_Q_FRACTION;
+    c->s1.n_warn = n_g * limits->greenwald_warn;
+}
+
+static void stage2(const PsqLimits *limits, PsqChecker *c) {
+    uint8_t v = 0, w = 0;
+    v |= c->s1.abs_z > limits->z_max ? PSQ_CHECK_VDE : 0;
+    v |= c->s1.q95 < limits->q95_min ? PSQ_CHECK_Q95 : 0;
+    v |= c->s1.n_e > c->s1.n_limit ? PSQ_CHECK_DENSITY : 0;
+    v |= c->s1.beta_n > limits->beta_n_max ? PSQ_CHECK_BETA : 0;
+    v |= c->s1.radiation > limits->radiation_max ? PSQ_CHECK_RADIATION : 0;
+    w |= c->s1.abs_z > limits->z_warn ? PSQ_CHECK_VDE : 0;
+    w |= c->s1.q95 < limits->q95_warn ? PSQ_CHECK_Q95 : 0;
+    w |= c->s1.n_e > c->s1.n_warn ? PSQ_CHECK_DENSITY : 0;
+    w |= c->s1.beta_n > limits->beta_n_warn ? PSQ_CHECK_BETA : 0;
+    w |= c->s1.radiation > limits->radiation_warn ? PSQ_CHECK_RADIATION : 0;
+    c->s2.tag = c->s1.tag;
+    c->s2.violations = v;
+    c->s2.warnings = w;
+}
+
+static void stage3(PsqChecker *c, bool latch) {
+    PsqVerdict *out = &c->s3;
+    uint8_t v = c->s2.violations, w = c->s2.warnings;
+    uint8_t select = v ? v : w;
+    uint8_t cause = DISRUPTION_CAUSE_NONE;
+    for (int k = PSQ_CHECK_COUNT - 1; k >= 0; k--) {
+        cause = select & (1u << k) ? check_cause[k] : cause;
+    }
+    out->tag = c->s2.tag;
+    out->violations = v;
+    out->warnings = w;
+    out->cause = cause;
+    out->action = v ? PSQ_ACTION_TRIP : w ? PSQ_ACTION_CORRECT : PSQ_ACTION_NONE;
+    if (latch) c->tripped |= v != 0;
+    out->tripped = latch ? c->tripped : v != 0;
+    out->valid = true;
+}
+
+// ================= PIPELINE =================
+void psq_checker_init(PsqChecker *checker, const PsqLimits *limits) {
+    memset(checker, 0, sizeof(*checker));
+    checker->limits = *limits;
+}
+
+void psq_checker_reset(PsqChecker *checker) {
+    PsqLimits limits = checker->limits;
+    psq_checker_init(checker, &limits);
+}
+
+void psq_checker_clock(PsqChecker *checker, const PsqSample *in, PsqVerdict *out) {
+    // Registers update from the previous edge's values: last stage first
+    if (checker->s2.valid) {
+        stage3(checker, true);
+    } else {
+        checker->s3.valid = false;
+    }
+    checker->s3.tripped = checker->tripped;
+    checker->s2.valid = checker->s1.valid;
+    if (checker->s1.valid) stage2(&checker->limits, checker);
+    checker->s1.valid = in != NULL;
+    if (in) stage1(&checker->limits, in, checker);
+    checker->cycle++;
+    *out = checker->s3;
+}
+
+static void dut_reset(void *ctx) {
+    psq_checker_reset(ctx);
+}
+
+static void dut_clock(void *ctx, const PsqSample *in, PsqVerdict *out) {
+    psq_checker_clock(ctx, in, out);
+}
+
+PsqDut psq_checker_dut(PsqChecker *checker) {
+    return (PsqDut){ .name = "c-model", .ctx = checker,
+                     .reset = dut_reset, .clock = dut_clock };
+}
+
+void psq_checker_evaluate(const PsqLimits *limits, const PsqSample *in, PsqVerdict *out) {
+    PsqChecker c;
+    memset(&c, 0, sizeof(c));
+    stage1(limits, in, &c);
+    stage2(limits, &c);
+    stage3(&c, false);
+    *out = c.s3;
+}
@@ -0,0 +1,136 @@
+#ifndef PSQ_CHECKER_H
+#define PSQ_CHECKER_H
+
+#include "npe_config.h"
+
+// ================= PSQ SAFETY CHECKER REFERENCE MODEL =================
+// Bit-exact, cycle-level C model of the 3-stage PSQ safety checker
+// (rtl/fpga_hardip/fpga_hardip_psq.sv in the AION-1 flow). All arithmetic is
+// on the fixed-point words the checker receives, so a correct RTL
+// implementation matches it bit for bit:
+//
+//   S1  capture: register the sample, |z|, and the Greenwald products
+//       n_e * 2^16 against Ip * scale at the limit and the warning fraction
+//   S2  compare: one comparator per limit and per warning threshold
+//   S3  decide:  priority-encode the cause, pick the action, set the
+//       sticky trip latch
+//
+// One sample enters per clock and its verdict leaves PSQ_CHECKER_STAGES
+// clocks later. At PSQ_CHECKER_CLOCK_MHZ that is the latency checked against
+// the PSQ_CHECKER_LATENCY_BUDGET_NS claim.
+//
+// psq_checker_evaluate() is the same decision as one combinational
+// function, the specification the pipeline is checked against. PsqDut
+// abstracts "something clocked with samples": the reference pipeline, or
+// a Verilated RTL model behind a C shim (see simulation_c/npe_psq_cosim.c).
+
+#define PSQ_CHECKER_STAGES 3
+#define PSQ_CHECKER_CLOCK_MHZ 250
+#define PSQ_CHECKER_LATENCY_BUDGET_NS 40
+
+// Fixed-point formats (fractional bits)
+#define PSQ_Q_Q95 8                 // q95, Q8.8
+#define PSQ_Q_BETA 12               // beta_N, Q4.12
+#define PSQ_Q_DENSITY 8             // n_e core, 1e19 m^-3, Q8.8
+#define PSQ_Q_CURRENT 8             // Ip, MA, Q8.8
+#define PSQ_Q_POSITION 13           // z, m, Q2.13 signed
+#define PSQ_Q_RADIATION 8           // P_rad, MW, Q8.8
+#define PSQ_Q_GREENWALD 8           // 10 / (pi a^2), Q8.8
+#define PSQ_Q_FRACTION 8            // Greenwald warning fraction, Q0.8
+
+#define PSQ_WARNING_MARGIN 0.15f    // warnings at 15 % from each limit
+
+// Check bits, in priority order for the cause encoder
+enum {
+    PSQ_CHECK_VDE = 1u << 0,
+    PSQ_CHECK_Q95 = 1u << 1,
+    PSQ_CHECK_DENSITY = 1u << 2,
+    PSQ_CHECK_BETA = 1u << 3,
+    PSQ_CHECK_RADIATION = 1u << 4,
+};
+#define PSQ_CHECK_COUNT 5
+
+typedef enum {
+    PSQ_ACTION_NONE,
+    PSQ_ACTION_CORRECT,             // warning band: active correction
+    PSQ_ACTION_TRIP                 // limit crossed: fire mitigation
+} PsqAction;
+
+typedef struct {
+    uint32_t tag;                   // carried through to the verdict
+    uint16_t q95;
+    uint16_t beta_n;
+    uint16_t density;
+    uint16_t current;
+    int16_t z;
+    uint16_t radiation;
+} PsqSample;
+
+// Configuration registers
+typedef struct {
+    uint16_t q95_min;
+    uint16_t q95_warn;
+    uint16_t beta_n_max;
+    uint16_t beta_n_warn;
+    uint16_t z_max;
+    uint16_t z_warn;
+    uint16_t radiation_max;
+    uint16_t radiation_warn;
+    uint16_t greenwald_scale;
+    uint16_t greenwald_warn;        // fraction of the limit
+} PsqLimits;
+
+typedef struct {
+    uint32_t tag;
+    uint8_t violations;             // PSQ_CHECK_* bits
+    uint8_t warnings;
+    uint8_t cause;                  // DisruptionCause
+    uint8_t action;                 // PsqAction
+    bool tripped;                   // sticky until reset
+    bool valid;
+} PsqVerdict;
+
+typedef struct {
+    PsqLimits limits;
+    struct {
+        bool valid;
+        uint32_t tag;
+        uint16_t q95, beta_n, abs_z, radiation;
+        uint64_t n_e, n_limit, n_warn;
+    } s1;
+    struct {
+        bool valid;
+        uint32_t tag;
+        uint8_t violations, warnings;
+    } s2;
+    PsqVerdict s3;
+    bool tripped;
+    uint64_t cycle;
+} PsqChecker;
+
+// Design under test: reset() clears the pipeline and the trip latch;
+// clock() applies one sample (NULL for a bubble) and returns the output
+// register after the edge.
+typedef struct {
+    const char *name;
+    void *ctx;
+    void (*reset)(void *ctx);
+    void (*clock)(void *ctx, const PsqSample *in, PsqVerdict *out);
+} PsqDut;
+
+// Limits of npe_config.h and machine_default, quantized
+void psq_limits_default(PsqLimits *limits);
+
+// Quantizes a plasma state with saturation; returns the number of
+// saturated fields
+int psq_sample_from_state(const PlasmaState *state, uint32_t tag, PsqSample *sample);
+
+void psq_checker_init(PsqChecker *checker, const PsqLimits *limits);
+void psq_checker_reset(PsqChecker *checker);
+void psq_checker_clock(PsqChecker *checker, const PsqSample *in, PsqVerdict *out);
+PsqDut psq_checker_dut(PsqChecker *checker);
+
+// Combinational specification; tripped reflects only this sample
+void psq_checker_evaluate(const PsqLimits *limits, const PsqSample *in, PsqVerdict *out);
+
+#endif // PSQ_CHECKER_H
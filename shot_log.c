@@ -0,0 +1,508 @@
+#include "shot_log.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(ShotLogFileHeader) == 64, "file header layout");
+_Static_assert(sizeof(ShotLogColumn) == 64, "column layout");
+_Static_assert(sizeof(ShotLogChunkHeader) == 64, "chunk header layout");
+_Static_assert(sizeof(ShotLogColumnRef) == 16, "column ref layout");
+_Static_assert(sizeof(ShotLogEvent) == 16, "event layout");
+_Static_assert(sizeof(ShotLogIndexEntry) == 32, "index entry layout");
+_Static_assert(sizeof(ShotLogTrailer) == 16, "trailer layout");
+
+static size_t align_up(size_t n) {
+    return (n + SHOT_LOG_ALIGN - 1) / SHOT_LOG_ALIGN * SHOT_LOG_ALIGN;
+}
+
+static size_t column_table_bytes(uint32_t num_columns) {
+    return align_up((size_t)num_columns * sizeof(ShotLogColumnRef));
+}
+
+// Largest encoded column; RAW blocks are smaller
+static size_t column_block_max(uint32_t rows) {
+    return align_up(sizeof(uint32_t) + ((size_t)rows * 4 + 7) / 8 + (size_t)rows * 4);
+}
+
+// ================= XOR_SPARSE CODEC =================
+static inline uint32_t float_bits(float x) {
+    uint32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits;
+}
+
+static size_t encode_xor_sparse(const float *column, uint32_t rows, uint8_t *out) {
+    size_t bitmap_bytes = ((size_t)rows * 4 + 7) / 8;
+    uint8_t *bitmap = out + sizeof(uint32_t);
+    uint8_t *bytes = bitmap + bitmap_bytes;
+    memset(bitmap, 0, bitmap_bytes);
+
+    size_t k = 0, nonzero = 0;
+    for (int plane = 0; plane < 4; plane++) {
+        uint32_t prev = 0;
+        for (uint32_t i = 0; i < rows; i++, k++) {
+            uint32_t word = float_bits(column[i]);
+            uint8_t b = (uint8_t)((word ^ prev) >> (8 * plane));
+            prev = word;
+            if (b) {
+                bitmap[k >> 3] |= (uint8_t)(1u << (k & 7));
+                bytes[nonzero++] = b;
+            }
+        }
+    }
+    uint32_t count = (uint32_t)nonzero;
+    memcpy(out, &count, sizeof(count));
+    return sizeof(uint32_t) + bitmap_bytes + nonzero;
+}
+
+static int decode_xor_sparse(const uint8_t *in, size_t size, uint32_t rows, float *out) {
+    size_t bitmap_bytes = ((size_t)rows * 4 + 7) / 8;
+    uint32_t count;
+    if (size < sizeof(count) + bitmap_bytes) return -1;
+    memcpy(&count, in, sizeof(count));
+    if (size < sizeof(count) + bitmap_bytes + count) return -1;
+    const uint8_t *bitmap = in + sizeof(count);
+    const uint8_t *bytes = bitmap + bitmap_bytes;
+
+    // Planes straight into the little-endian words, then undo the XOR
+    uint8_t *words = (uint8_t *)out;
+    memset(words, 0, (size_t)rows * sizeof(uint32_t));
+    size_t k = 0, next = 0;
+    for (int plane = 0; plane < 4; plane++) {
+        for (uint32_t i = 0; i < rows; i++, k++) {
+            if (bitmap[k >> 3] & (1u << (k & 7))) {
+                if (next == count) return -1;
+                words[4 * (size_t)i + plane] = bytes[next++];
+            }
+        }
+    }
+    uint32_t prev = 0;
+    for (uint32_t i = 0; i < rows; i++) {
+        uint32_t word = float_bits(out[i]) ^ prev;
+        memcpy(&out[i], &word, sizeof(word));
+        prev = word;
+    }
+    return 0;
+}
+
+// ================= WRITER =================
+ShotLog *shot_log_create(const char *path, const char *const *column_names,
+                         uint32_t num_columns, uint32_t chunk_rows,
+                         ShotLogCodec codec) {
+    if (num_columns == 0) return NULL;
+    if (chunk_rows == 0) chunk_rows = SHOT_LOG_CHUNK_ROWS_DEFAULT;
+    for (uint32_t c = 0; c < num_columns; c++) {
+        if (strlen(column_names[c]) >= SHOT_LOG_NAME_MAX) return NULL;
+    }
+
+    ShotLog *log = aligned_alloc(SHOT_LOG_ALIGN, align_up(sizeof(ShotLog)));
+    if (!log) return NULL;
+    memset(log, 0, sizeof(*log));
+    size_t chunk_bytes = align_up((size_t)num_columns * chunk_rows * sizeof(float));
+    size_t scratch_bytes = column_table_bytes(num_columns) +
+                           (size_t)num_columns * column_block_max(chunk_rows);
+    if (scratch_bytes < SHOT_LOG_EVENT_DEPTH * sizeof(ShotLogEvent)) {
+        scratch_bytes = SHOT_LOG_EVENT_DEPTH * sizeof(ShotLogEvent);
+    }
+    log->block = aligned_alloc(SHOT_LOG_ALIGN,
+                               SHOT_LOG_CHUNK_BUFFERS * chunk_bytes + scratch_bytes);
+    log->file = fopen(path, "wb");
+    if (!log->block || !log->file) goto fail;
+    // Fault every buffer in before the loop starts
+    memset(log->block, 0, SHOT_LOG_CHUNK_BUFFERS * chunk_bytes + scratch_bytes);
+
+    uint8_t *block = log->block;
+    for (int b = 0; b < SHOT_LOG_CHUNK_BUFFERS; b++) {
+        log->chunks[b].columns = (float *)(block + b * chunk_bytes);
+    }
+    log->scratch = block + SHOT_LOG_CHUNK_BUFFERS * chunk_bytes;
+    log->num_columns = num_columns;
+    log->chunk_rows = chunk_rows;
+    log->codec = codec;
+    atomic_init(&log->chunk_head, 0);
+    atomic_init(&log->chunk_tail, 0);
+    atomic_init(&log->event_head, 0);
+    atomic_init(&log->event_tail, 0);
+
+    size_t header_bytes = align_up(sizeof(ShotLogFileHeader) +
+                                   (size_t)num_columns * sizeof(ShotLogColumn));
+    uint8_t *header_block = calloc(1, header_bytes);
+    if (!header_block) goto fail;
+    ShotLogFileHeader *header = (ShotLogFileHeader *)header_block;
+    memcpy(header->magic, SHOT_LOG_MAGIC, sizeof(header->magic));
+    header->version = SHOT_LOG_VERSION;
+    header->header_bytes = (uint32_t)header_bytes;
+    header->num_columns = num_columns;
+    header->chunk_rows = chunk_rows;
+    header->codec = codec;
+    ShotLogColumn *columns = (ShotLogColumn *)(header + 1);
+    for (uint32_t c = 0; c < num_columns; c++) {
+        snprintf(columns[c].name, sizeof(columns[c].name), "%s", column_names[c]);
+    }
+    size_t written = fwrite(header_block, 1, header_bytes, log->file);
+    free(header_block);
+    if (written != header_bytes) goto fail;
+    log->file_offset = header_bytes;
+    return log;
+
+fail:
+    if (log->file) fclose(log->file);
+    free(log->block);
+    free(log);
+    return NULL;
+}
+
+bool shot_log_append(ShotLog *log, const float *row) {
+    uint64_t head = atomic_load_explicit(&log->chunk_head, memory_order_relaxed);
+    if (head - log->cached_chunk_tail == SHOT_LOG_CHUNK_BUFFERS) {
+        log->cached_chunk_tail = atomic_load_explicit(&log->chunk_tail,
+                                                      memory_order_acquire);
+        if (head - log->cached_chunk_tail == SHOT_LOG_CHUNK_BUFFERS) {
+            log->rows_dropped++;
+            return false;
+        }
+    }
+    ShotLogChunkBuffer *chunk = &log->chunks[head & (SHOT_LOG_CHUNK_BUFFERS - 1)];
+    uint32_t r = chunk->rows;
+    for (uint32_t c = 0; c < log->num_columns; c++) {
+        chunk->columns[(size_t)c * log->chunk_rows + r] = row[c];
+    }
+    chunk->rows = r + 1;
+    if (chunk->rows == log->chunk_rows) {
+        atomic_store_explicit(&log->chunk_head, head + 1, memory_order_release);
+    }
+    return true;
+}
+
+bool shot_log_event(ShotLog *log, float time, ShotLogEventType type, uint32_t value) {
+    uint64_t head = atomic_load_explicit(&log->event_head, memory_order_relaxed);
+    if (head - log->cached_event_tail == SHOT_LOG_EVENT_DEPTH) {
+        log->cached_event_tail = atomic_load_explicit(&log->event_tail,
+                                                      memory_order_acquire);
+        if (head - log->cached_event_tail == SHOT_LOG_EVENT_DEPTH) {
+            log->events_dropped++;
+            return false;
+        }
+    }
+    log->events[head & (SHOT_LOG_EVENT_DEPTH - 1)] = (ShotLogEvent){
+        .time = time, .type = (uint32_t)type, .value = value,
+    };
+    atomic_store_explicit(&log->event_head, head + 1, memory_order_release);
+    return true;
+}
+
+static int write_chunk(ShotLog *log, ShotLogChunkHeader *header,
+                       const void *payload, bool indexed) {
+    header->magic = SHOT_LOG_CHUNK_MAGIC;
+    if (fwrite(header, sizeof(*header), 1, log->file) != 1 ||
+        fwrite(payload, 1, header->payload_bytes, log->file) != header->payload_bytes) {
+        log->error = -1;
+        return -1;
+    }
+    if (indexed) {
+        if (log->index_count == log->index_capacity) {
+            uint32_t capacity = log->index_capacity ? 2 * log->index_capacity : 64;
+            ShotLogIndexEntry *grown = realloc(log->index, capacity * sizeof(*grown));
+            if (!grown) {
+                log->error = -1;
+                return -1;
+            }
+            log->index = grown;
+            log->index_capacity = capacity;
+        }
+        log->index[log->index_count++] = (ShotLogIndexEntry){
+            .offset = log->file_offset,
+            .kind = header->kind,
+            .rows = header->rows,
+            .first_row = header->first_row,
+            .time_first = header->time_first,
+            .time_last = header->time_last,
+        };
+    }
+    log->file_offset += sizeof(*header) + header->payload_bytes;
+    return 0;
+}
+
+static int write_rows_chunk(ShotLog *log, const ShotLogChunkBuffer *chunk) {
+    const uint32_t rows = chunk->rows;
+    uint8_t *payload = log->scratch;
+    ShotLogColumnRef *refs = (ShotLogColumnRef *)payload;
+    size_t offset = column_table_bytes(log->num_columns);
+    memset(payload, 0, offset);
+
+    for (uint32_t c = 0; c < log->num_columns; c++) {
+        const float *column = chunk->columns + (size_t)c * log->chunk_rows;
+        uint8_t *out = payload + offset;
+        size_t raw_bytes = (size_t)rows * sizeof(float);
+        size_t bytes = raw_bytes;
+        uint32_t codec = SHOT_LOG_CODEC_RAW;
+        if (log->codec == SHOT_LOG_CODEC_XOR_SPARSE) {
+            bytes = encode_xor_sparse(column, rows, out);
+            codec = SHOT_LOG_CODEC_XOR_SPARSE;
+        }
+        if (bytes >= raw_bytes) {
+            bytes = raw_bytes;
+            codec = SHOT_LOG_CODEC_RAW;
+            memcpy(out, column, raw_bytes);
+        }
+        size_t padded = align_up(bytes);
+        memset(out + bytes, 0, padded - bytes);
+        refs[c] = (ShotLogColumnRef){
+            .offset = offset, .codec = codec, .bytes = (uint32_t)bytes,
+        };
+        offset += padded;
+    }
+
+    ShotLogChunkHeader header = {
+        .kind = SHOT_LOG_CHUNK_ROWS,
+        .rows = rows,
+        .payload_bytes = offset,
+        .first_row = log->rows_written,
+        .time_first = chunk->columns[0],
+        .time_last = chunk->columns[rows - 1],
+    };
+    log->rows_written += rows;
+    return write_chunk(log, &header, payload, true);
+}
+
+static int write_events_chunk(ShotLog *log) {
+    uint64_t tail = atomic_load_explicit(&log->event_tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&log->event_head, memory_order_acquire);
+    if (head == tail) return 0;
+
+    uint32_t count = (uint32_t)(head - tail);
+    ShotLogEvent *payload = (ShotLogEvent *)log->scratch;
+    size_t bytes = align_up((size_t)count * sizeof(ShotLogEvent));
+    memset(payload, 0, bytes);
+    for (uint32_t i = 0; i < count; i++) {
+        payload[i] = log->events[(tail + i) & (SHOT_LOG_EVENT_DEPTH - 1)];
+    }
+    atomic_store_explicit(&log->event_tail, head, memory_order_release);
+
+    ShotLogChunkHeader header = {
+        .kind = SHOT_LOG_CHUNK_EVENTS,
+        .rows = count,
+        .payload_bytes = bytes,
+        .time_first = payload[0].time,
+        .time_last = payload[count - 1].time,
+    };
+    return write_chunk(log, &header, payload, true);
+}
+
+int shot_log_drain(ShotLog *log) {
+    uint64_t tail = atomic_load_explicit(&log->chunk_tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&log->chunk_head, memory_order_acquire);
+    for (; tail < head; tail++) {
+        ShotLogChunkBuffer *chunk = &log->chunks[tail & (SHOT_LOG_CHUNK_BUFFERS - 1)];
+        write_rows_chunk(log, chunk);
+        chunk->rows = 0;
+        atomic_store_explicit(&log->chunk_tail, tail + 1, memory_order_release);
+    }
+    write_events_chunk(log);
+    return log->error;
+}
+
+int shot_log_close(ShotLog *log) {
+    shot_log_drain(log);
+    uint64_t head = atomic_load_explicit(&log->chunk_head, memory_order_relaxed);
+    ShotLogChunkBuffer *partial = &log->chunks[head & (SHOT_LOG_CHUNK_BUFFERS - 1)];
+    if (partial->rows > 0) write_rows_chunk(log, partial);
+
+    uint64_t index_offset = log->file_offset;
+    ShotLogChunkHeader header = {
+        .kind = SHOT_LOG_CHUNK_INDEX,
+        .rows = log->index_count,
+        .payload_bytes = align_up((size_t)log->index_count * sizeof(ShotLogIndexEntry)),
+    };
+    uint8_t *payload = calloc(1, header.payload_bytes + 1);
+    if (payload) {
+        if (log->index_count > 0) {
+            memcpy(payload, log->index, log->index_count * sizeof(ShotLogIndexEntry));
+        }
+        write_chunk(log, &header, payload, false);
+        free(payload);
+    } else {
+        log->error = -1;
+    }
+    ShotLogTrailer trailer = { .index_offset = index_offset };
+    memcpy(trailer.magic, SHOT_LOG_TRAILER_MAGIC, sizeof(trailer.magic));
+    if (fwrite(&trailer, sizeof(trailer), 1, log->file) != 1) log->error = -1;
+    if (fclose(log->file) != 0) log->error = -1;
+
+    int rc = log->error;
+    free(log->index);
+    free(log->block);
+    free(log);
+    return rc;
+}
+
+// ================= READER =================
+static const ShotLogChunkHeader *chunk_at(const ShotLogReader *reader,
+                                          uint64_t offset) {
+    if (offset > reader->size || reader->size - offset < sizeof(ShotLogChunkHeader)) {
+        return NULL;
+    }
+    const ShotLogChunkHeader *header =
+        (const ShotLogChunkHeader *)(reader->map + offset);
+    if (header->magic != SHOT_LOG_CHUNK_MAGIC ||
+        header->payload_bytes > reader->size - offset - sizeof(*header)) {
+        return NULL;
+    }
+    return header;
+}
+
+static int load_index(ShotLogReader *reader) {
+    ShotLogTrailer trailer;
+    if (reader->size >= reader->header->header_bytes + sizeof(trailer)) {
+        memcpy(&trailer, reader->map + reader->size - sizeof(trailer), sizeof(trailer));
+        const ShotLogChunkHeader *index = NULL;
+        if (memcmp(trailer.magic, SHOT_LOG_TRAILER_MAGIC, sizeof(trailer.magic)) == 0) {
+            index = chunk_at(reader, trailer.index_offset);
+        }
+        if (index && index->kind == SHOT_LOG_CHUNK_INDEX &&
+            index->rows * sizeof(ShotLogIndexEntry) <= index->payload_bytes) {
+            reader->num_chunks = index->rows;
+            reader->chunks = malloc((size_t)index->rows * sizeof(ShotLogIndexEntry) + 1);
+            if (!reader->chunks) return -1;
+            memcpy(reader->chunks, index + 1, index->rows * sizeof(ShotLogIndexEntry));
+            for (uint32_t i = 0; i < reader->num_chunks; i++) {
+                if (!chunk_at(reader, reader->chunks[i].offset)) return -1;
+            }
+            return 0;
+        }
+    }
+
+    // No index: the writer did not close the log, walk the chunks
+    uint32_t capacity = 0;
+    uint64_t offset = reader->header->header_bytes;
+    const ShotLogChunkHeader *header;
+    while ((header = chunk_at(reader, offset)) != NULL &&
+           header->kind != SHOT_LOG_CHUNK_INDEX) {
+        if (reader->num_chunks == capacity) {
+            capacity = capacity ? 2 * capacity : 64;
+            ShotLogIndexEntry *grown = realloc(reader->chunks,
+                                               capacity * sizeof(*grown));
+            if (!grown) return -1;
+            reader->chunks = grown;
+        }
+        reader->chunks[reader->num_chunks++] = (ShotLogIndexEntry){
+            .offset = offset,
+            .kind = header->kind,
+            .rows = header->rows,
+            .first_row = header->first_row,
+            .time_first = header->time_first,
+            .time_last = header->time_last,
+        };
+        offset += sizeof(*header) + header->payload_bytes;
+    }
+    return 0;
+}
+
+int shot_log_reader_open(ShotLogReader *reader, const char *path) {
+    memset(reader, 0, sizeof(*reader));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShotLogFileHeader)) {
+        close(fd);
+        return -1;
+    }
+    void *p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) return -1;
+    reader->map = p;
+    reader->size = (size_t)st.st_size;
+    reader->header = p;
+
+    const ShotLogFileHeader *h = reader->header;
+    if (memcmp(h->magic, SHOT_LOG_MAGIC, sizeof(h->magic)) != 0 ||
+        h->version != SHOT_LOG_VERSION || h->num_columns == 0 ||
+        h->header_bytes > reader->size ||
+        sizeof(*h) + (size_t)h->num_columns * sizeof(ShotLogColumn) > h->header_bytes ||
+        load_index(reader) != 0) {
+        shot_log_reader_close(reader);
+        return -1;
+    }
+    reader->columns = (const ShotLogColumn *)(h + 1);
+    return 0;
+}
+
+void shot_log_reader_close(ShotLogReader *reader) {
+    if (reader->map) munmap((void *)reader->map, reader->size);
+    free(reader->chunks);
+    memset(reader, 0, sizeof(*reader));
+}
+
+int shot_log_reader_find_column(const ShotLogReader *reader, const char *name) {
+    for (uint32_t c = 0; c < reader->header->num_columns; c++) {
+        if (strncmp(reader->columns[c].name, name, SHOT_LOG_NAME_MAX) == 0) {
+            return (int)c;
+        }
+    }
+    return -1;
+}
+
+static const ShotLogColumnRef *column_ref(const ShotLogReader *reader, uint32_t chunk,
+                                          uint32_t column, const uint8_t **payload) {
+    if (chunk >= reader->num_chunks || column >= reader->header->num_columns ||
+        reader->chunks[chunk].kind != SHOT_LOG_CHUNK_ROWS) {
+        return NULL;
+    }
+    const ShotLogChunkHeader *header = chunk_at(reader, reader->chunks[chunk].offset);
+    if (!header || column_table_bytes(reader->header->num_columns) > header->payload_bytes) {
+        return NULL;
+    }
+    *payload = (const uint8_t *)(header + 1);
+    const ShotLogColumnRef *ref = (const ShotLogColumnRef *)*payload + column;
+    if (ref->offset > header->payload_bytes ||
+        ref->bytes > header->payload_bytes - ref->offset) {
+        return NULL;
+    }
+    return ref;
+}
+
+const float *shot_log_reader_view(const ShotLogReader *reader, uint32_t chunk,
+                                  uint32_t column) {
+    const uint8_t *payload;
+    const ShotLogColumnRef *ref = column_ref(reader, chunk, column, &payload);
+    if (!ref || ref->codec != SHOT_LOG_CODEC_RAW ||
+        ref->bytes != reader->chunks[chunk].rows * sizeof(float)) {
+        return NULL;
+    }
+    return (const float *)(payload + ref->offset);
+}
+
+long shot_log_reader_column(const ShotLogReader *reader, uint32_t chunk,
+                            uint32_t column, float *out) {
+    const uint8_t *payload;
+    const ShotLogColumnRef *ref = column_ref(reader, chunk, column, &payload);
+    if (!ref) return -1;
+    uint32_t rows = reader->chunks[chunk].rows;
+    if (ref->codec == SHOT_LOG_CODEC_RAW) {
+        if (ref->bytes != rows * sizeof(float)) return -1;
+        memcpy(out, payload + ref->offset, ref->bytes);
+    } else if (ref->codec == SHOT_LOG_CODEC_XOR_SPARSE) {
+        if (decode_xor_sparse(payload + ref->offset, ref->bytes, rows, out) != 0) {
+            return -1;
+        }
+    } else {
+        return -1;
+    }
+    return rows;
+}
+
+const ShotLogEvent *shot_log_reader_events(const ShotLogReader *reader,
+                                           uint32_t chunk) {
+    if (chunk >= reader->num_chunks ||
+        reader->chunks[chunk].kind != SHOT_LOG_CHUNK_EVENTS) {
+        return NULL;
+    }
+    const ShotLogChunkHeader *header = chunk_at(reader, reader->chunks[chunk].offset);
+    if (!header || header->rows * sizeof(ShotLogEvent) > header->payload_bytes) {
+        return NULL;
+    }
+    return (const ShotLogEvent *)(header + 1);
+}
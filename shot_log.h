@@ -0,0 +1,209 @@
+#ifndef SHOT_LOG_H
+#define SHOT_LOG_H
+
+#include "npe_config.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdio.h>
+
+// ================= BINARY SHOT LOG =================
+// Columnar, chunked log of float32 time series plus a table of discrete
+// events (controller-state transitions), written while a shot runs and
+// read back by random access through mmap, or by ia/shot_log.py through
+// numpy.memmap.
+//
+// Writing is split like state_history.h. The control loop calls
+// shot_log_append() / shot_log_event(); they copy into preallocated chunk
+// buffers and never allocate, lock or do I/O. A logger thread calls
+// shot_log_drain(), which encodes the full chunks and writes them. If the
+// logger falls SHOT_LOG_CHUNK_BUFFERS chunks behind, rows are dropped and
+// counted instead of blocking the loop. Column 0 is the time axis.
+//
+// File layout (little endian, every section 64-byte aligned):
+//   ShotLogFileHeader, ShotLogColumn[num_columns]
+//   chunks: ShotLogChunkHeader + payload, in write order
+//   INDEX chunk (ShotLogIndexEntry per chunk) + ShotLogTrailer (close only)
+// A ROWS payload starts with a ShotLogColumnRef per column, then the
+// column blocks. RAW columns are plain float32[rows], so readers can use
+// them in place. XOR_SPARSE columns are encoded as:
+//   u32 nonzero_count, bitmap[(4 rows + 7) / 8], nonzero bytes
+// The encode steps are: XOR each word with the previous one; split the
+// result into byte planes (plane p holds byte p of every word); keep only
+// the nonzero bytes, with a bitmap (LSB first) marking where they sat.
+// Slowly varying or constant signals shrink 2-8x, and numpy decodes a
+// column without a Python loop. The writer falls back to RAW for any
+// column the encoding does not shrink. A log whose writer died has no
+// index; readers then walk the chunk headers.
+
+#define SHOT_LOG_MAGIC "NPESHOTL"
+#define SHOT_LOG_TRAILER_MAGIC "NPSLINDX"
+#define SHOT_LOG_CHUNK_MAGIC 0x4b4e4843u    // "CHNK"
+#define SHOT_LOG_VERSION 1
+#define SHOT_LOG_ALIGN 64
+#define SHOT_LOG_NAME_MAX 56
+#define SHOT_LOG_CHUNK_BUFFERS 4            // power of two
+#define SHOT_LOG_EVENT_DEPTH 1024           // power of two
+#define SHOT_LOG_CHUNK_ROWS_DEFAULT 4096
+
+typedef enum {
+    SHOT_LOG_CODEC_RAW,
+    SHOT_LOG_CODEC_XOR_SPARSE
+} ShotLogCodec;
+
+typedef enum {
+    SHOT_LOG_CHUNK_ROWS = 1,
+    SHOT_LOG_CHUNK_EVENTS,
+    SHOT_LOG_CHUNK_INDEX
+} ShotLogChunkKind;
+
+typedef enum {
+    SHOT_LOG_EVENT_CONTROLLER_STATE = 1,    // value: new controller_state
+    SHOT_LOG_EVENT_MITIGATION,              // value: MitigationAction
+    SHOT_LOG_EVENT_LIMIT                    // value: limit index | active << 8
+} ShotLogEventType;
+
+// ---------------- On-disk records ----------------
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t header_bytes;          // this header plus the column table
+    uint32_t num_columns;
+    uint32_t chunk_rows;            // rows of a full ROWS chunk
+    uint32_t codec;                 // ShotLogCodec requested at create
+    uint32_t reserved[9];
+} ShotLogFileHeader;
+
+typedef struct {
+    char name[SHOT_LOG_NAME_MAX];
+    uint32_t type;                  // 0: float32
+    uint32_t reserved;
+} ShotLogColumn;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t kind;                  // ShotLogChunkKind
+    uint32_t rows;                  // rows, events or index entries
+    uint32_t reserved0;
+    uint64_t payload_bytes;         // after this header, multiple of 64
+    uint64_t first_row;             // ROWS: log row index of the first row
+    float time_first;
+    float time_last;
+    uint32_t reserved[6];
+} ShotLogChunkHeader;
+
+typedef struct {
+    uint64_t offset;                // of the column block, from payload start
+    uint32_t codec;
+    uint32_t bytes;
+} ShotLogColumnRef;
+
+typedef struct {
+    float time;
+    uint32_t type;                  // ShotLogEventType
+    uint32_t value;
+    uint32_t reserved;
+} ShotLogEvent;
+
+typedef struct {
+    uint64_t offset;                // of the chunk header, from file start
+    uint32_t kind;
+    uint32_t rows;
+    uint64_t first_row;
+    float time_first;
+    float time_last;
+} ShotLogIndexEntry;
+
+typedef struct {
+    uint64_t index_offset;
+    char magic[8];
+} ShotLogTrailer;
+
+// ---------------- Writer ----------------
+typedef struct {
+    float *columns;                 // [column][chunk_rows]
+    uint32_t rows;
+} ShotLogChunkBuffer;
+
+typedef struct ShotLog {
+    // Producer side
+    _Alignas(SHOT_LOG_ALIGN) _Atomic uint64_t chunk_head;
+    _Atomic uint64_t event_head;
+    uint64_t cached_chunk_tail;
+    uint64_t cached_event_tail;
+    uint64_t rows_dropped;
+    uint64_t events_dropped;
+
+    // Consumer side
+    _Alignas(SHOT_LOG_ALIGN) _Atomic uint64_t chunk_tail;
+    _Atomic uint64_t event_tail;
+    uint64_t rows_written;
+    uint64_t file_offset;
+    ShotLogIndexEntry *index;
+    uint32_t index_count;
+    uint32_t index_capacity;
+    uint8_t *scratch;
+    int error;
+
+    // Read-only after create
+    _Alignas(SHOT_LOG_ALIGN) FILE *file;
+    uint32_t num_columns;
+    uint32_t chunk_rows;
+    ShotLogCodec codec;
+    ShotLogChunkBuffer chunks[SHOT_LOG_CHUNK_BUFFERS];
+    ShotLogEvent events[SHOT_LOG_EVENT_DEPTH];
+    void *block;
+} ShotLog;
+
+// Creates `path` with the given columns (names up to SHOT_LOG_NAME_MAX - 1
+// characters; chunk_rows == 0 uses the default) and writes the header.
+// Returns NULL on failure.
+ShotLog *shot_log_create(const char *path, const char *const *column_names,
+                         uint32_t num_columns, uint32_t chunk_rows,
+                         ShotLogCodec codec);
+
+// Producer. row holds num_columns floats, row[0] the time. Returns false
+// (and counts a drop) if every chunk buffer awaits the consumer.
+bool shot_log_append(ShotLog *log, const float *row);
+bool shot_log_event(ShotLog *log, float time, ShotLogEventType type, uint32_t value);
+
+// Consumer. Writes full chunks and pending events; returns -1 after an
+// I/O error.
+int shot_log_drain(ShotLog *log);
+
+// Stops logging: with the producer quiescent, writes the partial chunk,
+// the remaining events and the index, closes the file and frees the log.
+// Returns -1 if any write failed.
+int shot_log_close(ShotLog *log);
+
+// ---------------- Reader ----------------
+typedef struct {
+    const uint8_t *map;
+    size_t size;
+    const ShotLogFileHeader *header;
+    const ShotLogColumn *columns;
+    ShotLogIndexEntry *chunks;
+    uint32_t num_chunks;
+} ShotLogReader;
+
+// Maps `path` read-only and loads the chunk index (walking the chunks if
+// the log was not closed). Returns -1 on a missing or malformed file.
+int shot_log_reader_open(ShotLogReader *reader, const char *path);
+void shot_log_reader_close(ShotLogReader *reader);
+
+int shot_log_reader_find_column(const ShotLogReader *reader, const char *name);
+
+// In-place view of a RAW column of ROWS chunk `chunk`, or NULL if the
+// column is encoded
+const float *shot_log_reader_view(const ShotLogReader *reader, uint32_t chunk,
+                                  uint32_t column);
+
+// Decodes column `column` of ROWS chunk `chunk` into out (chunk rows
+// floats). Returns the row count or -1.
+long shot_log_reader_column(const ShotLogReader *reader, uint32_t chunk,
+                            uint32_t column, float *out);
+
+// Events of EVENTS chunk `chunk`, in place
+const ShotLogEvent *shot_log_reader_events(const ShotLogReader *reader,
+                                           uint32_t chunk);
+
+#endif // SHOT_LOG_H
@@ -0,0 +1,554 @@
+// NPE-PSQ three-thread driver over the plasma bus
+//
+// Acquisition, control and safety run as separate periodic threads, each
+// optionally pinned to its own CPU, and share nothing but the lock-free
+// topics of plasma_bus.h:
+//
+//   acquisition  applies the latest command, advances the plasma, runs the
+//                MHD spectrum on the magnetics probes, publishes state
+//                and diagnostics; a fired mitigation on the safety
+//                topic cuts heating, fuelling and the loop voltage here
+//                directly, without waiting for the controller
+//   control      scenario state machine and actuator laws on the latest
+//                state, publishes commands
+//   safety       predictor and mitigation selection on the latest state and
+//                its MHD mode detections, armed by the controller state in
+//                the latest command, publishes its decision
+//
+// Each thread reports the publish-to-read latency of the topics it reads.
+//
+// Build: gcc -O2 -I.. npe_psq_bus_sim.c ../plasma_bus.c ../plasma_physics.c
+//            ../plasma_rng.c ../plasma_safety.c ../mhd_spectrum.c
+//            -lm -lpthread -o npe_psq_bus_sim
+// Run:   ./npe_psq_bus_sim --rate 1000 --duration 10 --cpus 1,2,3 --prio 80
+
+#define _GNU_SOURCE
+#include "mhd_spectrum.h"
+#include "plasma_bus.h"
+#include "plasma_physics.h"
+#include "plasma_rng.h"
+#include "plasma_safety.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+// ================= LOOP PARAMETERS =================
+#define LOOP_RATE_MIN_HZ 1
+#define LOOP_RATE_MAX_HZ 10000
+#define LOOP_RATE_DEFAULT_HZ 1000
+#define SAFETY_RATE_FACTOR 2              // safety runs at twice the loop rate
+#define PREFAULT_STACK_BYTES (256 * 1024)
+
+// ================= SCENARIO PARAMETERS =================
+// As in npe_psq_core_sim.c
+#define SCENARIO_PLASMA_CURRENT 2.0f      // MA
+#define SCENARIO_FLAT_TOP_TIME 5.0f       // s
+#define SCENARIO_RAMP_RATE 0.5f           // MA/s
+#define SCENARIO_DENSITY 10.0f            // 1e19 m^-3
+#define CURRENT_FEEDBACK_GAIN 4.0f
+#define VERTICAL_FEEDBACK_GAIN 0.5f
+#define HEATING_POWER 0.4f                // MW per system
+
+enum { THREAD_ACQUISITION, THREAD_CONTROL, THREAD_SAFETY, THREAD_COUNT };
+
+typedef struct {
+    uint64_t reads;
+    int64_t latency_max_ns;
+    int64_t latency_sum_ns;
+} TopicLatency;
+
+typedef struct {
+    const char *name;
+    int cpu;
+    int priority;
+    int64_t period_ns;
+    PlasmaBus *bus;
+    atomic_bool *stop;
+    uint64_t cycles;
+    uint64_t overruns;                    // cycles that ended past the next release
+    TopicLatency latency[BUS_TOPIC_COUNT];
+    BusCursor cursor[BUS_TOPIC_COUNT];
+} ThreadContext;
+
+typedef struct {
+    uint32_t rate_hz;
+    double duration_s;
+    int cpus[THREAD_COUNT];
+    int priority;
+    uint64_t seed;
+} BusConfig;
+
+static const char *state_names[] = {
+    "INIT", "RAMP_UP", "FLAT_TOP", "RAMP_DOWN",
+    "DISRUPTION", "MITIGATION", "SAFE_SHUTDOWN"
+};
+
+static inline int64_t now_ns(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (int64_t)t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+static inline void timespec_add_ns(struct timespec *t, int64_t ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+static void prefault_stack(void) {
+    volatile unsigned char stack[PREFAULT_STACK_BYTES];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+static void setup_thread(const ThreadContext *ctx) {
+    prefault_stack();
+    if (ctx->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(ctx->cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            fprintf(stderr, "warning: %s: cannot pin to CPU %d (%s)\n",
+                    ctx->name, ctx->cpu, strerror(err));
+        }
+    }
+    if (ctx->priority > 0) {
+        struct sched_param sp = { .sched_priority = ctx->priority };
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (err != 0) {
+            fprintf(stderr, "warning: %s: SCHED_FIFO %d unavailable (%s)\n",
+                    ctx->name, ctx->priority, strerror(err));
+        }
+    }
+}
+
+// Latest message of a topic, with its latency recorded when it is new
+static bool read_latest(ThreadContext *ctx, BusTopicId id, void *out) {
+    uint64_t timestamp;
+    BusTopic *topic = plasma_bus_topic(ctx->bus, id);
+    if (bus_read_latest(topic, &ctx->cursor[id], out, &timestamp) != BUS_READ_NEW) {
+        return false;
+    }
+    int64_t latency = now_ns() - (int64_t)timestamp;
+    TopicLatency *l = &ctx->latency[id];
+    l->reads++;
+    l->latency_sum_ns += latency;
+    if (latency > l->latency_max_ns) l->latency_max_ns = latency;
+    return true;
+}
+
+// Fixed-rate schedule shared by the three threads; a late cycle drops the
+// releases already in the past
+static void run_periodic(ThreadContext *ctx, void (*cycle)(ThreadContext *, void *),
+                         void *state) {
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!atomic_load_explicit(ctx->stop, memory_order_relaxed)) {
+        timespec_add_ns(&next, ctx->period_ns);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        cycle(ctx, state);
+        ctx->cycles++;
+        int64_t release = (int64_t)next.tv_sec * 1000000000LL + next.tv_nsec;
+        int64_t late = now_ns() - release;
+        if (late > ctx->period_ns) {
+            ctx->overruns++;
+            timespec_add_ns(&next, late / ctx->period_ns * ctx->period_ns);
+        }
+    }
+}
+
+// ================= ACQUISITION =================
+typedef struct {
+    PlasmaControlSystem control;
+    DiagnosticsSystem diagnostics;
+    MhdSpectrum mhd;
+    BusCommandMessage command;
+    BusSafetyMessage safety;
+    float dt;
+    uint64_t total_cycles;
+    bool mitigated;
+    float mitigation_time;
+    MitigationAction mitigation_action;
+} AcquisitionState;
+
+static void acquisition_cycle(ThreadContext *ctx, void *arg) {
+    AcquisitionState *a = arg;
+    PlasmaControlSystem *control = &a->control;
+
+    if (read_latest(ctx, BUS_TOPIC_COMMAND, &a->command)) {
+        bus_command_apply(&a->command, control);
+        control->controller_state = a->command.controller_state;
+    }
+    if (read_latest(ctx, BUS_TOPIC_SAFETY, &a->safety) && a->safety.mitigation_fired &&
+        !a->mitigated) {
+        a->mitigated = true;
+        a->mitigation_time = control->simulation_time;
+        a->mitigation_action = a->safety.decision.action;
+    }
+    if (a->mitigated) {
+        control->pf_coil_currents[0] = 0.0f;
+        control->fuel_injection_rate = 0.0f;
+        for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+            control->heating_systems[h].enabled = false;
+        }
+    }
+
+    advance_plasma_state(&a->control.current_state, control, a->dt);
+    control->simulation_time += a->dt;
+    control->iteration_count++;
+
+    // Synthetic diagnostics from the model state
+    const PlasmaState *s = &control->current_state;
+    DiagnosticsSystem *d = &a->diagnostics;
+    for (int i = 0; i < 32; i++) d->interferometer_density[i] = s->density_core;
+    for (int i = 0; i < 20; i++) {
+        float r = (float)i / 20.0f;
+        d->thomson_scattering_temp[i] = s->temperature_edge +
+            (s->temperature_core - s->temperature_edge) * (1.0f - r * r);
+    }
+    mhd_probe_signals(s, control->simulation_time, d->magnetics_probes);
+    mhd_spectrum_push_diagnostics(&a->mhd, d);
+    d->system_ok = true;
+    d->data_acquisition_rate = 1e9f / (float)ctx->period_ns;
+
+    int64_t t = now_ns();
+    BusTopic *topic = plasma_bus_topic(ctx->bus, BUS_TOPIC_STATE);
+    BusStateMessage *state = bus_publish_begin(topic);
+    bus_state_from_control(state, control);
+    state->locked_mode_detected = a->mhd.mode.locked_mode_detected;
+    state->ntm_detected = a->mhd.mode.ntm_detected;
+    bus_publish_commit(topic, (uint64_t)t);
+    bus_publish(plasma_bus_topic(ctx->bus, BUS_TOPIC_DIAGNOSTICS), d, (uint64_t)t);
+
+    if (control->iteration_count >= a->total_cycles) {
+        atomic_store_explicit(ctx->stop, true, memory_order_relaxed);
+    }
+}
+
+// ================= CONTROL =================
+typedef struct {
+    PlasmaControlSystem control;        // the controller's own view
+    BusStateMessage state;
+    BusSafetyMessage safety;
+    float plasma_current_ref;
+    float state_timer;
+    float dt;
+    bool have_state;
+} ControlState;
+
+static void set_state(ControlState *c, int state) {
+    c->control.controller_state = state;
+    c->state_timer = 0.0f;
+}
+
+static void control_cycle(ThreadContext *ctx, void *arg) {
+    ControlState *c = arg;
+    PlasmaControlSystem *control = &c->control;
+    if (read_latest(ctx, BUS_TOPIC_STATE, &c->state)) c->have_state = true;
+    if (read_latest(ctx, BUS_TOPIC_SAFETY, &c->safety) && c->safety.mitigation_fired &&
+        control->controller_state != PSQ_STATE_MITIGATION &&
+        control->controller_state != PSQ_STATE_SAFE_SHUTDOWN) {
+        set_state(c, PSQ_STATE_MITIGATION);
+    }
+    if (!c->have_state) return;
+
+    const PlasmaState *s = &c->state.state;
+    const float dt = c->dt;
+    control->current_state = *s;
+    control->simulation_time = c->state.time;
+    control->iteration_count = c->state.cycle;
+    c->state_timer += dt;
+
+    switch (control->controller_state) {
+    case PSQ_STATE_INIT:
+        c->plasma_current_ref = s->plasma_current;
+        set_state(c, PSQ_STATE_RAMP_UP);
+        break;
+    case PSQ_STATE_RAMP_UP:
+        c->plasma_current_ref = fminf(c->plasma_current_ref + SCENARIO_RAMP_RATE * dt,
+                                      SCENARIO_PLASMA_CURRENT);
+        if (s->plasma_current >= 0.99f * SCENARIO_PLASMA_CURRENT) set_state(c, PSQ_STATE_FLAT_TOP);
+        break;
+    case PSQ_STATE_FLAT_TOP:
+        if (c->state_timer >= SCENARIO_FLAT_TOP_TIME) set_state(c, PSQ_STATE_RAMP_DOWN);
+        break;
+    case PSQ_STATE_RAMP_DOWN:
+        c->plasma_current_ref = fmaxf(c->plasma_current_ref - SCENARIO_RAMP_RATE * dt, 0.0f);
+        if (s->plasma_current <= 0.05f && c->plasma_current_ref <= 0.0f) {
+            set_state(c, PSQ_STATE_SAFE_SHUTDOWN);
+        }
+        break;
+    case PSQ_STATE_MITIGATION:
+        if (s->plasma_current <= 0.05f) set_state(c, PSQ_STATE_SAFE_SHUTDOWN);
+        break;
+    default:
+        break;
+    }
+
+    int state = control->controller_state;
+    bool heating = state == PSQ_STATE_RAMP_UP || state == PSQ_STATE_FLAT_TOP;
+    bool shutdown = state == PSQ_STATE_MITIGATION || state == PSQ_STATE_SAFE_SHUTDOWN;
+    float plasma_volume = machine_plasma_volume(&machine_default, s->elongation);
+
+    float Ip_ref = c->plasma_current_ref;
+    float V_ref = Ip_ref + CURRENT_FEEDBACK_GAIN * (Ip_ref - s->plasma_current);
+    control->pf_coil_currents[0] = shutdown ? 0.0f : V_ref * 10.0f;
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        control->heating_systems[h].power = HEATING_POWER;
+        control->heating_systems[h].enabled = heating;
+    }
+    control->fuel_injection_rate = shutdown ? 0.0f :
+        SCENARIO_DENSITY * 1e19f * plasma_volume / 10.0f;
+
+    float mass_plasma = s->density_core * 1e19 * plasma_volume *
+                       (PROTON_MASS + ELECTRON_MASS);
+    float F_needed = -2.0f * mass_plasma * (VERTICAL_FEEDBACK_GAIN + dt) *
+                     s->vertical_position / (dt * dt);
+    float per_coil = fabsf(s->plasma_current) > 1e-3f ?
+        F_needed / (NUM_VERTICAL_COILS * s->plasma_current * 0.1f) : 0.0f;
+    for (int i = 0; i < NUM_VERTICAL_COILS; i++) {
+        control->vertical_coil_currents[i] = per_coil;
+    }
+
+    BusTopic *topic = plasma_bus_topic(ctx->bus, BUS_TOPIC_COMMAND);
+    bus_command_from_control(bus_publish_begin(topic), control);
+    bus_publish_commit(topic, (uint64_t)now_ns());
+}
+
+// ================= SAFETY =================
+typedef struct {
+    DisruptionPredictor predictor;
+    BusSafetyMessage out;
+    BusStateMessage state;
+    BusCommandMessage command;
+    DiagnosticsSystem diagnostics;
+    float dt;
+    int controller_state;
+    uint64_t evaluations;
+} SafetyThreadState;
+
+// Armed in flat-top only, as in npe_psq_core_sim.c; the controller state
+// comes from the command topic, so a stalled controller leaves the last
+// known state armed rather than blocking the check
+static void safety_cycle(ThreadContext *ctx, void *arg) {
+    SafetyThreadState *st = arg;
+    if (read_latest(ctx, BUS_TOPIC_COMMAND, &st->command)) {
+        st->controller_state = st->command.controller_state;
+    }
+    read_latest(ctx, BUS_TOPIC_DIAGNOSTICS, &st->diagnostics);
+    if (!read_latest(ctx, BUS_TOPIC_STATE, &st->state)) return;
+
+    BusSafetyMessage *m = &st->out;
+    update_disruption_flags(&m->system, &st->state.state);
+    m->system.disruption_flags.locked_mode_detected = st->state.locked_mode_detected;
+    m->system.disruption_flags.ntm_detected = st->state.ntm_detected;
+    predict_disruption(&st->predictor, &st->state.state, &m->system, st->dt,
+                       &m->prediction);
+    select_mitigation(&m->prediction, &m->system, &m->decision);
+    st->evaluations++;
+
+    MitigationAction action = m->decision.action;
+    bool hard = action != MITIGATION_NONE && action != MITIGATION_CONTROL_ADJUST &&
+                st->controller_state == PSQ_STATE_FLAT_TOP;
+    if (hard && !m->mitigation_fired) {
+        m->mitigation_fired = true;
+        m->system.disruption_count++;
+        m->system.last_disruption_time = st->state.time;
+    }
+    m->time = st->state.time;
+    m->cycle = st->state.cycle;
+    bus_publish(plasma_bus_topic(ctx->bus, BUS_TOPIC_SAFETY), m, (uint64_t)now_ns());
+}
+
+// ================= THREADS =================
+typedef struct {
+    ThreadContext *ctx;
+    void (*cycle)(ThreadContext *, void *);
+    void *state;
+} ThreadStart;
+
+static void *thread_main(void *arg) {
+    ThreadStart *start = arg;
+    setup_thread(start->ctx);
+    run_periodic(start->ctx, start->cycle, start->state);
+    return NULL;
+}
+
+static void print_thread(const ThreadContext *ctx) {
+    printf("%-12s %llu cycles, %llu late", ctx->name, (unsigned long long)ctx->cycles,
+           (unsigned long long)ctx->overruns);
+    for (int t = 0; t < BUS_TOPIC_COUNT; t++) {
+        const TopicLatency *l = &ctx->latency[t];
+        if (!l->reads) continue;
+        printf("; %s mean %lld max %lld ns", bus_topic_name((BusTopicId)t),
+               (long long)(l->latency_sum_ns / (int64_t)l->reads),
+               (long long)l->latency_max_ns);
+        if (ctx->cursor[t].overruns) {
+            printf(" (%llu overruns)", (unsigned long long)ctx->cursor[t].overruns);
+        }
+    }
+    printf("\n");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--rate HZ] [--duration S] [--cpus A,C,S] [--prio P] [--seed N]\n"
+            "  --rate      acquisition and control rate, %d-%d Hz (default %d);\n"
+            "              safety runs at %d times the rate\n"
+            "  --duration  simulated/wall seconds to run (default 10)\n"
+            "  --cpus      CPUs for the acquisition, control and safety threads\n"
+            "              (default: no pinning)\n"
+            "  --prio      SCHED_FIFO priority of all three (default: 0, no RT class)\n"
+            "  --seed      RNG seed for the MHD noise stream (default 1)\n",
+            prog, LOOP_RATE_MIN_HZ, LOOP_RATE_MAX_HZ, LOOP_RATE_DEFAULT_HZ,
+            SAFETY_RATE_FACTOR);
+}
+
+int main(int argc, char **argv) {
+    BusConfig cfg = {
+        .rate_hz = LOOP_RATE_DEFAULT_HZ,
+        .duration_s = 10.0,
+        .cpus = { -1, -1, -1 },
+        .priority = 0,
+        .seed = 1,
+    };
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--rate") == 0) {
+            cfg.rate_hz = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--duration") == 0) {
+            cfg.duration_s = strtod(argv[++i], NULL);
+        } else if (i + 1 < argc && strcmp(argv[i], "--cpus") == 0) {
+            if (sscanf(argv[++i], "%d,%d,%d", &cfg.cpus[0], &cfg.cpus[1],
+                       &cfg.cpus[2]) != THREAD_COUNT) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (i + 1 < argc && strcmp(argv[i], "--prio") == 0) {
+            cfg.priority = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.rate_hz < LOOP_RATE_MIN_HZ || cfg.rate_hz > LOOP_RATE_MAX_HZ ||
+        cfg.duration_s <= 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    // Static storage: the thread states are too large for the RT stacks
+    static PlasmaBus bus;
+    static AcquisitionState acquisition;
+    static ControlState control;
+    static SafetyThreadState safety;
+    static ThreadContext contexts[THREAD_COUNT];
+    static atomic_bool stop;
+    if (plasma_bus_init(&bus, BUS_DEPTH_DEFAULT) != 0) {
+        fprintf(stderr, "cannot allocate the bus\n");
+        return 1;
+    }
+    atomic_init(&stop, false);
+
+    const int64_t period_ns = 1000000000LL / cfg.rate_hz;
+    const float dt = (float)period_ns * 1e-9f;
+
+    PlasmaControlSystem *plant = &acquisition.control;
+    plasma_rng_seed(&plant->rng, cfg.seed, 0);
+    PlasmaState *s = &plant->current_state;
+    s->plasma_current = 0.1f;
+    s->elongation = 1.7f;
+    s->triangularity = 0.33f;
+    s->li_inductance = PLASMA_LI_TARGET;
+    s->density_core = SCENARIO_DENSITY;
+    s->density_edge = 3.0f;
+    s->temperature_core = 1.0f;
+    s->temperature_edge = 0.1f;
+    s->vertical_position = 0.01f;
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        plant->heating_systems[h].power = HEATING_POWER;
+        plant->heating_systems[h].frequency = 170.0e9f;
+    }
+    plant->energy_confinement_time = ENERGY_CONFINEMENT_TIME;
+    plant->stored_energy = 1.0f;
+    plant->controller_state = PSQ_STATE_INIT;
+    acquisition.dt = dt;
+    acquisition.total_cycles = (uint64_t)(cfg.duration_s * cfg.rate_hz);
+    if (mhd_spectrum_init(&acquisition.mhd, (float)cfg.rate_hz, 0) != 0) {
+        fprintf(stderr, "cannot allocate the MHD spectrum\n");
+        return 1;
+    }
+
+    control.control.controller_state = PSQ_STATE_INIT;
+    control.dt = dt;
+    disruption_predictor_init(&safety.predictor);
+    safety.out.system.mitigation_systems.massive_gas_injection_ready = true;
+    safety.out.system.mitigation_systems.pellet_injection_ready = true;
+    safety.out.system.mitigation_systems.killer_pulse_ready = true;
+    safety.dt = dt / SAFETY_RATE_FACTOR;
+    safety.controller_state = PSQ_STATE_INIT;
+
+    static const char *names[THREAD_COUNT] = { "acquisition", "control", "safety" };
+    void (*cycles[THREAD_COUNT])(ThreadContext *, void *) = {
+        acquisition_cycle, control_cycle, safety_cycle,
+    };
+    void *states[THREAD_COUNT] = { &acquisition, &control, &safety };
+    ThreadStart starts[THREAD_COUNT];
+    pthread_t threads[THREAD_COUNT];
+
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "warning: mlockall failed (%s)\n", strerror(errno));
+    }
+    for (int t = 0; t < THREAD_COUNT; t++) {
+        contexts[t] = (ThreadContext){
+            .name = names[t],
+            .cpu = cfg.cpus[t],
+            .priority = cfg.priority,
+            .period_ns = t == THREAD_SAFETY ? period_ns / SAFETY_RATE_FACTOR : period_ns,
+            .bus = &bus,
+            .stop = &stop,
+        };
+        starts[t] = (ThreadStart){ &contexts[t], cycles[t], states[t] };
+        if (pthread_create(&threads[t], NULL, thread_main, &starts[t]) != 0) {
+            fprintf(stderr, "cannot start the %s thread\n", names[t]);
+            return 1;
+        }
+    }
+    for (int t = 0; t < THREAD_COUNT; t++) pthread_join(threads[t], NULL);
+
+    printf("rate %u Hz (safety %u Hz), bus depth %d\n", cfg.rate_hz,
+           cfg.rate_hz * SAFETY_RATE_FACTOR, BUS_DEPTH_DEFAULT);
+    for (int t = 0; t < THREAD_COUNT; t++) print_thread(&contexts[t]);
+    printf("final state %s at t=%.3f s: Ip %.3f MA, q95 %.2f, Z %.4f m\n",
+           state_names[control.control.controller_state], plant->simulation_time,
+           s->plasma_current, s->safety_factor_q95, s->vertical_position);
+    printf("safety: %llu evaluations, p %.3f, cause %s",
+           (unsigned long long)safety.evaluations, safety.out.prediction.disruption_probability,
+           disruption_cause_name(safety.out.prediction.most_likely_cause));
+    if (acquisition.mitigated) {
+        printf(", mitigation %s applied at t=%.4f s",
+               mitigation_action_name(acquisition.mitigation_action),
+               acquisition.mitigation_time);
+    }
+    printf("\n");
+    const MhdSpectrum *mhd = &acquisition.mhd;
+    printf("mhd: %llu windows, %llu skipped; peak %.1f Hz, coherence %.2f%s%s\n",
+           (unsigned long long)mhd->windows, (unsigned long long)mhd->windows_skipped,
+           mhd->mode.peak_frequency, mhd->mode.mean_coherence,
+           mhd->mode.locked_mode_detected ? ", locked mode" : "",
+           mhd->mode.ntm_detected ? ", NTM" : "");
+    mhd_spectrum_free(&acquisition.mhd);
+    plasma_bus_free(&bus);
+    return 0;
+}
@@ -1 +1,815 @@
+// NPE-PSQ core simulation driver
+//
+// Runs advance_plasma_state() and the scenario control cycle of
+// control_cycle.h (actuator laws, disruption warning, predictor and
+// mitigation, PlasmaControlSystem.controller_state machine) on a
+// fixed-period real-time loop. Everything the loop touches is allocated
+// and faulted in before the first cycle; the loop itself never allocates,
+// locks or does I/O.
+//
+// Build: gcc -O2 -I.. npe_psq_core_sim.c ../control_cycle.c ../plasma_physics.c
+//            ../plasma_rng.c ../plasma_safety.c ../state_history.c
+//            ../disruption_quench.c ../plasma_trace.c ../shot_log.c
+//            ../limit_monitor.c ../nmpc.c ../coil_response.c
+//            ../mhd_spectrum.c -lm -lpthread -o npe_psq_core_sim
+//        (add -DPLASMA_TRACE for per-stage timing and --trace)
+// Run:   ./npe_psq_core_sim --rate 1000 --duration 10 --cpu 3 --prio 80 --log shot.csv
+//        ./npe_psq_core_sim --rate 10 --duration 60 --integrator semi-implicit
+//        ./npe_psq_core_sim --duration 2 --trace cycle.json   (-DPLASMA_TRACE)
+//        ./npe_psq_core_sim --duration 20 --shot-log shot.npsl  (read: ia/shot_log.py)
+//        ./npe_psq_core_sim --rate 10000 --duration 10 --multirate 100
+//        ./npe_psq_core_sim --duration 10 --nmpc
+//        ./npe_psq_core_sim --duration 10 --coils ../machines/npe_psq_default.coils
 
+#define _GNU_SOURCE
+#include "coil_response.h"
+#include "control_cycle.h"
+#include "disruption_quench.h"
+#include "limit_monitor.h"
+#include "mhd_spectrum.h"
+#include "nmpc.h"
+#include "plasma_physics.h"
+#include "plasma_rng.h"
+#include "plasma_safety.h"
+#include "plasma_trace.h"
+#include "shot_log.h"
+#include "state_history.h"
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+// ================= LOOP PARAMETERS =================
+#define LOOP_RATE_MIN_HZ 1
+#define LOOP_RATE_MAX_HZ 10000
+#define LOOP_RATE_DEFAULT_HZ 1000
+#define JITTER_HIST_BINS 64
+#define JITTER_HIST_BIN_NS 1000
+#define PREFAULT_STACK_BYTES (256 * 1024)
+#define HISTORY_DEPTH 16384
+#define LOGGER_PERIOD_NS 10000000L
+#define LOGGER_BATCH 512
+#define SHOT_LOG_STATE_COLUMNS (sizeof(PlasmaState) / sizeof(float))
+#define SHOT_LOG_NUM_COLUMNS (1 + SHOT_LOG_STATE_COLUMNS + NUM_PF_COILS + \
+                              NUM_VERTICAL_COILS + 4)
+
+#define COIL_UNIT_FORCE_MIN 1e-6f         // N/MA per vertical-coil A, for --coils
+
+typedef struct {
+    CycleSafety cycle;                    // quench: --analytic-quench only
+    LimitMonitor limits;
+    uint32_t limit_activations[LIMIT_MONITOR_MAX_LIMITS];
+    ShotLog *shot_log;                    // limit transitions, if logging
+    MhdSpectrum mhd;                      // locked-mode and NTM detection
+    DiagnosticsSystem diagnostics;        // synthetic probes and their spectrum
+} SafetyState;
+
+typedef struct {
+    uint64_t cycles;
+    uint64_t deadline_misses;
+    uint64_t skipped_periods;
+    int64_t jitter_min_ns;
+    int64_t jitter_max_ns;
+    int64_t jitter_sum_ns;
+    int64_t exec_max_ns;
+    int64_t exec_sum_ns;
+    uint64_t jitter_hist[JITTER_HIST_BINS];
+} LoopStats;
+
+typedef struct {
+    uint32_t rate_hz;
+    double duration_s;
+    int cpu;
+    int priority;
+    const char *log_path;
+    uint64_t seed;
+    IntegratorMode integrator;
+    uint32_t slow_period;                 // --multirate ticks, 0 for single-rate
+    bool nmpc;
+    bool analytic_quench;
+    const char *trace_path;
+    const char *shot_log_path;
+    const char *coils_path;
+} LoopConfig;
+
+// --coils: the vertical force on the plasma comes from the machine file's
+// coil Green's functions (coil_response.h) instead of the fixed per-coil
+// coupling. unit is the response to 1 A in every vertical coil the
+// controller drives, with the PF coils off.
+typedef struct {
+    CoilResponse cache;
+    float currents[COIL_RESPONSE_MAX_COILS];
+    float out[COIL_RESPONSE_ROWS];
+    float unit[COIL_RESPONSE_ROWS];
+} CoilCoupling;
+
+typedef struct {
+    StateHistory *history;
+    FILE *out;
+    ShotLog *shot_log;
+    bool shot_log_failed;
+    atomic_bool stop;
+} Logger;
+
+// Shot-log row: time, every PlasmaState field in declaration order, coil
+// currents, stored energy and the other actuators advance_plasma_state()
+// reads, so the log is a complete training set for ia/surrogate_train.py
+static const char *const shot_log_columns[SHOT_LOG_NUM_COLUMNS] = {
+    "time",
+    "plasma_current", "safety_factor_q95", "beta_normalized", "li_inductance",
+    "radial_position", "vertical_position", "elongation", "triangularity",
+    "temperature_core", "temperature_edge", "density_core", "density_edge",
+    "mhd_activity_level", "ntm_amplitude", "elm_frequency", "neutron_rate",
+    "impurity_concentration", "radiation_power",
+    "pf_coil_0", "pf_coil_1", "pf_coil_2", "pf_coil_3", "pf_coil_4",
+    "pf_coil_5", "pf_coil_6", "pf_coil_7", "pf_coil_8", "pf_coil_9",
+    "vertical_coil_0", "vertical_coil_1", "vertical_coil_2", "vertical_coil_3",
+    "stored_energy", "heating_power", "fuel_injection_rate", "energy_confinement_time",
+};
+_Static_assert(SHOT_LOG_STATE_COLUMNS == 18 && NUM_PF_COILS == 10 &&
+               NUM_VERTICAL_COILS == 4, "shot_log_columns out of date");
+
+static inline int64_t timespec_ns(const struct timespec *t) {
+    return (int64_t)t->tv_sec * 1000000000LL + t->tv_nsec;
+}
+
+static inline void timespec_add_ns(struct timespec *t, int64_t ns) {
+    t->tv_nsec += ns;
+    while (t->tv_nsec >= 1000000000L) {
+        t->tv_nsec -= 1000000000L;
+        t->tv_sec++;
+    }
+}
+
+static void prefault_stack(void) {
+    volatile unsigned char stack[PREFAULT_STACK_BYTES];
+    for (size_t i = 0; i < sizeof(stack); i += 4096) {
+        stack[i] = 0;
+    }
+}
+
+static void setup_realtime(const LoopConfig *cfg) {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+        fprintf(stderr, "warning: mlockall failed (%s)\n", strerror(errno));
+    }
+    prefault_stack();
+
+    if (cfg->cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cfg->cpu, &set);
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (err != 0) {
+            fprintf(stderr, "warning: cannot pin to CPU %d (%s)\n",
+                    cfg->cpu, strerror(err));
+        }
+    }
+    if (cfg->priority > 0) {
+        struct sched_param sp = { .sched_priority = cfg->priority };
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (err != 0) {
+            fprintf(stderr, "warning: SCHED_FIFO %d unavailable (%s)\n",
+                    cfg->priority, strerror(err));
+        }
+    }
+}
+
+static void init_control_system(PlasmaControlSystem *control, uint64_t seed) {
+    memset(control, 0, sizeof(*control));
+    plasma_rng_seed(&control->rng, seed, 0);
+    PlasmaState *s = &control->current_state;
+    s->plasma_current = 0.1f;
+    s->elongation = 1.7f;
+    s->triangularity = 0.33f;
+    s->li_inductance = PLASMA_LI_TARGET;
+    s->density_core = 10.0f;
+    s->density_edge = 3.0f;
+    s->temperature_core = 1.0f;
+    s->temperature_edge = 0.1f;
+    s->vertical_position = 0.01f;
+
+    control->target_state = *s;
+    control->target_state.plasma_current = SCENARIO_PLASMA_CURRENT;
+    control->target_state.vertical_position = 0.0f;
+
+    for (int i = 0; i < NUM_HEATING_SYSTEMS; i++) {
+        control->heating_systems[i].power = 0.4f;        // MW
+        control->heating_systems[i].frequency = 170.0e9f;
+        control->heating_systems[i].enabled = false;
+    }
+    control->energy_confinement_time = ENERGY_CONFINEMENT_TIME;
+    control->stored_energy = 1.0f;
+    control->controller_state = PSQ_STATE_INIT;
+}
+
+// With --coils the vertical law of control_cycle_actuators() is re-solved
+// against the coil set: the force per MA is linear in the currents, so the
+// common vertical-coil current is what the PF coils' stray field leaves of
+// F_needed / Ip, divided by the vertical coils' force per MA per ampere
+// at z.
+static void apply_coil_vertical(PlasmaControlSystem *control, CoilCoupling *coils,
+                                float dt) {
+    const PlasmaState *s = &control->current_state;
+    const CoilResponse *cache = &coils->cache;
+    float plasma_volume = machine_plasma_volume(&machine_default, s->elongation);
+    float F_needed = control_cycle_vertical_force(s, plasma_volume, dt);
+    float z = s->vertical_position;
+
+    coil_response_gather(cache, control, coils->currents);
+    for (uint32_t c = 0; c < cache->num_vertical; c++) {
+        coils->currents[cache->num_pf + c] = 0.0f;
+    }
+    coil_response_evaluate(cache, coils->currents, coils->out);
+    float pf_per_ma = coil_response_vertical_force_per_ma(cache, coils->out, z);
+    float unit_per_ma = coil_response_vertical_force_per_ma(cache, coils->unit, z);
+    float per_coil = 0.0f;
+    if (fabsf(s->plasma_current) > 1e-3f && fabsf(unit_per_ma) > COIL_UNIT_FORCE_MIN) {
+        per_coil = (F_needed / s->plasma_current - pf_per_ma) / unit_per_ma;
+    }
+    for (int i = 0; i < NUM_VERTICAL_COILS; i++) {
+        control->vertical_coil_currents[i] = per_coil;
+    }
+}
+
+// Returns -1 if the file does not load, or its vertical coils exert no
+// force on the centred plasma.
+static int coil_coupling_init(CoilCoupling *coils, const char *path) {
+    if (coil_response_load(&coils->cache, path) != 0) return -1;
+    const CoilResponse *cache = &coils->cache;
+    memset(coils->currents, 0, sizeof(coils->currents));
+    for (uint32_t c = 0; c < cache->num_vertical && c < NUM_VERTICAL_COILS; c++) {
+        coils->currents[cache->num_pf + c] = 1.0f;
+    }
+    coil_response_evaluate(cache, coils->currents, coils->unit);
+    if (!(fabsf(coil_response_vertical_force_per_ma(cache, coils->unit, 0.0f)) >
+          COIL_UNIT_FORCE_MIN)) {
+        coil_response_free(&coils->cache);
+        return -1;
+    }
+    return 0;
+}
+
+// With --nmpc the current, fuelling and vertical laws of
+// control_cycle_actuators() are replaced by one NMPC step while the
+// scenario drives the plasma; heating stays the scenario's, pinned through
+// the input box. Shutdown and disruption states
+// keep the scenario actuators, and the plan restarts from the measured
+// state when the NMPC takes over again.
+static void apply_nmpc(PlasmaControlSystem *control, const ScenarioState *scenario,
+                       bool *running, Nmpc *nmpc) {
+    int state = control->controller_state;
+    if (state != PSQ_STATE_RAMP_UP && state != PSQ_STATE_FLAT_TOP &&
+        state != PSQ_STATE_RAMP_DOWN) {
+        *running = false;
+        return;
+    }
+    float x[NMPC_STATES], u[NMPC_INPUTS];
+    nmpc_state_from_plasma(&control->current_state, control, x);
+    if (!*running) {
+        u[NMPC_U_LOOP] = control->pf_coil_currents[0];
+        u[NMPC_U_HEATING] = 0.0f;
+        u[NMPC_U_FUEL] = control->fuel_injection_rate / NMPC_FUEL_UNIT;
+        u[NMPC_U_VERTICAL] = control->vertical_coil_currents[0];
+        nmpc_reset(nmpc, x, u);
+        *running = true;
+    }
+    float P_heating = 0.0f;
+    for (int i = 0; i < NUM_HEATING_SYSTEMS; i++) {
+        if (control->heating_systems[i].enabled) {
+            P_heating += control->heating_systems[i].power;
+        }
+    }
+    nmpc_set_input_bounds(nmpc, NMPC_U_HEATING, P_heating, P_heating);
+    // The ramp reference stops where the tracked Ip enters flat-top, which
+    // without the P-law's lag is short of the target
+    float Ip_ref = state == PSQ_STATE_FLAT_TOP ? control->target_state.plasma_current
+                                               : scenario->plasma_current_ref;
+    const float reference[NMPC_OUTPUTS] = {
+        [NMPC_Y_CURRENT] = Ip_ref,
+        [NMPC_Y_DENSITY] = control->target_state.density_core,
+        [NMPC_Y_POSITION] = 0.0f,
+    };
+    nmpc_prepare(nmpc);
+    nmpc_feedback(nmpc, x, reference, u);
+    nmpc_apply_inputs(u, control);
+}
+
+// Limit transitions: counted, and logged as events when a shot log is open
+static void on_limit(void *user, uint32_t lane, uint32_t limit, bool active,
+                     float value, float time) {
+    (void)lane;
+    (void)value;
+    SafetyState *safety = user;
+    safety->limit_activations[limit] += active;
+    if (safety->shot_log) {
+        shot_log_event(safety->shot_log, time, SHOT_LOG_EVENT_LIMIT,
+                       limit | (uint32_t)active << 8);
+    }
+}
+
+static inline void record_cycle(LoopStats *stats, int64_t jitter_ns,
+                                int64_t exec_ns) {
+    stats->cycles++;
+    if (jitter_ns < stats->jitter_min_ns) stats->jitter_min_ns = jitter_ns;
+    if (jitter_ns > stats->jitter_max_ns) stats->jitter_max_ns = jitter_ns;
+    stats->jitter_sum_ns += jitter_ns;
+    if (exec_ns > stats->exec_max_ns) stats->exec_max_ns = exec_ns;
+    stats->exec_sum_ns += exec_ns;
+
+    int64_t bin = jitter_ns / JITTER_HIST_BIN_NS;
+    if (bin < 0) bin = 0;
+    if (bin >= JITTER_HIST_BINS) bin = JITTER_HIST_BINS - 1;
+    stats->jitter_hist[bin]++;
+}
+
+// Plasma update for one cycle. With --multirate the scheduler runs the
+// transport blocks every slow_period cycles; with --coils the explicit step
+// takes its vertical force from the coil set. With --analytic-quench the
+// DISRUPTION and MITIGATION states follow the closed-form thermal and
+// current quench from the onset, at the loop's own dt.
+static void advance_plasma(PlasmaControlSystem *control, SafetyState *safety,
+                           PlasmaIntegrator *integrator, PlasmaScheduler *scheduler,
+                           CoilCoupling *coils, const LoopConfig *cfg, float dt) {
+    PlasmaState *s = &control->current_state;
+    bool quench_phase = control->controller_state == PSQ_STATE_DISRUPTION ||
+                        control->controller_state == PSQ_STATE_MITIGATION;
+    if (!cfg->analytic_quench || !quench_phase) {
+        if (cfg->slow_period) {
+            advance_plasma_state_scheduled(scheduler, s, control, dt);
+        } else if (coils) {
+            coil_response_gather(&coils->cache, control, coils->currents);
+            coil_response_evaluate(&coils->cache, coils->currents, coils->out);
+            float force_per_ma = coil_response_vertical_force_per_ma(
+                &coils->cache, coils->out, s->vertical_position);
+            advance_plasma_state_coupled(s, control, force_per_ma, dt);
+        } else {
+            advance_plasma_state_integrated(integrator, s, control, dt);
+        }
+        return;
+    }
+    control_cycle_quench(control, &safety->cycle, dt);
+    if (cfg->slow_period) plasma_scheduler_sync(scheduler, s, control);
+}
+
+static void shot_log_record(ShotLog *log, const PlasmaControlSystem *control) {
+    float row[SHOT_LOG_NUM_COLUMNS];
+    uint32_t n = 0;
+    row[n++] = control->simulation_time;
+    memcpy(row + n, &control->current_state, sizeof(PlasmaState));
+    n += SHOT_LOG_STATE_COLUMNS;
+    for (int c = 0; c < NUM_PF_COILS; c++) row[n++] = control->pf_coil_currents[c];
+    for (int c = 0; c < NUM_VERTICAL_COILS; c++) {
+        row[n++] = control->vertical_coil_currents[c];
+    }
+    row[n++] = control->stored_energy;
+    float heating = 0.0f;
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        if (control->heating_systems[h].enabled) heating += control->heating_systems[h].power;
+    }
+    row[n++] = heating;
+    row[n++] = control->fuel_injection_rate;
+    row[n++] = control->energy_confinement_time;
+    shot_log_append(log, row);
+}
+
+static void run_loop(PlasmaControlSystem *control, SafetyState *safety,
+                     PlasmaIntegrator *integrator, PlasmaScheduler *scheduler,
+                     Nmpc *nmpc, CoilCoupling *coils, ShotLog *shot_log,
+                     const LoopConfig *cfg, LoopStats *stats) {
+    const int64_t period_ns = 1000000000LL / cfg->rate_hz;
+    const float dt = (float)period_ns * 1e-9f;
+    const uint64_t total_cycles = (uint64_t)(cfg->duration_s * cfg->rate_hz);
+    ScenarioState scenario;
+    control_cycle_scenario_init(&scenario, control);
+    bool nmpc_running = false;            // the plan follows the shot
+
+    memset(stats, 0, sizeof(*stats));
+    stats->jitter_min_ns = INT64_MAX;
+
+    struct timespec next;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    timespec_add_ns(&next, period_ns);
+
+    while (stats->cycles < total_cycles) {
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        struct timespec wake, done;
+        clock_gettime(CLOCK_MONOTONIC, &wake);
+        int64_t release_ns = timespec_ns(&next);
+        int64_t jitter_ns = timespec_ns(&wake) - release_ns;
+
+        PLASMA_TRACE_MARK(trace_ticks);
+        control_cycle_actuators(control, &scenario, dt);
+        if (nmpc) apply_nmpc(control, &scenario, &nmpc_running, nmpc);
+        if (coils) apply_coil_vertical(control, coils, dt);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_CYCLE_ACTUATORS, trace_ticks);
+        advance_plasma(control, safety, integrator, scheduler, coils, cfg, dt);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_CYCLE_PLASMA, trace_ticks);
+        bool was_detected = control->disruption_detected;
+        control_cycle_warnings(control, dt);
+        control_cycle_diagnostics(control, &safety->cycle, &safety->mhd,
+                                  &safety->diagnostics);
+        limit_monitor_update(&safety->limits, &control->current_state, dt,
+                             control->simulation_time);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_CYCLE_WARNINGS, trace_ticks);
+        control_cycle_safety(control, &safety->cycle, dt);
+        PLASMA_TRACE_STAGE(TRACE_STAGE_CYCLE_SAFETY, trace_ticks);
+        int previous_state = control->controller_state;
+        control_cycle_controller(control, &scenario, dt);
+        control->simulation_time += dt;
+        control->iteration_count++;
+        PLASMA_TRACE_STAGE(TRACE_STAGE_CYCLE_CONTROLLER, trace_ticks);
+        if (control->history) {
+            state_history_push(control->history, control->simulation_time,
+                               &control->current_state);
+        }
+        if (shot_log) {
+            shot_log_record(shot_log, control);
+            if (control->disruption_detected && !was_detected) {
+                shot_log_event(shot_log, control->simulation_time,
+                               SHOT_LOG_EVENT_MITIGATION, safety->cycle.fired.action);
+            }
+            if ((int)control->controller_state != previous_state) {
+                shot_log_event(shot_log, control->simulation_time,
+                               SHOT_LOG_EVENT_CONTROLLER_STATE,
+                               control->controller_state);
+            }
+        }
+        PLASMA_TRACE_STAGE(TRACE_STAGE_CYCLE_HISTORY, trace_ticks);
+
+        clock_gettime(CLOCK_MONOTONIC, &done);
+        int64_t done_ns = timespec_ns(&done);
+        record_cycle(stats, jitter_ns, done_ns - timespec_ns(&wake));
+
+        // Fixed-rate schedule: a cycle that finishes after the next release
+        // is a deadline miss, and any releases already in the past are
+        // dropped instead of being run back to back.
+        timespec_add_ns(&next, period_ns);
+        if (done_ns > timespec_ns(&next)) {
+            stats->deadline_misses++;
+            int64_t behind = (done_ns - timespec_ns(&next)) / period_ns + 1;
+            stats->skipped_periods += (uint64_t)behind;
+            timespec_add_ns(&next, behind * period_ns);
+        }
+    }
+}
+
+static void print_stats(const PlasmaControlSystem *control,
+                        const SafetyState *safety,
+                        const PlasmaIntegrator *integrator,
+                        const PlasmaScheduler *scheduler, const Nmpc *nmpc,
+                        const CoilCoupling *coils, const LoopConfig *cfg,
+                        const LoopStats *stats) {
+    static const char *state_names[] = {
+        "INIT", "RAMP_UP", "FLAT_TOP", "RAMP_DOWN",
+        "DISRUPTION", "MITIGATION", "SAFE_SHUTDOWN"
+    };
+    uint64_t n = stats->cycles ? stats->cycles : 1;
+
+    printf("rate %u Hz, cycles %llu, deadline misses %llu (skipped %llu periods)\n",
+           cfg->rate_hz, (unsigned long long)stats->cycles,
+           (unsigned long long)stats->deadline_misses,
+           (unsigned long long)stats->skipped_periods);
+    printf("jitter ns: min %lld  mean %lld  max %lld\n",
+           (long long)stats->jitter_min_ns,
+           (long long)(stats->jitter_sum_ns / (int64_t)n),
+           (long long)stats->jitter_max_ns);
+    printf("exec ns:   mean %lld  max %lld\n",
+           (long long)(stats->exec_sum_ns / (int64_t)n),
+           (long long)stats->exec_max_ns);
+    printf("jitter histogram (%d ns bins):\n", JITTER_HIST_BIN_NS);
+    for (int i = 0; i < JITTER_HIST_BINS; i++) {
+        if (stats->jitter_hist[i]) {
+            printf("  %s%6d us: %llu\n", i == JITTER_HIST_BINS - 1 ? ">=" : "  ",
+                   i, (unsigned long long)stats->jitter_hist[i]);
+        }
+    }
+    printf("final state %s at t=%.3f s: Ip %.3f MA, q95 %.2f, Z %.4f m\n",
+           state_names[control->controller_state], control->simulation_time,
+           control->current_state.plasma_current,
+           control->current_state.safety_factor_q95,
+           control->current_state.vertical_position);
+    if (cfg->slow_period) {
+        printf("multirate: %llu ticks, %llu handoffs;",
+               (unsigned long long)scheduler->tick,
+               (unsigned long long)scheduler->published);
+        for (int b = 0; b < PLASMA_BLOCK_COUNT; b++) {
+            printf(" %s 1/%u (%llu)", plasma_block_name((PlasmaBlock)b),
+                   scheduler->blocks[b].period,
+                   (unsigned long long)scheduler->blocks[b].runs);
+        }
+        printf("\n");
+    } else if (coils) {
+        printf("coils %s: %u PF, %u vertical, coupled euler step\n", cfg->coils_path,
+               coils->cache.num_pf, coils->cache.num_vertical);
+    } else {
+        const IntegratorStats *is = &integrator->stats;
+        printf("integrator %s: %llu substeps (%llu rejected), substep %.3g-%.3g s\n",
+               integrator_mode_name(integrator->mode),
+               (unsigned long long)is->substeps, (unsigned long long)is->rejected,
+               is->substeps ? is->substep_min : 0.0f, is->substep_max);
+    }
+    if (nmpc) {
+        const NmpcStats *ns = &nmpc->stats;
+        printf("nmpc: %llu cycles, QP iterations mean %.1f max %u (%llu capped), "
+               "last cost %.4g\n",
+               (unsigned long long)ns->cycles,
+               ns->cycles ? (double)ns->qp_iterations / (double)ns->cycles : 0.0,
+               ns->qp_iterations_max, (unsigned long long)ns->capped, ns->cost_last);
+    }
+    const MhdSpectrum *mhd = &safety->mhd;
+    printf("mhd: %llu windows, %llu skipped; peak %.1f Hz, coherence %.2f%s%s\n",
+           (unsigned long long)mhd->windows, (unsigned long long)mhd->windows_skipped,
+           mhd->mode.peak_frequency, mhd->mode.mean_coherence,
+           mhd->mode.locked_mode_detected ? ", locked mode" : "",
+           mhd->mode.ntm_detected ? ", NTM" : "");
+    printf("predictor: p %.3f, ttd %.3f s, cause %s\n",
+           safety->cycle.prediction.disruption_probability,
+           safety->cycle.prediction.time_to_disruption,
+           disruption_cause_name(safety->cycle.prediction.most_likely_cause));
+    const DisruptionQuench *q = &safety->cycle.quench;
+    if (q->active) {
+        printf("quench at t=%.4f s: TQ %.2f ms, CQ end %.2f ms (80-20 %.2f ms), "
+               "peak dIp/dt %.1f MA/s at %.2f ms, peak force %.4g at %.2f ms\n",
+               q->onset_time, q->thermal_quench_end * 1e3f,
+               q->current_quench_end * 1e3f, q->current_quench_duration * 1e3f,
+               q->peak_dIp_dt, q->peak_dIp_dt_time * 1e3f, q->peak_force,
+               q->peak_force_time * 1e3f);
+    }
+    printf("limits active at end: %#x\n", safety->limits.mask);
+    for (uint32_t i = 0; i < safety->limits.count; i++) {
+        if (safety->limit_activations[i]) {
+            printf("  %-14s tripped %u times\n", safety->limits.name[i],
+                   safety->limit_activations[i]);
+        }
+    }
+    if (safety->cycle.system.disruption_count) {
+        printf("mitigation fired at t=%.4f s: %s (urgency %.2f)\n",
+               safety->cycle.system.last_disruption_time,
+               mitigation_action_name(safety->cycle.fired.action),
+               safety->cycle.fired.urgency);
+    }
+}
+
+// Low-priority drain of the state history ring to CSV and of full shot-log
+// chunks to disk. Runs unpinned and never touches anything the control
+// loop writes except the rings themselves.
+static size_t logger_drain(Logger *logger, float *records) {
+    if (logger->shot_log && shot_log_drain(logger->shot_log) != 0) {
+        logger->shot_log_failed = true;
+    }
+    if (!logger->history) return 0;
+    size_t n = state_history_pop(logger->history, records, LOGGER_BATCH);
+    uint32_t stride = logger->history->record_floats;
+    for (size_t r = 0; r < n; r++) {
+        const float *rec = records + r * stride;
+        fprintf(logger->out, "%.6f", rec[0]);
+        for (uint32_t k = 1; k < stride; k++) {
+            fprintf(logger->out, ",%.6g", rec[k]);
+        }
+        fputc('\n', logger->out);
+    }
+    return n;
+}
+
+static void *logger_main(void *arg) {
+    Logger *logger = arg;
+    float records[LOGGER_BATCH * (1 + HISTORY_STATE_FIELDS)];
+    struct timespec period = { 0, LOGGER_PERIOD_NS };
+
+    while (!atomic_load(&logger->stop)) {
+        if (logger_drain(logger, records) < LOGGER_BATCH) {
+            nanosleep(&period, NULL);
+        }
+    }
+    while (logger_drain(logger, records) > 0) {}
+    return NULL;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--rate HZ] [--duration S] [--cpu N] [--prio P] [--log CSV] [--seed N]\n"
+            "          [--integrator MODE] [--analytic-quench] [--trace JSON]\n"
+            "          [--shot-log FILE] [--multirate N] [--nmpc] [--coils FILE]\n"
+            "  --rate      loop rate, %d-%d Hz (default %d)\n"
+            "  --duration  simulated/wall seconds to run (default 10)\n"
+            "  --cpu       pin the loop to this CPU (default: no pinning)\n"
+            "  --prio      SCHED_FIFO priority (default: 0, no RT class)\n"
+            "  --log       stream the state history to a CSV file\n"
+            "  --seed      RNG seed for the MHD noise stream (default 1)\n"
+            "  --integrator  euler, semi-implicit or adaptive (default euler)\n"
+            "  --analytic-quench  cross disruptions with the closed-form TQ/CQ\n"
+            "  --trace     write per-stage timings as a Chrome trace (-DPLASMA_TRACE builds)\n"
+            "  --shot-log  stream state, coil currents and state transitions to a\n"
+            "              binary shot log (shot_log.h)\n"
+            "  --multirate run energy and density every N cycles at N * dt, the\n"
+            "              vertical and circuit blocks every cycle (euler only)\n"
+            "  --nmpc      current, density and vertical control by real-time NMPC\n"
+            "              (nmpc.h) during ramp-up, flat-top and ramp-down\n"
+            "  --coils     vertical force from a coil set machine file\n"
+            "              (coil_response.h; euler only, not with --nmpc)\n",
+            prog, LOOP_RATE_MIN_HZ, LOOP_RATE_MAX_HZ, LOOP_RATE_DEFAULT_HZ);
+}
+
+int main(int argc, char **argv) {
+    LoopConfig cfg = {
+        .rate_hz = LOOP_RATE_DEFAULT_HZ,
+        .duration_s = 10.0,
+        .cpu = -1,
+        .priority = 0,
+        .log_path = NULL,
+        .seed = 1,
+        .integrator = INTEGRATOR_EULER,
+        .slow_period = 0,
+        .nmpc = false,
+        .analytic_quench = false,
+        .trace_path = NULL,
+        .shot_log_path = NULL,
+        .coils_path = NULL,
+    };
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--rate") == 0) {
+            cfg.rate_hz = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--duration") == 0) {
+            cfg.duration_s = strtod(argv[++i], NULL);
+        } else if (i + 1 < argc && strcmp(argv[i], "--cpu") == 0) {
+            cfg.cpu = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--prio") == 0) {
+            cfg.priority = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--log") == 0) {
+            cfg.log_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--shot-log") == 0) {
+            cfg.shot_log_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--coils") == 0) {
+            cfg.coils_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--trace") == 0) {
+            cfg.trace_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--multirate") == 0) {
+            cfg.slow_period = (uint32_t)strtoul(argv[++i], NULL, 10);
+            if (cfg.slow_period == 0) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--nmpc") == 0) {
+            cfg.nmpc = true;
+        } else if (strcmp(argv[i], "--analytic-quench") == 0) {
+            cfg.analytic_quench = true;
+        } else if (i + 1 < argc && strcmp(argv[i], "--integrator") == 0) {
+            const char *name = argv[++i];
+            int mode = INTEGRATOR_ADAPTIVE;
+            while (mode >= 0 && strcmp(name, integrator_mode_name(mode)) != 0) mode--;
+            if (mode < 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            cfg.integrator = (IntegratorMode)mode;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.rate_hz < LOOP_RATE_MIN_HZ || cfg.rate_hz > LOOP_RATE_MAX_HZ ||
+        cfg.duration_s <= 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (cfg.slow_period && cfg.integrator != INTEGRATOR_EULER) {
+        fprintf(stderr, "--multirate runs the explicit blocks; drop --integrator\n");
+        return 1;
+    }
+    if (cfg.coils_path && (cfg.slow_period || cfg.integrator != INTEGRATOR_EULER)) {
+        fprintf(stderr, "--coils runs the explicit coupled step; drop --multirate "
+                        "and --integrator\n");
+        return 1;
+    }
+    if (cfg.coils_path && cfg.nmpc) {
+        fprintf(stderr, "--nmpc models the per-coil vertical force; drop --coils\n");
+        return 1;
+    }
+    if (cfg.trace_path && !PLASMA_TRACE_ENABLED) {
+        fprintf(stderr, "--trace needs a build with -DPLASMA_TRACE\n");
+        return 1;
+    }
+
+    static PlasmaControlSystem control;
+    static LoopStats stats;
+    static SafetyState safety;
+    static PlasmaIntegrator integrator;
+    static PlasmaScheduler scheduler;
+    init_control_system(&control, cfg.seed);
+    plasma_integrator_init(&integrator, cfg.integrator);
+    if (cfg.slow_period) plasma_scheduler_init(&scheduler, cfg.slow_period);
+    static CoilCoupling coil_coupling;
+    CoilCoupling *coils = NULL;
+    if (cfg.coils_path) {
+        if (coil_coupling_init(&coil_coupling, cfg.coils_path) != 0) {
+            fprintf(stderr, "cannot load a vertical-control coil set from %s\n",
+                    cfg.coils_path);
+            return 1;
+        }
+        coils = &coil_coupling;
+    }
+    Nmpc *nmpc = NULL;
+    if (cfg.nmpc) {
+        NmpcConfig nmpc_config;
+        nmpc_config_default(&nmpc_config, 1.0f / (float)cfg.rate_hz);
+        nmpc_config.energy_confinement_time = control.energy_confinement_time;
+        nmpc = nmpc_create(&nmpc_config);
+        if (!nmpc) {
+            fprintf(stderr, "cannot create the NMPC\n");
+            return 1;
+        }
+    }
+    control_cycle_safety_init(&safety.cycle);
+    if (mhd_spectrum_init(&safety.mhd, (float)cfg.rate_hz, 0) != 0) {
+        fprintf(stderr, "cannot allocate the MHD spectrum\n");
+        return 1;
+    }
+    limit_monitor_compile(&safety.limits, limit_default_table, limit_default_count,
+                          on_limit, &safety);
+
+    // Before the logger starts, so a failure leaves no thread to stop; the
+    // buffer is still locked by setup_realtime()'s MCL_CURRENT
+    if (cfg.trace_path && plasma_trace_thread_init("control loop") != 0) {
+        fprintf(stderr, "cannot allocate the trace buffer\n");
+        return 1;
+    }
+
+    // The logger is started before the RT setup so it inherits the default
+    // scheduling class and affinity
+    static Logger logger;
+    pthread_t logger_thread;
+    if (cfg.log_path) {
+        logger.out = fopen(cfg.log_path, "w");
+        logger.history = state_history_create(HISTORY_DEPTH, HISTORY_FIELDS_DEFAULT);
+        if (!logger.out || !logger.history) {
+            fprintf(stderr, "cannot set up logging to %s\n", cfg.log_path);
+            return 1;
+        }
+        control.history = logger.history;
+    }
+    if (cfg.shot_log_path) {
+        logger.shot_log = shot_log_create(cfg.shot_log_path, shot_log_columns,
+                                          SHOT_LOG_NUM_COLUMNS,
+                                          SHOT_LOG_CHUNK_ROWS_DEFAULT,
+                                          SHOT_LOG_CODEC_XOR_SPARSE);
+        if (!logger.shot_log) {
+            fprintf(stderr, "cannot create shot log %s\n", cfg.shot_log_path);
+            return 1;
+        }
+    }
+    if (cfg.log_path || cfg.shot_log_path) {
+        atomic_init(&logger.stop, false);
+        int err = pthread_create(&logger_thread, NULL, logger_main, &logger);
+        if (err != 0) {
+            fprintf(stderr, "cannot start the logger thread (%s)\n", strerror(err));
+            return 1;
+        }
+    }
+
+    setup_realtime(&cfg);
+    safety.shot_log = logger.shot_log;
+    run_loop(&control, &safety, &integrator, &scheduler, nmpc, coils,
+             logger.shot_log, &cfg, &stats);
+
+    if (cfg.log_path || cfg.shot_log_path) {
+        atomic_store(&logger.stop, true);
+        pthread_join(logger_thread, NULL);
+    }
+    if (cfg.shot_log_path) {
+        uint64_t rows_dropped = logger.shot_log->rows_dropped;
+        uint64_t events_dropped = logger.shot_log->events_dropped;
+        if (shot_log_close(logger.shot_log) != 0 || logger.shot_log_failed) {
+            fprintf(stderr, "error writing shot log %s\n", cfg.shot_log_path);
+        }
+        printf("shot log: %llu rows, %llu events dropped\n",
+               (unsigned long long)rows_dropped, (unsigned long long)events_dropped);
+        logger.shot_log = NULL;
+        safety.shot_log = NULL;
+    }
+    if (cfg.log_path) {
+        printf("history: %llu samples dropped\n",
+               (unsigned long long)logger.history->dropped);
+        fclose(logger.out);
+        state_history_destroy(logger.history);
+        control.history = NULL;
+    }
+    print_stats(&control, &safety, &integrator, &scheduler, nmpc, coils, &cfg, &stats);
+    nmpc_destroy(nmpc);
+    mhd_spectrum_free(&safety.mhd);
+    if (coils) coil_response_free(&coils->cache);
+    if (cfg.trace_path) {
+        plasma_trace_summary(stdout);
+        if (plasma_trace_export_chrome(cfg.trace_path) != 0) {
+            fprintf(stderr, "cannot write trace to %s\n", cfg.trace_path);
+        }
+    }
+    return stats.deadline_misses ? 2 : 0;
+}
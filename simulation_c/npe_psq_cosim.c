@@ -0,0 +1,316 @@
+// NPE-PSQ safety checker co-simulation
+//
+// Drives the PSQ checker with advance_plasma_state() trajectories in bulk
+// and compares every verdict of the design under test against the
+// combinational specification (psq_checker.h), including the sticky trip
+// latch and the tag-to-verdict latency. Shots are open-loop from a
+// randomised flat-top base so that a share of them cross each limit.
+// Each thread records a shot's samples first, then clocks them through
+// the DUT back to back, one per cycle, so the checker rate is timed
+// separately from the physics.
+//
+// The DUT defaults to the reference pipeline. To check RTL, build with
+// -DPSQ_COSIM_EXTERNAL_DUT and link a shim that wraps the Verilated
+// fpga_hardip_psq model in a PsqDut (one model per thread).
+//
+// Build: gcc -O3 -fno-math-errno -fno-trapping-math -fopenmp -I..
+//            npe_psq_cosim.c ../psq_checker.c ../plasma_physics.c
+//            ../plasma_rng.c -lm -o npe_psq_cosim
+// Run:   ./npe_psq_cosim --shots 1024 --steps 5000 --threads 8
+
+#include "machine_geometry.h"
+#include "plasma_physics.h"
+#include "plasma_rng.h"
+#include "psq_checker.h"
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#ifdef PSQ_COSIM_EXTERNAL_DUT
+// Provided by the RTL shim; returns 0 on success
+int psq_external_dut_create(const PsqLimits *limits, PsqDut *dut);
+void psq_external_dut_destroy(PsqDut *dut);
+#endif
+
+#define COSIM_REPORT_MISMATCHES 8
+
+// ================= BASE SHOT =================
+#define BASE_DENSITY_CORE 10.0f           // 1e19 m^-3
+#define BASE_STORED_ENERGY 1.0f           // MJ
+
+typedef struct {
+    uint32_t shots;
+    uint32_t steps;
+    float dt;
+    uint64_t seed;
+    int num_threads;
+} CosimConfig;
+
+typedef struct {
+    uint64_t shots;
+    uint64_t cycles;
+    uint64_t verdicts;
+    uint64_t mismatches;
+    uint64_t lost;                  // samples without a verdict, or out of order
+    uint64_t trips;                 // shots whose latch fired
+    uint64_t saturated;
+    uint64_t float_disagreements;   // quantized checks differing from the float limits
+    uint64_t max_latency;           // cycles
+    uint64_t action[3];
+    double checker_seconds;
+} CosimStats;
+
+// Open-loop shot around a flat-top base with randomised current, density,
+// heating and vertical offset
+static void prepare_shot(const CosimConfig *cfg, uint64_t shot, PlasmaControlSystem *control) {
+    memset(control, 0, sizeof(*control));
+    plasma_rng_seed(&control->rng, cfg->seed, shot);
+    PlasmaRng *rng = &control->rng;
+    PlasmaState *s = &control->current_state;
+    s->plasma_current = 1.0f + 2.5f * plasma_rng_uniform(rng);
+    s->elongation = 1.7f;
+    s->triangularity = 0.33f;
+    s->li_inductance = PLASMA_LI_TARGET;
+    s->density_core = 4.0f + 20.0f * plasma_rng_uniform(rng);
+    s->density_edge = 3.0f;
+    s->temperature_core = 1.0f;
+    s->temperature_edge = 0.1f;
+    s->vertical_position = 0.06f * (plasma_rng_uniform(rng) - 0.5f);
+    control->target_state = *s;
+
+    float plasma_volume = machine_plasma_volume(&machine_default, s->elongation);
+    control->pf_coil_currents[0] = s->plasma_current * 10.0f;
+    control->fuel_injection_rate = BASE_DENSITY_CORE * 1e19f * plasma_volume / 10.0f *
+                                   (0.5f + 1.5f * plasma_rng_uniform(rng));
+    for (int i = 0; i < NUM_HEATING_SYSTEMS; i++) {
+        control->heating_systems[i].power = 3.0f * plasma_rng_uniform(rng);
+        control->heating_systems[i].frequency = 170.0e9f;
+        control->heating_systems[i].enabled = true;
+    }
+    control->energy_confinement_time = ENERGY_CONFINEMENT_TIME;
+    control->stored_energy = BASE_STORED_ENERGY;
+}
+
+// The checks of plasma_safety.c in float, in PSQ_CHECK_* bits
+static uint8_t float_violations(const PlasmaState *s) {
+    float n_G = s->plasma_current * machine_default.greenwald_coefficient;
+    uint8_t v = 0;
+    v |= fabsf(s->vertical_position) > VERTICAL_DISPLACEMENT_MAX ? PSQ_CHECK_VDE : 0;
+    v |= s->safety_factor_q95 < SAFETY_FACTOR_Q95_MIN ? PSQ_CHECK_Q95 : 0;
+    v |= s->density_core * 0.1f > n_G ? PSQ_CHECK_DENSITY : 0;
+    v |= s->beta_normalized > BETA_NORMAL_LIMIT ? PSQ_CHECK_BETA : 0;
+    v |= s->radiation_power > RADIATION_PEAK_LIMIT ? PSQ_CHECK_RADIATION : 0;
+    return v;
+}
+
+static bool verdict_equal(const PsqVerdict *a, const PsqVerdict *b) {
+    return a->tag == b->tag && a->violations == b->violations &&
+           a->warnings == b->warnings && a->cause == b->cause &&
+           a->action == b->action && a->tripped == b->tripped;
+}
+
+static void report_mismatch(uint64_t shot, uint64_t cycle, const PsqVerdict *dut,
+                            const PsqVerdict *ref) {
+    #pragma omp critical(cosim_report)
+    fprintf(stderr,
+            "mismatch shot %llu cycle %llu tag %u: dut v=%02x w=%02x cause=%u action=%u trip=%d"
+            " | ref v=%02x w=%02x cause=%u action=%u trip=%d\n",
+            (unsigned long long)shot, (unsigned long long)cycle, dut->tag,
+            dut->violations, dut->warnings, dut->cause, dut->action, dut->tripped,
+            ref->violations, ref->warnings, ref->cause, ref->action, ref->tripped);
+}
+
+static double seconds_between(const struct timespec *a, const struct timespec *b) {
+    return (double)(b->tv_sec - a->tv_sec) + (double)(b->tv_nsec - a->tv_nsec) * 1e-9;
+}
+
+static void cosim_worker(const CosimConfig *cfg, const PsqLimits *limits,
+                         _Atomic uint64_t *next_shot, CosimStats *stats) {
+    PsqSample *samples = aligned_alloc(64, ((size_t)cfg->steps * sizeof(PsqSample) + 63) / 64 * 64);
+    uint8_t *reference = malloc(cfg->steps);
+    if (!samples || !reference) {
+        free(samples);
+        free(reference);
+        stats->lost++;
+        return;
+    }
+    PsqChecker model;
+    PsqDut dut;
+    psq_checker_init(&model, limits);
+#ifdef PSQ_COSIM_EXTERNAL_DUT
+    if (psq_external_dut_create(limits, &dut) != 0) {
+        free(samples);
+        free(reference);
+        stats->lost++;
+        return;
+    }
+#else
+    dut = psq_checker_dut(&model);
+#endif
+    PlasmaControlSystem control;
+
+    uint64_t shot;
+    while ((shot = atomic_fetch_add(next_shot, 1)) < cfg->shots) {
+        // Trajectory
+        prepare_shot(cfg, shot, &control);
+        uint32_t n = 0;
+        while (n < cfg->steps) {
+            advance_plasma_state(&control.current_state, &control, cfg->dt);
+            const PlasmaState *s = &control.current_state;
+            stats->saturated += psq_sample_from_state(s, n, &samples[n]) != 0;
+            reference[n] = float_violations(s);
+            n++;
+            if (!isfinite(s->plasma_current) || !isfinite(s->vertical_position)) break;
+        }
+
+        // Bulk co-simulation: one sample per clock, then flush the pipeline
+        struct timespec start, end;
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        dut.reset(dut.ctx);
+        bool latch = false;
+        uint32_t expected = 0;
+        uint64_t cycles = (uint64_t)n + PSQ_CHECKER_STAGES;
+        for (uint64_t c = 0; c < cycles; c++) {
+            PsqVerdict out, ref;
+            dut.clock(dut.ctx, c < n ? &samples[c] : NULL, &out);
+            if (!out.valid) continue;
+            if (out.tag != expected || out.tag >= n) {
+                stats->lost++;
+                expected = out.tag + 1;
+                continue;
+            }
+            psq_checker_evaluate(limits, &samples[out.tag], &ref);
+            latch |= ref.violations != 0;
+            ref.tripped = latch;
+            uint64_t latency = c - out.tag + 1;
+            stats->max_latency = latency > stats->max_latency ? latency : stats->max_latency;
+            if (!verdict_equal(&out, &ref)) {
+                if (stats->mismatches < COSIM_REPORT_MISMATCHES) report_mismatch(shot, c, &out, &ref);
+                stats->mismatches++;
+            }
+            stats->float_disagreements += ref.violations != reference[out.tag];
+            stats->action[ref.action < 3 ? ref.action : 0]++;
+            stats->verdicts++;
+            expected++;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        stats->checker_seconds += seconds_between(&start, &end);
+        stats->lost += n - expected;
+        stats->trips += latch;
+        stats->cycles += cycles;
+        stats->shots++;
+    }
+
+#ifdef PSQ_COSIM_EXTERNAL_DUT
+    psq_external_dut_destroy(&dut);
+#endif
+    free(samples);
+    free(reference);
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [--shots N] [--steps N] [--dt S] [--seed N] [--threads N]\n"
+            "  --shots    trajectories (default 256)\n"
+            "  --steps    samples per trajectory (default 2000)\n"
+            "  --dt       physics time step (default 0.001 s)\n"
+            "  --seed     RNG seed for shot parameters and MHD noise (default 1)\n"
+            "  --threads  worker threads (default: all cores)\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    CosimConfig cfg = { .shots = 256, .steps = 2000, .dt = 0.001f, .seed = 1 };
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--shots") == 0) {
+            cfg.shots = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--steps") == 0) {
+            cfg.steps = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--dt") == 0) {
+            cfg.dt = strtof(argv[++i], NULL);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            cfg.seed = strtoull(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            cfg.num_threads = atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (cfg.steps == 0 || !(cfg.dt > 0.0f)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    PsqLimits limits;
+    psq_limits_default(&limits);
+    int num_threads = cfg.num_threads;
+#ifdef _OPENMP
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+#else
+    num_threads = 1;
+#endif
+    CosimStats *thread_stats = calloc((size_t)num_threads, sizeof(CosimStats));
+    if (!thread_stats) return 1;
+    _Atomic uint64_t next_shot;
+    atomic_init(&next_shot, 0);
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads) if(num_threads > 1)
+    cosim_worker(&cfg, &limits, &next_shot, &thread_stats[omp_get_thread_num()]);
+#else
+    cosim_worker(&cfg, &limits, &next_shot, &thread_stats[0]);
+#endif
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    CosimStats total = {0};
+    double checker_seconds_max = 0.0;
+    for (int t = 0; t < num_threads; t++) {
+        const CosimStats *s = &thread_stats[t];
+        total.shots += s->shots;
+        total.cycles += s->cycles;
+        total.verdicts += s->verdicts;
+        total.mismatches += s->mismatches;
+        total.lost += s->lost;
+        total.trips += s->trips;
+        total.saturated += s->saturated;
+        total.float_disagreements += s->float_disagreements;
+        for (int a = 0; a < 3; a++) total.action[a] += s->action[a];
+        total.max_latency = s->max_latency > total.max_latency ? s->max_latency : total.max_latency;
+        total.checker_seconds += s->checker_seconds;
+        if (s->checker_seconds > checker_seconds_max) checker_seconds_max = s->checker_seconds;
+    }
+    free(thread_stats);
+
+    double elapsed = seconds_between(&start, &end);
+    double latency_ns = (double)total.max_latency * 1000.0 / PSQ_CHECKER_CLOCK_MHZ;
+    bool pass = total.mismatches == 0 && total.lost == 0 && total.verdicts > 0 &&
+                latency_ns <= PSQ_CHECKER_LATENCY_BUDGET_NS;
+    fprintf(stderr, "%llu shots, %llu cycles on %d threads in %.3f s\n",
+            (unsigned long long)total.shots, (unsigned long long)total.cycles,
+            num_threads, elapsed);
+    fprintf(stderr, "  checker     %.1f Mcycles/s (%.1f per thread)\n",
+            checker_seconds_max > 0.0 ? total.cycles / checker_seconds_max * 1e-6 : 0.0,
+            total.checker_seconds > 0.0 ? total.cycles / total.checker_seconds * 1e-6 : 0.0);
+    fprintf(stderr, "  verdicts    %llu (none %llu, correct %llu, trip %llu), %llu shots tripped\n",
+            (unsigned long long)total.verdicts, (unsigned long long)total.action[PSQ_ACTION_NONE],
+            (unsigned long long)total.action[PSQ_ACTION_CORRECT],
+            (unsigned long long)total.action[PSQ_ACTION_TRIP], (unsigned long long)total.trips);
+    fprintf(stderr, "  mismatches  %llu, lost %llu\n",
+            (unsigned long long)total.mismatches, (unsigned long long)total.lost);
+    fprintf(stderr, "  latency     %llu cycles = %.1f ns at %d MHz (budget %d ns)\n",
+            (unsigned long long)total.max_latency, latency_ns, PSQ_CHECKER_CLOCK_MHZ,
+            PSQ_CHECKER_LATENCY_BUDGET_NS);
+    fprintf(stderr, "  quantizer   %llu samples saturated, %llu verdicts differ from float limits\n",
+            (unsigned long long)total.saturated,
+            (unsigned long long)total.float_disagreements);
+    fprintf(stderr, "%s\n", pass ? "PASS" : "FAIL");
+    return pass ? 0 : 1;
+}
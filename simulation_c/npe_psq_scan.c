@@ -0,0 +1,227 @@
+// NPE-PSQ parameter scan
+//
+// Runs a grid or Latin-hypercube scan of open-loop shots from a flat-top
+// base state through parameter_scan.h and streams one CSV summary row per
+// shot. Axes are named as in the CSV header; coil and heating axes take
+// the array index as a suffix (pf_coil_current_0, heating_power_2).
+//
+// With --surrogate the shots are screened for disruptions instead, one
+// learned horizon at a time (surrogate.h), falling back to the stepper
+// where the model is unsure.
+//
+// Build: gcc -O3 -fno-math-errno -fno-trapping-math -fopenmp -I..
+//            npe_psq_scan.c ../parameter_scan.c ../plasma_batch.c
+//            ../surrogate.c ../plasma_physics.c ../plasma_safety.c
+//            ../plasma_rng.c -lm -o npe_psq_scan
+// Run:   ./npe_psq_scan --axis fuel_injection_rate=0:2e21:64
+//                       --axis heating_power_0=0:20:64 --out scan.csv
+//        ./npe_psq_scan --lhs 100000 --axis density_core=2:20
+//                       --axis vertical_position=-0.02:0.02 --threads 8
+//        ./npe_psq_scan --lhs 1000000 --surrogate surrogate.bin
+//                       --axis density_core=2:20 --axis pf_coil_current_0=10:30
+
+#include "machine_geometry.h"
+#include "parameter_scan.h"
+#include "plasma_rng.h"
+#include "surrogate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// ================= BASE SHOT =================
+#define BASE_PLASMA_CURRENT 2.0f          // MA
+#define BASE_DENSITY_CORE 10.0f           // 1e19 m^-3
+#define BASE_STORED_ENERGY 1.0f           // MJ
+#define BASE_HEATING_POWER 0.4f           // MW per system
+#define BASE_VERTICAL_POSITION 0.01f      // m
+
+static void init_base(PlasmaControlSystem *control) {
+    memset(control, 0, sizeof(*control));
+    PlasmaState *s = &control->current_state;
+    s->plasma_current = BASE_PLASMA_CURRENT;
+    s->elongation = 1.7f;
+    s->triangularity = 0.33f;
+    s->li_inductance = PLASMA_LI_TARGET;
+    s->density_core = BASE_DENSITY_CORE;
+    s->density_edge = 3.0f;
+    s->temperature_core = 1.0f;
+    s->temperature_edge = 0.1f;
+    s->vertical_position = BASE_VERTICAL_POSITION;
+    control->target_state = *s;
+
+    // Loop voltage and fuelling that hold Ip and n_e at the base values
+    float plasma_volume = machine_plasma_volume(&machine_default, s->elongation);
+    control->pf_coil_currents[0] = BASE_PLASMA_CURRENT * 10.0f;
+    control->fuel_injection_rate = BASE_DENSITY_CORE * 1e19f * plasma_volume / 10.0f;
+    for (int i = 0; i < NUM_HEATING_SYSTEMS; i++) {
+        control->heating_systems[i].power = BASE_HEATING_POWER;
+        control->heating_systems[i].frequency = 170.0e9f;
+        control->heating_systems[i].enabled = true;
+    }
+    control->energy_confinement_time = ENERGY_CONFINEMENT_TIME;
+    control->stored_energy = BASE_STORED_ENERGY;
+}
+
+// NAME=MIN:MAX[:POINTS]
+static int parse_axis(const char *arg, ScanAxis *axis) {
+    memset(axis, 0, sizeof(*axis));
+    const char *eq = strchr(arg, '=');
+    if (!eq) return -1;
+    size_t len = (size_t)(eq - arg);
+    for (int p = 0; p < SCAN_PARAMETER_COUNT; p++) {
+        const char *name = scan_parameter_name((ScanParameter)p);
+        size_t n = strlen(name);
+        if (len < n || strncmp(arg, name, n) != 0) continue;
+        bool indexed = p == SCAN_HEATING_POWER || p == SCAN_PF_COIL_CURRENT;
+        if (indexed) {
+            if (len <= n + 1 || arg[n] != '_') continue;
+            axis->index = (uint32_t)strtoul(arg + n + 1, NULL, 10);
+        } else if (len != n) {
+            continue;
+        }
+        axis->parameter = (ScanParameter)p;
+        axis->points = 1;
+        int fields = sscanf(eq + 1, "%f:%f:%u", &axis->min, &axis->max, &axis->points);
+        return fields >= 2 ? 0 : -1;
+    }
+    return -1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s --axis NAME=MIN:MAX[:POINTS] ... [--lhs N] [--dt S] [--duration S]\n"
+            "          [--seed N] [--threads N] [--out CSV] [--surrogate MODEL]\n"
+            "          [--uncertainty U]\n"
+            "  --axis      scanned parameter, up to %d; POINTS for grid scans\n"
+            "  --lhs       Latin hypercube of N shots instead of a grid\n"
+            "  --dt        time step (default 0.001 s)\n"
+            "  --duration  shot length (default 5 s)\n"
+            "  --seed      RNG seed for hypercube draws and MHD noise (default 1)\n"
+            "  --threads   worker threads (default: all cores)\n"
+            "  --out       summary CSV (default stdout)\n"
+            "  --surrogate disruption screening with a model from ia/surrogate_train.py\n"
+            "  --uncertainty  surrogate uncertainty above which a horizon runs on\n"
+            "              the stepper (default %.2f)\n",
+            prog, SCAN_MAX_AXES, SURROGATE_UNCERTAINTY_DEFAULT);
+}
+
+static int screen(const Surrogate *model, const ParameterScan *scan,
+                  const PlasmaControlSystem *base, float uncertainty_max, FILE *out) {
+    SurrogateScreenStats stats;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int rc = surrogate_screen_run(model, scan, base, uncertainty_max, out, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (rc != 0) {
+        fprintf(stderr, "screening failed: duration / dt do not divide the %.4g s "
+                "horizon, or cannot allocate worker batches\n", model->horizon);
+        return 1;
+    }
+    double elapsed = (double)(end.tv_sec - start.tv_sec) +
+                     (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+    fprintf(stderr, "%llu shots, %llu horizons (%.2f%% on the stepper) in %.3f s "
+            "(%.1f Mshots/s)\n",
+            (unsigned long long)stats.shots, (unsigned long long)stats.horizons,
+            stats.horizons ? 100.0 * stats.fallbacks / stats.horizons : 0.0,
+            elapsed, stats.shots / elapsed * 1e-6);
+    fprintf(stderr, "  %-14s %llu\n", "flagged", (unsigned long long)stats.flagged);
+    for (int k = DISRUPTION_CAUSE_NONE + 1; k < DISRUPTION_CAUSE_COUNT; k++) {
+        fprintf(stderr, "    %-12s %llu\n", disruption_cause_name((DisruptionCause)k),
+                (unsigned long long)stats.flagged_cause[k]);
+    }
+    fprintf(stderr, "  %-14s %llu\n", "nonfinite", (unsigned long long)stats.nonfinite);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    ScanSpec spec = {
+        .mode = SCAN_GRID,
+        .seed = 1,
+        .dt = 0.001f,
+        .duration = 5.0f,
+        .num_threads = 0,
+    };
+    const char *out_path = NULL;
+    const char *surrogate_path = NULL;
+    float uncertainty_max = SURROGATE_UNCERTAINTY_DEFAULT;
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "--axis") == 0) {
+            if (spec.num_axes == SCAN_MAX_AXES ||
+                parse_axis(argv[++i], &spec.axes[spec.num_axes]) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            spec.num_axes++;
+        } else if (i + 1 < argc && strcmp(argv[i], "--lhs") == 0) {
+            spec.mode = SCAN_LATIN_HYPERCUBE;
+            spec.samples = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--dt") == 0) {
+            spec.dt = strtof(argv[++i], NULL);
+        } else if (i + 1 < argc && strcmp(argv[i], "--duration") == 0) {
+            spec.duration = strtof(argv[++i], NULL);
+        } else if (i + 1 < argc && strcmp(argv[i], "--seed") == 0) {
+            spec.seed = strtoull(argv[++i], NULL, 10);
+        } else if (i + 1 < argc && strcmp(argv[i], "--threads") == 0) {
+            spec.num_threads = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "--out") == 0) {
+            out_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--surrogate") == 0) {
+            surrogate_path = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "--uncertainty") == 0) {
+            uncertainty_max = strtof(argv[++i], NULL);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ParameterScan scan;
+    if (spec.num_axes == 0 || parameter_scan_init(&scan, &spec) != 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    static Surrogate model;
+    if (surrogate_path && surrogate_load(&model, surrogate_path) != 0) {
+        fprintf(stderr, "cannot load surrogate %s\n", surrogate_path);
+        parameter_scan_free(&scan);
+        return 1;
+    }
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot open %s\n", out_path);
+        parameter_scan_free(&scan);
+        return 1;
+    }
+
+    static PlasmaControlSystem base;
+    init_base(&base);
+    if (surrogate_path) {
+        int rc = screen(&model, &scan, &base, uncertainty_max, out);
+        if (out != stdout) fclose(out);
+        parameter_scan_free(&scan);
+        return rc;
+    }
+    ScanStats stats;
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int rc = parameter_scan_run(&scan, &base, out, &stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (out != stdout) fclose(out);
+
+    double elapsed = (double)(end.tv_sec - start.tv_sec) +
+                     (double)(end.tv_nsec - start.tv_nsec) * 1e-9;
+    fprintf(stderr, "%llu shots, %llu steps in %.3f s (%.1f Msteps/s)\n",
+            (unsigned long long)stats.shots, (unsigned long long)stats.steps,
+            elapsed, stats.steps / elapsed * 1e-6);
+    for (int l = 0; l < SCAN_LIMIT_COUNT; l++) {
+        fprintf(stderr, "  %-10s %llu\n", scan_limit_name((ScanLimit)l),
+                (unsigned long long)stats.limited[l]);
+    }
+    parameter_scan_free(&scan);
+    if (rc != 0) {
+        fprintf(stderr, "scan failed: cannot allocate worker batches\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "state_history.h"
+#include <stdlib.h>
+#include <string.h>
+
+StateHistory *state_history_create(uint32_t depth, uint32_t field_mask) {
+    if (depth < 2 || (depth & (depth - 1)) != 0) return NULL;
+    field_mask &= HISTORY_FIELDS_ALL;
+    if (field_mask == 0) return NULL;
+
+    StateHistory *history = aligned_alloc(HISTORY_CACHE_LINE,
+                                          sizeof(StateHistory));
+    if (!history) return NULL;
+    memset(history, 0, sizeof(*history));
+
+    for (uint32_t k = 0; k < HISTORY_STATE_FIELDS; k++) {
+        if (field_mask & (1u << k)) {
+            history->field_index[history->num_fields++] = (uint8_t)k;
+        }
+    }
+    history->depth = depth;
+    history->mask = depth - 1;
+    history->field_mask = field_mask;
+    history->record_floats = 1 + history->num_fields;
+
+    size_t bytes = (size_t)depth * history->record_floats * sizeof(float);
+    bytes = (bytes + HISTORY_CACHE_LINE - 1) / HISTORY_CACHE_LINE * HISTORY_CACHE_LINE;
+    history->records = aligned_alloc(HISTORY_CACHE_LINE, bytes);
+    if (!history->records) {
+        free(history);
+        return NULL;
+    }
+    // Touch every page now so the first pushes do not fault in the RT loop
+    memset(history->records, 0, bytes);
+
+    atomic_init(&history->head, 0);
+    atomic_init(&history->tail, 0);
+    return history;
+}
+
+void state_history_destroy(StateHistory *history) {
+    if (!history) return;
+    free(history->records);
+    free(history);
+}
+
+bool state_history_push(StateHistory *history, float time,
+                        const PlasmaState *state) {
+    uint64_t head = atomic_load_explicit(&history->head, memory_order_relaxed);
+    if (head - history->cached_tail >= history->depth) {
+        history->cached_tail = atomic_load_explicit(&history->tail,
+                                                    memory_order_acquire);
+        if (head - history->cached_tail >= history->depth) {
+            history->dropped++;
+            return false;
+        }
+    }
+
+    const float *fields = (const float *)state;
+    float *record = history->records + (head & history->mask) * history->record_floats;
+    record[0] = time;
+    for (uint32_t k = 0; k < history->num_fields; k++) {
+        record[1 + k] = fields[history->field_index[k]];
+    }
+    atomic_store_explicit(&history->head, head + 1, memory_order_release);
+    return true;
+}
+
+size_t state_history_pop(StateHistory *history, float *out, size_t max_records) {
+    uint64_t tail = atomic_load_explicit(&history->tail, memory_order_relaxed);
+    if (history->cached_head - tail < max_records) {
+        history->cached_head = atomic_load_explicit(&history->head,
+                                                    memory_order_acquire);
+    }
+    size_t available = (size_t)(history->cached_head - tail);
+    size_t n = available < max_records ? available : max_records;
+    const size_t stride = history->record_floats;
+
+    // At most two contiguous spans because of the wrap
+    size_t first = (size_t)(tail & history->mask);
+    size_t span = history->depth - first;
+    if (span > n) span = n;
+    memcpy(out, history->records + first * stride, span * stride * sizeof(float));
+    memcpy(out + span * stride, history->records,
+           (n - span) * stride * sizeof(float));
+
+    atomic_store_explicit(&history->tail, tail + n, memory_order_release);
+    return n;
+}
+
+size_t state_history_size(const StateHistory *history) {
+    uint64_t head = atomic_load_explicit(&history->head, memory_order_acquire);
+    uint64_t tail = atomic_load_explicit(&history->tail, memory_order_acquire);
+    return (size_t)(head - tail);
+}
@@ -0,0 +1,67 @@
+#ifndef STATE_HISTORY_H
+#define STATE_HISTORY_H
+
+#include "npe_config.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+// ================= STATE HISTORY RING =================
+// Single-producer / single-consumer ring of PlasmaState samples. The control
+// loop appends with state_history_push() and a logger or UI thread drains
+// with state_history_pop(); neither side takes a lock or waits on the other.
+//
+// Depth is a power of two. Each record is the simulation time followed by
+// the PlasmaState fields selected in field_mask (bit k = k-th float member
+// of PlasmaState, see HISTORY_FIELD_*). When the ring is full the new sample
+// is dropped and counted, so the producer never overwrites a record the
+// consumer may be reading.
+
+#define HISTORY_CACHE_LINE 64
+#define HISTORY_STATE_FIELDS (sizeof(PlasmaState) / sizeof(float))
+
+#define HISTORY_FIELD(member) (1u << (offsetof(PlasmaState, member) / sizeof(float)))
+#define HISTORY_FIELDS_ALL ((1u << HISTORY_STATE_FIELDS) - 1u)
+#define HISTORY_FIELDS_DEFAULT (HISTORY_FIELD(plasma_current) | \
+                                HISTORY_FIELD(safety_factor_q95) | \
+                                HISTORY_FIELD(beta_normalized) | \
+                                HISTORY_FIELD(radial_position) | \
+                                HISTORY_FIELD(vertical_position) | \
+                                HISTORY_FIELD(temperature_core) | \
+                                HISTORY_FIELD(density_core) | \
+                                HISTORY_FIELD(mhd_activity_level) | \
+                                HISTORY_FIELD(ntm_amplitude))
+
+typedef struct StateHistory {
+    // Producer side
+    _Alignas(HISTORY_CACHE_LINE) _Atomic uint64_t head;
+    uint64_t cached_tail;
+    uint64_t dropped;
+
+    // Consumer side
+    _Alignas(HISTORY_CACHE_LINE) _Atomic uint64_t tail;
+    uint64_t cached_head;
+
+    // Read-only after init
+    _Alignas(HISTORY_CACHE_LINE) uint64_t mask;
+    uint32_t depth;
+    uint32_t field_mask;
+    uint32_t num_fields;
+    uint32_t record_floats;             // 1 (time) + num_fields
+    uint8_t field_index[HISTORY_STATE_FIELDS];
+    float *records;
+} StateHistory;
+
+StateHistory *state_history_create(uint32_t depth, uint32_t field_mask);
+void state_history_destroy(StateHistory *history);
+
+// Producer. Returns false (and counts a drop) if the ring is full.
+bool state_history_push(StateHistory *history, float time,
+                        const PlasmaState *state);
+
+// Consumer. Copies up to max_records records into out (record_floats floats
+// each) and returns how many were copied.
+size_t state_history_pop(StateHistory *history, float *out, size_t max_records);
+
+size_t state_history_size(const StateHistory *history);
+
+#endif // STATE_HISTORY_H
@@ -0,0 +1,564 @@
+#include "surrogate.h"
+#include "machine_geometry.h"
+#include "plasma_batch.h"
+#include "plasma_physics.h"
+#include <float.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define I SURROGATE_INPUTS
+#define O SURROGATE_OUTPUTS
+#define F SURROGATE_FEATURES
+#define C SURROGATE_COLUMNS
+#define L SURROGATE_LANES
+
+// ================= MODEL =================
+int surrogate_load(Surrogate *model, const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    SurrogateHeader header;
+    Surrogate *loaded = aligned_alloc(SURROGATE_ALIGN, sizeof(Surrogate));
+    bool ok = loaded && fread(&header, sizeof(header), 1, f) == 1 &&
+              header.magic == SURROGATE_MAGIC &&
+              header.version == SURROGATE_VERSION &&
+              header.inputs == I && header.outputs == O &&
+              header.members == SURROGATE_MEMBERS && header.features == F &&
+              header.horizon > 0.0f &&
+              fread(loaded->input_center, sizeof(loaded->input_center), 1, f) == 1 &&
+              fread(loaded->input_scale, sizeof(loaded->input_scale), 1, f) == 1 &&
+              fread(loaded->output_scale, sizeof(loaded->output_scale), 1, f) == 1 &&
+              fread(loaded->weights, sizeof(loaded->weights), 1, f) == 1;
+    fclose(f);
+    for (int i = 0; ok && i < I; i++) {
+        ok = isfinite(loaded->input_center[i]) && loaded->input_scale[i] > 0.0f &&
+             isfinite(loaded->input_scale[i]);
+    }
+    for (int o = 0; ok && o < O; o++) {
+        ok = loaded->output_scale[o] > 0.0f && isfinite(loaded->output_scale[o]);
+    }
+    if (ok) {
+        loaded->horizon = header.horizon;
+        memcpy(model, loaded, sizeof(*loaded));
+    }
+    free(loaded);
+    return ok ? 0 : -1;
+}
+
+void surrogate_inputs(const PlasmaControlSystem *control, float *inputs) {
+    const PlasmaState *s = &control->current_state;
+    float vertical = 0.0f;
+    for (int c = 0; c < NUM_VERTICAL_COILS; c++) vertical += control->vertical_coil_currents[c];
+    float heating = 0.0f;
+    for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) {
+        if (control->heating_systems[h].enabled) heating += control->heating_systems[h].power;
+    }
+    inputs[SURROGATE_IN_PLASMA_CURRENT] = s->plasma_current;
+    inputs[SURROGATE_IN_VERTICAL_POSITION] = s->vertical_position;
+    inputs[SURROGATE_IN_DENSITY_CORE] = s->density_core;
+    inputs[SURROGATE_IN_STORED_ENERGY] = control->stored_energy;
+    inputs[SURROGATE_IN_ELONGATION] = s->elongation;
+    inputs[SURROGATE_IN_PF_COIL_0] = control->pf_coil_currents[0];
+    inputs[SURROGATE_IN_VERTICAL_COILS] = vertical;
+    inputs[SURROGATE_IN_HEATING_POWER] = heating;
+    inputs[SURROGATE_IN_FUEL_INJECTION_RATE] = control->fuel_injection_rate;
+    inputs[SURROGATE_IN_ENERGY_CONFINEMENT_TIME] = control->energy_confinement_time;
+}
+
+// Member mean into delta; returns the uncertainty of one point's columns,
+// column[c * stride], infinite for a point reaching outside the training
+// box. Inlined into lane loops, where stride = L makes every access
+// unit-stride across lanes.
+static inline float reduce_members(const Surrogate *model, const float *column,
+                                   uint32_t stride, float reach, float *delta,
+                                   uint32_t delta_stride) {
+    float spread2 = 0.0f;
+    for (int o = 0; o < O; o++) {
+        float mean = 0.0f;
+        for (int k = 0; k < SURROGATE_MEMBERS; k++) mean += column[(k * O + o) * stride];
+        mean *= 1.0f / SURROGATE_MEMBERS;
+        float var = 0.0f;
+        for (int k = 0; k < SURROGATE_MEMBERS; k++) {
+            float d = column[(k * O + o) * stride] - mean;
+            var += d * d;
+        }
+        float scale = model->output_scale[o];
+        float r = var / (scale * scale);
+        spread2 = r <= spread2 ? spread2 : r;
+        delta[o * delta_stride] = mean;
+    }
+    float uncertainty = SURROGATE_MEMBERS > 1 ?
+                        sqrtf(spread2 * (1.0f / (SURROGATE_MEMBERS - 1))) : 0.0f;
+    // NaN inputs reach here as NaN columns
+    return reach <= 1.0f + SURROGATE_DOMAIN_MARGIN && uncertainty <= FLT_MAX ?
+           uncertainty : INFINITY;
+}
+
+float surrogate_evaluate(const Surrogate *model, const float *inputs, float *delta) {
+    float x[I];
+    float phi[F];
+    float reach = 0.0f;
+    for (int i = 0; i < I; i++) {
+        x[i] = (inputs[i] - model->input_center[i]) * model->input_scale[i];
+        float a = fabsf(x[i]);
+        reach = a <= reach ? reach : a;
+    }
+    int f = 0;
+    phi[f++] = 1.0f;
+    for (int i = 0; i < I; i++) phi[f++] = x[i];
+    for (int i = 0; i < I; i++) {
+        for (int j = i; j < I; j++) phi[f++] = x[i] * x[j];
+    }
+    float column[C] = { 0 };
+    for (f = 0; f < F; f++) {
+        for (int c = 0; c < C; c++) column[c] += phi[f] * model->weights[f][c];
+    }
+    return reduce_members(model, column, 1, reach, delta, 1);
+}
+
+// Features of up to L points, lanes innermost, and each point's largest
+// |x_i|. Unused lanes are zero so the GEMM always runs full blocks.
+static void block_features(const Surrogate *model, const float *const *inputs,
+                           uint32_t base, uint32_t n, float (*restrict phi)[L],
+                           float *restrict reach) {
+    float (*restrict x)[L] = phi + 1;
+    for (uint32_t l = 0; l < L; l++) {
+        phi[0][l] = 1.0f;
+        reach[l] = 0.0f;
+    }
+    for (int i = 0; i < I; i++) {
+        const float *restrict in = inputs[i] + base;
+        float center = model->input_center[i];
+        float scale = model->input_scale[i];
+        for (uint32_t l = 0; l < n; l++) {
+            x[i][l] = (in[l] - center) * scale;
+            // Picks up a NaN, unlike fmaxf(), and if-converts
+            float a = fabsf(x[i][l]);
+            reach[l] = a <= reach[l] ? reach[l] : a;
+        }
+        for (uint32_t l = n; l < L; l++) x[i][l] = 0.0f;
+    }
+    float (*restrict q)[L] = x + I;
+    for (int i = 0; i < I; i++) {
+        for (int j = i; j < I; j++, q++) {
+            for (uint32_t l = 0; l < L; l++) (*q)[l] = x[i][l] * x[j][l];
+        }
+    }
+}
+
+// ================= KERNELS =================
+// acc[c][l] = sum_f weights[f][c] phi[f][l], lanes across the vector:
+// a column chunk's accumulators stay in registers and each weight is one
+// broadcast, GEMM_COLUMNS columns by one vector of lanes at a time.
+static void block_gemm(const Surrogate *model, const float (*restrict phi)[L],
+                       float (*restrict acc)[L]) {
+    int c0 = 0;
+#if defined(__AVX512F__)
+#define GEMM_COLUMNS 16
+    for (; c0 + GEMM_COLUMNS <= C; c0 += GEMM_COLUMNS) {
+        for (uint32_t l0 = 0; l0 < L; l0 += 16) {
+            __m512 a[GEMM_COLUMNS];
+            for (int c = 0; c < GEMM_COLUMNS; c++) a[c] = _mm512_setzero_ps();
+            for (int f = 0; f < F; f++) {
+                __m512 p = _mm512_load_ps(phi[f] + l0);
+                const float *w = &model->weights[f][c0];
+                for (int c = 0; c < GEMM_COLUMNS; c++) {
+                    a[c] = _mm512_fmadd_ps(_mm512_set1_ps(w[c]), p, a[c]);
+                }
+            }
+            for (int c = 0; c < GEMM_COLUMNS; c++) _mm512_store_ps(acc[c0 + c] + l0, a[c]);
+        }
+    }
+#elif defined(__AVX2__)
+#define GEMM_COLUMNS 8
+    for (; c0 + GEMM_COLUMNS <= C; c0 += GEMM_COLUMNS) {
+        for (uint32_t l0 = 0; l0 < L; l0 += 8) {
+            __m256 a[GEMM_COLUMNS];
+            for (int c = 0; c < GEMM_COLUMNS; c++) a[c] = _mm256_setzero_ps();
+            for (int f = 0; f < F; f++) {
+                __m256 p = _mm256_load_ps(phi[f] + l0);
+                const float *w = &model->weights[f][c0];
+                for (int c = 0; c < GEMM_COLUMNS; c++) {
+                    a[c] = _mm256_fmadd_ps(_mm256_set1_ps(w[c]), p, a[c]);
+                }
+            }
+            for (int c = 0; c < GEMM_COLUMNS; c++) _mm256_store_ps(acc[c0 + c] + l0, a[c]);
+        }
+    }
+#endif
+    for (; c0 < C; c0++) {
+        float sum[L] = { 0 };
+        for (int f = 0; f < F; f++) {
+            float w = model->weights[f][c0];
+            for (uint32_t l = 0; l < L; l++) sum[l] += w * phi[f][l];
+        }
+        memcpy(acc[c0], sum, sizeof(sum));
+    }
+}
+
+void surrogate_evaluate_batch(const Surrogate *model, const float *const *inputs,
+                              uint32_t count, float *const *delta,
+                              float *uncertainty) {
+    _Alignas(SURROGATE_ALIGN) float phi[F][L];
+    _Alignas(SURROGATE_ALIGN) float acc[C][L];
+    _Alignas(SURROGATE_ALIGN) float mean[O][L];
+    _Alignas(SURROGATE_ALIGN) float reach[L];
+    for (uint32_t base = 0; base < count; base += L) {
+        uint32_t n = count - base < L ? count - base : L;
+        block_features(model, inputs, base, n, phi, reach);
+        block_gemm(model, (const float (*)[L])phi, acc);
+        for (uint32_t l = 0; l < L; l++) {
+            reach[l] = reduce_members(model, &acc[0][0] + l, L, reach[l], &mean[0][0] + l, L);
+        }
+        for (uint32_t l = 0; l < n; l++) uncertainty[base + l] = reach[l];
+        for (int o = 0; o < O; o++) memcpy(delta[o] + base, mean[o], n * sizeof(float));
+    }
+}
+
+// ================= STATE UPDATE =================
+// The stepper's derived quantities after a surrogate horizon ending at
+// `time`, on machine_default as in plasma_batch.c
+static inline void apply_delta(const float *delta, float kappa, float time,
+                               float *Ip, float *z, float *ne, float *W,
+                               float *Te, float *q95, float *beta_N, float *mhd) {
+    *Ip += delta[SURROGATE_OUT_PLASMA_CURRENT];
+    *z += delta[SURROGATE_OUT_VERTICAL_POSITION];
+    *ne += delta[SURROGATE_OUT_DENSITY_CORE];
+    *W += delta[SURROGATE_OUT_STORED_ENERGY];
+
+    float plasma_volume = machine_plasma_volume(&machine_default, kappa);
+    *Te = *W * 1e6 / (1.5f * *ne * 1e19 * plasma_volume * ELECTRON_CHARGE * 1000.0f);
+    *q95 = machine_safety_factor(&machine_default, 0.95f, *Ip);
+    *beta_N = machine_beta_normalized(&machine_default, *Ip, *ne, *Te);
+
+    // Uniform noise at its mean, 0.05 * 0.5
+    float activity = 0.1f * sinf(time * 100.0f) + 0.025f;
+    if (*q95 < SAFETY_FACTOR_Q95_MIN) activity += 0.5f;
+    if (*beta_N > BETA_NORMAL_LIMIT) activity += 0.3f;
+    if (fabsf(*z) > VERTICAL_DISPLACEMENT_MAX) activity += 0.7f;
+    *mhd = activity;
+}
+
+int surrogate_advance(const Surrogate *model, PlasmaControlSystem *control,
+                      float uncertainty_max, float dt) {
+    float inputs[I];
+    float delta[O];
+    surrogate_inputs(control, inputs);
+    float uncertainty = surrogate_evaluate(model, inputs, delta);
+    PlasmaState *s = &control->current_state;
+    if (!(uncertainty <= uncertainty_max)) {
+        uint32_t steps = (uint32_t)(model->horizon / dt + 0.5f);
+        for (uint32_t k = 0; k < steps; k++) {
+            advance_plasma_state(s, control, dt);
+            control->simulation_time += dt;
+        }
+        return 1;
+    }
+    control->simulation_time += model->horizon;
+    apply_delta(delta, s->elongation, control->simulation_time,
+                &s->plasma_current, &s->vertical_position, &s->density_core,
+                &control->stored_energy, &s->temperature_core,
+                &s->safety_factor_q95, &s->beta_normalized, &s->mhd_activity_level);
+    return 0;
+}
+
+// ================= DISRUPTION SCREENING =================
+typedef struct {
+    const Surrogate *model;
+    const ParameterScan *scan;
+    const PlasmaControlSystem *base;
+    float uncertainty_max;
+    uint32_t horizons;              // per shot
+    uint32_t steps_per_horizon;     // of the stepper, at spec.dt
+    FILE *out;
+    _Atomic uint64_t next_block;
+    atomic_bool failed;
+} ScreenShared;
+
+typedef struct {
+    ScreenShared *shared;
+    PlasmaBatch batch;              // lane l holds shot block * L + l
+    PlasmaBatch fallback;
+    PlasmaControlSystem control[L]; // actuators of each lane's shot
+    DisruptionPredictor predictor[L];
+    float max_probability[L];
+    uint32_t fallbacks[L];
+    uint32_t active[L];
+    uint32_t stepper_lane[L];
+    _Alignas(SURROGATE_ALIGN) float input[I][L];
+    _Alignas(SURROGATE_ALIGN) float delta[O][L];
+    _Alignas(SURROGATE_ALIGN) float uncertainty[L];
+    char *rows;
+    size_t row_bytes;
+    SurrogateScreenStats stats;
+} ScreenWorker;
+
+static void flush_rows(ScreenWorker *w) {
+    if (w->row_bytes > 0) {
+        fwrite(w->rows, 1, w->row_bytes, w->shared->out);
+        w->row_bytes = 0;
+    }
+}
+
+static void finish_shot(ScreenWorker *w, uint64_t shot, uint32_t lane,
+                        const char *cause, float time_to_flag) {
+    const ParameterScan *scan = w->shared->scan;
+    float values[SCAN_MAX_AXES];
+    parameter_scan_point(scan, shot, values);
+
+    if (SURROGATE_FLUSH_BYTES - w->row_bytes < SURROGATE_ROW_MAX) flush_rows(w);
+    char *row = w->rows + w->row_bytes;
+    size_t room = SURROGATE_FLUSH_BYTES - w->row_bytes;
+    int n = snprintf(row, room, "%llu", (unsigned long long)shot);
+    for (uint32_t a = 0; a < scan->spec.num_axes; a++) {
+        n += snprintf(row + n, room - n, ",%.9g", values[a]);
+    }
+    n += snprintf(row + n, room - n, ",%s,%.9g,%.9g,%.9g,%.9g,%u\n", cause,
+                  time_to_flag, w->max_probability[lane],
+                  w->batch.plasma_current[lane], w->batch.stored_energy[lane],
+                  w->fallbacks[lane]);
+    w->row_bytes += (size_t)n;
+    w->stats.shots++;
+}
+
+// Runs the listed lanes through the stepper for one horizon
+static void stepper_horizon(ScreenWorker *w, uint32_t count) {
+    PlasmaBatch *b = &w->batch;
+    PlasmaBatch *fb = &w->fallback;
+    const float dt = w->shared->scan->spec.dt;
+    PlasmaControlSystem control;
+    for (uint32_t j = 0; j < count; j++) {
+        uint32_t l = w->stepper_lane[j];
+        control = w->control[l];
+        plasma_batch_store(b, l, &control.current_state, &control);
+        control.simulation_time = b->simulation_time[l];
+        plasma_batch_load(fb, j, &control.current_state, &control);
+    }
+    fb->count = count;
+    for (uint32_t k = 0; k < w->shared->steps_per_horizon; k++) {
+        advance_plasma_batch(fb, dt);
+        for (uint32_t j = 0; j < count; j++) fb->simulation_time[j] += dt;
+    }
+    for (uint32_t j = 0; j < count; j++) {
+        uint32_t l = w->stepper_lane[j];
+        control = w->control[l];
+        plasma_batch_store(fb, j, &control.current_state, &control);
+        control.simulation_time = fb->simulation_time[j];
+        plasma_batch_load(b, l, &control.current_state, &control);
+    }
+}
+
+static void gather_inputs(ScreenWorker *w, uint32_t count) {
+    const PlasmaBatch *b = &w->batch;
+    for (uint32_t j = 0; j < count; j++) {
+        uint32_t l = w->active[j];
+        float vertical = 0.0f;
+        for (int c = 0; c < NUM_VERTICAL_COILS; c++) vertical += b->vertical_coil_currents[c][l];
+        float heating = 0.0f;
+        for (int h = 0; h < NUM_HEATING_SYSTEMS; h++) heating += b->heating_power[h][l];
+        w->input[SURROGATE_IN_PLASMA_CURRENT][j] = b->plasma_current[l];
+        w->input[SURROGATE_IN_VERTICAL_POSITION][j] = b->vertical_position[l];
+        w->input[SURROGATE_IN_DENSITY_CORE][j] = b->density_core[l];
+        w->input[SURROGATE_IN_STORED_ENERGY][j] = b->stored_energy[l];
+        w->input[SURROGATE_IN_ELONGATION][j] = b->elongation[l];
+        w->input[SURROGATE_IN_PF_COIL_0][j] = b->pf_coil_currents[0][l];
+        w->input[SURROGATE_IN_VERTICAL_COILS][j] = vertical;
+        w->input[SURROGATE_IN_HEATING_POWER][j] = heating;
+        w->input[SURROGATE_IN_FUEL_INJECTION_RATE][j] = b->fuel_injection_rate[l];
+        w->input[SURROGATE_IN_ENERGY_CONFINEMENT_TIME][j] = b->energy_confinement_time[l];
+    }
+}
+
+static void screen_block(ScreenWorker *w, uint64_t first, uint32_t n) {
+    ScreenShared *shared = w->shared;
+    const Surrogate *model = shared->model;
+    const float horizon = model->horizon;
+    PlasmaBatch *b = &w->batch;
+    static const SafetyMitigationSystem clean_safety;
+
+    for (uint32_t l = 0; l < n; l++) {
+        parameter_scan_prepare(shared->scan, shared->base, first + l, &w->control[l]);
+        plasma_batch_load(b, l, &w->control[l].current_state, &w->control[l]);
+        disruption_predictor_init(&w->predictor[l]);
+        w->max_probability[l] = 0.0f;
+        w->fallbacks[l] = 0;
+        w->active[l] = l;
+    }
+    b->count = n;
+
+    const float *inputs[I];
+    float *delta[O];
+    for (int i = 0; i < I; i++) inputs[i] = w->input[i];
+    for (int o = 0; o < O; o++) delta[o] = w->delta[o];
+
+    uint32_t count = n;
+    for (uint32_t h = 0; h < shared->horizons && count > 0; h++) {
+        gather_inputs(w, count);
+        surrogate_evaluate_batch(model, inputs, count, delta, w->uncertainty);
+
+        uint32_t stepped = 0;
+        for (uint32_t j = 0; j < count; j++) {
+            uint32_t l = w->active[j];
+            if (!(w->uncertainty[j] <= shared->uncertainty_max)) {
+                w->stepper_lane[stepped++] = l;
+                w->fallbacks[l]++;
+                continue;
+            }
+            float d[O];
+            for (int o = 0; o < O; o++) d[o] = w->delta[o][j];
+            b->simulation_time[l] += horizon;
+            apply_delta(d, b->elongation[l], b->simulation_time[l],
+                        &b->plasma_current[l], &b->vertical_position[l],
+                        &b->density_core[l], &b->stored_energy[l],
+                        &b->temperature_core[l], &b->safety_factor_q95[l],
+                        &b->beta_normalized[l], &b->mhd_activity_level[l]);
+        }
+        if (stepped > 0) stepper_horizon(w, stepped);
+        w->stats.horizons += count;
+        w->stats.fallbacks += stepped;
+
+        float elapsed = (float)(h + 1) * horizon;
+        for (uint32_t j = 0; j < count; j++) {
+            uint32_t l = w->active[j];
+            PlasmaState state;
+            plasma_batch_store(b, l, &state, NULL);
+            bool finite = isfinite(state.plasma_current) &&
+                          isfinite(state.vertical_position) &&
+                          isfinite(b->stored_energy[l]);
+            DisruptionPrediction prediction = { 0 };
+            if (finite) {
+                predict_disruption(&w->predictor[l], &state, &clean_safety, horizon,
+                                   &prediction);
+                w->max_probability[l] = fmaxf(w->max_probability[l],
+                                              prediction.disruption_probability);
+            }
+            bool flagged = prediction.disruption_probability >=
+                           MITIGATION_TRIGGER_PROBABILITY;
+            if (finite && !flagged) continue;
+
+            if (finite) {
+                w->stats.flagged++;
+                w->stats.flagged_cause[prediction.most_likely_cause]++;
+            } else {
+                w->stats.nonfinite++;
+            }
+            finish_shot(w, first + l, l,
+                        finite ? disruption_cause_name(prediction.most_likely_cause)
+                               : "nonfinite", elapsed);
+            w->active[j--] = w->active[--count];
+        }
+    }
+    for (uint32_t j = 0; j < count; j++) {
+        uint32_t l = w->active[j];
+        finish_shot(w, first + l, l, disruption_cause_name(DISRUPTION_CAUSE_NONE), NAN);
+    }
+}
+
+static void screen_worker(ScreenShared *shared, SurrogateScreenStats *stats) {
+    ScreenWorker *w = aligned_alloc(SURROGATE_ALIGN, sizeof(*w));
+    char *rows = malloc(SURROGATE_FLUSH_BYTES);
+    if (w) memset(w, 0, sizeof(*w));
+    if (!w || !rows || plasma_batch_init(&w->batch, L) != 0 ||
+        plasma_batch_init(&w->fallback, L) != 0) {
+        atomic_store(&shared->failed, true);
+        if (w) {
+            plasma_batch_free(&w->batch);
+            plasma_batch_free(&w->fallback);
+        }
+        free(rows);
+        free(w);
+        return;
+    }
+    w->shared = shared;
+    w->rows = rows;
+
+    uint64_t total = shared->scan->shot_count;
+    for (;;) {
+        uint64_t block = atomic_fetch_add_explicit(&shared->next_block, 1,
+                                                   memory_order_relaxed);
+        uint64_t first = block * L;
+        if (first >= total) break;
+        screen_block(w, first, total - first < L ? (uint32_t)(total - first) : L);
+    }
+    flush_rows(w);
+    *stats = w->stats;
+    plasma_batch_free(&w->batch);
+    plasma_batch_free(&w->fallback);
+    free(rows);
+    free(w);
+}
+
+int surrogate_screen_run(const Surrogate *model, const ParameterScan *scan,
+                         const PlasmaControlSystem *base, float uncertainty_max,
+                         FILE *out, SurrogateScreenStats *stats) {
+    const ScanSpec *spec = &scan->spec;
+    float horizons = roundf(spec->duration / model->horizon);
+    float steps = roundf(model->horizon / spec->dt);
+    if (horizons < 1.0f || steps < 1.0f ||
+        fabsf(horizons * model->horizon - spec->duration) > 1e-3f * model->horizon ||
+        fabsf(steps * spec->dt - model->horizon) > 1e-3f * spec->dt) {
+        return -1;
+    }
+
+    fprintf(out, "shot");
+    for (uint32_t a = 0; a < spec->num_axes; a++) {
+        const ScanAxis *axis = &spec->axes[a];
+        if (axis->parameter == SCAN_HEATING_POWER ||
+            axis->parameter == SCAN_PF_COIL_CURRENT) {
+            fprintf(out, ",%s_%u", scan_parameter_name(axis->parameter), axis->index);
+        } else {
+            fprintf(out, ",%s", scan_parameter_name(axis->parameter));
+        }
+    }
+    fprintf(out, ",cause,time_to_flag,max_probability,final_Ip,final_W,fallbacks\n");
+
+    ScreenShared shared = {
+        .model = model, .scan = scan, .base = base,
+        .uncertainty_max = uncertainty_max,
+        .horizons = (uint32_t)horizons, .steps_per_horizon = (uint32_t)steps,
+        .out = out,
+    };
+    atomic_init(&shared.next_block, 0);
+    atomic_init(&shared.failed, false);
+
+    int num_threads = spec->num_threads;
+#ifdef _OPENMP
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+#else
+    num_threads = 1;
+#endif
+    SurrogateScreenStats *thread_stats = calloc((size_t)num_threads,
+                                                sizeof(SurrogateScreenStats));
+    if (!thread_stats) return -1;
+
+#ifdef _OPENMP
+    #pragma omp parallel num_threads(num_threads) if(num_threads > 1)
+    screen_worker(&shared, &thread_stats[omp_get_thread_num()]);
+#else
+    screen_worker(&shared, &thread_stats[0]);
+#endif
+
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+        for (int t = 0; t < num_threads; t++) {
+            const SurrogateScreenStats *s = &thread_stats[t];
+            stats->shots += s->shots;
+            stats->flagged += s->flagged;
+            stats->nonfinite += s->nonfinite;
+            stats->horizons += s->horizons;
+            stats->fallbacks += s->fallbacks;
+            for (int k = 0; k < DISRUPTION_CAUSE_COUNT; k++) {
+                stats->flagged_cause[k] += s->flagged_cause[k];
+            }
+        }
+    }
+    free(thread_stats);
+    fflush(out);
+    return atomic_load(&shared.failed) ? -1 : 0;
+}
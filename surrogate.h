@@ -0,0 +1,156 @@
+#ifndef SURROGATE_H
+#define SURROGATE_H
+
+#include "npe_config.h"
+#include "parameter_scan.h"
+#include "plasma_safety.h"
+#include <stdio.h>
+
+// ================= LEARNED ROLLOUT SURROGATE =================
+// Optional fast path for ensemble screening: one evaluation replaces
+// `horizon` seconds of advance_plasma_state() (10 ms by default, 10 to
+// 100 steps) with the actuators held fixed. Trained offline from binary
+// shot logs by ia/surrogate_train.py.
+//
+// Inputs are the evolving quantities and the actuators that drive them,
+// each mapped onto [-1, 1] over the training range:
+//   x = (input - input_center) * input_scale
+// Features are 1, x_i and every x_i x_j (i <= j, i outer), and each of
+// SURROGATE_MEMBERS ridge regressions, fitted on its own bootstrap
+// resample, maps them to the change of Ip, z, n_e and W over the horizon.
+// T_e, q95 and beta_N follow from those through the machine_geometry.h
+// kernels, as in the stepper, and the MHD activity takes its mean drive
+// (noise at its expectation) plus the stepper's limit increments.
+//
+// The prediction is the member mean; the uncertainty is the largest
+// member spread (sample standard deviation) over the output scales, the
+// training spread of each output. A point outside the training box by
+// more than SURROGATE_DOMAIN_MARGIN has infinite uncertainty. Callers send
+// anything above their threshold back to the full stepper.
+//
+// Evaluation is a GEMM: features for SURROGATE_LANES points at a time,
+// lanes innermost, times the SURROGATE_FEATURES x SURROGATE_COLUMNS
+// weight matrix, through AVX-512 or AVX2 kernels when the build enables
+// them (scalar otherwise). Build with -O3 -fno-math-errno
+// -fno-trapping-math, as for plasma_batch.c, so the lane loops vectorize.
+//
+// Blob (native-endian): SurrogateHeader, then float32 input_center[I],
+// input_scale[I], output_scale[O] and weights[F][K * O], row-major, the
+// column of member k and output o at k * O + o.
+
+#ifndef SURROGATE_MEMBERS
+#define SURROGATE_MEMBERS 4
+#endif
+#define SURROGATE_INPUTS 10
+#define SURROGATE_OUTPUTS 4
+#define SURROGATE_FEATURES (1 + SURROGATE_INPUTS + \
+                            SURROGATE_INPUTS * (SURROGATE_INPUTS + 1) / 2)
+#define SURROGATE_COLUMNS (SURROGATE_MEMBERS * SURROGATE_OUTPUTS)
+#define SURROGATE_LANES 64
+#define SURROGATE_ALIGN 64
+
+#define SURROGATE_MAGIC 0x4753504eu         // "NPSG"
+#define SURROGATE_VERSION 1
+#define SURROGATE_DOMAIN_MARGIN 0.1f        // of the half range
+#define SURROGATE_UNCERTAINTY_DEFAULT 0.05f
+#define SURROGATE_FLUSH_BYTES 65536
+#define SURROGATE_ROW_MAX 512
+
+typedef enum {
+    SURROGATE_IN_PLASMA_CURRENT,
+    SURROGATE_IN_VERTICAL_POSITION,
+    SURROGATE_IN_DENSITY_CORE,
+    SURROGATE_IN_STORED_ENERGY,
+    SURROGATE_IN_ELONGATION,
+    SURROGATE_IN_PF_COIL_0,
+    SURROGATE_IN_VERTICAL_COILS,            // sum of vertical_coil_currents
+    SURROGATE_IN_HEATING_POWER,             // enabled systems, MW
+    SURROGATE_IN_FUEL_INJECTION_RATE,
+    SURROGATE_IN_ENERGY_CONFINEMENT_TIME,
+} SurrogateInput;
+
+typedef enum {
+    SURROGATE_OUT_PLASMA_CURRENT,
+    SURROGATE_OUT_VERTICAL_POSITION,
+    SURROGATE_OUT_DENSITY_CORE,
+    SURROGATE_OUT_STORED_ENERGY,
+} SurrogateOutput;
+
+_Static_assert(SURROGATE_MEMBERS >= 1, "SURROGATE_MEMBERS must be positive");
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t inputs;
+    uint32_t outputs;
+    uint32_t members;
+    uint32_t features;
+    float horizon;                  // s
+    uint32_t reserved;
+} SurrogateHeader;
+
+typedef struct {
+    float horizon;                  // s
+    float input_center[SURROGATE_INPUTS];
+    float input_scale[SURROGATE_INPUTS];    // 1 / half range
+    float output_scale[SURROGATE_OUTPUTS];
+    _Alignas(SURROGATE_ALIGN) float weights[SURROGATE_FEATURES][SURROGATE_COLUMNS];
+} Surrogate;
+
+// Returns -1 on a missing file, a dimension mismatch with this build, or
+// non-positive scales or horizon
+int surrogate_load(Surrogate *model, const char *path);
+
+// Inputs of a shot, in SurrogateInput order
+void surrogate_inputs(const PlasmaControlSystem *control, float *inputs);
+
+// delta[SURROGATE_OUTPUTS] over the horizon; returns the uncertainty
+float surrogate_evaluate(const Surrogate *model, const float *inputs, float *delta);
+
+// Batched: inputs[i] and delta[o] are lane arrays of count entries
+void surrogate_evaluate_batch(const Surrogate *model, const float *const *inputs,
+                              uint32_t count, float *const *delta,
+                              float *uncertainty);
+
+// One horizon of control->current_state: the surrogate if its uncertainty
+// is at most uncertainty_max, otherwise horizon / dt steps of
+// advance_plasma_state(). Advances simulation_time either way. Returns 1
+// when it fell back to the stepper, 0 otherwise.
+int surrogate_advance(const Surrogate *model, PlasmaControlSystem *control,
+                      float uncertainty_max, float dt);
+
+// ================= DISRUPTION SCREENING =================
+// Runs every shot of a ParameterScan (its points, duration and dt) one
+// horizon at a time, SURROGATE_LANES shots per batch. Lanes whose
+// uncertainty exceeds uncertainty_max run that horizon through
+// advance_plasma_batch() at spec.dt instead; after each horizon
+// predict_disruption() (on a clean SafetyMitigationSystem, dt = horizon)
+// scores every live shot. A shot is flagged, and stops, once its
+// probability reaches MITIGATION_TRIGGER_PROBABILITY or its state is no
+// longer finite. spec.duration and the horizon must be whole multiples of
+// the horizon and of spec.dt, respectively.
+//
+// Rows stream to `out` as CSV in completion order:
+//   shot, <axes>, cause, time_to_flag, max_probability, final_Ip, final_W,
+//   fallbacks
+// cause is disruption_cause_name() of the flagging prediction ("none"
+// for shots that ran the full duration, "nonfinite" for a blown-up
+// state), time_to_flag nan for shots never flagged, and fallbacks the
+// horizons of the shot run on the stepper.
+
+typedef struct {
+    uint64_t shots;
+    uint64_t flagged;
+    uint64_t flagged_cause[DISRUPTION_CAUSE_COUNT];
+    uint64_t nonfinite;
+    uint64_t horizons;              // shot-horizons stepped
+    uint64_t fallbacks;             // of those, on the full stepper
+} SurrogateScreenStats;
+
+// Returns -1 if the durations do not divide or a worker could not
+// allocate. stats may be NULL. Threads as parameter_scan_run().
+int surrogate_screen_run(const Surrogate *model, const ParameterScan *scan,
+                         const PlasmaControlSystem *base, float uncertainty_max,
+                         FILE *out, SurrogateScreenStats *stats);
+
+#endif // SURROGATE_H
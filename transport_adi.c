@@ -0,0 +1,407 @@
+#include "transport_adi.h"
+#include <stdlib.h>
+#include <string.h>
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#define ADI_GRID_ARRAYS 13
+#define ADI_RING_ARRAYS 5
+
+// Sweeps running on several threads meet here between phases
+#ifdef _OPENMP
+#define ADI_BARRIER() _Pragma("omp barrier")
+#else
+#define ADI_BARRIER() ((void)0)
+#endif
+
+static uint32_t round_up_lanes(uint32_t n) {
+    return (n + ADI_LANE_BLOCK - 1) / ADI_LANE_BLOCK * ADI_LANE_BLOCK;
+}
+
+int adi_solver_init(AdiSolver *solver, const MachineGeometry *machine,
+                    uint32_t n_rho, uint32_t n_theta, int num_threads) {
+    memset(solver, 0, sizeof(*solver));
+    if (n_rho < ADI_MIN_RADIAL_POINTS || n_theta < ADI_MIN_POLOIDAL_POINTS) {
+        return -1;
+    }
+    uint32_t row_stride = round_up_lanes(n_theta);
+    uint32_t ring_stride = round_up_lanes(n_rho);
+    size_t grid = (size_t)n_rho * row_stride;
+    size_t rings = (size_t)n_theta * ring_stride;
+    size_t total = grid * ADI_GRID_ARRAYS + rings * ADI_RING_ARRAYS +
+                   row_stride + 3 * (size_t)ring_stride;
+    float *block = aligned_alloc(ADI_ALIGN, total * sizeof(float));
+    if (!block) return -1;
+    memset(block, 0, total * sizeof(float));
+
+    solver->n_rho = n_rho;
+    solver->n_theta = n_theta;
+    solver->row_stride = row_stride;
+    solver->ring_stride = ring_stride;
+    solver->major_radius = machine->major_radius;
+    solver->minor_radius = machine->minor_radius;
+    solver->num_threads = num_threads;
+    solver->block = block;
+
+    float **grid_arrays[ADI_GRID_ARRAYS] = {
+        &solver->value, &solver->source, &solver->chi_rho, &solver->chi_theta,
+        &solver->radial_lower, &solver->radial_upper,
+        &solver->poloidal_lower, &solver->poloidal_upper,
+        &solver->radial_subdiagonal, &solver->radial_pivot,
+        &solver->radial_inverse, &solver->rhs, &solver->work,
+    };
+    float **ring_arrays[ADI_RING_ARRAYS] = {
+        &solver->poloidal_subdiagonal, &solver->poloidal_pivot,
+        &solver->poloidal_inverse, &solver->poloidal_correction, &solver->ring,
+    };
+    float *p = block;
+    for (int k = 0; k < ADI_GRID_ARRAYS; k++, p += grid) *grid_arrays[k] = p;
+    for (int k = 0; k < ADI_RING_ARRAYS; k++, p += rings) *ring_arrays[k] = p;
+    solver->edge_value = p;
+    p += row_stride;
+    solver->poloidal_corner_ratio = p;
+    p += ring_stride;
+    solver->poloidal_correction_scale = p;
+    p += ring_stride;
+    solver->ring_weight = p;
+    return 0;
+}
+
+void adi_solver_free(AdiSolver *solver) {
+    free(solver->block);
+    memset(solver, 0, sizeof(*solver));
+}
+
+// ================= OPERATORS & FACTORIZATION =================
+
+static void build_operators(AdiSolver *s) {
+    const uint32_t nr = s->n_rho, nt = s->n_theta, rs = s->row_stride;
+    const double a = s->minor_radius, R0 = s->major_radius;
+    const double drho = 1.0 / nr, dtheta = 2.0 * M_PI / nt;
+    const double radial_scale = 1.0 / (a * a * drho * drho);
+    const double poloidal_scale = 1.0 / (a * a * dtheta * dtheta);
+
+    for (uint32_t i = 0; i < nr; i++) {
+        const double rho = (i + 0.5) * drho;
+        const float *chi_r = s->chi_rho + (size_t)i * rs;
+        const float *chi_t = s->chi_theta + (size_t)i * rs;
+        for (uint32_t j = 0; j < nt; j++) {
+            const double theta = j * dtheta;
+            const double R = R0 + a * rho * cos(theta);
+            const size_t ij = (size_t)i * rs + j;
+
+            // Radial faces at rho_i -+ drho/2; the axis face has no area and
+            // the edge face sits half a cell away from the boundary value.
+            double lower = 0.0, upper;
+            if (i > 0) {
+                double face = i * drho;
+                double chi = 0.5 * ((double)chi_r[j] + s->chi_rho[ij - rs]);
+                lower = chi * (R0 + a * face * cos(theta)) * face;
+            }
+            if (i + 1 < nr) {
+                double face = (i + 1) * drho;
+                double chi = 0.5 * ((double)chi_r[j] + s->chi_rho[ij + rs]);
+                upper = chi * (R0 + a * face * cos(theta)) * face;
+            } else {
+                upper = 2.0 * chi_r[j] * (R0 + a * cos(theta));
+            }
+            s->radial_lower[ij] = (float)(lower * radial_scale / (R * rho));
+            s->radial_upper[ij] = (float)(upper * radial_scale / (R * rho));
+
+            // Poloidal faces at theta_j -+ dtheta/2, periodic
+            uint32_t jm = j == 0 ? nt - 1 : j - 1;
+            uint32_t jp = j + 1 == nt ? 0 : j + 1;
+            double chi_m = 0.5 * ((double)chi_t[j] + chi_t[jm]);
+            double chi_p = 0.5 * ((double)chi_t[j] + chi_t[jp]);
+            double R_m = R0 + a * rho * cos(theta - 0.5 * dtheta);
+            double R_p = R0 + a * rho * cos(theta + 0.5 * dtheta);
+            double ring_scale = poloidal_scale / (R * rho * rho);
+            s->poloidal_lower[ij] = (float)(chi_m * R_m * ring_scale);
+            s->poloidal_upper[ij] = (float)(chi_p * R_p * ring_scale);
+        }
+    }
+}
+
+// (I - h L_rho) per poloidal angle: Thomas, factorized in place
+static void factorize_radial(AdiSolver *s, double h) {
+    const uint32_t nr = s->n_rho, nt = s->n_theta, rs = s->row_stride;
+    for (uint32_t j = 0; j < nt; j++) {
+        double pivot = 0.0;
+        for (uint32_t i = 0; i < nr; i++) {
+            size_t ij = (size_t)i * rs + j;
+            double lower = -h * s->radial_lower[ij];
+            double upper = i + 1 < nr ? -h * s->radial_upper[ij] : 0.0;
+            double diag = 1.0 + h * ((double)s->radial_lower[ij] +
+                                     s->radial_upper[ij]);
+            double inverse = 1.0 / (diag - lower * pivot);
+            pivot = upper * inverse;
+            s->radial_subdiagonal[ij] = (float)lower;
+            s->radial_inverse[ij] = (float)inverse;
+            s->radial_pivot[ij] = (float)pivot;
+        }
+    }
+}
+
+// (I - h L_theta) per radius: periodic, written as T + u v^T with T
+// tridiagonal, u = (gamma, 0, ..., 0, c_last), v = (1, 0, ..., 0,
+// a_first / gamma) and gamma = -b_first. T is factorized like the radial
+// system and z = T^-1 u kept for the Sherman-Morrison correction
+//   x = y - z (v.y) / (1 + v.z),  y = T^-1 d.
+static void factorize_poloidal(AdiSolver *s, double h) {
+    const uint32_t nr = s->n_rho, nt = s->n_theta;
+    const uint32_t rs = s->row_stride, ts = s->ring_stride;
+    for (uint32_t i = 0; i < nr; i++) {
+        const float *tl = s->poloidal_lower + (size_t)i * rs;
+        const float *tu = s->poloidal_upper + (size_t)i * rs;
+        double alpha = -h * tl[0];
+        double beta = -h * tu[nt - 1];
+        double gamma = -(1.0 + h * ((double)tl[0] + tu[0]));
+
+        double pivot = 0.0, z_prev = 0.0;
+        for (uint32_t j = 0; j < nt; j++) {
+            size_t ji = (size_t)j * ts + i;
+            double lower = j > 0 ? -h * tl[j] : 0.0;
+            double upper = j + 1 < nt ? -h * tu[j] : 0.0;
+            double diag = 1.0 + h * ((double)tl[j] + tu[j]);
+            if (j == 0) diag -= gamma;
+            if (j + 1 == nt) diag -= alpha * beta / gamma;
+            double inverse = 1.0 / (diag - lower * pivot);
+            pivot = upper * inverse;
+            s->poloidal_subdiagonal[ji] = (float)lower;
+            s->poloidal_inverse[ji] = (float)inverse;
+            s->poloidal_pivot[ji] = (float)pivot;
+
+            double u = j == 0 ? gamma : (j + 1 == nt ? beta : 0.0);
+            z_prev = (u - lower * z_prev) * inverse;
+            s->poloidal_correction[ji] = (float)z_prev;
+        }
+        // Back substitution for z, in double from the stored forward pass
+        double z_next = s->poloidal_correction[(size_t)(nt - 1) * ts + i];
+        for (uint32_t j = nt - 1; j-- > 0;) {
+            size_t ji = (size_t)j * ts + i;
+            z_next = s->poloidal_correction[ji] - s->poloidal_pivot[ji] * z_next;
+            s->poloidal_correction[ji] = (float)z_next;
+        }
+
+        double ratio = alpha / gamma;
+        double z_first = s->poloidal_correction[i];
+        double z_last = s->poloidal_correction[(size_t)(nt - 1) * ts + i];
+        s->poloidal_corner_ratio[i] = (float)ratio;
+        s->poloidal_correction_scale[i] =
+            (float)(1.0 / (1.0 + z_first + ratio * z_last));
+    }
+}
+
+int adi_solver_set_timestep(AdiSolver *solver, float dt) {
+    if (!(dt > 0.0f)) return -1;
+    build_operators(solver);
+    factorize_radial(solver, 0.5 * dt);
+    factorize_poloidal(solver, 0.5 * dt);
+    solver->dt = dt;
+    return 0;
+}
+
+// ================= INTERLEAVED KERNELS =================
+
+// Forward and back substitution of n factorized systems interleaved with
+// `stride`, lanes [begin, end) of each row, in place on x.
+static void thomas_substitute(const float *restrict subdiagonal,
+                              const float *restrict pivot,
+                              const float *restrict inverse,
+                              float *restrict x, uint32_t n, size_t stride,
+                              uint32_t begin, uint32_t end) {
+#pragma GCC ivdep
+    for (uint32_t l = begin; l < end; l++) x[l] *= inverse[l];
+    for (uint32_t k = 1; k < n; k++) {
+        const float *sub = subdiagonal + k * stride;
+        const float *inv = inverse + k * stride;
+        const float *prev = x + (k - 1) * stride;
+        float *row = x + k * stride;
+#pragma GCC ivdep
+        for (uint32_t l = begin; l < end; l++) {
+            row[l] = (row[l] - sub[l] * prev[l]) * inv[l];
+        }
+    }
+    for (uint32_t k = n - 1; k-- > 0;) {
+        const float *piv = pivot + k * stride;
+        const float *next = x + (k + 1) * stride;
+        float *row = x + k * stride;
+#pragma GCC ivdep
+        for (uint32_t l = begin; l < end; l++) {
+            row[l] -= piv[l] * next[l];
+        }
+    }
+}
+
+// Sherman-Morrison correction of the poloidal solve, rings [begin, end)
+static void cyclic_correct(AdiSolver *s, uint32_t begin, uint32_t end) {
+    const size_t ts = s->ring_stride;
+    const float *first = s->ring;
+    const float *last = s->ring + (size_t)(s->n_theta - 1) * ts;
+    float *weight = s->ring_weight;
+#pragma GCC ivdep
+    for (uint32_t l = begin; l < end; l++) {
+        weight[l] = (first[l] + s->poloidal_corner_ratio[l] * last[l]) *
+                    s->poloidal_correction_scale[l];
+    }
+    for (uint32_t k = 0; k < s->n_theta; k++) {
+        const float *z = s->poloidal_correction + k * ts;
+        float *row = s->ring + k * ts;
+#pragma GCC ivdep
+        for (uint32_t l = begin; l < end; l++) {
+            row[l] -= weight[l] * z[l];
+        }
+    }
+}
+
+// rhs = f + h L_theta f + h S (+ the edge term of the implicit radial
+// system), poloidal angles [begin, end)
+static void explicit_poloidal(AdiSolver *s, float h, uint32_t begin, uint32_t end) {
+    const uint32_t nt = s->n_theta;
+    const size_t rs = s->row_stride;
+    for (uint32_t i = 0; i < s->n_rho; i++) {
+        const float *f = s->value + i * rs;
+        const float *tl = s->poloidal_lower + i * rs;
+        const float *tu = s->poloidal_upper + i * rs;
+        const float *src = s->source + i * rs;
+        float *out = s->rhs + i * rs;
+        uint32_t lo = begin > 1 ? begin : 1;
+        uint32_t hi = end < nt - 1 ? end : nt - 1;
+#pragma GCC ivdep
+        for (uint32_t j = lo; j < hi; j++) {
+            out[j] = f[j] + h * (tl[j] * (f[j - 1] - f[j]) +
+                                 tu[j] * (f[j + 1] - f[j]) + src[j]);
+        }
+        // Wrap-around angles
+        if (begin == 0 && end > 0) {
+            out[0] = f[0] + h * (tl[0] * (f[nt - 1] - f[0]) +
+                                 tu[0] * (f[1] - f[0]) + src[0]);
+        }
+        if (end == nt && begin < end) {
+            uint32_t j = nt - 1;
+            out[j] = f[j] + h * (tl[j] * (f[j - 1] - f[j]) +
+                                 tu[j] * (f[0] - f[j]) + src[j]);
+        }
+    }
+    const float *ru = s->radial_upper + (size_t)(s->n_rho - 1) * rs;
+    float *out = s->rhs + (size_t)(s->n_rho - 1) * rs;
+#pragma GCC ivdep
+    for (uint32_t j = begin; j < end; j++) {
+        out[j] += h * ru[j] * s->edge_value[j];
+    }
+}
+
+// work = x + h L_rho x + h S for x = rhs, poloidal angles [begin, end)
+static void explicit_radial(AdiSolver *s, float h, uint32_t begin, uint32_t end) {
+    const uint32_t nr = s->n_rho;
+    const size_t rs = s->row_stride;
+    for (uint32_t i = 0; i < nr; i++) {
+        const float *x = s->rhs + i * rs;
+        // The axis row has no lower coupling; the edge row's upper
+        // neighbour is the boundary value
+        const float *below = i > 0 ? x - rs : x;
+        const float *above = i + 1 < nr ? x + rs : s->edge_value;
+        const float *rl = s->radial_lower + i * rs;
+        const float *ru = s->radial_upper + i * rs;
+        const float *src = s->source + i * rs;
+        float *out = s->work + i * rs;
+#pragma GCC ivdep
+        for (uint32_t j = begin; j < end; j++) {
+            out[j] = x[j] + h * (rl[j] * (below[j] - x[j]) +
+                                 ru[j] * (above[j] - x[j]) + src[j]);
+        }
+    }
+}
+
+// dst[c][r] = src[r][c] for rows [row_begin, row_end), columns
+// [col_begin, col_end), in ADI_LANE_BLOCK tiles
+static void transpose(const float *restrict src, size_t src_stride,
+                      float *restrict dst, size_t dst_stride,
+                      uint32_t row_begin, uint32_t row_end,
+                      uint32_t col_begin, uint32_t col_end) {
+    for (uint32_t r0 = row_begin; r0 < row_end; r0 += ADI_LANE_BLOCK) {
+        uint32_t r1 = r0 + ADI_LANE_BLOCK < row_end ? r0 + ADI_LANE_BLOCK : row_end;
+        for (uint32_t c0 = col_begin; c0 < col_end; c0 += ADI_LANE_BLOCK) {
+            uint32_t c1 = c0 + ADI_LANE_BLOCK < col_end ? c0 + ADI_LANE_BLOCK : col_end;
+            for (uint32_t c = c0; c < c1; c++) {
+                for (uint32_t r = r0; r < r1; r++) {
+                    dst[c * dst_stride + r] = src[r * src_stride + c];
+                }
+            }
+        }
+    }
+}
+
+// ================= TIME STEPPING =================
+
+// Lanes [begin, end) of part `part` of `parts`, whole ADI_LANE_BLOCKs
+// each so threads never share a cache line
+static void lane_range(uint32_t lanes, int part, int parts,
+                       uint32_t *begin, uint32_t *end) {
+    uint32_t blocks = (lanes + ADI_LANE_BLOCK - 1) / ADI_LANE_BLOCK;
+    uint32_t per_part = blocks / parts, extra = blocks % parts;
+    uint32_t p = (uint32_t)part;
+    uint32_t first = p * per_part + (p < extra ? p : extra);
+    uint32_t count = per_part + (p < extra ? 1 : 0);
+    uint32_t b = first * ADI_LANE_BLOCK;
+    uint32_t e = (first + count) * ADI_LANE_BLOCK;
+    *begin = b < lanes ? b : lanes;
+    *end = e < lanes ? e : lanes;
+}
+
+static void adi_run(AdiSolver *s, int part, int parts, uint32_t num_steps) {
+    const float h = 0.5f * s->dt;
+    uint32_t angle_begin, angle_end, ring_begin, ring_end;
+    lane_range(s->n_theta, part, parts, &angle_begin, &angle_end);
+    lane_range(s->n_rho, part, parts, &ring_begin, &ring_end);
+
+    for (uint32_t step = 0; step < num_steps; step++) {
+        // Radial half-step, lanes = poloidal angles
+        explicit_poloidal(s, h, angle_begin, angle_end);
+        thomas_substitute(s->radial_subdiagonal, s->radial_pivot,
+                          s->radial_inverse, s->rhs, s->n_rho, s->row_stride,
+                          angle_begin, angle_end);
+        explicit_radial(s, h, angle_begin, angle_end);
+        ADI_BARRIER();
+
+        // Poloidal half-step, lanes = radii
+        transpose(s->work, s->row_stride, s->ring, s->ring_stride,
+                  ring_begin, ring_end, 0, s->n_theta);
+        thomas_substitute(s->poloidal_subdiagonal, s->poloidal_pivot,
+                          s->poloidal_inverse, s->ring, s->n_theta,
+                          s->ring_stride, ring_begin, ring_end);
+        cyclic_correct(s, ring_begin, ring_end);
+        transpose(s->ring, s->ring_stride, s->value, s->row_stride,
+                  0, s->n_theta, ring_begin, ring_end);
+        ADI_BARRIER();
+    }
+}
+
+void adi_solver_step(AdiSolver *solver, uint32_t num_steps) {
+    if (solver->dt <= 0.0f || num_steps == 0) return;
+#ifdef _OPENMP
+    int num_threads = solver->num_threads;
+    if (num_threads <= 0) num_threads = omp_get_max_threads();
+    #pragma omp parallel num_threads(num_threads) if(num_threads > 1)
+    adi_run(solver, omp_get_thread_num(), omp_get_num_threads(), num_steps);
+#else
+    adi_run(solver, 0, 1, num_steps);
+#endif
+}
+
+double adi_solver_volume_integral(const AdiSolver *solver, const float *field) {
+    const double a = solver->minor_radius, R0 = solver->major_radius;
+    const double drho = 1.0 / solver->n_rho;
+    const double dtheta = 2.0 * M_PI / solver->n_theta;
+    double total = 0.0;
+    for (uint32_t i = 0; i < solver->n_rho; i++) {
+        double rho = (i + 0.5) * drho;
+        const float *f = field + (size_t)i * solver->row_stride;
+        for (uint32_t j = 0; j < solver->n_theta; j++) {
+            double R = R0 + a * rho * cos(j * dtheta);
+            total += f[j] * R * a * a * rho;
+        }
+    }
+    return total * 2.0 * M_PI * drho * dtheta;
+}
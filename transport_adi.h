@@ -0,0 +1,108 @@
+#ifndef TRANSPORT_ADI_H
+#define TRANSPORT_ADI_H
+
+#include "npe_config.h"
+#include "machine_geometry.h"
+
+// ================= 2D ADI TRANSPORT SOLVER =================
+// Peaceman-Rachford ADI for a diffusing field f(rho, theta),
+//   df/dt = L_rho f + L_theta f + S,
+// on a circular cross-section of major radius R0 and minor radius a:
+//   (I - dt/2 L_rho)   f*      = (I + dt/2 L_theta) f^n + dt/2 S
+//   (I - dt/2 L_theta) f^n+1   = (I + dt/2 L_rho)   f*  + dt/2 S
+// The first half-step is one Thomas solve per poloidal angle (radial
+// lines), the second one cyclic Thomas solve per radius (poloidal rings,
+// periodic, closed with Sherman-Morrison).
+//
+// Grid: cell-centred, rho_i = (i + 1/2) / n_rho and theta_j = 2 pi j / n_theta.
+// The operators are finite volumes in toroidal geometry, dV = 2 pi R J
+// drho dtheta with R = R0 + a rho cos(theta) and J = a^2 rho, so
+// adi_solver_volume_integral() of f changes only by the source and the
+// flux through the edge. Boundaries as in the 2D simulator: zero flux at
+// the axis (symmetry) and f = edge_value[j] at rho = 1 (Dirichlet).
+// Elongation and triangularity are not modelled.
+//
+// Every tridiagonal solve is interleaved: element k of system s lives at
+// [k * stride + s], so one recurrence step advances all systems at once
+// and the lane loop vectorizes. Fields are kept [rho][theta] (theta
+// contiguous) for the radial sweep and transposed to [theta][rho] for the
+// poloidal one. Both systems are constant for a given dt and diffusivity,
+// so adi_solver_set_timestep() factorizes them once and a step is forward
+// and back substitution only.
+//
+// With -fopenmp the lanes of each sweep are split across num_threads
+// threads in ADI_LANE_BLOCK-float blocks (num_threads <= 0 uses the OpenMP
+// default, 1 runs serially). Build with -O3 -fno-math-errno
+// -fno-trapping-math.
+
+#define ADI_ALIGN 64
+#define ADI_LANE_BLOCK (ADI_ALIGN / sizeof(float))
+#define ADI_MIN_RADIAL_POINTS 2
+#define ADI_MIN_POLOIDAL_POINTS 3
+
+typedef struct {
+    uint32_t n_rho;
+    uint32_t n_theta;
+    uint32_t row_stride;            // floats per rho row ([rho][theta] arrays)
+    uint32_t ring_stride;           // floats per theta row ([theta][rho] scratch)
+    float major_radius;             // m
+    float minor_radius;             // m
+    float dt;                       // s, of the current factorization
+    int num_threads;
+
+    // Caller-owned fields, [rho][theta]: f[i * row_stride + j]
+    float *value;                   // f
+    float *source;                  // S, units of f per second
+    float *chi_rho;                 // radial diffusivity, m^2/s
+    float *chi_theta;               // poloidal diffusivity, m^2/s
+    float *edge_value;              // f at rho = 1, [theta]
+
+    // Operators, [rho][theta], 1/s
+    float *radial_lower;
+    float *radial_upper;
+    float *poloidal_lower;
+    float *poloidal_upper;
+
+    // Radial factorization, [rho][theta]
+    float *radial_subdiagonal;
+    float *radial_pivot;
+    float *radial_inverse;
+
+    // Poloidal factorization, [theta][rho], and per-ring Sherman-Morrison terms
+    float *poloidal_subdiagonal;
+    float *poloidal_pivot;
+    float *poloidal_inverse;
+    float *poloidal_correction;
+    float *poloidal_corner_ratio;   // [rho]
+    float *poloidal_correction_scale;
+
+    // Scratch
+    float *rhs;                     // [rho][theta]
+    float *work;                    // [rho][theta]
+    float *ring;                    // [theta][rho]
+    float *ring_weight;             // [rho]
+
+    void *block;
+} AdiSolver;
+
+// Allocates a solver for an n_rho x n_theta grid on `machine`. All fields
+// start at zero. Returns 0 on success, -1 on a too small grid or failed
+// allocation.
+int adi_solver_init(AdiSolver *solver, const MachineGeometry *machine,
+                    uint32_t n_rho, uint32_t n_theta, int num_threads);
+void adi_solver_free(AdiSolver *solver);
+
+// Builds the operators from chi_rho / chi_theta and factorizes both
+// sweeps for time step dt. Call again after changing dt or a diffusivity.
+// Returns -1 if dt is not positive.
+int adi_solver_set_timestep(AdiSolver *solver, float dt);
+
+// Advances value by num_steps steps of the factorized dt; does nothing
+// before the first adi_solver_set_timestep().
+void adi_solver_step(AdiSolver *solver, uint32_t num_steps);
+
+// Integral of a [rho][theta] field over the plasma volume,
+// sum f 2 pi R J drho dtheta (e.g. energy from an energy density).
+double adi_solver_volume_integral(const AdiSolver *solver, const float *field);
+
+#endif // TRANSPORT_ADI_H